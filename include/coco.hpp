@@ -1,10 +1,15 @@
 #pragma once
 
 #include "json.hpp"
+#include "coco_aggregate.hpp"
+#include "coco_index.hpp"
 #include "clips.h"
 #include <chrono>
 #include <optional>
+#include <functional>
 #include <unordered_map>
+#include <set>
+#include <list>
 #include <memory>
 #include <mutex>
 #include <random>
@@ -29,10 +34,41 @@ namespace coco
   class property_type;
   class property;
   class rule;
+  class schema_validator;
+  class vector_buffer;
 #ifdef BUILD_LISTENERS
   class listener;
 #endif
 
+  /**
+   * @brief The specification of an item to be created in bulk.
+   */
+  struct item_spec
+  {
+    std::string name;                                                                   // The name through which the other items of the batch can reference the item, as `{"item": name}` static property values, if any..
+    std::vector<std::reference_wrapper<type>> types;                                    // The types of the item..
+    json::json props;                                                                   // The static properties of the item..
+    std::optional<std::pair<json::json, std::chrono::system_clock::time_point>> value; // The initial value of the item, if any..
+  };
+
+  /**
+   * @brief How the values older than the current value of an item are handled.
+   */
+  enum class late_policy : uint8_t
+  {
+    apply, // The late value replaces the current value of the item, as any other value..
+    store, // The late value is only stored in the history of the item, leaving its current value, its facts and the listeners untouched..
+    reject // The late value is discarded..
+  };
+
+  /**
+   * @brief The number of values which arrived later than the current value of an item, by how they have been handled.
+   */
+  struct late_stats
+  {
+    size_t applied = 0, stored = 0, rejected = 0;
+  };
+
   class coco
   {
     friend class coco_module;
@@ -83,6 +119,16 @@ namespace coco
       throw std::runtime_error("Module not found");
     }
 
+    /**
+     * @brief Sets a JSON schema, which the schemas of the `json` properties can reference.
+     *
+     * The compiled validators are discarded, so that they are recompiled against the new schemas.
+     *
+     * @param name The name of the schema.
+     * @param schema The schema.
+     */
+    void set_schema(std::string_view name, json::json &&schema) noexcept;
+
     /**
      * @brief Returns a vector of references to the types.
      *
@@ -102,7 +148,18 @@ namespace coco
      * @throws std::invalid_argument if the type does not exist.
      */
     [[nodiscard]] type &get_type(std::string_view name);
-    [[nodiscard]] type &create_type(std::string_view name, json::json &&static_props, json::json &&dynamic_props, json::json &&data = json::json(), bool infere = true) noexcept;
+    /**
+     * @brief Creates a new type.
+     *
+     * @param name The name of the type.
+     * @param static_props The static properties of the type.
+     * @param dynamic_props The dynamic properties of the type.
+     * @param data The data of the type, including the settings applied to its items, such as the `late` policy.
+     * @param infere Whether to run inference after the creation.
+     * @return A reference to the new type.
+     * @throws std::invalid_argument if the settings within the data are not valid.
+     */
+    [[nodiscard]] type &create_type(std::string_view name, json::json &&static_props, json::json &&dynamic_props, json::json &&data = json::json(), bool infere = true);
     void delete_type(type &tp, bool infere = true) noexcept;
 
     /**
@@ -123,6 +180,42 @@ namespace coco
      * @return A vector of references to the items of the specified type.
      */
     [[nodiscard]] std::vector<std::reference_wrapper<item>> get_items(const type &tp) noexcept;
+    /**
+     * @brief Retrieves the items of a specific type whose properties satisfy all the given filters.
+     *
+     * The candidates are taken from the most selective secondary index among those of the filtered properties, and checked against the remaining filters, so that the query is sublinear whenever at least one filter can be answered by an index. The instances of the type are scanned otherwise. Dynamic properties are filtered on their current value.
+     *
+     * @param tp The type of the items to retrieve.
+     * @param filters The filters, all of which must be satisfied.
+     * @return A vector of references to the matching items.
+     */
+    [[nodiscard]] std::vector<std::reference_wrapper<item>> find_items(const type &tp, const std::vector<item_filter> &filters) noexcept;
+    /**
+     * @brief Retrieves the items, of any type, whose properties satisfy all the given filters.
+     *
+     * @param filters The filters, all of which must be satisfied.
+     * @return A vector of references to the matching items.
+     */
+    [[nodiscard]] std::vector<std::reference_wrapper<item>> find_items(const std::vector<item_filter> &filters) noexcept;
+    /**
+     * @brief Searches the items of a specific type whose searchable static properties contain all the tokens of a text, ranked by relevance.
+     *
+     * Each token of the text matches the tokens of the property values it is a prefix of, so that partially typed words are found as well. The candidates are taken from the full-text indexes of the type and checked against the filters.
+     *
+     * @param tp The type of the items to search.
+     * @param text The text to search.
+     * @param filters The filters, all of which must be satisfied.
+     * @return The matching items with their relevance, the most relevant first.
+     */
+    [[nodiscard]] std::vector<std::pair<std::reference_wrapper<item>, double>> search_items(const type &tp, std::string_view text, const std::vector<item_filter> &filters = {}) noexcept;
+    /**
+     * @brief Searches the items, of any type, whose searchable static properties contain all the tokens of a text, ranked by relevance.
+     *
+     * @param text The text to search.
+     * @param filters The filters, all of which must be satisfied.
+     * @return The matching items with their relevance, the most relevant first.
+     */
+    [[nodiscard]] std::vector<std::pair<std::reference_wrapper<item>, double>> search_items(std::string_view text, const std::vector<item_filter> &filters = {}) noexcept;
 
     /**
      * @brief Retrieves an item with the specified ID.
@@ -146,6 +239,17 @@ namespace coco
      * @return A reference to the newly created item.
      */
     [[nodiscard]] item &create_item(std::vector<std::reference_wrapper<type>> &&tps = {}, json::json &&props = json::json(), std::optional<std::pair<json::json, std::chrono::system_clock::time_point>> &&val = std::nullopt, bool infere = true) noexcept;
+    /**
+     * @brief Creates several items at once.
+     *
+     * The items are persisted with a single bulk insert, their facts are asserted in a single pass and the inference, if requested, runs once. The items of the batch can reference each other by name, the referenced items being created first whenever the references are not circular.
+     *
+     * @param specs The specifications of the items.
+     * @param infere Whether to run inference after creating the items.
+     * @return The created items, in the order of their specifications.
+     * @throws std::invalid_argument if a name is used more than once, a referenced name is not in the batch, a property or value is not valid for the types of its item or the items could not be persisted, in which case none of them is created.
+     */
+    [[nodiscard]] std::vector<std::reference_wrapper<item>> create_items(std::vector<item_spec> &&specs, bool infere = true);
     /**
      * @brief Sets the properties of an item.
      *
@@ -156,6 +260,17 @@ namespace coco
      * @param infere Whether to run inference after setting the properties.
      */
     void set_properties(item &itm, json::json &&props, bool infere = true) noexcept;
+    /**
+     * @brief Applies a JSON patch to the static properties of an item.
+     *
+     * The paths of the patch are relative to the properties of the item, so that their first token is the name of a static property. Only the changed parts are validated and persisted: an element appended to a multiple property is validated on its own and pushed into the stored array.
+     *
+     * @param itm The item to update.
+     * @param patch The JSON patch, possibly using the `append`, `remove_at` and `set_path` shorthands.
+     * @param infere Whether to run inference after patching the properties.
+     * @throws std::invalid_argument if the patch is malformed, cannot be applied, targets a property which is not a static property of the item or produces invalid values.
+     */
+    void patch_properties(item &itm, const json::json &patch, bool infere = true);
     /**
      * @brief Retrieves the values of an item within a specified time range.
      *
@@ -167,6 +282,81 @@ namespace coco
      * @return A JSON object containing the values of the item within the specified time range.
      */
     [[nodiscard]] json::json get_values(const item &itm, const std::chrono::system_clock::time_point &from, const std::chrono::system_clock::time_point &to = std::chrono::system_clock::now());
+    /**
+     * @brief Retrieves a page of the values of an item within a specified time range.
+     *
+     * This function streams the values of the specified item, in timestamp order, as the database cursor advances. The lock of the CoCo object is released before the database is queried, so that large ranges do not block other requests.
+     *
+     * @param itm The item whose values are to be retrieved.
+     * @param fields The dynamic properties to retrieve, all of them if empty.
+     * @param from The start time of the range.
+     * @param to The end time of the range.
+     * @param limit The maximum number of values to retrieve.
+     * @param cb The callback invoked for each value as a `{"data": ..., "timestamp": ...}` object.
+     * @param token The continuation token returned by the previous page, if any.
+     * @return The continuation token of the next page, if there are more values within the range.
+     * @throws std::invalid_argument if the limit is zero, the token is not valid or a field is not a dynamic property of the item.
+     */
+    [[nodiscard]] std::optional<std::string> get_values(const item &itm, const std::vector<std::string> &fields, const std::chrono::system_clock::time_point &from, const std::chrono::system_clock::time_point &to, size_t limit, const std::function<void(json::json &&)> &cb, std::string_view token = "");
+    /**
+     * @brief Retrieves the values of several items within a specified time range.
+     *
+     * The items whose recent history covers the range are answered from memory, while all the others are retrieved with a single database query issued after the lock of the CoCo object is released. The values are streamed grouped per item.
+     *
+     * @param itm_ids The IDs of the items whose values are to be retrieved.
+     * @param fields The dynamic properties to retrieve, all of them if empty.
+     * @param from The start time of the range.
+     * @param to The end time of the range.
+     * @param cb The callback invoked, for each item in turn and in timestamp order, with the ID of the item and the value as a `{"data": ..., "timestamp": ...}` object.
+     * @throws std::invalid_argument if an item does not exist or a field is not a dynamic property of any of the items.
+     */
+    void get_values(const std::vector<std::string> &itm_ids, const std::vector<std::string> &fields, const std::chrono::system_clock::time_point &from, const std::chrono::system_clock::time_point &to, const std::function<void(const std::string &, json::json &&)> &cb);
+    /**
+     * @brief Retrieves the values of the instances of a type whose static properties match a filter within a specified time range.
+     *
+     * @param tp The type whose instances' values are to be retrieved.
+     * @param filter The JSON object mapping static properties to the values the instances must have.
+     * @param fields The dynamic properties to retrieve, all of them if empty.
+     * @param from The start time of the range.
+     * @param to The end time of the range.
+     * @param cb The callback invoked, for each item in turn and in timestamp order, with the ID of the item and the value as a `{"data": ..., "timestamp": ...}` object.
+     * @throws std::invalid_argument if the filter refers to a property which is not a static property of the type or a field is not a dynamic property of any of the instances.
+     */
+    void get_values(const type &tp, const json::json &filter, const std::vector<std::string> &fields, const std::chrono::system_clock::time_point &from, const std::chrono::system_clock::time_point &to, const std::function<void(const std::string &, json::json &&)> &cb);
+    /**
+     * @brief Retrieves the rollups of the numeric values of an item within a specified time range.
+     *
+     * This function retrieves the `count`, `sum`, `min`, `max` and `last` aggregates of the numeric dynamic properties of the specified item, maintained at write time for each bucket of the given resolution.
+     *
+     * @param itm The item whose rollups are to be retrieved.
+     * @param resolution The resolution of the rollups.
+     * @param from The start time of the range.
+     * @param to The end time of the range.
+     * @return A JSON array containing the non empty buckets within the specified time range.
+     * @throws std::invalid_argument if the resolution is not one of the rollup resolutions of the database.
+     */
+    [[nodiscard]] json::json get_values(const item &itm, const std::chrono::seconds &resolution, const std::chrono::system_clock::time_point &from, const std::chrono::system_clock::time_point &to = std::chrono::system_clock::now());
+    /**
+     * @brief Aggregates the values of an item within a specified time range.
+     *
+     * This function streams the values of the specified item from the database through a single-pass aggregator, so that the raw series is never materialized, and returns the aggregate of each bucket.
+     *
+     * @param itm The item whose values are to be aggregated.
+     * @param agg The aggregation, that is, the aggregate function, the bucket width and the dynamic properties to project on.
+     * @param from The start time of the range.
+     * @param to The end time of the range.
+     * @return A JSON array containing the non empty buckets within the specified time range.
+     * @throws std::invalid_argument if the bucket width is not positive or a projected property is not a dynamic property of the item.
+     */
+    [[nodiscard]] json::json get_values(const item &itm, const aggregation &agg, const std::chrono::system_clock::time_point &from, const std::chrono::system_clock::time_point &to = std::chrono::system_clock::now());
+    /**
+     * @brief Gets an estimate of the memory used by the recent history of the items.
+     *
+     * The `get_values` functions answer from the recent history kept in memory, rather than from the database, whenever it holds the whole requested range.
+     *
+     * @return The estimated number of bytes used by the recent history of all the items.
+     */
+    [[nodiscard]] size_t get_history_bytes() noexcept;
     /**
      * @brief Sets the value of an item.
      *
@@ -178,15 +368,50 @@ namespace coco
      * @param infere Whether to run inference after setting the value.
      */
     void set_value(item &itm, json::json &&val, const std::chrono::system_clock::time_point &timestamp = std::chrono::system_clock::now(), bool infere = true);
+    /**
+     * @brief Gets the number of late values, that is values older than the current value of their item, received so far.
+     *
+     * The handling of late values is declared through the `late` key of the data of the types, as one of `apply` (the default), `store` or `reject`. If the types of an item disagree, the strictest policy applies.
+     *
+     * @return The late values of all the items.
+     */
+    [[nodiscard]] late_stats get_late_stats() noexcept;
+    /**
+     * @brief Gets the number of late values received so far for the given item.
+     *
+     * @param itm The item.
+     * @return The late values of the item.
+     */
+    [[nodiscard]] late_stats get_late_stats(const item &itm) noexcept;
+    /**
+     * @brief Writes a series of past values of an item in bulk, bypassing the rule engine.
+     *
+     * The values are stored with a single database operation, as they are rather than through the archives of the item, and recorded in the recent history. The value of the item, and hence its facts, is updated only once, and only if the series contains values newer than the current one, merging them in timestamp order.
+     *
+     * @param itm The item whose values are backfilled.
+     * @param series The values, each paired with its timestamp, in any order.
+     * @param infere Whether to run inference if the value of the item has been updated.
+     * @throws std::invalid_argument if a value refers to a property which is not a dynamic property of the item or is not valid for it, in which case nothing is stored.
+     */
+    void backfill(item &itm, std::vector<std::pair<json::json, std::chrono::system_clock::time_point>> &&series, bool infere = true);
     /**
      * @brief Deletes an item.
      *
-     * This function deletes the specified item from the CoCo environment.
+     * This function deletes the specified item from the CoCo environment. The items referencing the deleted item are deleted as well if the referencing property cascades (`"on_delete": "cascade"`), otherwise the reference is removed from them. Each item is deleted once, even if the cascades are mutual.
      *
      * @param itm The item to be deleted.
      * @param infere Whether to run inference after deleting the item.
+     * @throws std::invalid_argument if an item which is not deleted references a deleted item through a property which neither cascades nor can be nulled, in which case nothing is deleted.
      */
-    void delete_item(item &itm, bool infere = true) noexcept;
+    void delete_item(item &itm, bool infere = true);
+
+    /**
+     * @brief Gets the items referencing the given item.
+     *
+     * @param itm The referenced item.
+     * @return The referencing items, each paired with the name of its referencing property.
+     */
+    [[nodiscard]] std::vector<std::pair<std::reference_wrapper<item>, std::string>> get_referrers(const item &itm) noexcept;
 
     /**
      * @brief Returns a vector of references to the rules.
@@ -230,11 +455,83 @@ namespace coco
     type &make_type(std::string_view name, json::json &&data = json::json());
     item &make_item(std::string_view id, std::vector<std::reference_wrapper<type>> &&tps, json::json &&props, std::optional<std::pair<json::json, std::chrono::system_clock::time_point>> &&val = std::nullopt);
 
+    /**
+     * @brief Wraps a JSON document into a CLIPS external address, so that facts and rules share the parsed document rather than its serialization.
+     *
+     * @param doc The document.
+     * @return The external address, released by CLIPS along with the facts holding it.
+     */
+    [[nodiscard]] CLIPSExternalAddress *to_json_address(std::shared_ptr<const json::json> doc) noexcept;
+    /**
+     * @brief Gets the JSON document held by a CLIPS value, either a JSON external address or a serialized JSON string.
+     *
+     * The documents parsed from strings are cached by lexeme, so that the rules repeatedly reading the same string parse it once.
+     *
+     * @param val The CLIPS value.
+     * @return The document, or a null pointer if the value holds no JSON document.
+     */
+    [[nodiscard]] std::shared_ptr<const json::json> to_json_document(const UDFValue &val) noexcept;
+    /**
+     * @brief Gets the JSON document held by a CLIPS value, without parsing strings.
+     *
+     * @param value The CLIPS value, as held by a `CLIPSValue` or by a `UDFValue`.
+     * @return The document, or a null pointer if the value is not a JSON external address.
+     */
+    [[nodiscard]] const json::json *to_json_document(void *value) const noexcept;
+    /**
+     * @brief Converts a value of a JSON document into a CLIPS value, the arrays and the objects being wrapped into external addresses sharing the document.
+     *
+     * @param doc The document.
+     * @param j The value, within the document.
+     * @return The CLIPS value.
+     */
+    [[nodiscard]] void *to_clips_value(const std::shared_ptr<const json::json> &doc, const json::json &j) noexcept;
+    /**
+     * @brief Wraps a vector into a CLIPS external address, so that facts and rules share the decoded buffer.
+     *
+     * @param buf The vector.
+     * @return The external address, released by CLIPS along with the facts holding it.
+     */
+    [[nodiscard]] CLIPSExternalAddress *to_vector_address(std::shared_ptr<const vector_buffer> buf) noexcept;
+    /**
+     * @brief Gets the vector held by a CLIPS value.
+     *
+     * @param value The CLIPS value, as held by a `CLIPSValue` or by a `UDFValue`.
+     * @return The vector, or a null pointer if the value is not a vector external address.
+     */
+    [[nodiscard]] const vector_buffer *to_vector_buffer(void *value) const noexcept;
+    /**
+     * @brief Replaces the vectors given as arrays of numbers within the properties or the value of an item with their compact form.
+     *
+     * @param tps The types of the item.
+     * @param val The properties or the value of the item, whose invalid vectors are left untouched.
+     * @param dynamic Whether the value holds dynamic rather than static properties.
+     */
+    void compact_vectors(const std::vector<std::reference_wrapper<type>> &tps, json::json &val, bool dynamic) const noexcept;
+
+    void add_referrer(const std::string &itm_id, const std::string &prop, const json::json &val) noexcept;
+    void remove_referrer(const std::string &itm_id, const std::string &prop, const json::json &val) noexcept;
+    void add_referrers(const item &itm) noexcept;
+    void remove_referrers(const item &itm) noexcept;
+
     friend void add_type(Environment *env, UDFContext *udfc, UDFValue *out);
     friend void remove_type(Environment *env, UDFContext *udfc, UDFValue *out);
     friend void set_props(Environment *env, UDFContext *udfc, UDFValue *out);
     friend void add_data(Environment *env, UDFContext *udfc, UDFValue *out);
 
+    friend void multifield_to_json(Environment *env, UDFContext *udfc, UDFValue *out);
+    friend void json_to_multifield(Environment *env, UDFContext *udfc, UDFValue *out);
+    friend void json_values(Environment *env, UDFContext *udfc, UDFValue *out);
+    friend void json_parse(Environment *env, UDFContext *udfc, UDFValue *out);
+    friend void json_get(Environment *env, UDFContext *udfc, UDFValue *out);
+    friend void json_has(Environment *env, UDFContext *udfc, UDFValue *out);
+    friend void json_len(Environment *env, UDFContext *udfc, UDFValue *out);
+    friend void vector_len(Environment *env, UDFContext *udfc, UDFValue *out);
+    friend void vector_nth(Environment *env, UDFContext *udfc, UDFValue *out);
+    friend void vector_norm(Environment *env, UDFContext *udfc, UDFValue *out);
+    friend void vector_peaks(Environment *env, UDFContext *udfc, UDFValue *out);
+    friend void vector_band_energy(Environment *env, UDFContext *udfc, UDFValue *out);
+
     friend void set_types(coco &cc, std::vector<std::filesystem::path> &&type_files) noexcept;
     friend void set_types(coco &cc, const std::filesystem::path &type_dir) noexcept;
     friend void set_types(coco &cc, std::vector<db_type> &&db_types) noexcept;
@@ -287,17 +584,38 @@ namespace coco
     void created_rule(const rule &rr) const;
 #endif
 
+  private:
+    /**
+     * @brief Gets the compiled validator of a JSON schema, compiling it if no property shares it already.
+     *
+     * The validators are shared by the properties having the same schema and are released along with the last of them.
+     *
+     * @param schema The schema.
+     * @return The validator, or a null pointer if the schema cannot be compiled and must be validated through `json::validate`.
+     */
+    [[nodiscard]] std::shared_ptr<const schema_validator> get_validator(const json::json &schema) noexcept;
+
   protected:
+    using parsed_lexeme_list = std::list<std::pair<CLIPSLexeme *, std::shared_ptr<const json::json>>>;
+
     coco_db &db;                                                                       // The database..
     std::unordered_map<std::type_index, std::unique_ptr<coco_module>> modules;         // The modules..
     json::json schemas;                                                                // The JSON schemas..
+    std::unordered_map<std::string, std::weak_ptr<const schema_validator>> validators; // The compiled JSON schemas still in use by some property, by their serialization..
+    size_t schemas_version = 0;                                                        // The number of changes of the JSON schemas, so that the properties can tell their validators are stale..
     std::mt19937 gen;                                                                  // The random number generator..
     std::map<std::string, std::unique_ptr<property_type>, std::less<>> property_types; // The property types..
     std::recursive_mutex mtx;                                                          // The mutex for the core..
     Environment *env;                                                                  // The CLIPS environment..
+    unsigned short json_address_type;                                                  // The CLIPS external address type of the JSON documents..
+    unsigned short vector_address_type;                                                // The CLIPS external address type of the vectors..
+    parsed_lexeme_list parsed_lexemes;                                                 // The documents parsed from the recently read JSON strings, the most recent first..
+    std::unordered_map<CLIPSLexeme *, parsed_lexeme_list::iterator> parsed_lexeme_pos; // The position of the parsed JSON strings in the cache..
     std::map<std::string, std::unique_ptr<type>, std::less<>> types;                   // The types managed by CoCo by name.
     std::unordered_map<std::string, std::unique_ptr<item>> items;                      // The items by their ID..
     std::map<std::string, std::unique_ptr<rule>, std::less<>> rules;                   // The rules..
+    std::unordered_map<std::string, late_stats> late_values;                           // The late values received for each item..
+    std::unordered_map<std::string, std::set<std::pair<std::string, std::string>>> referrers; // The referencing items, with their referencing property, by the ID of the referenced item..
 #ifdef BUILD_LISTENERS
     std::vector<listener *> listeners; // The CoCo listeners..
 #endif
@@ -323,6 +641,20 @@ namespace coco
   void empty_agenda(Environment *env, UDFContext *udfc, UDFValue *out);
   void multifield_to_json(Environment *env, UDFContext *udfc, UDFValue *out);
   void json_to_multifield(Environment *env, UDFContext *udfc, UDFValue *out);
+  void json_values(Environment *env, UDFContext *udfc, UDFValue *out);
+  void json_parse(Environment *env, UDFContext *udfc, UDFValue *out);
+  void json_get(Environment *env, UDFContext *udfc, UDFValue *out);
+  void json_has(Environment *env, UDFContext *udfc, UDFValue *out);
+  void json_len(Environment *env, UDFContext *udfc, UDFValue *out);
+
+  void vector_len(Environment *env, UDFContext *udfc, UDFValue *out);
+  void vector_nth(Environment *env, UDFContext *udfc, UDFValue *out);
+  void vector_norm(Environment *env, UDFContext *udfc, UDFValue *out);
+  void vector_peaks(Environment *env, UDFContext *udfc, UDFValue *out);
+  void vector_band_energy(Environment *env, UDFContext *udfc, UDFValue *out);
+
+  void geo_distance(Environment *env, UDFContext *udfc, UDFValue *out);
+  void geo_within(Environment *env, UDFContext *udfc, UDFValue *out);
 
 #ifdef BUILD_LISTENERS
   class listener
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "json.hpp"
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace coco
+{
+  /**
+   * @brief The functions which can be used to aggregate the values of a dynamic property within a bucket.
+   */
+  enum class aggregate_fn : uint8_t
+  {
+    avg,
+    min,
+    max,
+    count,
+    first,
+    last,
+    percentile,
+    rate
+  };
+
+  /**
+   * @brief Gets the aggregate function with the given name.
+   *
+   * @param name The name of the aggregate function.
+   * @return The aggregate function.
+   * @throws std::invalid_argument if the name is not the name of an aggregate function.
+   */
+  [[nodiscard]] aggregate_fn to_aggregate_fn(std::string_view name);
+
+  /**
+   * @brief A query-time aggregation of the values of an item.
+   */
+  struct aggregation
+  {
+    aggregate_fn fn = aggregate_fn::avg;
+    std::chrono::milliseconds bucket = std::chrono::minutes(1); // The width of the buckets..
+    double percentile = 50;                                     // The percentile, in [0, 100], used by the `percentile` function..
+    std::vector<std::string> properties;                        // The dynamic properties to aggregate, all of them if empty..
+  };
+
+  /**
+   * @brief A single-pass operator which folds a stream of points into per-bucket aggregates.
+   *
+   * Points can be pushed in any order, one dynamic property at a time or interleaved. Only a fixed-size accumulator is kept for each bucket and property, except for the `percentile` function which has to retain the values of the bucket.
+   */
+  class aggregator
+  {
+  public:
+    aggregator(const aggregation &agg) noexcept;
+
+    /**
+     * @brief Folds a point into the bucket which contains it.
+     *
+     * Non numeric values are only considered by the `count`, `first` and `last` functions.
+     *
+     * @param name The name of the dynamic property.
+     * @param timestamp The timestamp of the point, in milliseconds since the epoch.
+     * @param val The value of the point.
+     */
+    void add(std::string_view name, int64_t timestamp, const json::json &val);
+
+    /**
+     * @brief Gets the aggregates.
+     *
+     * @return An array of `{"timestamp": ..., "data": {...}}` objects, one for each non empty bucket sorted by start, where data maps each dynamic property to its aggregate.
+     */
+    [[nodiscard]] json::json get_result() const;
+
+  private:
+    struct accumulator
+    {
+      size_t count = 0, n_numbers = 0;
+      double sum = 0, min = 0, max = 0;
+      int64_t first_ts = 0, last_ts = 0;
+      json::json first, last;
+      std::vector<double> samples; // The numeric values, only kept for the `percentile` function..
+    };
+
+    [[nodiscard]] json::json value_of(const accumulator &acc) const;
+
+  private:
+    const aggregation agg;
+    std::map<int64_t, std::map<std::string, accumulator, std::less<>>> buckets; // The accumulators, indexed by bucket start and dynamic property name..
+  };
+} // namespace coco
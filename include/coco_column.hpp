@@ -0,0 +1,146 @@
+#pragma once
+
+#include "coco_index.hpp"
+#include <deque>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace coco
+{
+  /**
+   * @brief The values of a static property for all the instances of a type, one row per instance.
+   *
+   * Columns replace the per-item JSON objects with contiguous storage, so that scanning the instances of a type on a property touches a single array.
+   */
+  class column
+  {
+  public:
+    virtual ~column() = default;
+
+    /**
+     * @brief Gets the number of rows of the column.
+     *
+     * @return The number of rows.
+     */
+    [[nodiscard]] virtual size_t size() const noexcept = 0;
+    /**
+     * @brief Resizes the column, the new rows being null.
+     *
+     * @param rows The number of rows.
+     */
+    virtual void resize(size_t rows) noexcept = 0;
+
+    /**
+     * @brief Sets the value of a row.
+     *
+     * @param row The row.
+     * @param val The value, which must be valid for the property, or null.
+     */
+    virtual void set(size_t row, const json::json &val) noexcept = 0;
+    /**
+     * @brief Checks whether the value of a row is null.
+     *
+     * @param row The row.
+     * @return True if the row holds no value, false otherwise.
+     */
+    [[nodiscard]] virtual bool is_null(size_t row) const noexcept = 0;
+    /**
+     * @brief Gets the value of a row.
+     *
+     * @param row The row.
+     * @return The value of the row, null if the row holds no value.
+     */
+    [[nodiscard]] virtual json::json get(size_t row) const noexcept = 0;
+
+    /**
+     * @brief Clears the rows whose value does not satisfy the filter.
+     *
+     * @param f The filter.
+     * @param rows The rows still satisfying the filters, of the same size as the column.
+     */
+    virtual void filter(const item_filter &f, std::vector<bool> &rows) const noexcept;
+  };
+
+  /**
+   * @brief A column of single `bool`, `int` or `float` values, packed in a vector along with a null bitmap.
+   */
+  template <typename T>
+  class numeric_column final : public column
+  {
+  public:
+    [[nodiscard]] size_t size() const noexcept override { return values.size(); }
+    void resize(size_t rows) noexcept override
+    {
+      values.resize(rows);
+      nulls.resize(rows, true);
+    }
+
+    void set(size_t row, const json::json &val) noexcept override
+    {
+      if (val.is_null())
+        nulls[row] = true;
+      else
+      {
+        values[row] = val.get<T>();
+        nulls[row] = false;
+      }
+    }
+    [[nodiscard]] bool is_null(size_t row) const noexcept override { return nulls[row]; }
+    [[nodiscard]] json::json get(size_t row) const noexcept override
+    {
+      if (nulls[row])
+        return nullptr;
+      return static_cast<T>(values[row]);
+    }
+
+    void filter(const item_filter &f, std::vector<bool> &rows) const noexcept override;
+
+  private:
+    std::vector<T> values;  // The values, meaningful for the non null rows only..
+    std::vector<bool> nulls; // Whether each row is null..
+  };
+
+  /**
+   * @brief A column of single `string` or `symbol` values, interned so that each distinct value is stored once.
+   */
+  class lexeme_column final : public column
+  {
+  public:
+    [[nodiscard]] size_t size() const noexcept override { return ids.size(); }
+    void resize(size_t rows) noexcept override;
+
+    void set(size_t row, const json::json &val) noexcept override;
+    [[nodiscard]] bool is_null(size_t row) const noexcept override { return ids[row] == 0; }
+    [[nodiscard]] json::json get(size_t row) const noexcept override;
+
+    void filter(const item_filter &f, std::vector<bool> &rows) const noexcept override;
+
+  private:
+    void release(uint32_t id) noexcept;
+
+  private:
+    std::vector<uint32_t> ids;                               // The identifier of the value of each row, zero for null rows..
+    std::deque<std::string> lexemes;                         // The distinct values, the value with identifier `i` being at position `i - 1`..
+    std::vector<size_t> refs;                                // The number of rows holding each value..
+    std::unordered_map<std::string_view, uint32_t> lookup;   // The identifiers of the values..
+    std::vector<uint32_t> free_ids;                          // The identifiers of the values no longer held by any row..
+  };
+
+  /**
+   * @brief A column of values with no compact representation, such as multiple values, references and JSON objects.
+   */
+  class json_column final : public column
+  {
+  public:
+    [[nodiscard]] size_t size() const noexcept override { return values.size(); }
+    void resize(size_t rows) noexcept override { values.resize(rows, nullptr); }
+
+    void set(size_t row, const json::json &val) noexcept override { values[row] = val; }
+    [[nodiscard]] bool is_null(size_t row) const noexcept override { return values[row].is_null(); }
+    [[nodiscard]] json::json get(size_t row) const noexcept override { return values[row]; }
+
+  private:
+    std::vector<json::json> values; // The values, null for null rows..
+  };
+} // namespace coco
@@ -1,11 +1,18 @@
 #pragma once
 
 #include "json.hpp"
+#include "coco_ts.hpp"
 #include <unordered_map>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
 #include <memory>
 #include <typeindex>
 #include <optional>
 #include <chrono>
+#include <functional>
+#include <limits>
 
 namespace coco
 {
@@ -27,11 +34,83 @@ namespace coco
     std::optional<std::pair<json::json, std::chrono::system_clock::time_point>> value;
   };
 
+  /**
+   * @brief A partial update of the static properties of an item.
+   */
+  struct db_property_update
+  {
+    enum kind_t : uint8_t
+    {
+      set,   // Sets the value at the path..
+      unset, // Removes the value at the path..
+      push   // Inserts the value in the array at the path..
+    };
+
+    kind_t kind;                    // The kind of update..
+    std::vector<std::string> path;  // The path of the updated value, the first element being the name of the property..
+    json::json value;               // The value, for the `set` and `push` updates..
+    std::optional<size_t> position; // The position the value is inserted at, for the `push` updates, the end of the array if empty..
+  };
+
   struct db_rule
   {
     std::string name, content;
   };
 
+  /**
+   * @brief The aggregates of the numeric values of a dynamic property within a time bucket.
+   */
+  struct db_rollup
+  {
+    /**
+     * @brief Adds a value to the rollup.
+     *
+     * @param v The value.
+     * @param timestamp The timestamp of the value, in milliseconds since the epoch.
+     */
+    void add(double v, int64_t timestamp) noexcept;
+
+    [[nodiscard]] json::json to_json() const noexcept;
+
+    size_t count = 0;
+    double sum = 0, min = std::numeric_limits<double>::max(), max = std::numeric_limits<double>::lowest(), last = 0;
+    int64_t last_timestamp = std::numeric_limits<int64_t>::min(); // The timestamp of the last value, so that late values do not replace it..
+  };
+
+  /**
+   * @brief The retention policy of the data of an item.
+   */
+  struct db_retention
+  {
+    std::optional<std::chrono::seconds> raw;     // How long the raw values are kept, forever if empty..
+    std::optional<std::chrono::seconds> rollups; // How long the rollups are kept, forever if empty..
+  };
+
+  /**
+   * @brief The statistics about the compactions performed by the database.
+   */
+  struct compaction_stats
+  {
+    size_t runs = 0;                            // The number of compaction runs..
+    size_t backlog = 0;                         // The number of expired values found by the last run..
+    size_t deleted_values = 0;                  // The total number of deleted raw values..
+    size_t deleted_rollups = 0;                 // The total number of deleted rollups..
+    std::chrono::milliseconds last_duration{0}; // The duration of the last run..
+  };
+
+  /**
+   * @brief Gets the start of the bucket of the given resolution which contains the given timestamp.
+   *
+   * @param timestamp The timestamp, in milliseconds since the epoch.
+   * @param resolution The resolution of the buckets.
+   * @return The start of the bucket, in milliseconds since the epoch.
+   */
+  [[nodiscard]] inline int64_t bucket_of(int64_t timestamp, const std::chrono::seconds &resolution) noexcept
+  {
+    const int64_t width = std::chrono::duration_cast<std::chrono::milliseconds>(resolution).count();
+    return timestamp - ((timestamp % width) + width) % width;
+  }
+
   class db_module
   {
     friend class coco_db;
@@ -51,8 +130,68 @@ namespace coco
   {
   public:
     coco_db(json::json &&cnfg = {}) noexcept;
+    virtual ~coco_db();
 
     [[nodiscard]] const json::json &get_config() const noexcept { return config; }
+    /**
+     * @brief Gets the resolutions at which the numeric item values are rolled up.
+     *
+     * The resolutions, in seconds, are read from the `rollups` configuration key and default to one minute, one hour and one day. The entries which are not positive integers are ignored.
+     * The rollups held in memory by the base database are bounded, for each item and resolution, by the `max_rollups` configuration key (`HISTORY_MAX_SIZE` buckets by default), the oldest buckets being removed beyond it.
+     *
+     * @return The rollup resolutions.
+     */
+    [[nodiscard]] const std::vector<std::chrono::seconds> &get_rollup_resolutions() const noexcept { return resolutions; }
+
+    /**
+     * @brief Sets the function which gives the retention policies of the items.
+     *
+     * The function is invoked at the beginning of each compaction run, so that the policies follow the types the items have at that time. The items it does not return keep their data forever.
+     *
+     * @param provider The function returning the retention policies, indexed by item ID.
+     */
+    void set_retention_provider(std::function<std::unordered_map<std::string, db_retention>()> &&provider) noexcept;
+    /**
+     * @brief Sets the archive policies of the dynamic properties of an item.
+     *
+     * The values of the archived properties are filtered before being stored, so that only those needed to reconstruct their series within the deviation are kept. The current value of the item and its rollups still consider every value.
+     *
+     * @param itm_id The ID of the item.
+     * @param policies The archive policies, indexed by dynamic property name, or an empty map to store every value of the item.
+     */
+    void set_archive(std::string_view itm_id, const std::map<std::string, archive_policy> &policies) noexcept;
+    /**
+     * @brief Stores the points held back by the archives of an item, so that the stored data include the latest value.
+     *
+     * The held points are flushed before the values of the item are read and when its archive policies are replaced.
+     *
+     * @param itm_id The ID of the item.
+     */
+    void flush_archives(std::string_view itm_id);
+    /**
+     * @brief Stores the points held back by the archives of all the items, before shutting down.
+     */
+    void flush_archives();
+    /**
+     * @brief Starts the background compactor, which periodically deletes the expired data of the items having a retention policy.
+     *
+     * Every `COMPACTION_INTERVAL` seconds, the expired raw values of each item are deleted in batches of `COMPACTION_BATCH_SIZE` values, waiting `COMPACTION_THROTTLE` milliseconds between two batches, so that the compaction does not starve the other operations.
+     */
+    void start_compactor() noexcept;
+    /**
+     * @brief Stops the background compactor, waiting for the current batch to complete.
+     */
+    void stop_compactor() noexcept;
+    /**
+     * @brief Deletes the expired data of the items having a retention policy.
+     */
+    void compact() noexcept;
+    /**
+     * @brief Gets the statistics about the performed compactions.
+     *
+     * @return The statistics about the performed compactions.
+     */
+    [[nodiscard]] compaction_stats get_compaction_stats() noexcept;
 
     template <typename Tp, typename... Args>
     Tp &add_module(Args &&...args)
@@ -86,19 +225,163 @@ namespace coco
     virtual void delete_type(std::string_view tp_name);
 
     [[nodiscard]] virtual std::vector<db_item> get_items() noexcept;
-    virtual std::string create_item(const std::vector<std::string> &types, const json::json &props, const std::optional<std::pair<json::json, std::chrono::system_clock::time_point>> &val = std::nullopt);
+    /**
+     * @brief Generates the ID of a new item, without any round trip to the database.
+     *
+     * @return A new, unique, item ID.
+     */
+    [[nodiscard]] virtual std::string generate_id();
+    /**
+     * @brief Creates an item with the given ID.
+     *
+     * The item might be persisted asynchronously, so the call does not need to wait for the database. In that case, an insertion which fails is retried by the following writes.
+     *
+     * @param itm_id The ID of the item, as generated by `generate_id`.
+     * @param types The names of the types of the item.
+     * @param props The static properties of the item.
+     * @param val The value of the item, if any.
+     */
+    virtual void create_item(std::string_view itm_id, const std::vector<std::string> &types, const json::json &props, const std::optional<std::pair<json::json, std::chrono::system_clock::time_point>> &val = std::nullopt);
+    /**
+     * @brief Creates several items with a single bulk operation.
+     *
+     * Unlike `create_item`, the call waits for the items to be persisted, so that the whole batch is either created or rejected.
+     *
+     * @param itms The items, whose IDs have been generated by `generate_id`.
+     * @throws std::invalid_argument if the items could not be created, in which case none of them is.
+     */
+    virtual void create_items(const std::vector<db_item> &itms);
     virtual void set_properties(std::string_view itm_id, const json::json &props);
+    /**
+     * @brief Applies partial updates to the static properties of an item, so that only the changed parts are written.
+     *
+     * @param itm_id The ID of the item.
+     * @param updates The updates, applied in order.
+     */
+    virtual void update_properties(std::string_view itm_id, const std::vector<db_property_update> &updates);
     [[nodiscard]] virtual json::json get_values(std::string_view itm_id, const std::chrono::system_clock::time_point &from, const std::chrono::system_clock::time_point &to = std::chrono::system_clock::now());
+    /**
+     * @brief Gets a page of the values of an item within a time range, streaming them as the underlying cursor advances.
+     *
+     * @param itm_id The ID of the item.
+     * @param fields The dynamic properties to retrieve, all of them if empty.
+     * @param from The start of the range.
+     * @param to The end of the range.
+     * @param limit The maximum number of values to retrieve.
+     * @param cb The callback invoked, in timestamp order, for each value as a `{"data": ..., "timestamp": ...}` object.
+     * @return The timestamp from which the next page starts, if there are more values within the range.
+     */
+    virtual std::optional<std::chrono::system_clock::time_point> get_values(std::string_view itm_id, const std::vector<std::string> &fields, const std::chrono::system_clock::time_point &from, const std::chrono::system_clock::time_point &to, size_t limit, const std::function<void(json::json &&)> &cb);
+    /**
+     * @brief Gets the values of several items within a time range with a single query, streaming them grouped per item.
+     *
+     * @param itm_ids The IDs of the items.
+     * @param fields The dynamic properties to retrieve, all of them if empty.
+     * @param from The start of the range.
+     * @param to The end of the range.
+     * @param cb The callback invoked, for each item in turn and in timestamp order, with the ID of the item and the value as a `{"data": ..., "timestamp": ...}` object.
+     */
+    virtual void get_values(const std::vector<std::string> &itm_ids, const std::vector<std::string> &fields, const std::chrono::system_clock::time_point &from, const std::chrono::system_clock::time_point &to, const std::function<void(const std::string &, json::json &&)> &cb);
+    /**
+     * @brief Streams the values of an item within a time range, one point at a time, so that they can be folded without being materialized.
+     *
+     * @param itm_id The ID of the item.
+     * @param props The dynamic properties to stream, all of them if empty.
+     * @param from The start of the range.
+     * @param to The end of the range.
+     * @param cb The callback invoked for each point with the name of the dynamic property, the timestamp (in milliseconds since the epoch) and the value.
+     */
+    virtual void scan_values(std::string_view itm_id, const std::vector<std::string> &props, const std::chrono::system_clock::time_point &from, const std::chrono::system_clock::time_point &to, const std::function<void(const std::string &, int64_t, json::json &&)> &cb);
     virtual void set_value(std::string_view itm_id, const json::json &val, const std::chrono::system_clock::time_point &timestamp = std::chrono::system_clock::now());
+    /**
+     * @brief Stores, in bulk, a series of values of an item, without any per-value round trip.
+     *
+     * The values are stored as they are, without going through the archives of the item.
+     *
+     * @param itm_id The ID of the item.
+     * @param series The values, each paired with its timestamp, sorted by timestamp.
+     * @param latest The new current value of the item, if the series is newer than the current one.
+     */
+    virtual void set_values(std::string_view itm_id, const std::vector<std::pair<json::json, std::chrono::system_clock::time_point>> &series, const std::optional<std::pair<json::json, std::chrono::system_clock::time_point>> &latest = std::nullopt);
+    /**
+     * @brief Gets the rollups of the numeric values of an item within a time range.
+     *
+     * @param itm_id The ID of the item.
+     * @param resolution The resolution of the rollups, which must be one of the configured ones.
+     * @param from The start of the range.
+     * @param to The end of the range.
+     * @return An array of `{"timestamp": ..., "data": {...}}` objects, one for each non empty bucket, where data maps each numeric property to its `count`, `sum`, `min`, `max` and `last` aggregates.
+     */
+    [[nodiscard]] virtual json::json get_rollups(std::string_view itm_id, const std::chrono::seconds &resolution, const std::chrono::system_clock::time_point &from, const std::chrono::system_clock::time_point &to = std::chrono::system_clock::now());
     virtual void delete_item(std::string_view itm_id);
+    /**
+     * @brief Gets the number of raw values of an item which precede the given time.
+     *
+     * @param itm_id The ID of the item.
+     * @param before The expiration time.
+     * @return The number of expired values.
+     */
+    [[nodiscard]] virtual size_t count_values(std::string_view itm_id, const std::chrono::system_clock::time_point &before);
+    /**
+     * @brief Deletes at most `limit` raw values of an item which precede the given time.
+     *
+     * @param itm_id The ID of the item.
+     * @param before The expiration time.
+     * @param limit The maximum number of values to delete.
+     * @return The number of deleted values.
+     */
+    virtual size_t delete_values(std::string_view itm_id, const std::chrono::system_clock::time_point &before, size_t limit);
+    /**
+     * @brief Deletes the rollups of an item whose bucket precedes the given time.
+     *
+     * @param itm_id The ID of the item.
+     * @param before The expiration time.
+     * @return The number of deleted rollups.
+     */
+    virtual size_t delete_rollups(std::string_view itm_id, const std::chrono::system_clock::time_point &before);
 
     [[nodiscard]] virtual std::vector<db_rule> get_rules() noexcept;
     virtual void create_rule(std::string_view rule_name, std::string_view rule_content);
 
+  protected:
+    /**
+     * @brief Filters a value of an item through the archives of its dynamic properties.
+     *
+     * @param itm_id The ID of the item.
+     * @param val The value, an object mapping dynamic property names to values.
+     * @param timestamp The timestamp of the value.
+     * @return The data to store, indexed by timestamp in milliseconds since the epoch, which can include points held back by previous calls.
+     */
+    [[nodiscard]] std::map<int64_t, json::json> archive(std::string_view itm_id, const json::json &val, const std::chrono::system_clock::time_point &timestamp);
+    /**
+     * @brief Stores the data of an item which passed its archives.
+     *
+     * @param itm_id The ID of the item.
+     * @param data The data to store, indexed by timestamp in milliseconds since the epoch.
+     */
+    virtual void store_archived(std::string_view itm_id, const std::map<int64_t, json::json> &data);
+
+  private:
+    void store(std::string_view itm_id, const json::json &val, const std::chrono::system_clock::time_point &timestamp, bool archived = true);
+
   protected:
     const json::json config;
+    const std::vector<std::chrono::seconds> resolutions; // The resolutions of the rollups..
+    std::mutex values_mtx;                               // Guards the stored values and rollups, which are read without holding the lock of the CoCo object..
+    std::unique_ptr<ts_store> values;                    // The compressed history of the item values, kept in memory, available to any database as a storage layer and allocated by the first stored value, so that the databases persisting the values elsewhere (as `mongo_db` does) do not hold it..
 
   private:
-    std::unordered_map<std::type_index, std::unique_ptr<db_module>> modules; // The modules..
+    std::unordered_map<std::type_index, std::unique_ptr<db_module>> modules;                                         // The modules..
+    std::mutex compactor_mtx;                                                                                        // Guards the retention provider and the compaction statistics..
+    std::condition_variable compactor_cv;                                                                            // Wakes up the compactor..
+    bool compacting = false;                                                                                         // Whether the compactor is running..
+    bool stopping = false;                                                                                           // Whether the compactor is being stopped..
+    std::function<std::unordered_map<std::string, db_retention>()> retention_provider;                               // Gives the retention policies of the items..
+    std::mutex archives_mtx;                                                                                         // Guards the archives..
+    std::unordered_map<std::string, std::map<std::string, ts_archive>> archives;                                     // The archives of the dynamic properties of the items, for those having an archive policy..
+    compaction_stats c_stats;                                                                                        // The compaction statistics..
+    std::thread compactor;                                                                                           // The background compactor..
+    const size_t max_rollups;                                                                                        // The maximum number of buckets of each item and resolution..
+    std::unordered_map<std::string, std::map<int64_t, std::map<int64_t, std::map<std::string, db_rollup>>>> rollups; // The rollups of each item, by resolution (in seconds) and bucket start (in milliseconds)..
   };
 } // namespace coco
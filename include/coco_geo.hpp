@@ -0,0 +1,96 @@
+#pragma once
+
+#include "coco_index.hpp"
+#include <optional>
+#include <vector>
+
+namespace coco
+{
+  /**
+   * @brief A point on the Earth's surface, in degrees.
+   */
+  struct geo_point
+  {
+    double lat = 0, lon = 0;
+  };
+
+  /**
+   * @brief An area of the Earth's surface, either a box or a circle.
+   */
+  struct geo_area
+  {
+    geo_point min, max;               // The bounding box of the area, whose minimum longitude exceeds the maximum one if it crosses the antimeridian..
+    std::optional<geo_point> center; // The center of the circle, if the area is a circle..
+    double radius = 0;               // The radius of the circle, in meters..
+  };
+
+  /**
+   * @brief Gets the point represented by a `{"lat": ..., "lon": ...}` object.
+   *
+   * @param j The JSON object.
+   * @return The point, or nothing if the object does not represent a valid point.
+   */
+  [[nodiscard]] std::optional<geo_point> to_geo_point(const json::json &j) noexcept;
+  /**
+   * @brief Gets the points of a geographic shape, either a single point or a polygon given as an array of points.
+   *
+   * @param j The JSON value of the shape.
+   * @return The points of the shape, empty if the value does not represent a valid shape.
+   */
+  [[nodiscard]] std::vector<geo_point> geo_points(const json::json &j) noexcept;
+  /**
+   * @brief Gets the area represented by a `{"bbox": [min_lat, min_lon, max_lat, max_lon]}` or by a `{"lat": ..., "lon": ..., "radius": ...}` object.
+   *
+   * @param j The JSON object.
+   * @return The area, or nothing if the object does not represent a valid area.
+   */
+  [[nodiscard]] std::optional<geo_area> to_geo_area(const json::json &j) noexcept;
+
+  /**
+   * @brief Gets the great-circle distance between two points.
+   *
+   * @param a The first point.
+   * @param b The second point.
+   * @return The distance, in meters.
+   */
+  [[nodiscard]] double distance(const geo_point &a, const geo_point &b) noexcept;
+  /**
+   * @brief Gets the centroid (the average of the vertices) of a shape.
+   *
+   * @param pts The points of the shape, which must not be empty.
+   * @return The centroid of the shape.
+   */
+  [[nodiscard]] geo_point centroid(const std::vector<geo_point> &pts) noexcept;
+  /**
+   * @brief Checks whether a shape lies within an area, that is whether all its points do.
+   *
+   * @param pts The points of the shape.
+   * @param area The area.
+   * @return True if the shape is not empty and lies within the area, false otherwise.
+   */
+  [[nodiscard]] bool within(const std::vector<geo_point> &pts, const geo_area &area) noexcept;
+
+  /**
+   * @brief A spatial index of the shapes held by a `geo` property.
+   *
+   * Shapes are indexed by the Z-order (Morton) code of their first point, so that an area is answered by scanning the code ranges of the quadtree cells covering its bounding box. A shape lies within an area only if all its points do, hence its first point is always among the scanned ones.
+   */
+  class geo_index final : public item_index
+  {
+  public:
+    [[nodiscard]] bool supports(const item_filter &f) const noexcept override { return f.op == filter_op::within; }
+
+    void insert(const std::string &itm_id, const json::json &val) noexcept override;
+    void erase(const std::string &itm_id, const json::json &val) noexcept override;
+
+    [[nodiscard]] size_t count(const item_filter &f, size_t limit) const noexcept override;
+    void find(const item_filter &f, const std::function<void(const std::string &)> &cb) const noexcept override;
+
+  private:
+    template <typename Fn>
+    void for_each(const item_filter &f, Fn &&fn) const noexcept;
+
+  private:
+    std::map<uint64_t, std::unordered_set<std::string>> cells; // The IDs of the items by the Z-order code of the first point of their shape..
+  };
+} // namespace coco
@@ -0,0 +1,149 @@
+#pragma once
+
+#include "json.hpp"
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <variant>
+
+namespace coco
+{
+  /**
+   * @brief The kinds of secondary indexes which can be declared on a static property.
+   */
+  enum class index_kind : uint8_t
+  {
+    hash,   // Equality lookups only..
+    ordered // Equality and range lookups..
+  };
+
+  /**
+   * @brief Gets the index kind with the given name.
+   *
+   * @param name The name of the index kind.
+   * @return The index kind.
+   * @throws std::invalid_argument if the name is not the name of an index kind.
+   */
+  [[nodiscard]] index_kind to_index_kind(std::string_view name);
+
+  /**
+   * @brief The comparisons which can be used to filter the items on the value of a property.
+   */
+  enum class filter_op : uint8_t
+  {
+    eq,
+    lt,
+    le,
+    gt,
+    ge,
+    within // The geographic shape lies within an area..
+  };
+
+  /**
+   * @brief A condition on the value of a property.
+   *
+   * Numbers (and booleans) are compared numerically and strings lexicographically, while objects and arrays can only be compared for equality. A multiple valued property satisfies the condition if any of its values does. The `within` comparison applies to `geo` properties, the value being either a `{"bbox": [min_lat, min_lon, max_lat, max_lon]}` box or a `{"lat": ..., "lon": ..., "radius": ...}` circle, with the radius in meters.
+   */
+  struct item_filter
+  {
+    std::string property;        // The name of the property..
+    filter_op op = filter_op::eq; // The comparison..
+    json::json value;            // The value the property is compared with..
+  };
+
+  /**
+   * @brief Checks whether a property value satisfies a filter.
+   *
+   * @param val The value of the property, either a single value or an array of values.
+   * @param f The filter.
+   * @return True if the value satisfies the filter, false otherwise.
+   */
+  [[nodiscard]] bool matches(const json::json &val, const item_filter &f) noexcept;
+
+  /**
+   * @brief A secondary index from the values of a property to the IDs of the items holding them.
+   *
+   * Indexes may return candidates which do not satisfy a filter, so the candidates are always checked against the filters.
+   */
+  class item_index
+  {
+  public:
+    virtual ~item_index() = default;
+
+    /**
+     * @brief Checks whether the index can answer the given filter.
+     *
+     * @param f The filter.
+     * @return True if the filter can be answered by the index, false otherwise.
+     */
+    [[nodiscard]] virtual bool supports(const item_filter &f) const noexcept = 0;
+
+    /**
+     * @brief Indexes the value of the property of an item.
+     *
+     * @param itm_id The ID of the item.
+     * @param val The value of the property.
+     */
+    virtual void insert(const std::string &itm_id, const json::json &val) noexcept = 0;
+    /**
+     * @brief Removes the value of the property of an item from the index.
+     *
+     * @param itm_id The ID of the item.
+     * @param val The indexed value of the property.
+     */
+    virtual void erase(const std::string &itm_id, const json::json &val) noexcept = 0;
+
+    /**
+     * @brief Counts the candidates for a filter, an upper bound of the number of items satisfying it.
+     *
+     * The counting stops as soon as the limit is reached, so that an index can be discarded, in favour of a more selective one, without scanning it all.
+     *
+     * @param f The filter, which must be supported by the index.
+     * @param limit The number of candidates beyond which the counting stops.
+     * @return The number of candidates, or a number not less than the limit if they are at least as many.
+     */
+    [[nodiscard]] virtual size_t count(const item_filter &f, size_t limit) const noexcept = 0;
+    /**
+     * @brief Invokes the callback with the ID of each candidate for a filter, possibly more than once.
+     *
+     * @param f The filter, which must be supported by the index.
+     * @param cb The callback.
+     */
+    virtual void find(const item_filter &f, const std::function<void(const std::string &)> &cb) const noexcept = 0;
+  };
+
+  /**
+   * @brief A secondary index from the values of a static property to the IDs of the items holding them.
+   *
+   * The values of multiple valued properties are indexed one by one. Null values, objects and arrays are not indexed, hence the filters on objects and arrays are not supported. The candidates of a filter are exactly the items satisfying it.
+   */
+  class property_index final : public item_index
+  {
+  public:
+    property_index(index_kind kind) noexcept;
+
+    [[nodiscard]] index_kind get_kind() const noexcept { return kind; }
+
+    [[nodiscard]] bool supports(const item_filter &f) const noexcept override { return (f.op == filter_op::eq || (kind == index_kind::ordered && f.op != filter_op::within)) && !f.value.is_object() && !f.value.is_array(); }
+
+    void insert(const std::string &itm_id, const json::json &val) noexcept override;
+    void erase(const std::string &itm_id, const json::json &val) noexcept override;
+
+    [[nodiscard]] size_t count(const item_filter &f, size_t limit) const noexcept override;
+    void find(const item_filter &f, const std::function<void(const std::string &)> &cb) const noexcept override;
+
+  private:
+    using key = std::variant<double, std::string>;
+    using ids = std::unordered_set<std::string>;
+
+    template <typename Fn>
+    void for_each(const item_filter &f, Fn &&fn) const noexcept;
+
+  private:
+    const index_kind kind;                    // The kind of the index..
+    std::unordered_map<key, ids> hash_index;  // The IDs of the items by value, for hash indexes..
+    std::map<key, ids> ordered_index;         // The IDs of the items by value, for ordered indexes..
+  };
+} // namespace coco
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "json.hpp"
+#include "coco_ts.hpp"
 #include "clips.h"
 #include <chrono>
 #include <optional>
@@ -58,9 +59,20 @@ namespace coco
     /**
      * @brief Gets the properties of the item.
      *
+     * The values of the static properties are stored in the columns of the types of the item, so the returned object is built on each call.
+     *
      * @return The properties of the item.
      */
-    [[nodiscard]] const json::json &get_properties() const { return properties; }
+    [[nodiscard]] json::json get_properties() const;
+    /**
+     * @brief Gets the value of a static property of the item.
+     *
+     * Only the column holding the property is read, so that the properties are not built as a whole.
+     *
+     * @param p_name The name of the static property.
+     * @return The value of the property, null if the item has none.
+     */
+    [[nodiscard]] json::json get_property_value(const std::string &p_name) const noexcept;
 
     /**
      * @brief Gets the value of the item.
@@ -75,8 +87,9 @@ namespace coco
      * This function takes a JSON object containing the properties and sets them for the item.
      *
      * @param props The JSON object containing the properties.
+     * @param validate Whether the values must be validated, false if the caller has already validated them.
      */
-    void set_properties(json::json &&props);
+    void set_properties(json::json &&props, bool validate = true);
 
     /**
      * @brief Sets the value of the item.
@@ -84,23 +97,66 @@ namespace coco
      * This function sets the value of the item using the provided pair of JSON value and timestamp.
      *
      * @param val The pair of JSON value and timestamp.
+     * @param keep_history Whether the value is recorded in the recent history, which is not the case for values merged from already recorded ones.
+     */
+    void set_value(std::pair<json::json, std::chrono::system_clock::time_point> &&val, bool keep_history = true);
+    /**
+     * @brief Records a value in the recent history, without updating the value of the item.
+     *
+     * @param val The value, an object mapping dynamic property names to values.
+     * @param timestamp The timestamp of the value.
+     */
+    void record(const json::json &val, const std::chrono::system_clock::time_point &timestamp) noexcept;
+
+    /**
+     * @brief Checks whether the recent history kept in memory holds every value of the given dynamic properties from the given time on.
+     *
+     * The recent history of a dynamic property is kept only if configured through the `history` key of the data of the type, either as a `count` of values or as a `duration` in seconds, for all the dynamic properties or, within its `properties` key, for each of them by name.
+     *
+     * @param props The dynamic properties, all of those of the item if empty.
+     * @param from The start time of the requested range.
+     * @return True if the recent history covers the requested range, false otherwise.
+     */
+    [[nodiscard]] bool covers(const std::vector<std::string> &props, const std::chrono::system_clock::time_point &from) const noexcept;
+    /**
+     * @brief Invokes the callback for each value of the recent history of the given dynamic properties within the given range.
+     *
+     * @param props The dynamic properties, all of those having a recent history if empty.
+     * @param from The start time of the range.
+     * @param to The end time of the range.
+     * @param cb The callback invoked, one dynamic property after the other, with the name of the property, the timestamp (in milliseconds since the epoch) and the value.
+     */
+    void get_history(const std::vector<std::string> &props, const std::chrono::system_clock::time_point &from, const std::chrono::system_clock::time_point &to, const std::function<void(const std::string &, int64_t, json::json &&)> &cb) const;
+    /**
+     * @brief Gets an estimate of the number of bytes used by the recent history kept in memory.
+     *
+     * @return The estimated number of bytes used by the recent history.
      */
-    void set_value(std::pair<json::json, std::chrono::system_clock::time_point> &&val);
+    [[nodiscard]] size_t get_history_bytes() const noexcept;
 
     [[nodiscard]] const property &get_property(std::string_view name) const;
 
+    /**
+     * @brief Gets the values of the static and dynamic properties of the item which reference other items.
+     *
+     * @return The name and the value, either an item ID or an array of item IDs, of each referencing property.
+     */
+    [[nodiscard]] std::vector<std::pair<std::string, json::json>> get_references() const noexcept;
+
     [[nodiscard]] json::json to_json() const noexcept;
 
   private:
     void add_type(const type &tp);
     void remove_type(const type &tp);
+    [[nodiscard]] bool is_reference(const std::string &p_name, bool dynamic) const noexcept;
 
   private:
     coco &cc;                                                                          // The CoCo object..
     const std::string id;                                                              // The ID of the item.
     std::map<std::string, Fact *> item_facts;                                          // The facts representing, for each type, the item itself.
     std::map<std::string, std::map<std::string, Fact *>> value_facts;                  // The facts representing, for each type, the value of the item.
-    json::json properties;                                                             // The properties of the item.
+    json::json properties;                                                             // The properties of the item not held by the columns of its types.
     std::optional<std::pair<json::json, std::chrono::system_clock::time_point>> value; // The value of the item.
+    std::map<std::string, ts_buffer> history;                                          // The recent history of the dynamic properties, for those which are configured to keep it.
   };
 } // namespace coco
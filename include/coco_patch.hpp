@@ -0,0 +1,59 @@
+#pragma once
+
+#include "json.hpp"
+#include <string_view>
+#include <vector>
+
+namespace coco
+{
+  enum class patch_kind : uint8_t
+  {
+    add,     // Adds a value, inserting it if the target is an array index or `-`..
+    remove,  // Removes a value..
+    replace, // Replaces an existing value..
+    move,    // Moves a value..
+    copy,    // Copies a value..
+    test,    // Checks that a value equals the given one..
+    set      // Sets a value, creating the missing parent objects and replacing the existing array elements..
+  };
+
+  /**
+   * @brief An operation of a JSON patch.
+   */
+  struct patch_op
+  {
+    patch_kind kind;               // The kind of operation..
+    std::vector<std::string> path; // The reference tokens of the target..
+    std::vector<std::string> from; // The reference tokens of the source, for the `move` and `copy` operations..
+    json::json value;              // The value, for the `add`, `replace`, `test` and `set` operations..
+  };
+
+  /**
+   * @brief Splits a JSON pointer into its unescaped reference tokens.
+   *
+   * @param ptr The JSON pointer.
+   * @return The reference tokens.
+   * @throws std::invalid_argument if the pointer is not empty and does not start with `/`.
+   */
+  [[nodiscard]] std::vector<std::string> parse_pointer(std::string_view ptr);
+
+  /**
+   * @brief Parses a JSON patch.
+   *
+   * Besides the RFC 6902 operations, the patch can use the `append` (`{"op": "append", "path": ..., "value": ...}`), `remove_at` (`{"op": "remove_at", "path": ..., "index": ...}`) and `set_path` (`{"op": "set_path", "path": ..., "value": ...}`) shorthands, which add an element at the end of an array, remove an element of an array and set a value creating the missing parent objects. Unlike `add`, `set_path` replaces the element at an existing array index, inserting only at the end of the array.
+   *
+   * @param patch The patch, as an array of operations.
+   * @return The operations of the patch.
+   * @throws std::invalid_argument if the patch is malformed.
+   */
+  [[nodiscard]] std::vector<patch_op> parse_patch(const json::json &patch);
+
+  /**
+   * @brief Applies an operation of a JSON patch to a document.
+   *
+   * @param doc The document.
+   * @param op The operation.
+   * @throws std::invalid_argument if the operation cannot be applied, in which case the document should be discarded.
+   */
+  void apply_patch(json::json &doc, const patch_op &op);
+} // namespace coco
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "json.hpp"
+#include "coco_ts.hpp"
+#include "coco_vector.hpp"
 #include "clips.h"
 #include <memory>
 #include <random>
@@ -15,11 +17,15 @@ namespace coco
   constexpr const char *symbol_kw = "symbol";
   constexpr const char *item_kw = "item";
   constexpr const char *json_kw = "json";
+  constexpr const char *geo_kw = "geo";
+  constexpr const char *vector_kw = "vector";
 
   class coco;
   class type;
   class property;
   class item;
+  class column;
+  class schema_validator;
 
   class property_type
   {
@@ -118,6 +124,24 @@ namespace coco
     [[nodiscard]] std::unique_ptr<property> new_instance(type &tp, bool dynamic, std::string_view name, const json::json &j) noexcept override;
   };
 
+  class geo_property_type final : public property_type
+  {
+  public:
+    geo_property_type(coco &cc) noexcept;
+
+  private:
+    [[nodiscard]] std::unique_ptr<property> new_instance(type &tp, bool dynamic, std::string_view name, const json::json &j) noexcept override;
+  };
+
+  class vector_property_type final : public property_type
+  {
+  public:
+    vector_property_type(coco &cc) noexcept;
+
+  private:
+    [[nodiscard]] std::unique_ptr<property> new_instance(type &tp, bool dynamic, std::string_view name, const json::json &j) noexcept override;
+  };
+
   class property
   {
     friend class type;
@@ -170,16 +194,41 @@ namespace coco
     [[nodiscard]] virtual bool validate(const json::json &j) const noexcept = 0;
 
     [[nodiscard]] virtual bool is_complex() const noexcept = 0;
+    /**
+     * @brief Checks whether the property holds an array of independent values, so that each of them can be validated on its own.
+     *
+     * @return True if the property holds multiple values, false otherwise.
+     */
+    [[nodiscard]] virtual bool is_multiple() const noexcept { return false; }
 
     [[nodiscard]] virtual json::json to_json() const noexcept = 0;
 
     [[nodiscard]] virtual json::json fake() const noexcept = 0;
 
+    /**
+     * @brief Gets the policy according to which the values of the property are archived.
+     *
+     * @return The archive policy, or an empty optional if every value is stored.
+     */
+    [[nodiscard]] virtual std::optional<archive_policy> get_archive() const noexcept { return std::nullopt; }
+
+    /**
+     * @brief Creates the column holding the values of the static property for the instances of its type.
+     *
+     * @return A new, empty, column.
+     */
+    [[nodiscard]] virtual std::unique_ptr<column> new_column() const noexcept;
+
   protected:
     [[nodiscard]] std::string get_deftemplate_name() const noexcept;
 
     Environment *get_env() const noexcept;
     const json::json &get_schemas() const noexcept;
+    [[nodiscard]] std::shared_ptr<const schema_validator> get_validator(const json::json &schema) const noexcept;
+    [[nodiscard]] size_t get_schemas_version() const noexcept;
+    [[nodiscard]] CLIPSExternalAddress *get_json_address(std::shared_ptr<const json::json> doc) const noexcept;
+    [[nodiscard]] const json::json *get_json_document(void *value) const noexcept;
+    [[nodiscard]] CLIPSExternalAddress *get_vector_address(std::shared_ptr<const vector_buffer> buf) const noexcept;
     std::mt19937 &get_gen() const noexcept;
 
   private:
@@ -230,12 +279,15 @@ namespace coco
 
     [[nodiscard]] bool validate(const json::json &j) const noexcept override;
 
+    [[nodiscard]] bool is_multiple() const noexcept override { return multiple; }
     [[nodiscard]] bool is_complex() const noexcept override { return false; }
 
     [[nodiscard]] json::json to_json() const noexcept override;
 
     [[nodiscard]] json::json fake() const noexcept override;
 
+    [[nodiscard]] std::unique_ptr<column> new_column() const noexcept override;
+
   private:
     void set_value(FactBuilder *property_fact_builder, const json::json &value) const noexcept override;
     void set_value(FactModifier *property_fact_modifier, const json::json &value) const noexcept override;
@@ -250,16 +302,21 @@ namespace coco
   class int_property final : public property
   {
   public:
-    int_property(const property_type &pt, const type &tp, bool dynamic, std::string_view name, bool nullable = false, bool multiple = false, std::optional<std::vector<long>> default_value = std::nullopt, std::optional<long> min = std::nullopt, std::optional<long> max = std::nullopt) noexcept;
+    int_property(const property_type &pt, const type &tp, bool dynamic, std::string_view name, bool nullable = false, bool multiple = false, std::optional<std::vector<long>> default_value = std::nullopt, std::optional<long> min = std::nullopt, std::optional<long> max = std::nullopt, std::optional<archive_policy> archive = std::nullopt) noexcept;
 
     [[nodiscard]] bool validate(const json::json &j) const noexcept override;
 
+    [[nodiscard]] bool is_multiple() const noexcept override { return multiple; }
     [[nodiscard]] bool is_complex() const noexcept override { return false; }
 
     [[nodiscard]] json::json to_json() const noexcept override;
 
     [[nodiscard]] json::json fake() const noexcept override;
 
+    [[nodiscard]] std::unique_ptr<column> new_column() const noexcept override;
+
+    [[nodiscard]] std::optional<archive_policy> get_archive() const noexcept override { return archive; }
+
   private:
     void set_value(FactBuilder *property_fact_builder, const json::json &value) const noexcept override;
     void set_value(FactModifier *property_fact_modifier, const json::json &value) const noexcept override;
@@ -271,21 +328,27 @@ namespace coco
     std::optional<std::vector<long>> default_value; // The default value for the property.
     std::optional<long> min;                        // The minimum value allowed for the property.
     std::optional<long> max;                        // The maximum value allowed for the property.
+    std::optional<archive_policy> archive;          // The policy according to which the values of the property are archived.
   };
 
   class float_property final : public property
   {
   public:
-    float_property(const property_type &pt, const type &tp, bool dynamic, std::string_view name, bool nullable = false, bool multiple = false, std::optional<std::vector<double>> default_value = std::nullopt, std::optional<double> min = std::nullopt, std::optional<double> max = std::nullopt) noexcept;
+    float_property(const property_type &pt, const type &tp, bool dynamic, std::string_view name, bool nullable = false, bool multiple = false, std::optional<std::vector<double>> default_value = std::nullopt, std::optional<double> min = std::nullopt, std::optional<double> max = std::nullopt, std::optional<archive_policy> archive = std::nullopt) noexcept;
 
     [[nodiscard]] bool validate(const json::json &j) const noexcept override;
 
+    [[nodiscard]] bool is_multiple() const noexcept override { return multiple; }
     [[nodiscard]] bool is_complex() const noexcept override { return false; }
 
     [[nodiscard]] json::json to_json() const noexcept override;
 
     [[nodiscard]] json::json fake() const noexcept override;
 
+    [[nodiscard]] std::unique_ptr<column> new_column() const noexcept override;
+
+    [[nodiscard]] std::optional<archive_policy> get_archive() const noexcept override { return archive; }
+
   private:
     void set_value(FactBuilder *property_fact_builder, const json::json &value) const noexcept override;
     void set_value(FactModifier *property_fact_modifier, const json::json &value) const noexcept override;
@@ -297,6 +360,7 @@ namespace coco
     std::optional<std::vector<double>> default_value; // The default value for the property.
     std::optional<double> min;                        // The minimum value allowed for the property.
     std::optional<double> max;                        // The maximum value allowed for the property.
+    std::optional<archive_policy> archive;            // The policy according to which the values of the property are archived.
   };
 
   class string_property final : public property
@@ -306,12 +370,15 @@ namespace coco
 
     [[nodiscard]] bool validate(const json::json &j) const noexcept override;
 
+    [[nodiscard]] bool is_multiple() const noexcept override { return multiple; }
     [[nodiscard]] bool is_complex() const noexcept override { return false; }
 
     [[nodiscard]] json::json to_json() const noexcept override;
 
     [[nodiscard]] json::json fake() const noexcept override;
 
+    [[nodiscard]] std::unique_ptr<column> new_column() const noexcept override;
+
   private:
     void set_value(FactBuilder *property_fact_builder, const json::json &value) const noexcept override;
     void set_value(FactModifier *property_fact_modifier, const json::json &value) const noexcept override;
@@ -330,12 +397,15 @@ namespace coco
 
     [[nodiscard]] bool validate(const json::json &j) const noexcept override;
 
+    [[nodiscard]] bool is_multiple() const noexcept override { return multiple; }
     [[nodiscard]] bool is_complex() const noexcept override { return multiple; }
 
     [[nodiscard]] json::json to_json() const noexcept override;
 
     [[nodiscard]] json::json fake() const noexcept override;
 
+    [[nodiscard]] std::unique_ptr<column> new_column() const noexcept override;
+
   private:
     void set_value(FactBuilder *property_fact_builder, const json::json &value) const noexcept override;
     void set_value(FactModifier *property_fact_modifier, const json::json &value) const noexcept override;
@@ -351,7 +421,16 @@ namespace coco
   class item_property final : public property
   {
   public:
-    item_property(const property_type &pt, const type &tp, bool dynamic, std::string_view name, const type &domain, bool nullable = false, bool multiple = false, std::optional<std::vector<std::reference_wrapper<item>>> default_value = std::nullopt) noexcept;
+    item_property(const property_type &pt, const type &tp, bool dynamic, std::string_view name, const type &domain, bool nullable = false, bool multiple = false, std::optional<std::vector<std::reference_wrapper<item>>> default_value = std::nullopt, bool cascade = false) noexcept;
+
+    [[nodiscard]] bool is_multiple() const noexcept override { return multiple; }
+
+    /**
+     * @brief Checks whether deleting a referenced item deletes the referencing items as well, rather than removing the reference from them.
+     *
+     * @return True if the deletion cascades to the referencing items, false otherwise.
+     */
+    [[nodiscard]] bool is_cascading() const noexcept { return cascade; }
 
     [[nodiscard]] bool validate(const json::json &j) const noexcept override;
 
@@ -371,6 +450,7 @@ namespace coco
     const type &domain;                                                     // The domain of the property.
     bool multiple;                                                          // Indicates whether the property can have multiple values.
     std::optional<std::vector<std::reference_wrapper<item>>> default_value; // The default value for the property.
+    bool cascade;                                                           // Indicates whether deleting a referenced item deletes the referencing items as well.
   };
 
   class json_property final : public property
@@ -386,6 +466,92 @@ namespace coco
 
     [[nodiscard]] json::json fake() const noexcept override;
 
+  private:
+    void set_value(FactBuilder *property_fact_builder, const json::json &value) const noexcept override;
+    /**
+     * Sets the value of the property using a FactModifier.
+     *
+     * A value equal, as a JSON document, to the one currently held by the fact keeps the current external address, so that CLIPS sees the slot as unchanged and the rules matching it are not reactivated. The documents are compared through the JSON equality, hence by value rather than by address.
+     */
+    void set_value(FactModifier *property_fact_modifier, const json::json &value) const noexcept override;
+
+    std::string get_slot_declaration() const noexcept override;
+
+  private:
+    std::optional<json::json> schema;                                // The validation schema..
+    std::optional<json::json> default_value;                         // The default value for the property.
+    std::shared_ptr<const json::json> default_document;              // The default value, shared by the facts it is assigned to..
+    mutable std::shared_ptr<const schema_validator> validator;       // The compiled validation schema, if the schema can be compiled..
+    mutable size_t validator_version = 0;                            // The version of the JSON schemas the validator has been compiled against..
+  };
+
+  /**
+   * @brief A property holding a geographic shape, either a `{"lat": ..., "lon": ...}` point or, for polygon properties, an array of such points.
+   *
+   * The shape is represented in CLIPS as a compact multislot of floats alternating latitudes and longitudes. The items are spatially indexed on the property, so that they can be filtered by area.
+   */
+  class geo_property final : public property
+  {
+  public:
+    geo_property(const property_type &pt, const type &tp, bool dynamic, std::string_view name, bool nullable = false, bool polygon = false) noexcept;
+
+    [[nodiscard]] bool is_polygon() const noexcept { return polygon; }
+
+    [[nodiscard]] bool validate(const json::json &j) const noexcept override;
+
+    [[nodiscard]] bool is_complex() const noexcept override { return true; }
+
+    [[nodiscard]] json::json to_json() const noexcept override;
+
+    [[nodiscard]] json::json fake() const noexcept override;
+
+  private:
+    void set_value(FactBuilder *property_fact_builder, const json::json &value) const noexcept override;
+    void set_value(FactModifier *property_fact_modifier, const json::json &value) const noexcept override;
+
+    std::string get_slot_declaration() const noexcept override;
+
+  private:
+    bool polygon; // Indicates whether the property holds polygons rather than points.
+  };
+
+  /**
+   * @brief A property holding a vector of numbers of a given element type, such as a spectrum or a waveform.
+   *
+   * The vector is represented in CLIPS as an external address sharing its decoded buffer, which the rules read through the vector-* functions rather than unpacking it into a multifield.
+   */
+  class vector_property final : public property
+  {
+  public:
+    vector_property(const property_type &pt, const type &tp, bool dynamic, std::string_view name, bool nullable = false, vector_dtype dtype = vector_dtype::f64, std::optional<size_t> length = std::nullopt, std::optional<size_t> max_length = std::nullopt, std::optional<double> min = std::nullopt, std::optional<double> max = std::nullopt) noexcept;
+
+    [[nodiscard]] vector_dtype get_dtype() const noexcept { return dtype; }
+
+    /**
+     * @brief Decodes and validates a vector of the property.
+     *
+     * The last decoded vector is kept, along with its wire and compact forms, so that the validation, the compaction and the facts of a value share a single decoded buffer.
+     *
+     * @param j The vector, either as an array of numbers or in its compact form.
+     * @return The decoded buffer, or a null pointer if the value is not a valid vector of the property.
+     */
+    [[nodiscard]] std::shared_ptr<const vector_buffer> decode(const json::json &j) const noexcept;
+    /**
+     * @brief Gets the compact form of a vector of the property.
+     *
+     * @param j The vector.
+     * @return The base64 form of the vector, or the value itself if it is not a valid vector of the property.
+     */
+    [[nodiscard]] json::json compact(const json::json &j) const noexcept;
+
+    [[nodiscard]] bool validate(const json::json &j) const noexcept override;
+
+    [[nodiscard]] bool is_complex() const noexcept override { return true; }
+
+    [[nodiscard]] json::json to_json() const noexcept override;
+
+    [[nodiscard]] json::json fake() const noexcept override;
+
   private:
     void set_value(FactBuilder *property_fact_builder, const json::json &value) const noexcept override;
     void set_value(FactModifier *property_fact_modifier, const json::json &value) const noexcept override;
@@ -393,7 +559,13 @@ namespace coco
     std::string get_slot_declaration() const noexcept override;
 
   private:
-    std::optional<json::json> schema;        // The validation schema..
-    std::optional<json::json> default_value; // The default value for the property.
+    vector_dtype dtype;                                       // The type of the elements..
+    std::optional<size_t> length;                             // The length of the vectors, if fixed..
+    std::optional<size_t> max_length;                         // The maximum length of the vectors..
+    std::optional<double> min;                                // The minimum value allowed for the elements..
+    std::optional<double> max;                                // The maximum value allowed for the elements..
+    mutable json::json last_value;                            // The last decoded vector, as received..
+    mutable json::json last_compact;                          // The last decoded vector, in its compact form..
+    mutable std::shared_ptr<const vector_buffer> last_buffer; // The last decoded vector..
   };
 } // namespace coco
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "json.hpp"
+#include <optional>
+#include <regex>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace coco
+{
+  /**
+   * @brief A JSON schema compiled into a program of nodes, so that values are validated without re-walking the schema.
+   *
+   * References are resolved, enumerations are turned into sets, patterns into regular expressions and the property names of objects are sorted once, at compile time. References are resolved against the given schemas, either by name (`#/components/schemas/name`, `#/name`) or by JSON pointer, and may be recursive.
+   */
+  class schema_validator final
+  {
+  public:
+    /**
+     * @brief Compiles a JSON schema.
+     *
+     * @param schema The schema.
+     * @param schemas The schemas the references are resolved against.
+     * @throws std::invalid_argument if the schema uses an unsupported keyword or an unresolvable reference.
+     */
+    schema_validator(const json::json &schema, const json::json &schemas);
+
+    /**
+     * @brief Validates a value against the compiled schema.
+     *
+     * @param j The value.
+     * @return True if the value is valid, false otherwise.
+     */
+    [[nodiscard]] bool validate(const json::json &j) const noexcept { return validate(j, 0); }
+
+  private:
+    struct key
+    {
+      std::string name;          // The name of the property..
+      std::optional<size_t> sub; // The node the property must satisfy, if listed..
+      bool required = false;     // Whether the property is required..
+    };
+
+    struct node
+    {
+      uint8_t types = 0xFF;                                        // The allowed JSON types, as a bitmask..
+      std::vector<json::json> enum_values;                         // The allowed non-string values, if enumerated..
+      std::unordered_set<std::string> enum_strings;                // The allowed string values, if enumerated..
+      bool enumerated = false;                                     // Whether the values are enumerated..
+      std::optional<double> minimum, maximum;                      // The inclusive bounds of numbers..
+      std::optional<double> exclusive_minimum, exclusive_maximum;  // The exclusive bounds of numbers..
+      std::optional<size_t> min_length, max_length;                // The bounds of the length of strings..
+      std::optional<std::regex> pattern;                           // The pattern strings must contain..
+      std::vector<key> keys;                                       // The listed and the required properties of objects, sorted by name..
+      size_t n_required = 0;                                       // The number of required properties of objects..
+      bool additional = true;                                      // Whether objects may have properties other than the listed ones..
+      std::optional<size_t> additional_node;                       // The node the other properties of objects must satisfy, if any..
+      std::optional<size_t> items;                                 // The node the items of arrays must satisfy, if any..
+      std::optional<size_t> min_items, max_items;                  // The bounds of the size of arrays..
+      std::vector<size_t> all_of, any_of, one_of;                  // The combined nodes..
+      std::optional<size_t> not_node;                              // The node values must not satisfy, if any..
+      std::optional<size_t> ref;                                   // The referenced node, if any..
+    };
+
+    size_t compile(const json::json &schema, const json::json &schemas, std::unordered_map<std::string, size_t> &refs);
+    [[nodiscard]] bool validate(const json::json &j, size_t n) const noexcept;
+
+  private:
+    std::vector<node> nodes; // The nodes of the program, the first being the root..
+  };
+} // namespace coco
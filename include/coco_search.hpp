@@ -0,0 +1,57 @@
+#pragma once
+
+#include "json.hpp"
+#include <functional>
+#include <map>
+#include <unordered_map>
+
+namespace coco
+{
+  /**
+   * @brief Splits a text into its lowercase tokens, that is its maximal runs of letters and digits.
+   *
+   * Non-ASCII characters are considered letters, so that UTF-8 encoded words are kept whole.
+   *
+   * @param text The text.
+   * @return The tokens of the text, in order.
+   */
+  [[nodiscard]] std::vector<std::string> tokenize(std::string_view text) noexcept;
+
+  /**
+   * @brief An inverted index from the tokens of the values of a `string` or `symbol` property to the IDs of the items holding them.
+   *
+   * The tokens are kept sorted, so that the items holding a token starting with a given prefix are found by a range scan.
+   */
+  class text_index
+  {
+  public:
+    /**
+     * @brief Indexes the tokens of the value of the property of an item.
+     *
+     * @param itm_id The ID of the item.
+     * @param val The value of the property, either a string or an array of strings.
+     */
+    void insert(const std::string &itm_id, const json::json &val) noexcept;
+    /**
+     * @brief Removes the tokens of the value of the property of an item from the index.
+     *
+     * @param itm_id The ID of the item.
+     * @param val The indexed value of the property.
+     */
+    void erase(const std::string &itm_id, const json::json &val) noexcept;
+
+    /**
+     * @brief Invokes the callback with the ID and the relevance of each item holding a token starting with the given one.
+     *
+     * The relevance grows with the occurrences and the rarity of the matching tokens, and is highest when they equal the given one.
+     *
+     * @param token The token, or the prefix of a token.
+     * @param cb The callback, invoked once per item.
+     */
+    void search(std::string_view token, const std::function<void(const std::string &, double)> &cb) const noexcept;
+
+  private:
+    std::map<std::string, std::unordered_map<std::string, unsigned>, std::less<>> postings; // The occurrences of each token, by item ID..
+    std::unordered_map<std::string, unsigned> tokens;                                       // The number of indexed tokens, by item ID..
+  };
+} // namespace coco
@@ -0,0 +1,418 @@
+#pragma once
+
+#include "json.hpp"
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <map>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace coco
+{
+  /**
+   * @brief A growable sequence of bits, packed most significant bit first into 64-bit words.
+   */
+  class bit_stream
+  {
+  public:
+    /**
+     * @brief Appends the `n` lowest bits of `bits` to the stream.
+     *
+     * @param bits The bits to append.
+     * @param n The number of bits to append (at most 64).
+     */
+    void write(uint64_t bits, unsigned n);
+
+    /**
+     * @brief Gets the number of bits written in the stream.
+     *
+     * @return The number of bits written in the stream.
+     */
+    [[nodiscard]] size_t size() const noexcept { return n_bits; }
+    /**
+     * @brief Gets the number of bytes used by the stream.
+     *
+     * @return The number of bytes used by the stream.
+     */
+    [[nodiscard]] size_t bytes() const noexcept { return words.capacity() * sizeof(uint64_t); }
+
+    /**
+     * @brief Releases the unused capacity of the stream.
+     */
+    void shrink() { words.shrink_to_fit(); }
+
+    class reader
+    {
+    public:
+      reader(const bit_stream &bs) noexcept : bs(bs) {}
+
+      [[nodiscard]] uint64_t read(unsigned n) noexcept;
+      [[nodiscard]] bool read_bit() noexcept { return read(1); }
+
+    private:
+      const bit_stream &bs;
+      size_t pos = 0;
+    };
+
+  private:
+    std::vector<uint64_t> words;
+    size_t n_bits = 0;
+  };
+
+  /**
+   * @brief An immutable-once-sealed run of consecutive points of a single dynamic property.
+   *
+   * Timestamps are stored as delta-of-delta, floats are XOR-ed with their predecessor (Gorilla encoding), integers are stored as zig-zag encoded deltas in variable width bit fields, booleans as single bits and strings, symbols and complex values as codes into a chunk local dictionary.
+   */
+  class ts_chunk
+  {
+  public:
+    enum class kind : uint8_t
+    {
+      null,
+      boolean,
+      integer,
+      real,
+      string,
+      complex
+    };
+
+    ts_chunk(kind k) noexcept : k(k) {}
+
+    /**
+     * @brief Gets the kind of column which can store the given value.
+     *
+     * @param val The value.
+     * @return The kind of column which can store the value.
+     */
+    [[nodiscard]] static kind kind_of(const json::json &val) noexcept;
+
+    [[nodiscard]] kind get_kind() const noexcept { return k; }
+    [[nodiscard]] size_t size() const noexcept { return count; }
+    [[nodiscard]] int64_t get_from() const noexcept { return first_ts; }
+    [[nodiscard]] int64_t get_to() const noexcept { return last_ts; }
+    [[nodiscard]] bool is_sealed() const noexcept { return sealed; }
+    /**
+     * @brief Gets the number of bytes used by the chunk.
+     *
+     * @return The number of bytes used by the chunk.
+     */
+    [[nodiscard]] size_t bytes() const noexcept;
+
+    /**
+     * @brief Appends a point to the chunk.
+     *
+     * The value must be of the kind of the chunk and the timestamp must not precede the last appended one.
+     *
+     * @param timestamp The timestamp of the point, in milliseconds since the epoch.
+     * @param val The value of the point.
+     */
+    void append(int64_t timestamp, const json::json &val);
+    /**
+     * @brief Seals the chunk, releasing the encoder state.
+     */
+    void seal();
+
+    /**
+     * @brief Decodes the points of the chunk whose timestamp is within the given range.
+     *
+     * The timestamps and the values are first decoded into flat buffers, whose reconstruction loops carry no per-point branches, up to the end of the range. Only the points within the range are then turned into JSON values.
+     *
+     * @param from The start of the range, in milliseconds since the epoch.
+     * @param to The end of the range, in milliseconds since the epoch.
+     * @param cb The callback invoked for each decoded point.
+     */
+    void decode(int64_t from, int64_t to, const std::function<void(int64_t, json::json &&)> &cb) const;
+
+  private:
+    kind k;
+    bool sealed = false;
+    size_t count = 0;
+    int64_t first_ts = 0, last_ts = 0, last_delta = 0;
+    bit_stream timestamps, values;
+    // encoder state..
+    uint64_t last_bits = 0;
+    unsigned last_lz = 0, last_tz = 0;
+    uint32_t last_code = 0;
+    std::vector<std::string> dictionary;
+    std::unordered_map<std::string, uint32_t> codes;
+  };
+
+  /**
+   * @brief The chunked history of a single dynamic property of an item.
+   */
+  class ts_series
+  {
+  public:
+    ts_series(size_t chunk_size, size_t max_points) noexcept : chunk_size(chunk_size), max_points(max_points) {}
+
+    /**
+     * @brief Appends a point to the series, removing the oldest chunks once the series holds more than its maximum number of points.
+     */
+    void append(int64_t timestamp, const json::json &val);
+    /**
+     * @brief Decodes the points within the given range, skipping the chunks which do not overlap it.
+     */
+    void decode(int64_t from, int64_t to, const std::function<void(int64_t, json::json &&)> &cb) const;
+
+    /**
+     * @brief Removes the chunks whose points all precede the given timestamp, until at least the given number of points has been removed.
+     *
+     * @return The number of removed points.
+     */
+    size_t expire(int64_t before, size_t limit) noexcept;
+    /**
+     * @brief Gets the number of points in the chunks which would be removed by `expire`.
+     */
+    [[nodiscard]] size_t expired(int64_t before) const noexcept;
+
+    [[nodiscard]] size_t size() const noexcept { return n_points; }
+    [[nodiscard]] size_t bytes() const noexcept;
+
+  private:
+    const size_t chunk_size, max_points;
+    std::vector<ts_chunk> chunks;
+    size_t n_points = 0; // The number of points in the chunks..
+  };
+
+  /**
+   * @brief A bounded, uncompressed, buffer of the most recent points of a single dynamic property.
+   *
+   * The buffer holds every point whose timestamp is not earlier than its coverage start. Evicting a point, either because the buffer is full or because the point is older than the retained duration, moves the coverage start past it.
+   */
+  class ts_buffer
+  {
+  public:
+    /**
+     * @brief Constructs a new `ts_buffer` object.
+     *
+     * @param capacity The maximum number of points of the buffer.
+     * @param duration The maximum time span of the buffer, unbounded if zero.
+     * @param covered_since The timestamp, in milliseconds since the epoch, from which the buffer starts recording.
+     */
+    ts_buffer(size_t capacity, const std::chrono::milliseconds &duration, int64_t covered_since) noexcept : capacity(capacity), duration(duration.count()), covered_since(covered_since) {}
+
+    /**
+     * @brief Records a point, replacing the one with the same timestamp, if any.
+     *
+     * Points earlier than the coverage start are ignored.
+     *
+     * @param timestamp The timestamp of the point, in milliseconds since the epoch.
+     * @param val The value of the point.
+     */
+    void push(int64_t timestamp, const json::json &val);
+    /**
+     * @brief Invokes the callback, in timestamp order, for each point within the given range.
+     */
+    void decode(int64_t from, int64_t to, const std::function<void(int64_t, json::json &&)> &cb) const;
+
+    /**
+     * @brief Gets the timestamp from which the buffer holds every point.
+     *
+     * @return The coverage start, in milliseconds since the epoch.
+     */
+    [[nodiscard]] int64_t get_covered_since() const noexcept { return covered_since; }
+    [[nodiscard]] size_t size() const noexcept { return points.size(); }
+    /**
+     * @brief Gets an estimate of the number of bytes used by the buffer.
+     *
+     * @return The estimated number of bytes used by the buffer.
+     */
+    [[nodiscard]] size_t bytes() const noexcept { return sizeof(ts_buffer) + n_bytes; }
+
+  private:
+    void evict() noexcept;
+
+  private:
+    struct point
+    {
+      int64_t timestamp; // The timestamp of the point..
+      json::json val;    // The value of the point..
+      size_t bytes;      // The estimated size of the point, computed once when the point is recorded..
+    };
+
+    const size_t capacity;
+    const int64_t duration;
+    int64_t covered_since;
+    std::deque<point> points;
+    size_t n_bytes = 0; // The estimated size of the points..
+  };
+
+  /**
+   * @brief Stitches the points of several dynamic properties back into rows sorted by timestamp.
+   *
+   * Only the first `limit + 1` rows are kept, regardless of the number of points, the extra one telling where the next page starts.
+   */
+  class ts_stitcher
+  {
+  public:
+    ts_stitcher(size_t limit = std::numeric_limits<size_t>::max()) noexcept : limit(limit), keep(limit < std::numeric_limits<size_t>::max() ? limit + 1 : limit) {}
+
+    void add(const std::string &name, int64_t timestamp, json::json &&val);
+    /**
+     * @brief Invokes the callback, in timestamp order, for the first `limit` rows.
+     *
+     * @param cb The callback invoked for each row with its timestamp and data.
+     * @return The timestamp of the first row beyond the limit, if any.
+     */
+    std::optional<int64_t> flush(const std::function<void(int64_t, json::json &&)> &cb);
+
+  private:
+    const size_t limit, keep;
+    std::map<int64_t, json::json> rows;
+  };
+
+  /**
+   * @brief The lossy compression applied to the archived points of a numeric dynamic property.
+   */
+  enum class archive_mode : uint8_t
+  {
+    deadband,     // A point is archived only if it differs from the last archived one by more than the deviation..
+    swinging_door // A point is archived only if the points since the last archived one can no longer be interpolated within the deviation..
+  };
+
+  /**
+   * @brief The archive policy of a numeric dynamic property.
+   */
+  struct archive_policy
+  {
+    archive_mode mode = archive_mode::swinging_door;
+    double deviation = 0; // The maximum error, in the unit of the property, of the reconstructed series..
+  };
+
+  /**
+   * @brief Filters the points of a numeric dynamic property, keeping only those needed to reconstruct its series within the deviation.
+   *
+   * With the `deadband` mode, the series is reconstructed by holding the last archived value. With the `swinging_door` mode, the series is reconstructed by linear interpolation between the archived points: the latest point is held back until a new one closes the door, in which case the held point is archived, moved onto the interpolating line if its own value would break the bound of the points it covers.
+   * Non numeric values, as well as points which do not follow the held one, are always archived, after the held point.
+   */
+  class ts_archive
+  {
+  public:
+    ts_archive(const archive_policy &policy) noexcept : policy(policy) {}
+
+    /**
+     * @brief Filters a point.
+     *
+     * Late points, not newer than the latest point in order, are archived as they are, so that they do not move the anchor of the segment being built.
+     *
+     * @param timestamp The timestamp of the point, in milliseconds since the epoch.
+     * @param val The value of the point.
+     * @param cb The callback invoked, in timestamp order except for the late points, for each point to archive.
+     */
+    void push(int64_t timestamp, const json::json &val, const std::function<void(int64_t, const json::json &)> &cb);
+    /**
+     * @brief Archives the held point, if any.
+     *
+     * @param cb The callback invoked for the held point.
+     */
+    void flush(const std::function<void(int64_t, const json::json &)> &cb);
+
+    [[nodiscard]] const archive_policy &get_policy() const noexcept { return policy; }
+
+  private:
+    void archive(int64_t timestamp, const json::json &val, const std::function<void(int64_t, const json::json &)> &cb);
+
+  private:
+    const archive_policy policy;
+    std::optional<std::pair<int64_t, double>> anchor;         // The last archived point, if numeric..
+    std::optional<std::pair<int64_t, json::json>> held;       // The latest point, not archived yet..
+    std::optional<int64_t> latest;                            // The timestamp of the latest point in order, the points not newer than it being late..
+    double lower = -std::numeric_limits<double>::infinity(); // The greatest lower slope of the door..
+    double upper = std::numeric_limits<double>::infinity();  // The smallest upper slope of the door..
+  };
+
+  /**
+   * @brief A compressed, column oriented, store of item data.
+   *
+   * Each dynamic property of each item is stored in its own series of chunks so that range queries only decode the chunks overlapping the requested interval.
+   */
+  class ts_store
+  {
+  public:
+    /**
+     * @brief Constructs a new `ts_store` object.
+     *
+     * @param chunk_size The maximum number of points of a chunk.
+     * @param max_points The maximum number of points kept for each dynamic property of each item, the oldest chunks being removed beyond it.
+     */
+    ts_store(size_t chunk_size = 1024, size_t max_points = std::numeric_limits<size_t>::max()) noexcept : chunk_size(chunk_size), max_points(max_points) {}
+
+    /**
+     * @brief Appends the given value to the history of the item.
+     *
+     * @param itm_id The ID of the item.
+     * @param val The value, an object mapping dynamic property names to values.
+     * @param timestamp The timestamp of the value.
+     */
+    void append(std::string_view itm_id, const json::json &val, const std::chrono::system_clock::time_point &timestamp);
+    /**
+     * @brief Gets the values of the item within the given range, as an array of `{"data": ..., "timestamp": ...}` objects sorted by timestamp.
+     */
+    [[nodiscard]] json::json get_values(std::string_view itm_id, const std::chrono::system_clock::time_point &from, const std::chrono::system_clock::time_point &to) const;
+    /**
+     * @brief Gets the first `limit` values of the item within the given range, projected on the given dynamic properties.
+     *
+     * At most `limit + 1` rows are held while the columns are stitched back together, regardless of the size of the range.
+     *
+     * @param itm_id The ID of the item.
+     * @param props The dynamic properties to retrieve, all of them if empty.
+     * @param from The start of the range.
+     * @param to The end of the range.
+     * @param limit The maximum number of values to retrieve.
+     * @param cb The callback invoked, in timestamp order, for each value with its timestamp and data.
+     * @return The timestamp of the first value beyond the limit, if any.
+     */
+    std::optional<int64_t> get_values(std::string_view itm_id, const std::vector<std::string> &props, const std::chrono::system_clock::time_point &from, const std::chrono::system_clock::time_point &to, size_t limit, const std::function<void(int64_t, json::json &&)> &cb) const;
+    /**
+     * @brief Streams the points of the item within the given range, one dynamic property after the other, without materializing them.
+     *
+     * @param itm_id The ID of the item.
+     * @param props The dynamic properties to stream, all of them if empty.
+     * @param from The start of the range.
+     * @param to The end of the range.
+     * @param cb The callback invoked for each point with the name of the dynamic property, the timestamp and the value.
+     */
+    void scan(std::string_view itm_id, const std::vector<std::string> &props, const std::chrono::system_clock::time_point &from, const std::chrono::system_clock::time_point &to, const std::function<void(const std::string &, int64_t, json::json &&)> &cb) const;
+
+    /**
+     * @brief Removes the points of the item which precede the given time, stopping once `limit` points have been removed.
+     *
+     * Points are removed a whole chunk at a time, so a chunk is kept until all of its points have expired and the last removed chunk can exceed the limit.
+     *
+     * @param itm_id The ID of the item.
+     * @param before The expiration time.
+     * @param limit The maximum number of points to remove.
+     * @return The number of removed points.
+     */
+    size_t expire(std::string_view itm_id, const std::chrono::system_clock::time_point &before, size_t limit) noexcept;
+    /**
+     * @brief Gets the number of points of the item which `expire` would remove, were it not for the limit.
+     */
+    [[nodiscard]] size_t expired(std::string_view itm_id, const std::chrono::system_clock::time_point &before) const noexcept;
+
+    void erase(std::string_view itm_id) noexcept { series.erase(std::string(itm_id)); }
+    void clear() noexcept { series.clear(); }
+
+    /**
+     * @brief Gets the number of points stored.
+     *
+     * @return The number of points stored.
+     */
+    [[nodiscard]] size_t size() const noexcept;
+    /**
+     * @brief Gets the number of bytes used by the stored points.
+     *
+     * @return The number of bytes used by the stored points.
+     */
+    [[nodiscard]] size_t bytes() const noexcept;
+
+  private:
+    const size_t chunk_size, max_points;
+    std::unordered_map<std::string, std::map<std::string, ts_series>> series; // The series of each item, indexed by dynamic property name..
+  };
+} // namespace coco
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "json.hpp"
+#include "coco_index.hpp"
+#include "coco_search.hpp"
 #include "clips.h"
 #include <chrono>
 #include <optional>
@@ -12,10 +14,12 @@ namespace coco
   class coco;
   class property;
   class item;
+  class column;
 
   class type final
   {
     friend class coco;
+    friend class item;
 
   public:
     /**
@@ -63,14 +67,66 @@ namespace coco
      */
     [[nodiscard]] const std::map<std::string, std::unique_ptr<property>> &get_dynamic_properties() const noexcept { return dynamic_properties; }
 
+    /**
+     * @brief Sets the static and dynamic properties of the type.
+     *
+     * Static properties can declare, through their `index` key, a `hash` (equality) or an `ordered` (equality and range) secondary index, which is rebuilt from the current instances. Static and dynamic `geo` properties are always spatially indexed. Static `string` and `symbol` properties can opt, through their `search` key, into full-text search.
+     *
+     * @param static_props The static properties, by name.
+     * @param dynamic_props The dynamic properties, by name.
+     */
     void set_properties(json::json &&static_props, json::json &&dynamic_props) noexcept;
 
+    /**
+     * @brief Gets the secondary index of a property.
+     *
+     * @param name The name of the property.
+     * @return The index of the property, or `nullptr` if the property is not indexed.
+     */
+    [[nodiscard]] const item_index *get_index(std::string_view name) const noexcept;
+    /**
+     * @brief Gets the full-text indexes of the searchable static properties.
+     *
+     * @return The full-text indexes, by property name.
+     */
+    [[nodiscard]] const std::map<std::string, text_index, std::less<>> &get_text_indexes() const noexcept { return text_indexes; }
+
     /**
      * @brief Gets the instances of the type.
      *
      * @return The instances of the type.
      */
     [[nodiscard]] std::vector<std::reference_wrapper<item>> get_instances() const noexcept;
+    /**
+     * @brief Gets the instances of the type whose static properties satisfy the given filters.
+     *
+     * The filters are evaluated column by column over the values of all the instances, those on properties which are not static properties of the type being ignored.
+     *
+     * @param filters The filters.
+     * @return The instances satisfying the filters on the static properties of the type.
+     */
+    [[nodiscard]] std::vector<std::reference_wrapper<item>> get_instances(const std::vector<item_filter> &filters) const noexcept;
+    /**
+     * @brief Checks, in constant time, whether an item is an instance of the type.
+     *
+     * @param itm_id The ID of the item.
+     * @return True if the item is an instance of the type, false otherwise.
+     */
+    [[nodiscard]] bool has_instance(const std::string &itm_id) const noexcept { return instances.count(itm_id); }
+    /**
+     * @brief Checks whether all the items of a multiple reference are instances of the type.
+     *
+     * @param itm_ids The IDs of the items, as a JSON array.
+     * @return True if the value is an array of IDs of instances of the type, false otherwise.
+     */
+    [[nodiscard]] bool has_instances(const json::json &itm_ids) const noexcept;
+    /**
+     * @brief Checks whether the values of a static property are stored in a column of the type.
+     *
+     * @param name The name of the property.
+     * @return True if the property is a static property of the type, false otherwise.
+     */
+    [[nodiscard]] bool has_column(std::string_view name) const noexcept { return columns.find(name) != columns.end(); }
 
     /**
      * @brief Adds an instance to the type.
@@ -87,12 +143,29 @@ namespace coco
 
     [[nodiscard]] json::json to_json() const noexcept;
 
+  private:
+    [[nodiscard]] json::json get_values(size_t row) const noexcept;
+    [[nodiscard]] json::json get_value(const item &itm, const std::string &p_name) const noexcept;
+    void set_value(const item &itm, const std::string &p_name, const json::json &val) noexcept;
+    void store(item &itm) noexcept;
+    [[nodiscard]] bool is_held_elsewhere(const item &itm, const std::string &p_name) const noexcept;
+
+    void index(const item &itm) noexcept;
+    void index(const item &itm, bool dynamic) noexcept;
+    void unindex(const item &itm) noexcept;
+    void unindex(const item &itm, bool dynamic) noexcept;
+
   private:
     coco &cc;                                                            // The CoCo object..
     std::string name;                                                    // The name of the type..
     const json::json data;                                               // The data of the type..
     std::map<std::string, std::unique_ptr<property>> static_properties;  // The static properties..
     std::map<std::string, std::unique_ptr<property>> dynamic_properties; // The dynamic properties..
-    std::unordered_set<std::string> instances;                           // The IDs of the instances of the type..
+    std::unordered_map<std::string, size_t> instances;                   // The row of each instance of the type, by ID..
+    std::vector<item *> rows;                                            // The instance of each row, `nullptr` for the free rows..
+    std::vector<size_t> free_rows;                                       // The rows released by the removed instances..
+    std::map<std::string, std::unique_ptr<column>, std::less<>> columns; // The values of the static properties, one row per instance..
+    std::map<std::string, std::unique_ptr<item_index>, std::less<>> indexes; // The secondary indexes of the properties..
+    std::map<std::string, text_index, std::less<>> text_indexes;             // The full-text indexes of the searchable static properties..
   };
 } // namespace coco
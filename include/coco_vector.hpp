@@ -0,0 +1,114 @@
+#pragma once
+
+#include "json.hpp"
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <variant>
+#include <vector>
+
+namespace coco
+{
+  enum class vector_dtype : uint8_t
+  {
+    f32, // 32-bit floating point elements..
+    f64, // 64-bit floating point elements..
+    i16  // 16-bit signed integer elements..
+  };
+
+  /**
+   * @brief Gets the element type of a vector from its name.
+   *
+   * @param name The name of the element type, either `f32`, `f64` or `i16`.
+   * @return The element type, or nothing if the name is unknown.
+   */
+  [[nodiscard]] std::optional<vector_dtype> to_vector_dtype(std::string_view name) noexcept;
+  /**
+   * @brief Gets the name of the element type of a vector.
+   *
+   * @param dtype The element type.
+   * @return The name of the element type.
+   */
+  [[nodiscard]] const char *to_string(vector_dtype dtype) noexcept;
+
+  /**
+   * @brief Encodes bytes in base64, with padding.
+   *
+   * @param data The bytes.
+   * @param size The number of bytes.
+   * @return The base64 encoding of the bytes.
+   */
+  [[nodiscard]] std::string to_base64(const void *data, size_t size) noexcept;
+  /**
+   * @brief Decodes a base64 string, with or without padding.
+   *
+   * @param str The base64 string.
+   * @return The decoded bytes, or nothing if the string is not valid base64.
+   */
+  [[nodiscard]] std::optional<std::string> from_base64(std::string_view str) noexcept;
+
+  /**
+   * @brief A vector of numbers, stored as a contiguous buffer of its element type.
+   *
+   * On the wire, a vector is either a JSON array of numbers or a base64 string of its little-endian elements, the latter being the compact form in which vectors are stored. The kernels run over the buffer with no branches in their inner loops, so that the compiler vectorizes them.
+   */
+  class vector_buffer final
+  {
+  public:
+    /**
+     * @brief Decodes a vector from its wire form.
+     *
+     * @param j Either a JSON array of numbers or a base64 string of the little-endian elements.
+     * @param dtype The element type.
+     * @return The vector, or nothing if the value is not a valid vector of the element type, including when an element is not finite or, once converted, beyond the range of the element type.
+     */
+    [[nodiscard]] static std::optional<vector_buffer> from_json(const json::json &j, vector_dtype dtype) noexcept;
+
+    /**
+     * @brief Gets the compact wire form of the vector.
+     *
+     * @return The base64 string of the little-endian elements.
+     */
+    [[nodiscard]] json::json to_json() const noexcept;
+
+    [[nodiscard]] vector_dtype get_dtype() const noexcept { return static_cast<vector_dtype>(data.index()); }
+    [[nodiscard]] size_t size() const noexcept;
+    [[nodiscard]] double operator[](size_t i) const noexcept;
+
+    /**
+     * @brief Checks whether all the elements lie within bounds.
+     *
+     * @param min The lower bound.
+     * @param max The upper bound.
+     * @return True if no element is below `min`, above `max` or not a number, false otherwise.
+     */
+    [[nodiscard]] bool within(double min, double max) const noexcept;
+    /**
+     * @brief Gets a norm of the vector.
+     *
+     * @param p The order of the norm, `1`, `2` or infinity for the maximum norm.
+     * @return The norm of the vector.
+     */
+    [[nodiscard]] double norm(double p = 2) const noexcept;
+    /**
+     * @brief Gets the energy of a band of the vector, that is the sum of the squares of its elements.
+     *
+     * @param from The first index of the band.
+     * @param to The index past the last one of the band, clamped to the size of the vector.
+     * @return The energy of the band.
+     */
+    [[nodiscard]] double band_energy(size_t from, size_t to) const noexcept;
+    /**
+     * @brief Gets the peaks of the vector, that is the local maxima reaching a threshold.
+     *
+     * An inner element is a peak if it is greater than the previous one and than the first different next one, so that a plateau counts once, at its start.
+     *
+     * @param threshold The minimum value of a peak.
+     * @return The indices of the peaks, in increasing order.
+     */
+    [[nodiscard]] std::vector<size_t> peaks(double threshold) const noexcept;
+
+  private:
+    std::variant<std::vector<float>, std::vector<double>, std::vector<int16_t>> data; // The elements, the alternatives being in the order of the element types..
+  };
+} // namespace coco
@@ -2,6 +2,15 @@
 
 #include "coco_db.hpp"
 #include <mongocxx/pool.hpp>
+#include <mongocxx/model/write.hpp>
+#include <bsoncxx/builder/basic/document.hpp>
+#include <bsoncxx/builder/basic/array.hpp>
+#include <bsoncxx/types/bson_value/view.hpp>
+#include <bsoncxx/oid.hpp>
+#include <condition_variable>
+#include <mutex>
+#include <tuple>
+#include <thread>
 
 namespace coco
 {
@@ -43,26 +52,73 @@ namespace coco
     return uri;
   }
 
+  /**
+   * @brief Statistics about the bulk writes of the pending operations.
+   */
+  struct flush_stats
+  {
+    size_t flushes = 0;                                        // The number of performed flushes..
+    size_t operations = 0;                                     // The total number of flushed operations..
+    size_t dropped = 0;                                        // The total number of operations dropped after `MONGODB_FLUSH_RETRIES` failed flushes..
+    size_t last_batch_size = 0, max_batch_size = 0;            // The number of operations of the last and of the largest flush..
+    std::chrono::microseconds last_latency{0}, max_latency{0}; // The latency of the last and of the slowest flush..
+    std::string last_error;                                    // The reason why the last flush left operations unwritten, empty if it wrote all of them..
+  };
+
+  /**
+   * @brief A database persisting the types, the items, their data and the rules in MongoDB.
+   *
+   * The data of the items are stored as one `item_data` document per item and timestamp, so that range queries, pagination, projections, multi-item queries and retention are all served through the `(item_id, timestamp)` index. The compressed columnar store of `coco_db` is not used by this backend, whose storage size and decode cost are those of the raw documents.
+   */
   class mongo_db : public coco_db
   {
     friend class mongo_module;
 
   public:
     mongo_db(json::json &&cnfg = {{"name", COCO_NAME}}, std::string_view mongodb_uri = default_mongodb_uri()) noexcept;
+    ~mongo_db() override;
 
     [[nodiscard]] const std::string &get_db_name() const noexcept { return db_name; }
 
+    /**
+     * @brief Writes the pending item updates and item data to the database.
+     *
+     * Item properties, values and data are queued and written in ordered bulk operations, either when `MONGODB_BULK_SIZE` operations are pending or every `MONGODB_FLUSH_INTERVAL` milliseconds. Reads flush the pending operations first.
+     * Each collection is written on its own. The operations which could not be written are put back at the front of the queues, to be retried by the next flush, and are dropped after `MONGODB_FLUSH_RETRIES` consecutive failed flushes. An operation rejected by the database, instead, is dropped right away.
+     * The rollup updates are tagged with the ID of their flush, which the buckets remember, so that those applied by a flush whose outcome is unknown are not applied again when retried.
+     *
+     * @throws std::invalid_argument If some operations could not be written.
+     */
+    void flush();
+    /**
+     * @brief Gets the statistics about the performed flushes.
+     *
+     * @return The statistics about the performed flushes.
+     */
+    [[nodiscard]] flush_stats get_flush_stats() noexcept;
+
     [[nodiscard]] std::vector<db_type> get_types() noexcept override;
     void create_type(std::string_view tp_name, const json::json &static_props, const json::json &dynamic_props, const json::json &data) override;
     void set_properties(std::string_view tp_name, const json::json &static_props, const json::json &dynamic_props) override;
     void delete_type(std::string_view tp_name) override;
 
     [[nodiscard]] std::vector<db_item> get_items() noexcept override;
-    std::string create_item(const std::vector<std::string> &types, const json::json &props, const std::optional<std::pair<json::json, std::chrono::system_clock::time_point>> &val = std::nullopt) override;
+    [[nodiscard]] std::string generate_id() override;
+    void create_item(std::string_view itm_id, const std::vector<std::string> &types, const json::json &props, const std::optional<std::pair<json::json, std::chrono::system_clock::time_point>> &val = std::nullopt) override;
+    void create_items(const std::vector<db_item> &itms) override;
     void set_properties(std::string_view itm_id, const json::json &props) override;
+    void update_properties(std::string_view itm_id, const std::vector<db_property_update> &updates) override;
     [[nodiscard]] json::json get_values(std::string_view itm_id, const std::chrono::system_clock::time_point &from, const std::chrono::system_clock::time_point &to = std::chrono::system_clock::now()) override;
+    std::optional<std::chrono::system_clock::time_point> get_values(std::string_view itm_id, const std::vector<std::string> &fields, const std::chrono::system_clock::time_point &from, const std::chrono::system_clock::time_point &to, size_t limit, const std::function<void(json::json &&)> &cb) override;
+    void get_values(const std::vector<std::string> &itm_ids, const std::vector<std::string> &fields, const std::chrono::system_clock::time_point &from, const std::chrono::system_clock::time_point &to, const std::function<void(const std::string &, json::json &&)> &cb) override;
+    void scan_values(std::string_view itm_id, const std::vector<std::string> &props, const std::chrono::system_clock::time_point &from, const std::chrono::system_clock::time_point &to, const std::function<void(const std::string &, int64_t, json::json &&)> &cb) override;
     void set_value(std::string_view itm_id, const json::json &val, const std::chrono::system_clock::time_point &timestamp = std::chrono::system_clock::now()) override;
+    void set_values(std::string_view itm_id, const std::vector<std::pair<json::json, std::chrono::system_clock::time_point>> &series, const std::optional<std::pair<json::json, std::chrono::system_clock::time_point>> &latest = std::nullopt) override;
+    [[nodiscard]] json::json get_rollups(std::string_view itm_id, const std::chrono::seconds &resolution, const std::chrono::system_clock::time_point &from, const std::chrono::system_clock::time_point &to = std::chrono::system_clock::now()) override;
     void delete_item(std::string_view itm_id) override;
+    [[nodiscard]] size_t count_values(std::string_view itm_id, const std::chrono::system_clock::time_point &before) override;
+    size_t delete_values(std::string_view itm_id, const std::chrono::system_clock::time_point &before, size_t limit) override;
+    size_t delete_rollups(std::string_view itm_id, const std::chrono::system_clock::time_point &before) override;
 
     [[nodiscard]] std::vector<db_rule> get_rules() noexcept override;
     void create_rule(std::string_view rule_name, std::string_view rule_content) override;
@@ -72,14 +128,105 @@ namespace coco
     static constexpr const char *types_collection_name = "types";
     static constexpr const char *items_collection_name = "items";
     static constexpr const char *item_data_collection_name = "item_data";
+    static constexpr const char *item_rollups_collection_name = "item_rollups";
     static constexpr const char *rules_collection_name = "rules";
 
+  private:
+    [[nodiscard]] size_t pending_size() const noexcept { return pending_items.size() + pending_values.size() + pending_data.size() + pending_rollups.size(); }
+    /**
+     * @brief Builds the insertion of an item, as an upsert so that it can be safely retried.
+     */
+    [[nodiscard]] static mongocxx::model::replace_one item_insert(std::string_view itm_id, const std::vector<std::string> &types, const json::json &props, const std::optional<std::pair<json::json, std::chrono::system_clock::time_point>> &val);
+    /**
+     * @brief Builds the upserts of the item data collection which store the archived points of a value.
+     */
+    [[nodiscard]] std::vector<mongocxx::model::update_one> data_upserts(std::string_view itm_id, const json::json &val, const std::chrono::system_clock::time_point &timestamp);
+    /**
+     * @brief Builds the upserts of the item data collection which store the given archived points.
+     */
+    [[nodiscard]] static std::vector<mongocxx::model::update_one> data_upserts(const bsoncxx::oid &itm_oid, const std::map<int64_t, json::json> &data);
+    void store_archived(std::string_view itm_id, const std::map<int64_t, json::json> &data) override;
+    /**
+     * @brief Coalesces a value into the pending latest value of the item. Must be called holding `batch_mtx`.
+     */
+    void set_latest(std::string_view itm_id, const json::json &val, const std::chrono::system_clock::time_point &timestamp);
+    /**
+     * @brief Folds a value into the pending rollups of the item. Must be called holding `batch_mtx`.
+     */
+    void add_rollups(std::string_view itm_id, const json::json &val, const std::chrono::system_clock::time_point &timestamp);
+
   private:
     mongocxx::pool pool;
+    std::mutex batch_mtx;                                                                                       // Guards the pending operations and the statistics..
+    std::mutex flush_mtx;                                                                                       // Serializes the flushes, so that the pending operations are written in order..
+    std::condition_variable batch_cv;                                                                           // Wakes up the flusher..
+    bool running = true;                                                                                        // Whether the flusher is running..
+    std::vector<mongocxx::model::write> pending_items;                                                          // The pending operations on the items collection..
+    std::unordered_map<std::string, std::pair<json::json, std::chrono::system_clock::time_point>> pending_values; // The latest pending value of each item, coalesced..
+    std::vector<mongocxx::model::write> pending_data;                                                           // The pending operations on the item data collection..
+    std::vector<mongocxx::model::write> pending_rollup_ops;                                                     // The pending writes on the item rollups collection, either deletions or the upserts of a failed flush..
+    std::map<std::tuple<std::string, int64_t, int64_t>, std::map<std::string, db_rollup>> pending_rollups;       // The pending rollups, by item, resolution and bucket, coalesced..
+    size_t failed_flushes = 0;                                                                                  // The number of consecutive flushes which left operations unwritten..
+    flush_stats stats;                                                                                          // The flush statistics..
+    std::thread flusher;                                                                                        // The background flusher..
 
   protected:
     const std::string db_name;
   };
 
+  /**
+   * @brief Appends a JSON value to a BSON document being built.
+   *
+   * Integers are stored as 64-bit integers, floats as doubles and nested objects and arrays as sub-documents and sub-arrays, without going through their textual representation.
+   *
+   * @param doc The document being built.
+   * @param key The key of the value.
+   * @param j The JSON value.
+   */
+  void append_bson(bsoncxx::builder::basic::sub_document doc, std::string_view key, const json::json &j);
+  /**
+   * @brief Appends a JSON value to a BSON array being built.
+   *
+   * @param arr The array being built.
+   * @param j The JSON value.
+   */
+  void append_bson(bsoncxx::builder::basic::sub_array arr, const json::json &j);
+  /**
+   * @brief Converts a JSON object into a BSON document.
+   *
+   * @param j The JSON object.
+   * @return The BSON document.
+   */
+  [[nodiscard]] bsoncxx::document::value to_bson(const json::json &j);
+  /**
+   * @brief Converts a JSON array into a BSON array.
+   *
+   * @param j The JSON array.
+   * @return The BSON array.
+   */
   [[nodiscard]] bsoncxx::array::value to_bson_array(const json::json &j);
+
+  /**
+   * @brief Converts a BSON value into a JSON value.
+   *
+   * 32 and 64-bit integers become JSON integers, object IDs become their hexadecimal string and dates become the number of milliseconds since the epoch.
+   *
+   * @param val The BSON value.
+   * @return The JSON value.
+   */
+  [[nodiscard]] json::json from_bson(const bsoncxx::types::bson_value::view &val);
+  /**
+   * @brief Converts a BSON document into a JSON object.
+   *
+   * @param doc The BSON document.
+   * @return The JSON object.
+   */
+  [[nodiscard]] json::json from_bson(const bsoncxx::document::view &doc);
+  /**
+   * @brief Converts a BSON array into a JSON array.
+   *
+   * @param arr The BSON array.
+   * @return The JSON array.
+   */
+  [[nodiscard]] json::json from_bson(const bsoncxx::array::view &arr);
 } // namespace coco
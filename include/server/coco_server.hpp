@@ -91,12 +91,16 @@ namespace coco
 
     std::unique_ptr<network::response> get_items(const network::request &req);
     std::unique_ptr<network::response> get_item(const network::request &req);
+    std::unique_ptr<network::response> get_referrers(const network::request &req);
     std::unique_ptr<network::response> create_item(const network::request &req);
+    std::unique_ptr<network::response> create_items(const network::request &req);
     std::unique_ptr<network::response> update_item(const network::request &req);
     std::unique_ptr<network::response> delete_item(const network::request &req);
 
     std::unique_ptr<network::response> get_data(const network::request &req);
+    std::unique_ptr<network::response> query_data(const network::request &req);
     std::unique_ptr<network::response> set_datum(const network::request &req);
+    std::unique_ptr<network::response> backfill_data(const network::request &req);
 
     std::unique_ptr<network::response> fake(const network::request &req);
 
@@ -1,7 +1,6 @@
 #include "auth_db.hpp"
 #include "crypto.hpp"
 #include "logging.hpp"
-#include <bsoncxx/json.hpp>
 #include <bsoncxx/builder/stream/document.hpp>
 #include <cassert>
 
@@ -34,7 +33,7 @@ namespace coco
         if (doc->view().find("personal_data") == doc->view().end())
             return db_user{user_id, username, user_role, json::json{}};
         else
-            return db_user{user_id, username, user_role, json::load(bsoncxx::to_json(doc->view()["personal_data"].get_document().view()))};
+            return db_user{user_id, username, user_role, from_bson(doc->view()["personal_data"].get_document().view())};
     }
 
     db_user auth_db::get_user(std::string_view username, std::string_view password)
@@ -49,7 +48,7 @@ namespace coco
         if (doc->view().find("personal_data") == doc->view().end())
             return db_user{user_id, username.data(), user_role, json::json{}};
         else
-            return db_user{user_id, username.data(), user_role, json::load(bsoncxx::to_json(doc->view()["personal_data"].get_document().view()))};
+            return db_user{user_id, username.data(), user_role, from_bson(doc->view()["personal_data"].get_document().view())};
     }
 
     std::vector<db_user> auth_db::get_users() noexcept
@@ -62,7 +61,7 @@ namespace coco
             user.id = std::string(doc["_id"].get_string().value);
             user.username = std::string(doc["username"].get_string().value);
             if (doc.find("personal_data") != doc.end())
-                user.personal_data = json::load(bsoncxx::to_json(doc["personal_data"].get_document().view()));
+                user.personal_data = from_bson(doc["personal_data"].get_document().view());
             users.push_back(std::move(user));
         }
         return users;
@@ -78,7 +77,7 @@ namespace coco
         doc.append(bsoncxx::builder::basic::kvp("role", user_role));
         doc.append(bsoncxx::builder::basic::kvp("salt", salt.data()));
         if (!personal_data.as_object().empty())
-            doc.append(bsoncxx::builder::basic::kvp("personal_data", bsoncxx::from_json(personal_data.dump())));
+            doc.append(bsoncxx::builder::basic::kvp("personal_data", to_bson(personal_data)));
         if (!users_collection.insert_one(doc.view()))
             throw std::invalid_argument("Failed to insert user: " + std::string(username));
     }
@@ -3,6 +3,11 @@
 #include "coco_type.hpp"
 #include "coco_property.hpp"
 #include "coco_item.hpp"
+#include "coco_geo.hpp"
+#include "coco_search.hpp"
+#include "coco_schema.hpp"
+#include "coco_patch.hpp"
+#include "coco_vector.hpp"
 #include "coco_rule.hpp"
 #include "coco_db.hpp"
 #ifdef BUILD_AUTH
@@ -10,14 +15,353 @@
 #endif
 #include "logging.hpp"
 #include <algorithm>
+#include <cctype>
+#include <cstdio>
 #include <functional>
 #include <fstream>
+#include <limits>
+#include <set>
+#include <tuple>
 #include <cassert>
 
 namespace coco
 {
+    namespace
+    {
+        // the longest retention declared by the types of an item applies, and the data are kept forever if any of its types does not declare one..
+        [[nodiscard]] std::optional<db_retention> retention_of(const std::vector<std::reference_wrapper<type>> &tps)
+        {
+            if (tps.empty())
+                return std::nullopt;
+            db_retention res;
+            bool keep_raw = false, keep_rollups = false;
+            for (const type &tp : tps)
+            {
+                const auto &data = tp.get_data();
+                const bool has_retention = data.is_object() && data.contains("retention");
+                if (has_retention && data["retention"].contains("raw"))
+                    res.raw = std::max(res.raw.value_or(std::chrono::seconds::zero()), std::chrono::seconds(data["retention"]["raw"].get<int64_t>()));
+                else
+                    keep_raw = true;
+                if (has_retention && data["retention"].contains("rollups"))
+                    res.rollups = std::max(res.rollups.value_or(std::chrono::seconds::zero()), std::chrono::seconds(data["retention"]["rollups"].get<int64_t>()));
+                else
+                    keep_rollups = true;
+            }
+            if (keep_raw)
+                res.raw.reset();
+            if (keep_rollups)
+                res.rollups.reset();
+            if (!res.raw && !res.rollups)
+                return std::nullopt;
+            return res;
+        }
+
+        // the tightest archive policy declared by the types of an item applies to each of its dynamic properties..
+        [[nodiscard]] std::map<std::string, archive_policy> archives_of(const std::vector<std::reference_wrapper<type>> &tps)
+        {
+            std::map<std::string, archive_policy> res;
+            for (const type &tp : tps)
+                for (const auto &[p_name, prop] : tp.get_dynamic_properties())
+                    if (auto policy = prop->get_archive())
+                        if (auto [it, inserted] = res.emplace(p_name, *policy); !inserted && policy->deviation < it->second.deviation)
+                            it->second = *policy;
+            return res;
+        }
+
+        // checks the values of the properties, either static or dynamic, which the given types declare, the skipped ones apart..
+        void check_values(const std::vector<std::reference_wrapper<type>> &tps, const json::json &vals, bool dynamic, const std::set<std::string> &skipped = {})
+        {
+            if (vals.is_null())
+                return;
+            if (!vals.is_object())
+                throw std::invalid_argument("Invalid properties: " + vals.dump());
+            for (const auto &[p_name, v] : vals.as_object())
+                if (!v.is_null() && !skipped.count(p_name))
+                    for (const type &tp : tps)
+                    {
+                        const auto &props = dynamic ? tp.get_dynamic_properties() : tp.get_static_properties();
+                        if (auto prop = props.find(p_name); prop != props.end() && !prop->second->validate(v))
+                            throw std::invalid_argument("Invalid value for property " + p_name + ": " + v.dump());
+                    }
+        }
+
+        // checks the bounds of a recent history, either shared by all the dynamic properties or given for one of them..
+        void check_history_bounds(const json::json &bounds, const std::string &scope, bool shared)
+        {
+            for (const auto &[key, bound] : bounds.as_object())
+                if (key != "count" && key != "duration" && (!shared || key != "properties"))
+                    throw std::invalid_argument("Unknown history setting `" + key + "` for " + scope + (shared ? ", the histories of the single properties going within `properties`" : ""));
+                else if (key != "properties" && (!bound.is_integer() || bound.get<int64_t>() < 0))
+                    throw std::invalid_argument("The history `" + key + "` for " + scope + " must be a non-negative integer: " + bound.dump());
+        }
+
+        // checks the settings, within the data of a type, which the types apply to their items..
+        void check_type_data(const json::json &data)
+        {
+            if (!data.is_object())
+                return;
+            if (data.contains("late"))
+                if (const auto &late = data["late"]; !late.is_string() || (late.get<std::string>() != "apply" && late.get<std::string>() != "store" && late.get<std::string>() != "reject"))
+                    throw std::invalid_argument("The `late` policy must be one of `apply`, `store` or `reject`: " + late.dump());
+            if (data.contains("history"))
+            {
+                const auto &history = data["history"];
+                if (!history.is_object())
+                    throw std::invalid_argument("The `history` must be an object: " + history.dump());
+                check_history_bounds(history, "all the dynamic properties", true);
+                if (history.contains("properties"))
+                {
+                    if (!history["properties"].is_object())
+                        throw std::invalid_argument("The history `properties` must map the dynamic properties to their history: " + history["properties"].dump());
+                    for (const auto &[p_name, bounds] : history["properties"].as_object())
+                        if (!bounds.is_object())
+                            throw std::invalid_argument("The history of property " + p_name + " must be an object: " + bounds.dump());
+                        else
+                            check_history_bounds(bounds, "property " + p_name, false);
+                }
+            }
+        }
+
+        // checks the shapes of the vector properties and the deletion policies of the referencing properties, since a reference can be nulled only if its property is nullable..
+        void check_type_properties(const json::json &static_props, const json::json &dynamic_props)
+        {
+            for (const auto &props : {&static_props, &dynamic_props})
+                if (props->is_object())
+                    for (const auto &[p_name, prop] : props->as_object())
+                    {
+                        if (prop.is_object() && prop.contains("type") && prop["type"] == json::json(vector_kw))
+                        {
+                            if (prop.contains("dtype") && (!prop["dtype"].is_string() || !to_vector_dtype(prop["dtype"].get<std::string>())))
+                                throw std::invalid_argument("The element type of property " + p_name + " must be either `f32`, `f64` or `i16`: " + prop["dtype"].dump());
+                            for (const auto *key : {"length", "max_length"})
+                                if (prop.contains(key) && (!prop[key].is_integer() || prop[key].get<int64_t>() < 0))
+                                    throw std::invalid_argument("The `" + std::string(key) + "` of property " + p_name + " must be a non-negative integer: " + prop[key].dump());
+                            if (prop.contains("length") && prop.contains("max_length") && prop["length"].get<int64_t>() > prop["max_length"].get<int64_t>())
+                                throw std::invalid_argument("The length of property " + p_name + " exceeds its maximum length");
+                        }
+                        if (prop.is_object() && prop.contains("on_delete"))
+                        {
+                            const auto &on_delete = prop["on_delete"];
+                            if (!on_delete.is_string() || (on_delete.get<std::string>() != "null" && on_delete.get<std::string>() != "cascade"))
+                                throw std::invalid_argument("The `on_delete` policy of property " + p_name + " must be either `null` or `cascade`: " + on_delete.dump());
+                            const bool nullable = prop.contains("nullable") && prop["nullable"].is_boolean() && prop["nullable"].get<bool>(), multiple = prop.contains("multiple") && prop["multiple"].is_boolean() && prop["multiple"].get<bool>();
+                            if (on_delete.get<std::string>() == "null" && !nullable && !multiple)
+                                throw std::invalid_argument("The references of property " + p_name + " cannot be nulled, since the property is not nullable");
+                        }
+                    }
+        }
+
+        // the strictest late policy declared by the types of an item applies..
+        [[nodiscard]] late_policy late_policy_of(const std::vector<std::reference_wrapper<type>> &tps)
+        {
+            late_policy res = late_policy::apply;
+            for (const type &tp : tps)
+                if (const auto &data = tp.get_data(); data.is_object() && data.contains("late"))
+                {
+                    if (!data["late"].is_string())
+                    { // types stored before their data were checked might hold anything..
+                        LOG_WARN("Ignoring the invalid late policy of type " + tp.get_name() + ": " + data["late"].dump());
+                        continue;
+                    }
+                    const auto policy = data["late"].get<std::string>();
+                    if (policy == "reject")
+                        return late_policy::reject;
+                    if (policy == "store")
+                        res = late_policy::store;
+                    else if (policy != "apply")
+                        LOG_WARN("Ignoring the unknown late policy of type " + tp.get_name() + ": " + policy);
+                }
+            return res;
+        }
+
+        // reads the alternating latitudes and longitudes of a multifield, as stored in the slots of the geographic properties..
+        [[nodiscard]] std::vector<geo_point> to_geo_points(const Multifield &mf) noexcept
+        {
+            std::vector<double> coords;
+            coords.reserve(mf.length);
+            for (size_t i = 0; i < mf.length; ++i)
+                if (mf.contents[i].header->type == FLOAT_TYPE)
+                    coords.push_back(mf.contents[i].floatValue->contents);
+                else if (mf.contents[i].header->type == INTEGER_TYPE)
+                    coords.push_back(static_cast<double>(mf.contents[i].integerValue->contents));
+                else
+                    return {};
+            if (coords.size() % 2)
+                return {};
+            std::vector<geo_point> pts;
+            pts.reserve(coords.size() / 2);
+            for (size_t i = 0; i < coords.size(); i += 2)
+                pts.push_back({coords[i], coords[i + 1]});
+            return pts;
+        }
+
+        [[nodiscard]] bool satisfies_all(const item &itm, const std::vector<item_filter> &filters) noexcept
+        {
+            const auto &val = itm.get_value();
+            return std::all_of(filters.begin(), filters.end(), [&itm, &val](const item_filter &f)
+                               {
+                                   if (const auto p_val = itm.get_property_value(f.property); !p_val.is_null())
+                                       return matches(p_val, f);
+                                   return val.has_value() && val->first.contains(f.property) && matches(val->first[f.property], f); });
+        }
+
+        // the JSON documents are handed to CLIPS as pointers to shared, immutable, documents, which CLIPS releases along with the facts holding them..
+        void print_json_address(Environment *env, const char *logical_name, void *contents)
+        { // the serialization is produced only when the document is printed..
+            WriteString(env, logical_name, "<JSON-");
+            WriteString(env, logical_name, (*static_cast<std::shared_ptr<const json::json> *>(contents))->dump().c_str());
+            WriteString(env, logical_name, ">");
+        }
+        bool discard_json_address(Environment *, void *contents)
+        {
+            delete static_cast<std::shared_ptr<const json::json> *>(contents);
+            return true;
+        }
+        externalAddressType json_address{"json", print_json_address, print_json_address, discard_json_address, nullptr, nullptr};
+
+        // the vectors are handed to CLIPS as pointers to shared, immutable, buffers, as the JSON documents are..
+        void print_vector_address(Environment *env, const char *logical_name, void *contents)
+        {
+            const auto &buf = **static_cast<std::shared_ptr<const vector_buffer> *>(contents);
+            WriteString(env, logical_name, "<VECTOR-");
+            WriteString(env, logical_name, to_string(buf.get_dtype()));
+            WriteString(env, logical_name, "-");
+            WriteString(env, logical_name, std::to_string(buf.size()).c_str());
+            WriteString(env, logical_name, ">");
+        }
+        bool discard_vector_address(Environment *, void *contents)
+        {
+            delete static_cast<std::shared_ptr<const vector_buffer> *>(contents);
+            return true;
+        }
+        externalAddressType vector_address{"vector", print_vector_address, print_vector_address, discard_vector_address, nullptr, nullptr};
+
+        void append_json_string(StringBuilder *sb, const char *str)
+        {
+            SBAddChar(sb, '"');
+            const char *run = str; // the characters which need no escaping are appended in runs..
+            for (const char *c = str;; ++c)
+            {
+                const auto ch = static_cast<unsigned char>(*c);
+                if (ch != 0 && ch != '"' && ch != '\\' && ch >= 0x20)
+                    continue;
+                if (ch == 0)
+                { // the last run is the null-terminated tail of the string..
+                    SBAppend(sb, run);
+                    break;
+                }
+                if (c != run)
+                    SBAppend(sb, std::string(run, c).c_str());
+                switch (ch)
+                {
+                case '"':
+                    SBAppend(sb, "\\\"");
+                    break;
+                case '\\':
+                    SBAppend(sb, "\\\\");
+                    break;
+                case '\n':
+                    SBAppend(sb, "\\n");
+                    break;
+                case '\r':
+                    SBAppend(sb, "\\r");
+                    break;
+                case '\t':
+                    SBAppend(sb, "\\t");
+                    break;
+                default:
+                {
+                    char esc[7];
+                    std::snprintf(esc, sizeof(esc), "\\u%04x", ch);
+                    SBAppend(sb, esc);
+                    break;
+                }
+                }
+                run = c + 1;
+            }
+            SBAddChar(sb, '"');
+        }
+
+        // walks a `a.b[2]` path through a JSON document..
+        [[nodiscard]] const json::json *at_path(const json::json &j, std::string_view path) noexcept
+        {
+            const json::json *cur = &j;
+            size_t i = 0;
+            while (i < path.size())
+                if (path[i] == '[')
+                {
+                    const auto end = path.find(']', i);
+                    if (end == std::string_view::npos || end == i + 1 || !cur->is_array())
+                        return nullptr;
+                    size_t idx = 0;
+                    for (size_t d = i + 1; d < end; ++d)
+                        if (std::isdigit(static_cast<unsigned char>(path[d])))
+                            idx = idx * 10 + (path[d] - '0');
+                        else
+                            return nullptr;
+                    if (idx >= cur->size())
+                        return nullptr;
+                    cur = &cur->as_array()[idx];
+                    i = end + 1;
+                    if (i < path.size() && path[i] == '.')
+                        ++i;
+                }
+                else
+                {
+                    const auto end = std::min(path.find_first_of(".[", i), path.size());
+                    if (!cur->is_object())
+                        return nullptr;
+                    const auto &obj = cur->as_object();
+                    auto it = obj.find(std::string(path.substr(i, end - i)));
+                    if (it == obj.end())
+                        return nullptr;
+                    cur = &it->second;
+                    i = end < path.size() && path[end] == '.' ? end + 1 : end;
+                }
+            return cur;
+        }
+
+        // converts the elements of an array, the key/value pairs of an object or a single value into a multifield..
+        template <typename Fn>
+        [[nodiscard]] Multifield *to_multifield(Environment *env, const json::json &j, Fn &&to_value) noexcept
+        {
+            switch (j.get_type())
+            {
+            case json::json_type::array:
+            {
+                const auto &arr = j.as_array();
+                Multifield *mf = CreateMultifield(env, arr.size());
+                for (size_t i = 0; i < arr.size(); ++i)
+                    mf->contents[i].value = to_value(arr[i]);
+                return mf;
+            }
+            case json::json_type::object:
+            {
+                Multifield *mf = CreateMultifield(env, j.size() * 2);
+                size_t i = 0;
+                for (const auto &[key, value] : j.as_object())
+                {
+                    mf->contents[i++].lexemeValue = CreateString(env, key.c_str());
+                    mf->contents[i++].value = to_value(value);
+                }
+                return mf;
+            }
+            default:
+            {
+                Multifield *mf = CreateMultifield(env, 1);
+                mf->contents[0].value = to_value(j);
+                return mf;
+            }
+            }
+        }
+    } // namespace
+
     coco::coco(coco_db &db) noexcept : db(db), env(CreateEnvironment())
     {
+        json_address_type = static_cast<unsigned short>(InstallExternalAddressType(env, &json_address));
+        vector_address_type = static_cast<unsigned short>(InstallExternalAddressType(env, &vector_address));
+
         add_property_type(std::make_unique<bool_property_type>(*this));
         add_property_type(std::make_unique<int_property_type>(*this));
         add_property_type(std::make_unique<float_property_type>(*this));
@@ -25,6 +369,8 @@ namespace coco
         add_property_type(std::make_unique<symbol_property_type>(*this));
         add_property_type(std::make_unique<item_property_type>(*this));
         add_property_type(std::make_unique<json_property_type>(*this));
+        add_property_type(std::make_unique<geo_property_type>(*this));
+        add_property_type(std::make_unique<vector_property_type>(*this));
 
         [[maybe_unused]] auto add_type_err = AddUDF(env, "add_type", "v", 2, 2, "yy", add_type, "add_type", this);
         assert(add_type_err == AUE_NO_ERROR);
@@ -39,8 +385,32 @@ namespace coco
         assert(agenda_empty_err == AUE_NO_ERROR);
         [[maybe_unused]] auto to_json_err = AddUDF(env, "to_json", "s", 1, 1, "m", multifield_to_json, "multifield_to_json", this);
         assert(to_json_err == AUE_NO_ERROR);
-        [[maybe_unused]] auto from_json_err = AddUDF(env, "from_json", "m", 1, 1, "s", json_to_multifield, "json_to_multifield", this);
+        [[maybe_unused]] auto from_json_err = AddUDF(env, "from_json", "m", 1, 1, "se", json_to_multifield, "json_to_multifield", this);
         assert(from_json_err == AUE_NO_ERROR);
+        [[maybe_unused]] auto json_values_err = AddUDF(env, "json-values", "m", 1, 1, "se", json_values, "json_values", this);
+        assert(json_values_err == AUE_NO_ERROR);
+        [[maybe_unused]] auto json_parse_err = AddUDF(env, "json-parse", "e", 1, 1, "s", json_parse, "json_parse", this);
+        assert(json_parse_err == AUE_NO_ERROR);
+        [[maybe_unused]] auto json_get_err = AddUDF(env, "json-get", "*", 2, 2, "se", json_get, "json_get", this);
+        assert(json_get_err == AUE_NO_ERROR);
+        [[maybe_unused]] auto json_has_err = AddUDF(env, "json-has", "b", 2, 2, "se", json_has, "json_has", this);
+        assert(json_has_err == AUE_NO_ERROR);
+        [[maybe_unused]] auto json_len_err = AddUDF(env, "json-len", "l", 1, 2, "se", json_len, "json_len", this);
+        assert(json_len_err == AUE_NO_ERROR);
+        [[maybe_unused]] auto vector_len_err = AddUDF(env, "vector-len", "l", 1, 1, "e", vector_len, "vector_len", this);
+        assert(vector_len_err == AUE_NO_ERROR);
+        [[maybe_unused]] auto vector_nth_err = AddUDF(env, "vector-nth", "d", 2, 2, "el", vector_nth, "vector_nth", this);
+        assert(vector_nth_err == AUE_NO_ERROR);
+        [[maybe_unused]] auto vector_norm_err = AddUDF(env, "vector-norm", "d", 1, 2, "elyd", vector_norm, "vector_norm", this);
+        assert(vector_norm_err == AUE_NO_ERROR);
+        [[maybe_unused]] auto vector_peaks_err = AddUDF(env, "vector-peaks", "m", 1, 2, "eld", vector_peaks, "vector_peaks", this);
+        assert(vector_peaks_err == AUE_NO_ERROR);
+        [[maybe_unused]] auto vector_band_energy_err = AddUDF(env, "vector-band-energy", "d", 3, 3, "el", vector_band_energy, "vector_band_energy", this);
+        assert(vector_band_energy_err == AUE_NO_ERROR);
+        [[maybe_unused]] auto distance_err = AddUDF(env, "distance", "d", 2, 2, "mm", geo_distance, "geo_distance", this);
+        assert(distance_err == AUE_NO_ERROR);
+        [[maybe_unused]] auto within_err = AddUDF(env, "within", "b", 2, 2, "mm", geo_within, "geo_within", this);
+        assert(within_err == AUE_NO_ERROR);
 
         LOG_DEBUG("Retrieving all types");
         auto db_tps = db.get_types();
@@ -65,6 +435,15 @@ namespace coco
                 tps.push_back(get_type(tp_name));
             make_item(db_itm.id, std::move(tps), db_itm.props.has_value() ? std::move(db_itm.props.value()) : json::json{}, db_itm.value.has_value() ? std::make_optional(std::move(db_itm.value.value())) : std::nullopt);
         }
+        db.set_retention_provider([this]
+                                  { // the retentions are read from the current types of the items, which may change after their creation..
+                                      std::lock_guard<std::recursive_mutex> _(mtx);
+                                      std::unordered_map<std::string, db_retention> res;
+                                      for (const auto &[id, itm] : items)
+                                          if (auto retention = retention_of(itm->get_types()))
+                                              res.emplace(id, *retention);
+                                      return res; });
+        db.start_compactor();
 
 #ifdef BUILD_AUTH
         add_module<coco_auth>(*this);
@@ -72,6 +451,18 @@ namespace coco
     }
     coco::~coco()
     {
+        db.stop_compactor(); // the compactor reads the retentions from the items..
+        db.set_retention_provider(nullptr);
+        try
+        { // the points held back by the archives are stored before shutting down..
+            db.flush_archives();
+        }
+        catch (const std::exception &e)
+        {
+            LOG_ERR("Failed to flush the archives: " << e.what());
+        }
+        for (auto &[lexeme, _] : parsed_lexemes)
+            ReleaseLexeme(env, lexeme);
         items.clear();
         rules.clear();
         types.clear();
@@ -93,6 +484,45 @@ namespace coco
         Run(env, -1);
     }
 
+    void coco::set_schema(std::string_view name, json::json &&schema) noexcept
+    {
+        std::lock_guard<std::recursive_mutex> _(mtx);
+        schemas[name.data()] = std::move(schema);
+        validators.clear();
+        ++schemas_version;
+    }
+
+    std::shared_ptr<const schema_validator> coco::get_validator(const json::json &schema) noexcept
+    {
+        std::lock_guard<std::recursive_mutex> _(mtx);
+        auto key = schema.dump();
+        if (auto it = validators.find(key); it != validators.end())
+        {
+            if (auto validator = it->second.lock())
+                return validator;
+            validators.erase(it);
+        }
+        std::shared_ptr<const schema_validator> validator;
+        try
+        {
+            validator = std::make_shared<const schema_validator>(schema, schemas);
+        }
+        catch (const std::exception &e)
+        { // the schema is validated through the generic validator..
+            LOG_DEBUG("Schema not compiled: " << e.what());
+        }
+        if (validator)
+        {
+            for (auto it = validators.begin(); it != validators.end();) // the validators no longer in use are dropped..
+                if (it->second.expired())
+                    it = validators.erase(it);
+                else
+                    ++it;
+            validators.emplace(std::move(key), validator);
+        }
+        return validator;
+    }
+
     std::vector<std::reference_wrapper<type>> coco::get_types() noexcept
     {
         std::lock_guard<std::recursive_mutex> _(mtx);
@@ -111,8 +541,10 @@ namespace coco
         return *types.at(name.data());
     }
 
-    type &coco::create_type(std::string_view name, json::json &&static_props, json::json &&dynamic_props, json::json &&data, bool infere) noexcept
+    type &coco::create_type(std::string_view name, json::json &&static_props, json::json &&dynamic_props, json::json &&data, bool infere)
     {
+        check_type_data(data);
+        check_type_properties(static_props, dynamic_props);
         std::lock_guard<std::recursive_mutex> _(mtx);
         db.create_type(name, static_props, dynamic_props, data);
         auto &tp = make_type(name, std::move(data));
@@ -151,6 +583,103 @@ namespace coco
         return res;
     }
 
+    std::vector<std::reference_wrapper<item>> coco::find_items(const type &tp, const std::vector<item_filter> &filters) noexcept
+    {
+        std::lock_guard<std::recursive_mutex> _(mtx);
+        // the most selective index provides the candidates, which are then checked against all the filters..
+        const item_index *idx = nullptr;
+        const item_filter *idx_f = nullptr;
+        size_t n_candidates = 0;
+        for (const auto &f : filters)
+            if (auto f_idx = tp.get_index(f.property); f_idx && f_idx->supports(f))
+                if (const auto n = f_idx->count(f, idx ? n_candidates : std::numeric_limits<size_t>::max()); !idx || n < n_candidates)
+                {
+                    idx = f_idx;
+                    idx_f = &f;
+                    n_candidates = n;
+                }
+
+        std::vector<std::reference_wrapper<item>> res;
+        if (!idx)
+        { // the filters on the static properties of the type are evaluated on its columns, the others on each remaining instance..
+            std::vector<item_filter> others;
+            for (const auto &f : filters)
+                if (!tp.has_column(f.property))
+                    others.push_back(f);
+            for (auto &itm : tp.get_instances(filters))
+                if (satisfies_all(itm, others))
+                    res.push_back(itm);
+            return res;
+        }
+        std::unordered_set<std::string> seen; // the values of a multiple valued property can lead to the same item more than once..
+        idx->find(*idx_f, [this, &filters, &seen, &res](const std::string &id)
+                  {
+                      if (!seen.insert(id).second)
+                          return;
+                      auto &itm = *items.at(id);
+                      if (satisfies_all(itm, filters))
+                          res.push_back(itm); });
+        return res;
+    }
+    std::vector<std::reference_wrapper<item>> coco::find_items(const std::vector<item_filter> &filters) noexcept
+    {
+        std::lock_guard<std::recursive_mutex> _(mtx);
+        std::vector<std::reference_wrapper<item>> res;
+        for (auto &[id, itm] : items)
+            if (satisfies_all(*itm, filters))
+                res.push_back(*itm);
+        return res;
+    }
+
+    std::vector<std::pair<std::reference_wrapper<item>, double>> coco::search_items(const type &tp, std::string_view text, const std::vector<item_filter> &filters) noexcept
+    {
+        std::lock_guard<std::recursive_mutex> _(mtx);
+        const auto tokens = tokenize(text);
+        std::unordered_map<std::string, std::pair<size_t, double>> hits; // the number of matched tokens and the relevance, by item ID..
+        for (size_t i = 0; i < tokens.size(); ++i)
+        {
+            std::unordered_map<std::string, double> scores;
+            for (const auto &[name, idx] : tp.get_text_indexes())
+                idx.search(tokens[i], [&scores](const std::string &id, double score)
+                           { scores[id] += score; });
+            for (const auto &[id, score] : scores)
+                if (i == 0)
+                    hits.emplace(id, std::make_pair(1, score));
+                else if (auto hit = hits.find(id); hit != hits.end() && hit->second.first == i) // the item matched all the previous tokens..
+                {
+                    ++hit->second.first;
+                    hit->second.second += score;
+                }
+        }
+
+        std::vector<std::pair<std::reference_wrapper<item>, double>> res;
+        for (const auto &[id, hit] : hits)
+            if (hit.first == tokens.size())
+                if (auto &itm = *items.at(id); satisfies_all(itm, filters))
+                    res.emplace_back(itm, hit.second);
+        std::sort(res.begin(), res.end(), [](const auto &a, const auto &b)
+                  { return a.second != b.second ? a.second > b.second : a.first.get().get_id() < b.first.get().get_id(); });
+        return res;
+    }
+    std::vector<std::pair<std::reference_wrapper<item>, double>> coco::search_items(std::string_view text, const std::vector<item_filter> &filters) noexcept
+    {
+        std::lock_guard<std::recursive_mutex> _(mtx);
+        std::unordered_map<std::string, std::pair<std::reference_wrapper<item>, double>> best; // items of more types keep their best relevance..
+        for (const auto &[name, tp] : types)
+            if (!tp->get_text_indexes().empty())
+                for (auto &[itm, score] : search_items(*tp, text, filters))
+                    if (auto [it, inserted] = best.emplace(itm.get().get_id(), std::make_pair(itm, score)); !inserted && it->second.second < score)
+                        it->second.second = score;
+
+        std::vector<std::pair<std::reference_wrapper<item>, double>> res;
+        res.reserve(best.size());
+        for (auto &[id, hit] : best)
+            res.push_back(hit);
+        std::sort(res.begin(), res.end(), [](const auto &a, const auto &b)
+                  { return a.second != b.second ? a.second > b.second : a.first.get().get_id() < b.first.get().get_id(); });
+        return res;
+    }
+
     item &coco::get_item(std::string_view id)
     {
         std::lock_guard<std::recursive_mutex> _(mtx);
@@ -164,44 +693,739 @@ namespace coco
         tp_names.reserve(tps.size());
         for (auto &tp : tps)
             tp_names.push_back(tp.get().get_name());
+        auto id = db.generate_id();
         std::lock_guard<std::recursive_mutex> _(mtx);
-        auto id = db.create_item(tp_names, props, val);
+        compact_vectors(tps, props, false);
+        if (val)
+            compact_vectors(tps, val->first, true);
+        db.create_item(id, tp_names, props, val);
         auto &itm = make_item(id, std::move(tps), std::move(props), std::move(val));
         if (infere)
             Run(env, -1);
         return itm;
     }
+    std::vector<std::reference_wrapper<item>> coco::create_items(std::vector<item_spec> &&specs, bool infere)
+    {
+        std::unordered_map<std::string, size_t> nm_idxs;
+        for (size_t i = 0; i < specs.size(); ++i)
+            if (!specs[i].name.empty() && !nm_idxs.emplace(specs[i].name, i).second)
+                throw std::invalid_argument("item `" + specs[i].name + "` is specified more than once");
+
+        // the IDs are generated upfront, so that the references between the items of the batch can be resolved before creating them..
+        std::vector<db_item> db_itms;
+        db_itms.reserve(specs.size());
+        std::vector<std::vector<size_t>> referrers(specs.size());                   // The items referencing each item..
+        std::vector<std::vector<std::pair<std::string, size_t>>> refs_of(specs.size()); // The items referenced by each item, by property name..
+        std::vector<size_t> n_refs(specs.size(), 0);
+        for (auto &spec : specs)
+        {
+            std::vector<std::string> tp_names;
+            tp_names.reserve(spec.types.size());
+            for (const type &tp : spec.types)
+                tp_names.push_back(tp.get_name());
+            db_itms.push_back(db_item{db.generate_id(), std::move(tp_names), std::nullopt, std::nullopt});
+        }
+        for (size_t i = 0; i < specs.size(); ++i)
+            if (specs[i].props.is_object())
+                for (auto &[p_name, p_val] : specs[i].props.as_object())
+                    if (p_val.is_object() && p_val.contains("item"))
+                    {
+                        if (!p_val["item"].is_string())
+                            throw std::invalid_argument("Invalid reference: " + p_val.dump());
+                        auto ref_it_name = p_val["item"].get<std::string>();
+                        auto ref = nm_idxs.find(ref_it_name);
+                        if (ref == nm_idxs.end())
+                            throw std::invalid_argument("item `" + ref_it_name + "` is not specified");
+                        p_val = db_itms[ref->second].id;
+                        referrers[ref->second].push_back(i);
+                        refs_of[i].emplace_back(p_name, ref->second);
+                        ++n_refs[i];
+                    }
+
+        // the referenced items are created before their referrers, so that the references can be validated when the facts are asserted..
+        std::vector<size_t> order;
+        order.reserve(specs.size());
+        for (size_t i = 0; i < specs.size(); ++i)
+            if (n_refs[i] == 0)
+                order.push_back(i);
+        for (size_t o = 0; o < order.size(); ++o)
+            for (auto r : referrers[order[o]])
+                if (--n_refs[r] == 0)
+                    order.push_back(r);
+        for (size_t i = 0; i < specs.size(); ++i)
+            if (n_refs[i] > 0) // circular references..
+                order.push_back(i);
+
+        std::lock_guard<std::recursive_mutex> _(mtx);
+        for (size_t i = 0; i < specs.size(); ++i)
+        { // the whole batch is validated before anything is written, the references to the items of the batch apart, since they do not exist yet..
+            std::set<std::string> batch_refs;
+            for (const auto &[p_name, _] : refs_of[i])
+                batch_refs.insert(p_name);
+            check_values(specs[i].types, specs[i].props, false, batch_refs);
+            compact_vectors(specs[i].types, specs[i].props, false);
+            if (specs[i].value)
+                check_values(specs[i].types, specs[i].value->first, true);
+        }
+        for (size_t i = 0; i < specs.size(); ++i)
+            if (specs[i].props.is_object() && !specs[i].props.as_object().empty())
+                db_itms[i].props = specs[i].props;
+        db.create_items(db_itms); // nothing is created in memory unless the whole batch has been persisted..
+
+        std::vector<bool> made(specs.size(), false);
+        std::vector<std::pair<size_t, json::json>> deferred; // the references to the items which are not created yet..
+        for (auto i : order)
+        {
+            json::json props = std::move(specs[i].props), refs;
+            for (const auto &[p_name, r] : refs_of[i])
+                if (!made[r])
+                {
+                    refs[p_name] = props[p_name];
+                    props.erase(p_name);
+                }
+            if (!refs.is_null())
+                deferred.emplace_back(i, std::move(refs));
+            make_item(db_itms[i].id, std::move(specs[i].types), std::move(props));
+            made[i] = true;
+        }
+        for (auto &[i, refs] : deferred)
+            get_item(db_itms[i].id).set_properties(std::move(refs));
+
+        std::vector<std::reference_wrapper<item>> res;
+        res.reserve(specs.size());
+        for (size_t i = 0; i < specs.size(); ++i)
+        {
+            auto &itm = *items.at(db_itms[i].id);
+            if (specs[i].value.has_value())
+                set_value(itm, std::move(specs[i].value->first), specs[i].value->second, false);
+            res.emplace_back(itm);
+        }
+        if (infere)
+            Run(env, -1);
+        return res;
+    }
     void coco::set_properties(item &itm, json::json &&props, bool infere) noexcept
     {
         std::lock_guard<std::recursive_mutex> _(mtx);
+        compact_vectors(itm.get_types(), props, false);
         db.set_properties(itm.get_id(), props);
         itm.set_properties(std::move(props));
         if (infere)
             Run(env, -1);
     }
+    namespace
+    {
+        // the value a path refers to, if any..
+        [[nodiscard]] const json::json *find_path(const json::json &doc, const std::vector<std::string> &path, size_t n) noexcept
+        {
+            const json::json *cur = &doc;
+            for (size_t i = 0; i < n; ++i)
+                if (cur->is_object() && cur->contains(path[i]))
+                    cur = &(*cur)[path[i]];
+                else if (cur->is_array() && !path[i].empty() && std::all_of(path[i].begin(), path[i].end(), [](char ch)
+                                                                             { return std::isdigit(static_cast<unsigned char>(ch)); }) &&
+                         std::stoull(path[i]) < cur->size())
+                    cur = &cur->as_array()[std::stoull(path[i])];
+                else
+                    return nullptr;
+            return cur;
+        }
+
+        // whether the path can be used as a dotted path of the database..
+        [[nodiscard]] bool is_plain_path(const std::vector<std::string> &path) noexcept
+        {
+            return std::none_of(path.begin(), path.end(), [](const std::string &token)
+                                { return token.empty() || token[0] == '$' || token.find('.') != std::string::npos; });
+        }
+    } // namespace
+
+    void coco::patch_properties(item &itm, const json::json &patch, bool infere)
+    {
+        const auto ops = parse_patch(patch);
+        std::lock_guard<std::recursive_mutex> _(mtx);
+        // the static properties of the item, by name, as declared by each of its types..
+        std::unordered_map<std::string, std::vector<const property *>> static_props;
+        for (const auto &tp : itm.get_types())
+            for (const auto &[p_name, prop] : tp.get().get_static_properties())
+                static_props[p_name].push_back(prop.get());
+        const auto check_property = [&static_props](const std::vector<std::string> &path)
+        {
+            if (path.empty())
+                throw std::invalid_argument("A JSON patch operation must target a property");
+            if (!static_props.count(path.front()))
+                throw std::invalid_argument("Unknown static property: " + path.front());
+        };
+
+        json::json props(json::json_type::object); // only the properties the patch refers to are read..
+        for (const auto &op : ops)
+            for (const auto *path : {&op.path, &op.from})
+                if (!path->empty() && !props.contains(path->front()))
+                    if (auto val = itm.get_property_value(path->front()); !val.is_null())
+                        props[path->front()] = std::move(val);
+        std::set<std::string> touched;                             // the properties changed by the patch..
+        std::set<std::string> whole;                               // the properties to be validated as a whole..
+        std::vector<std::pair<std::string, json::json>> elements; // the elements added to multiple properties, to be validated on their own..
+        std::vector<db_property_update> updates;
+        const auto set_whole = [&props, &updates](const std::string &p_name)
+        { // the whole property is persisted, as the change cannot be expressed on its parts..
+            if (props.contains(p_name))
+                updates.push_back({db_property_update::set, {p_name}, props[p_name], std::nullopt});
+            else
+                updates.push_back({db_property_update::unset, {p_name}, {}, std::nullopt});
+        };
+        const auto is_element = [&static_props](const patch_op &op)
+        {
+            return op.path.size() == 2 && std::all_of(static_props[op.path.front()].begin(), static_props[op.path.front()].end(), [](const property *prop)
+                                                      { return prop->is_multiple(); });
+        };
+
+        for (const auto &op : ops)
+        {
+            check_property(op.path);
+            if (op.kind == patch_kind::move || op.kind == patch_kind::copy)
+                check_property(op.from);
+            const auto &p_name = op.path.front();
+            const auto *parent = find_path(props, op.path, op.path.size() - 1);
+            const bool in_array = op.path.size() > 1 && parent && parent->is_array();
+            const auto size = in_array ? parent->size() : 0;
+            apply_patch(props, op);
+            if (op.kind == patch_kind::test)
+                continue;
+            touched.insert(p_name);
+
+            switch (op.kind)
+            {
+            case patch_kind::add:
+            case patch_kind::set:
+            case patch_kind::replace:
+                if (!is_plain_path(op.path))
+                    set_whole(p_name);
+                else if (in_array && (op.kind == patch_kind::add || op.path.back() == "-" || std::stoull(op.path.back()) == size))
+                { // the elements are inserted, except those set at an existing index, which are replaced in place..
+                    std::optional<size_t> position;
+                    if (op.path.back() != "-" && std::stoull(op.path.back()) < size)
+                        position = std::stoull(op.path.back());
+                    updates.push_back({db_property_update::push, {op.path.begin(), op.path.end() - 1}, op.value, position});
+                }
+                else
+                    updates.push_back({db_property_update::set, op.path, op.value, std::nullopt});
+                if (is_element(op))
+                    elements.emplace_back(p_name, op.value);
+                else
+                    whole.insert(p_name);
+                break;
+            case patch_kind::remove:
+                if (op.path.size() == 1 || (!in_array && is_plain_path(op.path)))
+                    updates.push_back({db_property_update::unset, op.path, {}, std::nullopt});
+                else // an element cannot be removed by index with a single update of the database..
+                    set_whole(p_name);
+                if (!is_element(op))
+                    whole.insert(p_name);
+                break;
+            case patch_kind::move:
+            case patch_kind::copy:
+                if (op.kind == patch_kind::move && op.from.front() != p_name)
+                {
+                    touched.insert(op.from.front());
+                    whole.insert(op.from.front());
+                    set_whole(op.from.front());
+                }
+                set_whole(p_name);
+                whole.insert(p_name);
+                break;
+            default:
+                break;
+            }
+        }
+
+        // only the changed parts are validated..
+        for (const auto &p_name : whole)
+        {
+            const auto val = props.contains(p_name) ? props[p_name] : json::json();
+            for (const auto *prop : static_props[p_name])
+                if (!prop->validate(val))
+                    throw std::invalid_argument("Invalid value for property " + p_name + ": " + val.dump());
+        }
+        for (const auto &[p_name, val] : elements)
+            if (!whole.count(p_name))
+            {
+                json::json arr(json::json_type::array);
+                arr.push_back(val);
+                for (const auto *prop : static_props[p_name])
+                    if (!prop->validate(arr))
+                        throw std::invalid_argument("Invalid value for property " + p_name + ": " + val.dump());
+            }
+
+        if (touched.empty())
+            return;
+        const auto tps = itm.get_types();
+        for (auto &upd : updates)
+            if (upd.kind == db_property_update::set && upd.path.size() == 1)
+            { // the vectors set as a whole are persisted in their compact form..
+                json::json val{{upd.path.front(), std::move(upd.value)}};
+                compact_vectors(tps, val, false);
+                upd.value = std::move(val[upd.path.front()]);
+            }
+        db.update_properties(itm.get_id(), updates);
+        json::json changed(json::json_type::object);
+        for (const auto &p_name : touched)
+            changed[p_name] = props.contains(p_name) ? props[p_name] : json::json();
+        compact_vectors(tps, changed, false);
+        itm.set_properties(std::move(changed), false);
+        if (infere)
+            Run(env, -1);
+    }
+
+    namespace
+    {
+        [[nodiscard]] bool has_dynamic_property(const item &itm, const std::string &prop)
+        {
+            const auto tps = itm.get_types();
+            return std::any_of(tps.begin(), tps.end(), [&prop](const type &tp)
+                               { return tp.get_dynamic_properties().count(prop); });
+        }
+
+        void check_dynamic_properties(const item &itm, const std::vector<std::string> &props)
+        {
+            for (const auto &prop : props)
+                if (!has_dynamic_property(itm, prop))
+                    throw std::invalid_argument("Unknown dynamic property: " + prop);
+        }
+    } // namespace
+
     json::json coco::get_values(const item &itm, const std::chrono::system_clock::time_point &from, const std::chrono::system_clock::time_point &to)
+    {
+        std::unique_lock<std::recursive_mutex> lock(mtx);
+        if (itm.covers({}, from))
+        { // the recent history kept in memory holds the whole range..
+            ts_stitcher stitcher;
+            itm.get_history({}, from, to, [&stitcher](const std::string &name, int64_t timestamp, json::json &&val)
+                            { stitcher.add(name, timestamp, std::move(val)); });
+            json::json res(json::json_type::array);
+            stitcher.flush([&res](int64_t timestamp, json::json &&data)
+                           { res.push_back(json::json{{"data", std::move(data)}, {"timestamp", timestamp}}); });
+            return res;
+        }
+        const std::string itm_id = itm.get_id();
+        lock.unlock(); // the database is queried without holding the lock..
+        return db.get_values(itm_id, from, to);
+    }
+    std::optional<std::string> coco::get_values(const item &itm, const std::vector<std::string> &fields, const std::chrono::system_clock::time_point &from, const std::chrono::system_clock::time_point &to, size_t limit, const std::function<void(json::json &&)> &cb, std::string_view token)
+    {
+        if (!limit)
+            throw std::invalid_argument("Invalid limit: 0");
+        auto start = from;
+        if (!token.empty())
+            try
+            { // the token is the timestamp from which the next page starts..
+                start = std::max(from, std::chrono::system_clock::time_point(std::chrono::milliseconds{std::stoll(std::string(token))}));
+            }
+            catch (const std::logic_error &)
+            {
+                throw std::invalid_argument("Invalid continuation token: " + std::string(token));
+            }
+        std::unique_lock<std::recursive_mutex> lock(mtx);
+        const std::string itm_id = itm.get_id();
+        check_dynamic_properties(itm, fields);
+        if (itm.covers(fields, start))
+        { // the recent history kept in memory holds the whole range..
+            ts_stitcher stitcher(limit);
+            itm.get_history(fields, start, to, [&stitcher](const std::string &name, int64_t timestamp, json::json &&val)
+                            { stitcher.add(name, timestamp, std::move(val)); });
+            if (auto next = stitcher.flush([&cb](int64_t timestamp, json::json &&data)
+                                           { cb(json::json{{"data", std::move(data)}, {"timestamp", timestamp}}); }))
+                return std::to_string(*next);
+            return std::nullopt;
+        }
+        lock.unlock(); // the database is queried without holding the lock..
+        if (auto next = db.get_values(itm_id, fields, start, to, limit, cb))
+            return std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(next->time_since_epoch()).count());
+        return std::nullopt;
+    }
+    void coco::get_values(const std::vector<std::string> &itm_ids, const std::vector<std::string> &fields, const std::chrono::system_clock::time_point &from, const std::chrono::system_clock::time_point &to, const std::function<void(const std::string &, json::json &&)> &cb)
+    {
+        std::unique_lock<std::recursive_mutex> lock(mtx);
+        std::vector<std::reference_wrapper<const item>> itms;
+        itms.reserve(itm_ids.size());
+        for (const auto &itm_id : itm_ids)
+            itms.emplace_back(get_item(itm_id));
+        for (const auto &field : fields)
+            if (std::none_of(itms.begin(), itms.end(), [&field](const item &itm)
+                             { return has_dynamic_property(itm, field); }))
+                throw std::invalid_argument("Unknown dynamic property: " + field);
+
+        std::vector<std::string> db_itm_ids; // the items whose recent history does not cover the range..
+        for (const item &itm : itms)
+            if (itm.covers(fields, from))
+            {
+                ts_stitcher stitcher;
+                itm.get_history(fields, from, to, [&stitcher](const std::string &name, int64_t timestamp, json::json &&val)
+                                { stitcher.add(name, timestamp, std::move(val)); });
+                stitcher.flush([&cb, &itm](int64_t timestamp, json::json &&data)
+                               { cb(itm.get_id(), json::json{{"data", std::move(data)}, {"timestamp", timestamp}}); });
+            }
+            else
+                db_itm_ids.push_back(itm.get_id());
+        lock.unlock(); // the database is queried without holding the lock..
+        if (!db_itm_ids.empty())
+            db.get_values(db_itm_ids, fields, from, to, cb);
+    }
+    void coco::get_values(const type &tp, const json::json &filter, const std::vector<std::string> &fields, const std::chrono::system_clock::time_point &from, const std::chrono::system_clock::time_point &to, const std::function<void(const std::string &, json::json &&)> &cb)
+    {
+        std::vector<std::string> itm_ids;
+        {
+            std::lock_guard<std::recursive_mutex> _(mtx);
+            std::vector<item_filter> filters;
+            for (const auto &[p_name, val] : filter.as_object())
+            {
+                if (!tp.get_static_properties().count(p_name))
+                    throw std::invalid_argument("Unknown static property: " + p_name);
+                filters.push_back({p_name, filter_op::eq, val});
+            }
+            for (const item &itm : tp.get_instances(filters)) // the filters are evaluated on the columns of the type..
+                itm_ids.push_back(itm.get_id());
+        }
+        get_values(itm_ids, fields, from, to, cb);
+    }
+    json::json coco::get_values(const item &itm, const std::chrono::seconds &resolution, const std::chrono::system_clock::time_point &from, const std::chrono::system_clock::time_point &to)
+    {
+        if (const auto &resolutions = db.get_rollup_resolutions(); std::find(resolutions.begin(), resolutions.end(), resolution) == resolutions.end())
+            throw std::invalid_argument("Unsupported resolution: " + std::to_string(resolution.count()) + "s");
+        std::unique_lock<std::recursive_mutex> lock(mtx);
+        const std::string itm_id = itm.get_id();
+        lock.unlock(); // the database is queried without holding the lock..
+        return db.get_rollups(itm_id, resolution, from, to);
+    }
+    json::json coco::get_values(const item &itm, const aggregation &agg, const std::chrono::system_clock::time_point &from, const std::chrono::system_clock::time_point &to)
+    {
+        if (agg.bucket.count() <= 0)
+            throw std::invalid_argument("Invalid bucket width: " + std::to_string(agg.bucket.count()) + "ms");
+        std::unique_lock<std::recursive_mutex> lock(mtx);
+        const std::string itm_id = itm.get_id();
+        check_dynamic_properties(itm, agg.properties);
+        aggregator aggr(agg);
+        if (itm.covers(agg.properties, from))
+        { // the recent history kept in memory holds the whole range..
+            itm.get_history(agg.properties, from, to, [&aggr](const std::string &name, int64_t timestamp, json::json &&val)
+                            { aggr.add(name, timestamp, val); });
+            return aggr.get_result();
+        }
+        lock.unlock(); // the database is queried without holding the lock..
+        db.scan_values(itm_id, agg.properties, from, to, [&aggr](const std::string &name, int64_t timestamp, json::json &&val)
+                       { aggr.add(name, timestamp, val); });
+        return aggr.get_result();
+    }
+    size_t coco::get_history_bytes() noexcept
     {
         std::lock_guard<std::recursive_mutex> _(mtx);
-        return db.get_values(itm.get_id(), from, to);
+        size_t res = 0;
+        for (const auto &[_, itm] : items)
+            res += itm->get_history_bytes();
+        return res;
     }
     void coco::set_value(item &itm, json::json &&val, const std::chrono::system_clock::time_point &timestamp, bool infere)
     {
         std::lock_guard<std::recursive_mutex> _(mtx);
+        compact_vectors(itm.get_types(), val, true);
+        if (const auto &current = itm.get_value(); current && timestamp < current->second)
+        { // the value is older than the current one, so it must not roll the state of the item back, unless told otherwise..
+            auto &stats = late_values[itm.get_id()];
+            switch (late_policy_of(itm.get_types()))
+            {
+            case late_policy::reject:
+                LOG_WARN("Rejecting late value for item " + itm.get_id());
+                ++stats.rejected;
+                return;
+            case late_policy::store:
+                LOG_DEBUG("Storing late value for item " + itm.get_id());
+                ++stats.stored;
+                db.set_values(itm.get_id(), {{val, timestamp}});
+                itm.record(val, timestamp);
+                return;
+            case late_policy::apply:
+                ++stats.applied;
+                break;
+            }
+        }
         db.set_value(itm.get_id(), val, timestamp);
         itm.set_value(std::make_pair(std::move(val), timestamp));
         if (infere)
             Run(env, -1);
     }
-    void coco::delete_item(item &itm, bool infere) noexcept
+    late_stats coco::get_late_stats() noexcept
+    {
+        std::lock_guard<std::recursive_mutex> _(mtx);
+        late_stats res;
+        for (const auto &[_, stats] : late_values)
+        {
+            res.applied += stats.applied;
+            res.stored += stats.stored;
+            res.rejected += stats.rejected;
+        }
+        return res;
+    }
+    late_stats coco::get_late_stats(const item &itm) noexcept
+    {
+        std::lock_guard<std::recursive_mutex> _(mtx);
+        if (auto it = late_values.find(itm.get_id()); it != late_values.end())
+            return it->second;
+        return {};
+    }
+    void coco::backfill(item &itm, std::vector<std::pair<json::json, std::chrono::system_clock::time_point>> &&series, bool infere)
     {
-        auto id = itm.get_id();
+        if (series.empty())
+            return;
+        std::stable_sort(series.begin(), series.end(), [](const auto &a, const auto &b)
+                         { return a.second < b.second; });
         std::lock_guard<std::recursive_mutex> _(mtx);
-        db.delete_item(id);
-        items.erase(id);
+        const auto tps = itm.get_types();
+        for (const auto &[val, _] : series)
+        { // the whole series is validated before anything is stored..
+            if (!val.is_object())
+                throw std::invalid_argument("Invalid value: " + val.dump());
+            for (const auto &[p_name, v] : val.as_object())
+            {
+                if (!has_dynamic_property(itm, p_name))
+                    throw std::invalid_argument("Unknown dynamic property: " + p_name);
+                if (!v.is_null())
+                    for (const type &tp : tps)
+                        if (auto prop = tp.get_dynamic_properties().find(p_name); prop != tp.get_dynamic_properties().end() && !prop->second->validate(v))
+                            throw std::invalid_argument("Invalid value for dynamic property " + p_name + ": " + v.dump());
+            }
+        }
+        for (auto &[val, _] : series)
+            compact_vectors(tps, val, true);
+        // only the values newer than the current one contribute to the new value of the item..
+        std::optional<std::pair<json::json, std::chrono::system_clock::time_point>> latest;
+        const auto &current = itm.get_value();
+        for (const auto &[val, timestamp] : series)
+            if (!current || timestamp > current->second)
+            {
+                if (!latest)
+                    latest.emplace(json::json(json::json_type::object), timestamp);
+                for (const auto &[nm, v] : val.as_object())
+                    latest->first[nm] = v;
+                latest->second = timestamp;
+            }
+        db.set_values(itm.get_id(), series, latest);
+        for (const auto &[val, timestamp] : series)
+            itm.record(val, timestamp);
+        if (latest)
+        {
+            itm.set_value(std::move(*latest), false);
+            if (infere)
+                Run(env, -1);
+        }
+    }
+    void coco::delete_item(item &itm, bool infere)
+    {
+        std::lock_guard<std::recursive_mutex> _(mtx);
+        // the items the deletion cascades to are collected upfront, each once, so that mutual cascades terminate..
+        std::vector<std::string> deleting{itm.get_id()};
+        std::unordered_set<std::string> in_progress{itm.get_id()};
+        std::vector<std::tuple<std::string, std::string, std::string>> nulled; // the references to be removed, as referencing item, property and referenced item..
+        for (size_t i = 0; i < deleting.size(); ++i)
+            if (auto it = referrers.find(deleting[i]); it != referrers.end())
+                for (const auto &[ref_id, p_name] : it->second)
+                {
+                    const auto prop = dynamic_cast<const item_property *>(&items.at(ref_id)->get_property(p_name));
+                    if (prop && prop->is_cascading())
+                    {
+                        if (in_progress.insert(ref_id).second)
+                            deleting.push_back(ref_id);
+                    }
+                    else
+                        nulled.emplace_back(ref_id, p_name, deleting[i]);
+                }
+        for (const auto &[ref_id, p_name, id] : nulled) // the deletion is refused, before anything is deleted, if a reference cannot be removed..
+            if (!in_progress.count(ref_id))
+                if (const auto &prop = items.at(ref_id)->get_property(p_name); !prop.is_nullable() && !prop.is_multiple())
+                    throw std::invalid_argument("Item " + id + " is referenced by item " + ref_id + " through the non-nullable property " + p_name);
+
+        for (const auto &id : deleting)
+        {
+            LOG_DEBUG("Deleting item " + id);
+            referrers.erase(id);
+            auto &del_itm = *items.at(id);
+            for (auto &tp : del_itm.get_types()) // this also drops the references of the item..
+                tp.get().remove_instance(del_itm);
+            db.set_archive(id, {}); // the held points are flushed before the data of the item are deleted..
+            db.delete_item(id);
+            late_values.erase(id);
+            items.erase(id);
+        }
+        for (const auto &[ref_id, p_name, id] : nulled)
+        {
+            if (in_progress.count(ref_id))
+                continue; // deleted as well..
+            auto &ref = *items.at(ref_id);
+            const auto dynamic = ref.get_property(p_name).is_dynamic();
+            const json::json p_val = dynamic ? (ref.get_value() && ref.get_value()->first.contains(p_name) ? ref.get_value()->first[p_name] : json::json()) : ref.get_property_value(p_name);
+            if (p_val.is_null())
+                continue;
+            try
+            {
+                json::json new_val = nullptr; // the references to the deleted items are removed..
+                if (p_val.is_array())
+                {
+                    new_val = json::json(json::json_type::array);
+                    for (const auto &v : p_val.as_array())
+                        if (!in_progress.count(v.get<std::string>()))
+                            new_val.push_back(v);
+                    if (new_val.size() == p_val.size())
+                        continue; // already removed, along with the reference to another deleted item..
+                }
+                if (dynamic)
+                    set_value(ref, json::json{{p_name, std::move(new_val)}}, std::chrono::system_clock::now(), false);
+                else
+                    set_properties(ref, json::json{{p_name, std::move(new_val)}}, false);
+            }
+            catch (const std::exception &e)
+            {
+                LOG_ERR("Failed to remove the reference to item " << id << " from item " << ref_id << ": " << e.what());
+            }
+        }
         if (infere)
             Run(env, -1);
     }
 
+    std::vector<std::pair<std::reference_wrapper<item>, std::string>> coco::get_referrers(const item &itm) noexcept
+    {
+        std::lock_guard<std::recursive_mutex> _(mtx);
+        std::vector<std::pair<std::reference_wrapper<item>, std::string>> res;
+        if (auto it = referrers.find(itm.get_id()); it != referrers.end())
+            for (const auto &[ref_id, p_name] : it->second)
+                res.emplace_back(*items.at(ref_id), p_name);
+        return res;
+    }
+
+    static_assert(JSON_CACHE_SIZE > 0, "The cache of the parsed JSON strings must hold at least one document");
+
+    CLIPSExternalAddress *coco::to_json_address(std::shared_ptr<const json::json> doc) noexcept { return CreateExternalAddress(env, new std::shared_ptr<const json::json>(std::move(doc)), json_address_type); }
+    std::shared_ptr<const json::json> coco::to_json_document(const UDFValue &val) noexcept
+    {
+        switch (val.header->type)
+        {
+        case EXTERNAL_ADDRESS_TYPE:
+            if (val.externalAddressValue->type == json_address_type)
+                return *static_cast<std::shared_ptr<const json::json> *>(val.externalAddressValue->contents);
+            return nullptr;
+        case STRING_TYPE:
+        { // the lexemes are interned, so a retained lexeme always holds the same string..
+            if (auto it = parsed_lexeme_pos.find(val.lexemeValue); it != parsed_lexeme_pos.end())
+            {
+                parsed_lexemes.splice(parsed_lexemes.begin(), parsed_lexemes, it->second);
+                return it->second->second;
+            }
+            std::shared_ptr<const json::json> doc;
+            try
+            {
+                doc = std::make_shared<const json::json>(json::load(val.lexemeValue->contents));
+            }
+            catch (const std::exception &e)
+            {
+                LOG_ERR("Invalid JSON document: " << e.what());
+                return nullptr;
+            }
+            if (parsed_lexemes.size() == JSON_CACHE_SIZE)
+            { // the least recently read string is evicted..
+                ReleaseLexeme(env, parsed_lexemes.back().first);
+                parsed_lexeme_pos.erase(parsed_lexemes.back().first);
+                parsed_lexemes.pop_back();
+            }
+            RetainLexeme(env, val.lexemeValue);
+            parsed_lexemes.emplace_front(val.lexemeValue, doc);
+            parsed_lexeme_pos.emplace(val.lexemeValue, parsed_lexemes.begin());
+            return doc;
+        }
+        default:
+            return nullptr;
+        }
+    }
+    const json::json *coco::to_json_document(void *value) const noexcept
+    {
+        if (static_cast<const TypeHeader *>(value)->type != EXTERNAL_ADDRESS_TYPE)
+            return nullptr;
+        const auto *addr = static_cast<const CLIPSExternalAddress *>(value);
+        if (addr->type != json_address_type)
+            return nullptr;
+        return static_cast<std::shared_ptr<const json::json> *>(addr->contents)->get();
+    }
+    void *coco::to_clips_value(const std::shared_ptr<const json::json> &doc, const json::json &j) noexcept
+    {
+        switch (j.get_type())
+        {
+        case json::json_type::boolean:
+            return CreateBoolean(env, j.get<bool>());
+        case json::json_type::number:
+            if (j.is_integer())
+                return CreateInteger(env, j.get<int64_t>());
+            return CreateFloat(env, j.get<double>());
+        case json::json_type::string:
+            return CreateString(env, j.get<std::string>().c_str());
+        case json::json_type::array:
+        case json::json_type::object: // the nested document shares the ownership of the whole document..
+            return to_json_address(std::shared_ptr<const json::json>(doc, &j));
+        default:
+            return CreateSymbol(env, "nil");
+        }
+    }
+
+    CLIPSExternalAddress *coco::to_vector_address(std::shared_ptr<const vector_buffer> buf) noexcept { return CreateExternalAddress(env, new std::shared_ptr<const vector_buffer>(std::move(buf)), vector_address_type); }
+    const vector_buffer *coco::to_vector_buffer(void *value) const noexcept
+    {
+        if (static_cast<const TypeHeader *>(value)->type != EXTERNAL_ADDRESS_TYPE)
+            return nullptr;
+        const auto *addr = static_cast<const CLIPSExternalAddress *>(value);
+        if (addr->type != vector_address_type)
+            return nullptr;
+        return static_cast<std::shared_ptr<const vector_buffer> *>(addr->contents)->get();
+    }
+    void coco::compact_vectors(const std::vector<std::reference_wrapper<type>> &tps, json::json &val, bool dynamic) const noexcept
+    {
+        if (!val.is_object())
+            return;
+        for (auto &[p_name, v] : val.as_object())
+            if (v.is_array())
+                for (const auto &tp : tps)
+                {
+                    const auto &props = dynamic ? tp.get().get_dynamic_properties() : tp.get().get_static_properties();
+                    if (auto prop = props.find(p_name); prop != props.end() && prop->second->get_property_type().get_name() == vector_kw)
+                    { // the vector is stored, and sent to the listeners, as a single base64 string rather than as an array of numbers..
+                        v = static_cast<const vector_property &>(*prop->second).compact(v);
+                        break;
+                    }
+                }
+    }
+
+    void coco::add_referrer(const std::string &itm_id, const std::string &prop, const json::json &val) noexcept
+    {
+        if (val.is_array())
+            for (const auto &v : val.as_array())
+                add_referrer(itm_id, prop, v);
+        else if (val.is_string())
+            referrers[val.get<std::string>()].emplace(itm_id, prop);
+    }
+    void coco::remove_referrer(const std::string &itm_id, const std::string &prop, const json::json &val) noexcept
+    {
+        if (val.is_array())
+            for (const auto &v : val.as_array())
+                remove_referrer(itm_id, prop, v);
+        else if (val.is_string())
+            if (auto it = referrers.find(val.get<std::string>()); it != referrers.end() && it->second.erase({itm_id, prop}) && it->second.empty())
+                referrers.erase(it);
+    }
+    void coco::add_referrers(const item &itm) noexcept
+    {
+        for (const auto &[p_name, val] : itm.get_references())
+            add_referrer(itm.get_id(), p_name, val);
+    }
+    void coco::remove_referrers(const item &itm) noexcept
+    {
+        for (const auto &[p_name, val] : itm.get_references())
+            remove_referrer(itm.get_id(), p_name, val);
+    }
+
     std::vector<std::reference_wrapper<rule>> coco::get_rules() noexcept
     {
         std::lock_guard<std::recursive_mutex> _(mtx);
@@ -265,6 +1489,7 @@ namespace coco
             throw std::invalid_argument("item `" + std::string(id) + "` already exists");
         for (auto &tp : tps)
             tp.get().add_instance(itm);
+        db.set_archive(id, archives_of(tps));
         return itm;
     }
 
@@ -449,31 +1674,22 @@ namespace coco
 
     void set_items(coco &cc, std::unordered_map<std::string, db_item> &&db_items) noexcept
     {
-        std::unordered_map<std::string, std::string> nm_ids;
+        std::vector<item_spec> specs;
+        specs.reserve(db_items.size());
         for (auto &[it_name, db_itm] : db_items)
         {
             std::vector<std::reference_wrapper<type>> tps;
             for (auto &tp_name : db_itm.types)
                 tps.push_back(cc.get_type(tp_name));
-            nm_ids.emplace(it_name, cc.create_item(std::move(tps), json::json{}, std::nullopt, false).get_id());
+            specs.push_back(item_spec{it_name, std::move(tps), db_itm.props.has_value() ? std::move(*db_itm.props) : json::json{}, std::move(db_itm.value)});
         }
-        for (auto &[it_name, db_itm] : db_items)
+        try
         {
-            json::json props;
-            if (db_itm.props.has_value())
-            {
-                for (auto &[prop_name, prop_value] : db_itm.props->as_object())
-                    if (prop_value.is_object() && prop_value.contains("item"))
-                    {
-                        auto ref_it_name = prop_value["item"].get<std::string>();
-                        props[prop_name] = nm_ids.at(ref_it_name);
-                    }
-                    else
-                        props[prop_name] = std::move(prop_value);
-            }
-            cc.set_properties(cc.get_item(nm_ids.at(it_name)), std::move(props), false);
-            if (db_itm.value.has_value())
-                cc.set_value(cc.get_item(nm_ids.at(it_name)), std::move(db_itm.value->first), db_itm.value->second, false);
+            [[maybe_unused]] auto itms = cc.create_items(std::move(specs), false);
+        }
+        catch (const std::exception &e)
+        {
+            LOG_ERR("Failed to create the items: " << e.what());
         }
     }
 
@@ -552,6 +1768,18 @@ namespace coco
             case STRING_TYPE:
                 data[par.lexemeValue->contents] = val.lexemeValue->contents;
                 break;
+            case EXTERNAL_ADDRESS_TYPE:
+                if (const auto *buf = cc.to_vector_buffer(val.value))
+                    data[par.lexemeValue->contents] = buf->to_json();
+                else if (const auto *doc = cc.to_json_document(val.value))
+                    data[par.lexemeValue->contents] = *doc;
+                else
+                {
+                    LOG_ERR("The value of the `" << par.lexemeValue->contents << "` property must be a JSON document or a vector");
+                    UDFThrowError(udfc);
+                    return;
+                }
+                break;
             case SYMBOL_TYPE:
                 if (std::string(val.lexemeValue->contents) == "TRUE")
                     data[par.lexemeValue->contents] = true;
@@ -610,6 +1838,18 @@ namespace coco
                 else
                     data[par.lexemeValue->contents] = val.lexemeValue->contents;
                 break;
+            case EXTERNAL_ADDRESS_TYPE:
+                if (const auto *buf = cc.to_vector_buffer(val.value))
+                    data[par.lexemeValue->contents] = buf->to_json();
+                else if (const auto *doc = cc.to_json_document(val.value))
+                    data[par.lexemeValue->contents] = *doc;
+                else
+                {
+                    LOG_ERR("The value of the `" << par.lexemeValue->contents << "` property must be a JSON document or a vector");
+                    UDFThrowError(udfc);
+                    return;
+                }
+                break;
             case SYMBOL_TYPE:
                 if (std::string(val.lexemeValue->contents) == "TRUE")
                     data[par.lexemeValue->contents] = true;
@@ -646,72 +1886,320 @@ namespace coco
 
     void multifield_to_json(Environment *env, UDFContext *udfc, UDFValue *ret)
     {
+        auto &cc = *reinterpret_cast<coco *>(udfc->context);
+
         UDFValue multifield;
         if (!UDFFirstArgument(udfc, MULTIFIELD_BIT, &multifield))
             return;
 
-        json::json j_array(json::json_type::array);
-
+        // the serialization is written directly, without building an intermediate document..
+        StringBuilder *sb = CreateStringBuilder(env, 64);
+        SBAddChar(sb, '[');
+        bool first = true;
         for (size_t i = 0; i < multifield.multifieldValue->length; ++i)
         {
             auto &val = multifield.multifieldValue->contents[i];
+            if (val.header->type != STRING_TYPE && val.header->type != SYMBOL_TYPE && val.header->type != INTEGER_TYPE && val.header->type != FLOAT_TYPE && (val.header->type != EXTERNAL_ADDRESS_TYPE || (val.externalAddressValue->type != cc.json_address_type && val.externalAddressValue->type != cc.vector_address_type)))
+                continue;
+            if (!first)
+                SBAddChar(sb, ',');
+            first = false;
             switch (val.header->type)
             {
             case STRING_TYPE:
             case SYMBOL_TYPE:
-                j_array.push_back(val.lexemeValue->contents);
+                append_json_string(sb, val.lexemeValue->contents);
                 break;
             case INTEGER_TYPE:
-                j_array.push_back(static_cast<int64_t>(val.integerValue->contents));
+                SBAppendInteger(sb, val.integerValue->contents);
                 break;
             case FLOAT_TYPE:
-                j_array.push_back(val.floatValue->contents);
+                SBAppendFloat(sb, val.floatValue->contents);
                 break;
             default:
+                if (const auto *buf = cc.to_vector_buffer(val.value))
+                    SBAppend(sb, buf->to_json().dump().c_str());
+                else
+                    SBAppend(sb, (*static_cast<std::shared_ptr<const json::json> *>(val.externalAddressValue->contents))->dump().c_str());
                 break;
             }
         }
+        SBAddChar(sb, ']');
 
-        ret->lexemeValue = CreateString(env, j_array.dump().c_str());
+        ret->lexemeValue = CreateString(env, sb->contents);
+        SBDispose(sb);
     }
 
     void json_to_multifield(Environment *env, UDFContext *udfc, UDFValue *ret)
     {
+        auto &cc = *reinterpret_cast<coco *>(udfc->context);
+
+        UDFValue json_val;
+        if (!UDFFirstArgument(udfc, STRING_BIT | EXTERNAL_ADDRESS_BIT, &json_val))
+            return;
+        const auto doc = cc.to_json_document(json_val);
+        if (!doc)
+        {
+            LOG_ERR("The argument of from_json must be a JSON document");
+            UDFThrowError(udfc);
+            return;
+        }
+
+        // each value is serialized into a string, as the existing rules expect..
+        ret->multifieldValue = to_multifield(env, *doc, [env](const json::json &j)
+                                             { return CreateString(env, j.dump().c_str()); });
+    }
+
+    void json_values(Environment *env, UDFContext *udfc, UDFValue *ret)
+    {
+        auto &cc = *reinterpret_cast<coco *>(udfc->context);
+
+        UDFValue json_val;
+        if (!UDFFirstArgument(udfc, STRING_BIT | EXTERNAL_ADDRESS_BIT, &json_val))
+            return;
+        const auto doc = cc.to_json_document(json_val);
+        if (!doc)
+        {
+            LOG_ERR("The argument of json-values must be a JSON document");
+            UDFThrowError(udfc);
+            return;
+        }
+
+        // the values are converted in place, the nested arrays and objects sharing the document..
+        ret->multifieldValue = to_multifield(env, *doc, [&cc, &doc](const json::json &j)
+                                             { return cc.to_clips_value(doc, j); });
+    }
+
+    void json_parse(Environment *, UDFContext *udfc, UDFValue *ret)
+    {
+        auto &cc = *reinterpret_cast<coco *>(udfc->context);
+
         UDFValue json_str;
         if (!UDFFirstArgument(udfc, STRING_BIT, &json_str))
             return;
 
-        json::json j = json::load(json_str.lexemeValue->contents);
-        switch (j.get_type())
+        const auto doc = cc.to_json_document(json_str);
+        if (!doc)
         {
-        case json::json_type::array:
+            UDFThrowError(udfc);
+            return;
+        }
+        ret->externalAddressValue = cc.to_json_address(doc);
+    }
+
+    void json_get(Environment *env, UDFContext *udfc, UDFValue *ret)
+    {
+        auto &cc = *reinterpret_cast<coco *>(udfc->context);
+
+        UDFValue json_val, path;
+        if (!UDFFirstArgument(udfc, STRING_BIT | EXTERNAL_ADDRESS_BIT, &json_val) || !UDFNextArgument(udfc, STRING_BIT, &path))
+            return;
+        const auto doc = cc.to_json_document(json_val);
+        if (!doc)
         {
-            Multifield *mf = CreateMultifield(env, j.size());
-            for (size_t i = 0; i < j.size(); ++i)
-                mf->contents[i].lexemeValue = CreateString(env, j[i].dump().c_str());
-            ret->multifieldValue = mf;
-            break;
+            LOG_ERR("The first argument of json-get must be a JSON document");
+            UDFThrowError(udfc);
+            return;
         }
-        case json::json_type::object:
+
+        if (const auto *j = at_path(*doc, path.lexemeValue->contents))
+            ret->value = cc.to_clips_value(doc, *j);
+        else
+            ret->lexemeValue = CreateSymbol(env, "nil");
+    }
+
+    void json_has(Environment *env, UDFContext *udfc, UDFValue *ret)
+    {
+        auto &cc = *reinterpret_cast<coco *>(udfc->context);
+
+        UDFValue json_val, path;
+        if (!UDFFirstArgument(udfc, STRING_BIT | EXTERNAL_ADDRESS_BIT, &json_val) || !UDFNextArgument(udfc, STRING_BIT, &path))
+            return;
+        const auto doc = cc.to_json_document(json_val);
+        ret->lexemeValue = CreateBoolean(env, doc && at_path(*doc, path.lexemeValue->contents));
+    }
+
+    void json_len(Environment *env, UDFContext *udfc, UDFValue *ret)
+    {
+        auto &cc = *reinterpret_cast<coco *>(udfc->context);
+
+        UDFValue json_val;
+        if (!UDFFirstArgument(udfc, STRING_BIT | EXTERNAL_ADDRESS_BIT, &json_val))
+            return;
+        const auto doc = cc.to_json_document(json_val);
+        const json::json *j = doc.get();
+        if (UDFHasNextArgument(udfc))
         {
-            Multifield *mf = CreateMultifield(env, j.size() * 2);
-            size_t i = 0;
-            for (auto &[key, value] : j.as_object())
-            {
-                mf->contents[i++].lexemeValue = CreateString(env, key.c_str());
-                mf->contents[i++].lexemeValue = CreateString(env, value.dump().c_str());
-            }
-            ret->multifieldValue = mf;
-            break;
+            UDFValue path;
+            if (!UDFNextArgument(udfc, STRING_BIT, &path))
+                return;
+            if (j)
+                j = at_path(*j, path.lexemeValue->contents);
         }
-        default:
+        if (!j || (!j->is_array() && !j->is_object()))
+        {
+            LOG_ERR("The argument of json-len must be a JSON array or object");
+            UDFThrowError(udfc);
+            return;
+        }
+        ret->integerValue = CreateInteger(env, static_cast<long long>(j->size()));
+    }
+
+    void vector_len(Environment *env, UDFContext *udfc, UDFValue *ret)
+    {
+        auto &cc = *reinterpret_cast<coco *>(udfc->context);
+
+        UDFValue vec;
+        if (!UDFFirstArgument(udfc, EXTERNAL_ADDRESS_BIT, &vec))
+            return;
+        const auto *buf = cc.to_vector_buffer(vec.value);
+        if (!buf)
         {
-            Multifield *mf = CreateMultifield(env, 1);
-            mf->contents[0].lexemeValue = CreateString(env, j.dump().c_str());
-            ret->multifieldValue = mf;
-            break;
+            LOG_ERR("The argument of vector-len must be a vector");
+            UDFThrowError(udfc);
+            return;
         }
+        ret->integerValue = CreateInteger(env, static_cast<long long>(buf->size()));
+    }
+
+    void vector_nth(Environment *env, UDFContext *udfc, UDFValue *ret)
+    {
+        auto &cc = *reinterpret_cast<coco *>(udfc->context);
+
+        UDFValue vec, idx;
+        if (!UDFFirstArgument(udfc, EXTERNAL_ADDRESS_BIT, &vec) || !UDFNextArgument(udfc, INTEGER_BIT, &idx))
+            return;
+        const auto *buf = cc.to_vector_buffer(vec.value);
+        if (!buf || idx.integerValue->contents < 0 || static_cast<size_t>(idx.integerValue->contents) >= buf->size())
+        {
+            LOG_ERR("The arguments of vector-nth must be a vector and an index within it");
+            UDFThrowError(udfc);
+            return;
+        }
+        ret->floatValue = CreateFloat(env, (*buf)[static_cast<size_t>(idx.integerValue->contents)]);
+    }
+
+    void vector_norm(Environment *env, UDFContext *udfc, UDFValue *ret)
+    {
+        auto &cc = *reinterpret_cast<coco *>(udfc->context);
+
+        UDFValue vec;
+        if (!UDFFirstArgument(udfc, EXTERNAL_ADDRESS_BIT, &vec))
+            return;
+        const auto *buf = cc.to_vector_buffer(vec.value);
+        double p = 2;
+        if (UDFHasNextArgument(udfc))
+        { // the order of the norm is either a number or the `inf` symbol, for the maximum norm..
+            UDFValue order;
+            if (!UDFNextArgument(udfc, INTEGER_BIT | FLOAT_BIT | SYMBOL_BIT, &order))
+                return;
+            if (order.header->type == INTEGER_TYPE)
+                p = static_cast<double>(order.integerValue->contents);
+            else if (order.header->type == FLOAT_TYPE)
+                p = order.floatValue->contents;
+            else if (std::string_view(order.lexemeValue->contents) == "inf")
+                p = std::numeric_limits<double>::infinity();
+            else
+                p = 0;
+        }
+        if (!buf || !(p >= 1))
+        {
+            LOG_ERR("The arguments of vector-norm must be a vector and, optionally, an order not less than 1 or inf");
+            UDFThrowError(udfc);
+            return;
+        }
+        ret->floatValue = CreateFloat(env, buf->norm(p));
+    }
+
+    void vector_peaks(Environment *env, UDFContext *udfc, UDFValue *ret)
+    {
+        auto &cc = *reinterpret_cast<coco *>(udfc->context);
+
+        UDFValue vec;
+        if (!UDFFirstArgument(udfc, EXTERNAL_ADDRESS_BIT, &vec))
+            return;
+        const auto *buf = cc.to_vector_buffer(vec.value);
+        if (!buf)
+        {
+            LOG_ERR("The first argument of vector-peaks must be a vector");
+            UDFThrowError(udfc);
+            return;
+        }
+        double threshold = -std::numeric_limits<double>::infinity();
+        if (UDFHasNextArgument(udfc))
+        {
+            UDFValue thr;
+            if (!UDFNextArgument(udfc, NUMBER_BITS, &thr))
+                return;
+            threshold = thr.header->type == INTEGER_TYPE ? static_cast<double>(thr.integerValue->contents) : thr.floatValue->contents;
+        }
+
+        // only the indices of the peaks are unpacked, the rules reading their values through vector-nth..
+        const auto peaks = buf->peaks(threshold);
+        Multifield *mf = CreateMultifield(env, peaks.size());
+        for (size_t i = 0; i < peaks.size(); ++i)
+            mf->contents[i].integerValue = CreateInteger(env, static_cast<long long>(peaks[i]));
+        ret->multifieldValue = mf;
+    }
+
+    void vector_band_energy(Environment *env, UDFContext *udfc, UDFValue *ret)
+    {
+        auto &cc = *reinterpret_cast<coco *>(udfc->context);
+
+        UDFValue vec, from, to;
+        if (!UDFFirstArgument(udfc, EXTERNAL_ADDRESS_BIT, &vec) || !UDFNextArgument(udfc, INTEGER_BIT, &from) || !UDFNextArgument(udfc, INTEGER_BIT, &to))
+            return;
+        const auto *buf = cc.to_vector_buffer(vec.value);
+        if (!buf || from.integerValue->contents < 0 || to.integerValue->contents < from.integerValue->contents)
+        {
+            LOG_ERR("The arguments of vector-band-energy must be a vector and a range of indices");
+            UDFThrowError(udfc);
+            return;
+        }
+        ret->floatValue = CreateFloat(env, buf->band_energy(static_cast<size_t>(from.integerValue->contents), static_cast<size_t>(to.integerValue->contents)));
+    }
+
+    void geo_distance(Environment *env, UDFContext *udfc, UDFValue *ret)
+    {
+        UDFValue a, b;
+        if (!UDFFirstArgument(udfc, MULTIFIELD_BIT, &a) || !UDFNextArgument(udfc, MULTIFIELD_BIT, &b))
+            return;
+
+        const auto a_pts = to_geo_points(*a.multifieldValue), b_pts = to_geo_points(*b.multifieldValue);
+        if (a_pts.empty() || b_pts.empty())
+        {
+            LOG_ERR("The arguments of distance must be non-empty sequences of latitudes and longitudes");
+            UDFThrowError(udfc);
+            return;
+        }
+        ret->floatValue = CreateFloat(env, distance(centroid(a_pts), centroid(b_pts)));
+    }
+
+    void geo_within(Environment *env, UDFContext *udfc, UDFValue *ret)
+    {
+        UDFValue shape, area;
+        if (!UDFFirstArgument(udfc, MULTIFIELD_BIT, &shape) || !UDFNextArgument(udfc, MULTIFIELD_BIT, &area))
+            return;
+
+        const auto pts = to_geo_points(*shape.multifieldValue);
+        std::vector<double> vals;
+        for (size_t i = 0; i < area.multifieldValue->length; ++i)
+            if (auto &v = area.multifieldValue->contents[i]; v.header->type == FLOAT_TYPE)
+                vals.push_back(v.floatValue->contents);
+            else if (v.header->type == INTEGER_TYPE)
+                vals.push_back(static_cast<double>(v.integerValue->contents));
+        std::optional<geo_area> g_area;
+        if (vals.size() == 4 && vals.size() == area.multifieldValue->length)
+            g_area = to_geo_area(json::json{{"bbox", std::vector<json::json>{vals[0], vals[1], vals[2], vals[3]}}});
+        else if (vals.size() == 3 && vals.size() == area.multifieldValue->length)
+            g_area = to_geo_area(json::json{{"lat", vals[0]}, {"lon", vals[1]}, {"radius", vals[2]}});
+        if (!g_area)
+        {
+            LOG_ERR("The area of within must be either a box (min_lat min_lon max_lat max_lon) or a circle (lat lon radius)");
+            UDFThrowError(udfc);
+            return;
         }
+        ret->lexemeValue = CreateBoolean(env, within(pts, *g_area));
     }
 
 #ifdef BUILD_LISTENERS
@@ -0,0 +1,124 @@
+#include "coco_aggregate.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace coco
+{
+    aggregate_fn to_aggregate_fn(std::string_view name)
+    {
+        if (name == "avg")
+            return aggregate_fn::avg;
+        if (name == "min")
+            return aggregate_fn::min;
+        if (name == "max")
+            return aggregate_fn::max;
+        if (name == "count")
+            return aggregate_fn::count;
+        if (name == "first")
+            return aggregate_fn::first;
+        if (name == "last")
+            return aggregate_fn::last;
+        if (name == "percentile")
+            return aggregate_fn::percentile;
+        if (name == "rate")
+            return aggregate_fn::rate;
+        throw std::invalid_argument("Unknown aggregate function: " + std::string(name));
+    }
+
+    aggregator::aggregator(const aggregation &agg) noexcept : agg(agg) {}
+
+    void aggregator::add(std::string_view name, int64_t timestamp, const json::json &val)
+    {
+        const bool numeric = val.is_number();
+        if (!numeric && agg.fn != aggregate_fn::count && agg.fn != aggregate_fn::first && agg.fn != aggregate_fn::last)
+            return; // only the numeric values contribute to the numeric aggregates..
+
+        const int64_t width = std::max<int64_t>(agg.bucket.count(), 1);
+        auto &bucket = buckets[timestamp - ((timestamp % width) + width) % width];
+        auto acc_it = bucket.find(name);
+        if (acc_it == bucket.end())
+            acc_it = bucket.emplace(std::string(name), accumulator{}).first;
+        auto &acc = acc_it->second;
+
+        if (numeric)
+        {
+            const auto v = val.get<double>();
+            if (acc.n_numbers++ == 0)
+                acc.min = acc.max = v;
+            else
+            {
+                acc.min = std::min(acc.min, v);
+                acc.max = std::max(acc.max, v);
+            }
+            acc.sum += v;
+            if (agg.fn == aggregate_fn::percentile)
+                acc.samples.push_back(v);
+        }
+        if (acc.count++ == 0 || timestamp < acc.first_ts)
+        {
+            acc.first_ts = timestamp;
+            acc.first = val;
+        }
+        if (acc.count == 1 || timestamp >= acc.last_ts)
+        {
+            acc.last_ts = timestamp;
+            acc.last = val;
+        }
+    }
+
+    json::json aggregator::get_result() const
+    {
+        json::json res(json::json_type::array);
+        for (const auto &[start, bucket] : buckets)
+        {
+            json::json data(json::json_type::object);
+            for (const auto &[name, acc] : bucket)
+                if (auto v = value_of(acc); !v.is_null())
+                    data[name] = std::move(v);
+            if (!data.as_object().empty())
+                res.push_back(json::json{{"timestamp", start}, {"data", std::move(data)}});
+        }
+        return res;
+    }
+
+    json::json aggregator::value_of(const accumulator &acc) const
+    {
+        switch (agg.fn)
+        {
+        case aggregate_fn::avg:
+            return acc.n_numbers ? json::json(acc.sum / acc.n_numbers) : json::json();
+        case aggregate_fn::min:
+            return acc.n_numbers ? json::json(acc.min) : json::json();
+        case aggregate_fn::max:
+            return acc.n_numbers ? json::json(acc.max) : json::json();
+        case aggregate_fn::count:
+            return static_cast<int64_t>(acc.count);
+        case aggregate_fn::first:
+            return acc.first;
+        case aggregate_fn::last:
+            return acc.last;
+        case aggregate_fn::percentile:
+        {
+            if (acc.samples.empty())
+                return json::json();
+            // linear interpolation between the closest ranks..
+            auto samples = acc.samples;
+            const double rank = std::clamp(agg.percentile, 0.0, 100.0) / 100.0 * (samples.size() - 1);
+            const auto lo = static_cast<size_t>(std::floor(rank));
+            std::nth_element(samples.begin(), samples.begin() + lo, samples.end());
+            const double lo_v = samples[lo];
+            if (lo + 1 >= samples.size())
+                return lo_v;
+            const double hi_v = *std::min_element(samples.begin() + lo + 1, samples.end());
+            return lo_v + (hi_v - lo_v) * (rank - lo);
+        }
+        case aggregate_fn::rate:
+            // the per-second change between the first and the last value of the bucket..
+            if (acc.count < 2 || acc.last_ts == acc.first_ts)
+                return json::json();
+            return (acc.last.get<double>() - acc.first.get<double>()) * 1000.0 / static_cast<double>(acc.last_ts - acc.first_ts);
+        }
+        return json::json();
+    }
+} // namespace coco
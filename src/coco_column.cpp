@@ -0,0 +1,124 @@
+#include "coco_column.hpp"
+#include <algorithm>
+#include <cassert>
+
+namespace coco
+{
+    void column::filter(const item_filter &f, std::vector<bool> &rows) const noexcept
+    {
+        for (size_t row = 0; row < rows.size(); ++row)
+            if (rows[row])
+                rows[row] = !is_null(row) && matches(get(row), f);
+    }
+
+    template <typename T>
+    void numeric_column<T>::filter(const item_filter &f, std::vector<bool> &rows) const noexcept
+    {
+        if (!f.value.is_number() && !f.value.is_boolean())
+        { // numbers are never equal, nor comparable, to other values..
+            std::fill(rows.begin(), rows.end(), false);
+            return;
+        }
+        const double rhs = f.value.is_boolean() ? (f.value.get<bool>() ? 1.0 : 0.0) : f.value.get<double>();
+        const auto scan = [this, &rows](auto &&cmp)
+        {
+            for (size_t row = 0; row < rows.size(); ++row)
+                rows[row] = rows[row] && !nulls[row] && cmp(static_cast<double>(values[row]));
+        };
+        switch (f.op)
+        {
+        case filter_op::eq:
+            scan([rhs](double v)
+                 { return v == rhs; });
+            break;
+        case filter_op::lt:
+            scan([rhs](double v)
+                 { return v < rhs; });
+            break;
+        case filter_op::le:
+            scan([rhs](double v)
+                 { return v <= rhs; });
+            break;
+        case filter_op::gt:
+            scan([rhs](double v)
+                 { return v > rhs; });
+            break;
+        case filter_op::ge:
+            scan([rhs](double v)
+                 { return v >= rhs; });
+            break;
+        case filter_op::within:
+            std::fill(rows.begin(), rows.end(), false);
+            break;
+        }
+    }
+
+    template class numeric_column<bool>;
+    template class numeric_column<int64_t>;
+    template class numeric_column<double>;
+
+    void lexeme_column::resize(size_t rows) noexcept
+    {
+        for (size_t row = rows; row < ids.size(); ++row)
+            release(ids[row]);
+        ids.resize(rows, 0);
+    }
+
+    void lexeme_column::set(size_t row, const json::json &val) noexcept
+    {
+        release(ids[row]);
+        ids[row] = 0;
+        if (val.is_null())
+            return;
+        assert(val.is_string());
+        const auto lexeme = val.get<std::string>();
+        if (auto it = lookup.find(lexeme); it != lookup.end())
+        {
+            ids[row] = it->second;
+            ++refs[it->second - 1];
+            return;
+        }
+        uint32_t id;
+        if (free_ids.empty())
+        {
+            lexemes.push_back(lexeme);
+            refs.push_back(0);
+            id = static_cast<uint32_t>(lexemes.size());
+        }
+        else
+        {
+            id = free_ids.back();
+            free_ids.pop_back();
+            lexemes[id - 1] = lexeme;
+        }
+        lookup.emplace(lexemes[id - 1], id); // the deque never moves its elements, so the key stays valid..
+        ++refs[id - 1];
+        ids[row] = id;
+    }
+
+    json::json lexeme_column::get(size_t row) const noexcept
+    {
+        if (ids[row] == 0)
+            return nullptr;
+        return lexemes[ids[row] - 1];
+    }
+
+    void lexeme_column::filter(const item_filter &f, std::vector<bool> &rows) const noexcept
+    {
+        // the filter is evaluated once per distinct value, the rows are then checked by identifier..
+        std::vector<bool> ok(lexemes.size() + 1, false);
+        for (size_t i = 0; i < lexemes.size(); ++i)
+            ok[i + 1] = refs[i] && matches(lexemes[i], f);
+        for (size_t row = 0; row < rows.size(); ++row)
+            rows[row] = rows[row] && ok[ids[row]];
+    }
+
+    void lexeme_column::release(uint32_t id) noexcept
+    {
+        if (id == 0 || --refs[id - 1])
+            return;
+        lookup.erase(lexemes[id - 1]);
+        lexemes[id - 1].clear();
+        free_ids.push_back(id);
+    }
+} // namespace coco
@@ -1,5 +1,6 @@
 #include "coco_db.hpp"
 #include "logging.hpp"
+#include <algorithm>
 #include <atomic>
 #include <iomanip>
 
@@ -16,14 +17,241 @@ namespace coco
             data = std::move(tp_data["data"]);
     }
 
+    namespace
+    {
+        [[nodiscard]] std::vector<std::chrono::seconds> rollup_resolutions(const json::json &config) noexcept
+        {
+            if (!config.contains("rollups"))
+                return {std::chrono::minutes(1), std::chrono::hours(1), std::chrono::hours(24)};
+            std::vector<std::chrono::seconds> res;
+            for (const auto &r : config["rollups"].as_array())
+                if (r.is_integer() && r.get<int64_t>() > 0)
+                    res.emplace_back(r.get<int64_t>());
+                else // a bucket must have a positive width..
+                    LOG_WARN("Ignoring invalid rollup resolution: " + r.dump());
+            return res;
+        }
+    } // namespace
+
+    void db_rollup::add(double v, int64_t timestamp) noexcept
+    {
+        ++count;
+        sum += v;
+        min = std::min(min, v);
+        max = std::max(max, v);
+        if (timestamp >= last_timestamp)
+        {
+            last = v;
+            last_timestamp = timestamp;
+        }
+    }
+    json::json db_rollup::to_json() const noexcept { return json::json{{"count", static_cast<int64_t>(count)}, {"sum", sum}, {"min", min}, {"max", max}, {"last", last}}; }
+
     db_module::db_module(coco_db &db) noexcept : db(db) {}
     void db_module::drop() noexcept {}
 
-    coco_db::coco_db(json::json &&config) noexcept : config(std::move(config)) {}
+    coco_db::coco_db(json::json &&config) noexcept : config(std::move(config)), resolutions(rollup_resolutions(this->config)), max_rollups(this->config.contains("max_rollups") ? this->config["max_rollups"].get<size_t>() : HISTORY_MAX_SIZE) {}
+
+    coco_db::~coco_db() { stop_compactor(); }
+
+    void coco_db::set_retention_provider(std::function<std::unordered_map<std::string, db_retention>()> &&provider) noexcept
+    {
+        std::lock_guard<std::mutex> _(compactor_mtx);
+        retention_provider = std::move(provider);
+    }
+
+    void coco_db::set_archive(std::string_view itm_id, const std::map<std::string, archive_policy> &policies) noexcept
+    {
+        try
+        { // the points held back by the replaced archives are not lost..
+            flush_archives(itm_id);
+        }
+        catch (const std::exception &e)
+        {
+            LOG_ERR(std::string("Flushing the archives of item ") + itm_id.data() + " failed: " + e.what());
+        }
+        std::lock_guard<std::mutex> _(archives_mtx);
+        if (policies.empty())
+        {
+            archives.erase(std::string(itm_id));
+            return;
+        }
+        auto &itm_archives = archives[std::string(itm_id)];
+        itm_archives.clear();
+        for (const auto &[p_name, policy] : policies)
+            itm_archives.emplace(p_name, policy);
+    }
+    std::map<int64_t, json::json> coco_db::archive(std::string_view itm_id, const json::json &val, const std::chrono::system_clock::time_point &timestamp)
+    {
+        const auto ts = std::chrono::duration_cast<std::chrono::milliseconds>(timestamp.time_since_epoch()).count();
+        std::map<int64_t, json::json> res;
+        std::lock_guard<std::mutex> _(archives_mtx);
+        auto itm_archives = archives.find(std::string(itm_id));
+        if (itm_archives == archives.end())
+        {
+            res.emplace(ts, val);
+            return res;
+        }
+        const auto store = [&res](int64_t data_ts, const std::string &nm, const json::json &v)
+        { res.try_emplace(data_ts, json::json(json::json_type::object)).first->second[nm] = v; };
+        for (const auto &[nm, v] : val.as_object())
+            if (auto ar = itm_archives->second.find(nm); ar != itm_archives->second.end())
+                ar->second.push(ts, v, [&store, &nm = nm](int64_t a_ts, const json::json &a_v)
+                                { store(a_ts, nm, a_v); });
+            else
+                store(ts, nm, v);
+        return res;
+    }
+
+    void coco_db::flush_archives(std::string_view itm_id)
+    {
+        std::map<int64_t, json::json> data;
+        {
+            std::lock_guard<std::mutex> _(archives_mtx);
+            auto itm_archives = archives.find(std::string(itm_id));
+            if (itm_archives == archives.end())
+                return;
+            for (auto &[nm, ar] : itm_archives->second)
+                ar.flush([&data, &nm = nm](int64_t a_ts, const json::json &a_v)
+                         { data.try_emplace(a_ts, json::json(json::json_type::object)).first->second[nm] = a_v; });
+        }
+        if (!data.empty())
+            store_archived(itm_id, data);
+    }
+    void coco_db::flush_archives()
+    {
+        std::vector<std::string> itm_ids;
+        {
+            std::lock_guard<std::mutex> _(archives_mtx);
+            itm_ids.reserve(archives.size());
+            for (const auto &[itm_id, _] : archives)
+                itm_ids.push_back(itm_id);
+        }
+        for (const auto &itm_id : itm_ids)
+            flush_archives(itm_id);
+    }
+    void coco_db::store_archived(std::string_view itm_id, const std::map<int64_t, json::json> &data)
+    {
+        std::lock_guard<std::mutex> _(values_mtx);
+        if (!values) // each dynamic property keeps, by default, as many values as the items keep in their history..
+            values = std::make_unique<ts_store>(config.contains("chunk_size") ? config["chunk_size"].get<size_t>() : 1024, config.contains("max_values") ? config["max_values"].get<size_t>() : HISTORY_MAX_SIZE);
+        for (const auto &[data_ts, d] : data)
+            values->append(itm_id, d, std::chrono::system_clock::time_point(std::chrono::milliseconds(data_ts)));
+    }
+
+    void coco_db::start_compactor() noexcept
+    {
+        std::lock_guard<std::mutex> _(compactor_mtx);
+        if (compacting)
+            return;
+        compacting = true;
+        compactor = std::thread([this]
+                                {
+            std::unique_lock<std::mutex> lock(compactor_mtx);
+            while (compacting)
+            {
+                compactor_cv.wait_for(lock, std::chrono::seconds(COMPACTION_INTERVAL), [this]
+                                      { return !compacting; });
+                if (!compacting)
+                    break;
+                lock.unlock();
+                compact();
+                lock.lock();
+            } });
+    }
+    void coco_db::stop_compactor() noexcept
+    {
+        {
+            std::lock_guard<std::mutex> _(compactor_mtx);
+            compacting = false;
+            stopping = true;
+        }
+        compactor_cv.notify_all();
+        if (compactor.joinable())
+            compactor.join();
+        std::lock_guard<std::mutex> _(compactor_mtx);
+        stopping = false;
+    }
+
+    void coco_db::compact() noexcept
+    {
+        const auto start = std::chrono::steady_clock::now();
+        std::function<std::unordered_map<std::string, db_retention>()> provider;
+        {
+            std::lock_guard<std::mutex> _(compactor_mtx);
+            provider = retention_provider;
+        }
+        std::unordered_map<std::string, db_retention> policies;
+        try
+        { // the provider is invoked without holding the compactor lock, since it may need to lock the types of the items..
+            if (provider)
+                policies = provider();
+        }
+        catch (const std::exception &e)
+        {
+            LOG_ERR(std::string("Retrieving the retention policies failed: ") + e.what());
+        }
+        const auto stopped = [this]
+        {
+            std::lock_guard<std::mutex> _(compactor_mtx);
+            return stopping;
+        };
+        const auto now = std::chrono::system_clock::now();
+        size_t backlog = 0, deleted_values = 0, deleted_rollups = 0;
+        bool interrupted = false;
+        for (auto it = policies.cbegin(); it != policies.cend() && !interrupted; ++it)
+            try
+            {
+                const auto &[itm_id, retention] = *it;
+                if (stopped())
+                    break; // the compactor is being stopped..
+                if (retention.raw)
+                {
+                    const auto before = now - *retention.raw;
+                    backlog += count_values(itm_id, before);
+                    // the expired values are deleted in small batches, leaving room to the other operations in between..
+                    for (size_t deleted = COMPACTION_BATCH_SIZE; deleted >= COMPACTION_BATCH_SIZE;)
+                    {
+                        deleted = delete_values(itm_id, before, COMPACTION_BATCH_SIZE);
+                        deleted_values += deleted;
+                        std::unique_lock<std::mutex> lock(compactor_mtx);
+                        if (stopping || (deleted >= COMPACTION_BATCH_SIZE && compactor_cv.wait_for(lock, std::chrono::milliseconds(COMPACTION_THROTTLE), [this]
+                                                                                                    { return stopping; })))
+                        { // the compactor is being stopped..
+                            interrupted = true;
+                            break;
+                        }
+                    }
+                }
+                if (retention.rollups && !interrupted)
+                    deleted_rollups += delete_rollups(itm_id, now - *retention.rollups);
+            }
+            catch (const std::exception &e)
+            {
+                LOG_ERR("Compaction of item " + it->first + " failed: " + e.what());
+            }
+
+        std::lock_guard<std::mutex> _(compactor_mtx);
+        ++c_stats.runs;
+        c_stats.backlog = backlog;
+        c_stats.deleted_values += deleted_values;
+        c_stats.deleted_rollups += deleted_rollups;
+        c_stats.last_duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        LOG_DEBUG("Compaction deleted " + std::to_string(deleted_values) + " values and " + std::to_string(deleted_rollups) + " rollups out of a backlog of " + std::to_string(backlog) + " values");
+    }
+
+    compaction_stats coco_db::get_compaction_stats() noexcept
+    {
+        std::lock_guard<std::mutex> _(compactor_mtx);
+        return c_stats;
+    }
 
     void coco_db::drop() noexcept
     {
         LOG_WARN("Dropping database..");
+        std::lock_guard<std::mutex> _(values_mtx);
+        values.reset();
+        rollups.clear();
         for (auto &[_, mod] : modules)
             mod->drop();
     }
@@ -58,10 +286,14 @@ namespace coco
         LOG_WARN("Retrieving all the items..");
         return std::vector<db_item>();
     }
-    std::string coco_db::create_item(const std::vector<std::string> &types, const json::json &props, const std::optional<std::pair<json::json, std::chrono::system_clock::time_point>> &val)
+    std::string coco_db::generate_id()
     {
         static std::atomic<int> counter{0};
-        LOG_WARN(std::string("Creating new item of types: ") + [&types]()
+        return std::to_string(counter++);
+    }
+    void coco_db::create_item(std::string_view itm_id, const std::vector<std::string> &types, const json::json &props, const std::optional<std::pair<json::json, std::chrono::system_clock::time_point>> &val)
+    {
+        LOG_WARN(std::string("Creating new item ") + itm_id.data() + " of types: " + [&types]()
                  {
             std::string res;
             for (const auto &t : types)
@@ -78,7 +310,11 @@ namespace coco
             oss << std::put_time(&tm, "%Y-%m-%d %H:%M:%S");
             LOG_WARN(std::string("Timestamp: ") + oss.str());
         }
-        return std::to_string(counter++);
+    }
+    void coco_db::create_items(const std::vector<db_item> &itms)
+    {
+        for (const auto &itm : itms)
+            create_item(itm.id, itm.types, itm.props.value_or(json::json(json::json_type::object)), itm.value);
     }
     void coco_db::set_properties(std::string_view itm_id, const json::json &props)
     {
@@ -86,6 +322,20 @@ namespace coco
         if (!props.as_object().empty())
             LOG_WARN(std::string("Properties: ") + props.dump());
     }
+    void coco_db::update_properties(std::string_view itm_id, const std::vector<db_property_update> &updates)
+    {
+        LOG_WARN(std::string("Updating properties for item ") + itm_id.data());
+        for (const auto &upd : updates)
+        {
+            std::string path;
+            for (const auto &token : upd.path)
+                path += (path.empty() ? "" : ".") + token;
+            if (upd.kind == db_property_update::unset)
+                LOG_WARN("Unset: " + path);
+            else
+                LOG_WARN((upd.kind == db_property_update::set ? "Set: " : "Push: ") + path + " = " + upd.value.dump());
+        }
+    }
     json::json coco_db::get_values(std::string_view itm_id, const std::chrono::system_clock::time_point &from, const std::chrono::system_clock::time_point &to)
     {
         LOG_WARN(std::string("Getting values for item ") + itm_id.data());
@@ -99,8 +349,43 @@ namespace coco
         std::ostringstream to_oss;
         to_oss << std::put_time(&to_tm, "%Y-%m-%d %H:%M:%S");
         LOG_WARN(std::string("FROM: ") + to_oss.str());
-        json::json res(json::json_type::array);
-        return res;
+        flush_archives(itm_id);
+        std::lock_guard<std::mutex> _(values_mtx);
+        if (!values)
+            return json::json(json::json_type::array);
+        return values->get_values(itm_id, from, to);
+    }
+    std::optional<std::chrono::system_clock::time_point> coco_db::get_values(std::string_view itm_id, const std::vector<std::string> &fields, const std::chrono::system_clock::time_point &from, const std::chrono::system_clock::time_point &to, size_t limit, const std::function<void(json::json &&)> &cb)
+    {
+        LOG_WARN(std::string("Getting a page of values for item ") + itm_id.data());
+        flush_archives(itm_id);
+        std::lock_guard<std::mutex> _(values_mtx);
+        if (!values)
+            return std::nullopt;
+        if (auto next = values->get_values(itm_id, fields, from, to, limit, [&cb](int64_t ts, json::json &&data)
+                                          { cb(json::json{{"data", std::move(data)}, {"timestamp", ts}}); }))
+            return std::chrono::system_clock::time_point(std::chrono::milliseconds{*next});
+        return std::nullopt;
+    }
+    void coco_db::get_values(const std::vector<std::string> &itm_ids, const std::vector<std::string> &fields, const std::chrono::system_clock::time_point &from, const std::chrono::system_clock::time_point &to, const std::function<void(const std::string &, json::json &&)> &cb)
+    {
+        LOG_WARN("Getting values for " + std::to_string(itm_ids.size()) + " items");
+        for (const auto &itm_id : itm_ids)
+            flush_archives(itm_id);
+        std::lock_guard<std::mutex> _(values_mtx);
+        if (!values)
+            return;
+        for (const auto &itm_id : itm_ids)
+            values->get_values(itm_id, fields, from, to, std::numeric_limits<size_t>::max(), [&cb, &itm_id](int64_t ts, json::json &&data)
+                              { cb(itm_id, json::json{{"data", std::move(data)}, {"timestamp", ts}}); });
+    }
+    void coco_db::scan_values(std::string_view itm_id, const std::vector<std::string> &props, const std::chrono::system_clock::time_point &from, const std::chrono::system_clock::time_point &to, const std::function<void(const std::string &, int64_t, json::json &&)> &cb)
+    {
+        LOG_WARN(std::string("Scanning values for item ") + itm_id.data());
+        flush_archives(itm_id);
+        std::lock_guard<std::mutex> _(values_mtx);
+        if (values)
+            values->scan(itm_id, props, from, to, cb);
     }
     void coco_db::set_value(std::string_view itm_id, const json::json &val, const std::chrono::system_clock::time_point &timestamp)
     {
@@ -111,8 +396,92 @@ namespace coco
         std::ostringstream oss;
         oss << std::put_time(&tm, "%Y-%m-%d %H:%M:%S");
         LOG_WARN(std::string("Timestamp: ") + oss.str());
+        store(itm_id, val, timestamp);
+    }
+    void coco_db::set_values(std::string_view itm_id, const std::vector<std::pair<json::json, std::chrono::system_clock::time_point>> &series, const std::optional<std::pair<json::json, std::chrono::system_clock::time_point>> &)
+    {
+        LOG_WARN("Setting " + std::to_string(series.size()) + " values for item " + itm_id.data());
+        for (const auto &[val, timestamp] : series) // backfilled values bypass the archives, leaving the segments being built untouched..
+            store(itm_id, val, timestamp, false);
+    }
+    void coco_db::store(std::string_view itm_id, const json::json &val, const std::chrono::system_clock::time_point &timestamp, bool archived)
+    {
+        if (archived)
+            store_archived(itm_id, archive(itm_id, val, timestamp));
+        else
+            store_archived(itm_id, {{std::chrono::duration_cast<std::chrono::milliseconds>(timestamp.time_since_epoch()).count(), val}});
+
+        std::lock_guard<std::mutex> _(values_mtx);
+        const auto ts = std::chrono::duration_cast<std::chrono::milliseconds>(timestamp.time_since_epoch()).count();
+        for (const auto &[nm, v] : val.as_object())
+            if (v.is_number())
+                for (const auto &res : resolutions)
+                {
+                    auto &buckets = rollups[std::string(itm_id)][res.count()];
+                    buckets[bucket_of(ts, res)][nm].add(v.get<double>(), ts);
+                    if (buckets.size() > max_rollups) // the oldest bucket is removed, even without any retention policy..
+                        buckets.erase(buckets.begin());
+                }
+    }
+    json::json coco_db::get_rollups(std::string_view itm_id, const std::chrono::seconds &resolution, const std::chrono::system_clock::time_point &from, const std::chrono::system_clock::time_point &to)
+    {
+        LOG_WARN(std::string("Getting rollups for item ") + itm_id.data());
+        std::lock_guard<std::mutex> _(values_mtx);
+        json::json res(json::json_type::array);
+        auto itm_rollups = rollups.find(std::string(itm_id));
+        if (itm_rollups == rollups.end())
+            return res;
+        auto res_rollups = itm_rollups->second.find(resolution.count());
+        if (res_rollups == itm_rollups->second.end())
+            return res;
+        const auto from_ts = bucket_of(std::chrono::duration_cast<std::chrono::milliseconds>(from.time_since_epoch()).count(), resolution);
+        const auto to_ts = std::chrono::duration_cast<std::chrono::milliseconds>(to.time_since_epoch()).count();
+        for (auto it = res_rollups->second.lower_bound(from_ts); it != res_rollups->second.end() && it->first <= to_ts; ++it)
+        {
+            json::json data(json::json_type::object);
+            for (const auto &[nm, r] : it->second)
+                data[nm] = r.to_json();
+            res.push_back(json::json{{"timestamp", it->first}, {"data", std::move(data)}});
+        }
+        return res;
+    }
+    void coco_db::delete_item(std::string_view itm_id)
+    {
+        LOG_WARN(std::string("Deleting item ") + itm_id.data());
+        std::lock_guard<std::mutex> _(values_mtx);
+        if (values)
+            values->erase(itm_id);
+        rollups.erase(std::string(itm_id));
+    }
+
+    size_t coco_db::count_values(std::string_view itm_id, const std::chrono::system_clock::time_point &before)
+    {
+        std::lock_guard<std::mutex> _(values_mtx);
+        return values ? values->expired(itm_id, before) : 0;
+    }
+    size_t coco_db::delete_values(std::string_view itm_id, const std::chrono::system_clock::time_point &before, size_t limit)
+    {
+        LOG_DEBUG(std::string("Deleting expired values for item ") + itm_id.data());
+        std::lock_guard<std::mutex> _(values_mtx);
+        return values ? values->expire(itm_id, before, limit) : 0;
+    }
+    size_t coco_db::delete_rollups(std::string_view itm_id, const std::chrono::system_clock::time_point &before)
+    {
+        LOG_DEBUG(std::string("Deleting expired rollups for item ") + itm_id.data());
+        std::lock_guard<std::mutex> _(values_mtx);
+        auto itm_rollups = rollups.find(std::string(itm_id));
+        if (itm_rollups == rollups.end())
+            return 0;
+        const auto before_ts = std::chrono::duration_cast<std::chrono::milliseconds>(before.time_since_epoch()).count();
+        size_t deleted = 0;
+        for (auto &[res, buckets] : itm_rollups->second)
+        { // a bucket expires once it ends before the expiration time..
+            const auto width = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::seconds(res)).count();
+            for (auto it = buckets.begin(); it != buckets.end() && it->first + width <= before_ts; it = buckets.erase(it))
+                deleted += it->second.size();
+        }
+        return deleted;
     }
-    void coco_db::delete_item(std::string_view itm_id) { LOG_WARN(std::string("Deleting item ") + itm_id.data()); }
 
     std::vector<db_rule> coco_db::get_rules() noexcept
     {
@@ -0,0 +1,221 @@
+#include "coco_geo.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace coco
+{
+    namespace
+    {
+        constexpr double earth_radius = 6371008.8; // The mean radius of the Earth, in meters..
+        constexpr double pi = 3.14159265358979323846;
+
+        [[nodiscard]] double to_radians(double deg) noexcept { return deg * pi / 180; }
+        [[nodiscard]] double to_degrees(double rad) noexcept { return rad * 180 / pi; }
+
+        // quantizes a coordinate within [min, min + span] on 32 bits..
+        [[nodiscard]] uint32_t quantize(double v, double min, double span) noexcept { return static_cast<uint32_t>(std::clamp((v - min) / span * 4294967296.0, 0.0, 4294967295.0)); }
+
+        // spreads the bits of a 32 bits value over the even bits of a 64 bits one..
+        [[nodiscard]] uint64_t spread(uint32_t v) noexcept
+        {
+            uint64_t x = v;
+            x = (x | (x << 16)) & 0x0000FFFF0000FFFFULL;
+            x = (x | (x << 8)) & 0x00FF00FF00FF00FFULL;
+            x = (x | (x << 4)) & 0x0F0F0F0F0F0F0F0FULL;
+            x = (x | (x << 2)) & 0x3333333333333333ULL;
+            x = (x | (x << 1)) & 0x5555555555555555ULL;
+            return x;
+        }
+        [[nodiscard]] uint64_t morton(uint32_t x, uint32_t y) noexcept { return spread(x) | (spread(y) << 1); }
+        [[nodiscard]] uint64_t morton(const geo_point &p) noexcept { return morton(quantize(p.lon, -180, 360), quantize(p.lat, -90, 180)); }
+
+        struct cell_rect
+        {
+            uint32_t x0, y0, x1, y1; // The quantized bounds, both inclusive..
+        };
+
+        // appends the Z-order ranges of the quadtree cells, down to the given level, covering the rectangle..
+        void cover(const cell_rect &r, unsigned level, unsigned max_level, uint64_t cx, uint64_t cy, std::vector<std::pair<uint64_t, uint64_t>> &ranges) noexcept
+        {
+            const unsigned shift = 32 - level;
+            const uint64_t x_lo = cx << shift, x_hi = ((cx + 1) << shift) - 1, y_lo = cy << shift, y_hi = ((cy + 1) << shift) - 1;
+            if (x_hi < r.x0 || x_lo > r.x1 || y_hi < r.y0 || y_lo > r.y1)
+                return; // disjoint..
+            if (level == max_level || (x_lo >= r.x0 && x_hi <= r.x1 && y_lo >= r.y0 && y_hi <= r.y1))
+            { // the cell is a contiguous range of codes..
+                const auto lo = morton(static_cast<uint32_t>(x_lo), static_cast<uint32_t>(y_lo)), hi = morton(static_cast<uint32_t>(x_hi), static_cast<uint32_t>(y_hi));
+                if (!ranges.empty() && ranges.back().second + 1 == lo)
+                    ranges.back().second = hi;
+                else
+                    ranges.emplace_back(lo, hi);
+                return;
+            }
+            for (uint64_t child = 0; child < 4; ++child) // children in Z-order..
+                cover(r, level + 1, max_level, (cx << 1) | (child & 1), (cy << 1) | (child >> 1), ranges);
+        }
+
+        [[nodiscard]] std::vector<std::pair<uint64_t, uint64_t>> ranges_of(const geo_area &area) noexcept
+        {
+            std::vector<cell_rect> rects;
+            const auto y0 = quantize(area.min.lat, -90, 180), y1 = quantize(area.max.lat, -90, 180);
+            if (area.min.lon <= area.max.lon)
+                rects.push_back({quantize(area.min.lon, -180, 360), y0, quantize(area.max.lon, -180, 360), y1});
+            else
+            { // the area crosses the antimeridian..
+                rects.push_back({quantize(area.min.lon, -180, 360), y0, UINT32_MAX, y1});
+                rects.push_back({0, y0, quantize(area.max.lon, -180, 360), y1});
+            }
+            std::vector<std::pair<uint64_t, uint64_t>> ranges;
+            for (const auto &r : rects)
+            { // the cells are not smaller than a fourth of the rectangle, which bounds the number of ranges..
+                const uint64_t span = std::max(r.x1 - r.x0, r.y1 - r.y0) / 4 + 1;
+                unsigned bits = 0;
+                while (bits < 31 && (uint64_t(1) << (bits + 1)) <= span)
+                    ++bits;
+                cover(r, 0, 32 - bits, 0, 0, ranges);
+            }
+            return ranges;
+        }
+    } // namespace
+
+    std::optional<geo_point> to_geo_point(const json::json &j) noexcept
+    {
+        if (!j.is_object() || !j.contains("lat") || !j.contains("lon") || !j["lat"].is_number() || !j["lon"].is_number())
+            return std::nullopt;
+        geo_point p{j["lat"].get<double>(), j["lon"].get<double>()};
+        if (p.lat < -90 || p.lat > 90 || p.lon < -180 || p.lon > 180)
+            return std::nullopt;
+        return p;
+    }
+
+    std::vector<geo_point> geo_points(const json::json &j) noexcept
+    {
+        std::vector<geo_point> pts;
+        if (j.is_array())
+        {
+            pts.reserve(j.as_array().size());
+            for (const auto &v : j.as_array())
+                if (auto p = to_geo_point(v))
+                    pts.push_back(*p);
+                else
+                    return {};
+        }
+        else if (auto p = to_geo_point(j))
+            pts.push_back(*p);
+        return pts;
+    }
+
+    std::optional<geo_area> to_geo_area(const json::json &j) noexcept
+    {
+        if (!j.is_object())
+            return std::nullopt;
+        geo_area area;
+        if (j.contains("bbox"))
+        {
+            const auto &bbox = j["bbox"];
+            if (!bbox.is_array() || bbox.size() != 4 || !std::all_of(bbox.as_array().begin(), bbox.as_array().end(), [](const json::json &v)
+                                                                      { return v.is_number(); }))
+                return std::nullopt;
+            area.min = {std::max(bbox[0].get<double>(), -90.0), std::clamp(bbox[1].get<double>(), -180.0, 180.0)};
+            area.max = {std::min(bbox[2].get<double>(), 90.0), std::clamp(bbox[3].get<double>(), -180.0, 180.0)};
+            if (area.min.lat > area.max.lat)
+                return std::nullopt;
+            return area;
+        }
+        auto center = to_geo_point(j);
+        if (!center || !j.contains("radius") || !j["radius"].is_number() || j["radius"].get<double>() < 0)
+            return std::nullopt;
+        area.center = center;
+        area.radius = j["radius"].get<double>();
+        // the bounding box of the circle..
+        const double d_lat = to_degrees(area.radius / earth_radius);
+        area.min.lat = std::max(center->lat - d_lat, -90.0);
+        area.max.lat = std::min(center->lat + d_lat, 90.0);
+        const double cos_lat = std::cos(to_radians(std::max(std::abs(area.min.lat), std::abs(area.max.lat))));
+        if (area.min.lat <= -90 || area.max.lat >= 90 || cos_lat <= 0 || d_lat / cos_lat >= 180)
+        { // the circle contains a pole, or spans all the longitudes..
+            area.min.lon = -180;
+            area.max.lon = 180;
+        }
+        else
+        {
+            const double d_lon = d_lat / cos_lat;
+            area.min.lon = center->lon - d_lon < -180 ? center->lon - d_lon + 360 : center->lon - d_lon;
+            area.max.lon = center->lon + d_lon > 180 ? center->lon + d_lon - 360 : center->lon + d_lon;
+        }
+        return area;
+    }
+
+    double distance(const geo_point &a, const geo_point &b) noexcept
+    {
+        const double d_lat = to_radians(b.lat - a.lat), d_lon = to_radians(b.lon - a.lon);
+        const double h = std::sin(d_lat / 2) * std::sin(d_lat / 2) + std::cos(to_radians(a.lat)) * std::cos(to_radians(b.lat)) * std::sin(d_lon / 2) * std::sin(d_lon / 2);
+        return 2 * earth_radius * std::asin(std::min(1.0, std::sqrt(h)));
+    }
+
+    geo_point centroid(const std::vector<geo_point> &pts) noexcept
+    {
+        geo_point c;
+        for (const auto &p : pts)
+        {
+            c.lat += p.lat;
+            c.lon += p.lon;
+        }
+        c.lat /= pts.size();
+        c.lon /= pts.size();
+        return c;
+    }
+
+    bool within(const std::vector<geo_point> &pts, const geo_area &area) noexcept
+    {
+        return !pts.empty() && std::all_of(pts.begin(), pts.end(), [&area](const geo_point &p)
+                                           {
+                                               if (area.center)
+                                                   return distance(p, *area.center) <= area.radius;
+                                               if (p.lat < area.min.lat || p.lat > area.max.lat)
+                                                   return false;
+                                               return area.min.lon <= area.max.lon ? p.lon >= area.min.lon && p.lon <= area.max.lon : p.lon >= area.min.lon || p.lon <= area.max.lon; });
+    }
+
+    void geo_index::insert(const std::string &itm_id, const json::json &val) noexcept
+    {
+        if (const auto pts = geo_points(val); !pts.empty())
+            cells[morton(pts.front())].insert(itm_id);
+    }
+
+    void geo_index::erase(const std::string &itm_id, const json::json &val) noexcept
+    {
+        if (const auto pts = geo_points(val); !pts.empty())
+            if (auto it = cells.find(morton(pts.front())); it != cells.end() && it->second.erase(itm_id) && it->second.empty())
+                cells.erase(it);
+    }
+
+    template <typename Fn>
+    void geo_index::for_each(const item_filter &f, Fn &&fn) const noexcept
+    {
+        const auto area = to_geo_area(f.value);
+        if (f.op != filter_op::within || !area)
+            return;
+        for (const auto &[lo, hi] : ranges_of(*area))
+            for (auto it = cells.lower_bound(lo); it != cells.end() && it->first <= hi; ++it)
+                if (!fn(it->second))
+                    return;
+    }
+
+    size_t geo_index::count(const item_filter &f, size_t limit) const noexcept
+    {
+        size_t res = 0;
+        for_each(f, [&res, limit](const std::unordered_set<std::string> &itms)
+                 { res += itms.size();
+                   return res < limit; });
+        return res;
+    }
+
+    void geo_index::find(const item_filter &f, const std::function<void(const std::string &)> &cb) const noexcept
+    {
+        for_each(f, [&cb](const std::unordered_set<std::string> &itms)
+                 { for (const auto &id : itms)
+                       cb(id);
+                   return true; });
+    }
+} // namespace coco
@@ -0,0 +1,174 @@
+#include "coco_index.hpp"
+#include "coco_geo.hpp"
+#include <optional>
+#include <stdexcept>
+
+namespace coco
+{
+    namespace
+    {
+        [[nodiscard]] std::optional<std::variant<double, std::string>> key_of(const json::json &v) noexcept
+        {
+            if (v.is_null())
+                return std::nullopt;
+            if (v.is_boolean())
+                return v.get<bool>() ? 1.0 : 0.0;
+            if (v.is_number())
+                return v.get<double>();
+            if (v.is_string())
+                return v.get<std::string>();
+            return std::nullopt; // objects and arrays are neither indexed nor compared..
+        }
+
+        [[nodiscard]] bool satisfies(const json::json &v, const item_filter &f) noexcept
+        {
+            if (f.op == filter_op::within)
+            {
+                const auto area = to_geo_area(f.value);
+                return area && within(geo_points(v), *area);
+            }
+            if (v.is_object() || v.is_array() || f.value.is_object() || f.value.is_array())
+                return f.op == filter_op::eq && v == f.value;
+            const auto lhs = key_of(v), rhs = key_of(f.value);
+            if (!lhs || !rhs || lhs->index() != rhs->index())
+                return false;
+            switch (f.op)
+            {
+            case filter_op::eq:
+                return *lhs == *rhs;
+            case filter_op::lt:
+                return *lhs < *rhs;
+            case filter_op::le:
+                return *lhs <= *rhs;
+            case filter_op::gt:
+                return *lhs > *rhs;
+            case filter_op::ge:
+                return *lhs >= *rhs;
+            case filter_op::within:
+                break;
+            }
+            return false;
+        }
+    } // namespace
+
+    index_kind to_index_kind(std::string_view name)
+    {
+        if (name == "hash")
+            return index_kind::hash;
+        if (name == "ordered")
+            return index_kind::ordered;
+        throw std::invalid_argument("Unknown index kind: " + std::string(name));
+    }
+
+    bool matches(const json::json &val, const item_filter &f) noexcept
+    {
+        if (val.is_array() && f.op != filter_op::within && !f.value.is_array()) // polygons are arrays of points..
+        {
+            for (const auto &v : val.as_array())
+                if (satisfies(v, f))
+                    return true;
+            return false;
+        }
+        return satisfies(val, f);
+    }
+
+    property_index::property_index(index_kind kind) noexcept : kind(kind) {}
+
+    void property_index::insert(const std::string &itm_id, const json::json &val) noexcept
+    {
+        if (val.is_array())
+        {
+            for (const auto &v : val.as_array())
+                insert(itm_id, v);
+            return;
+        }
+        if (auto k = key_of(val))
+        {
+            if (kind == index_kind::hash)
+                hash_index[std::move(*k)].insert(itm_id);
+            else
+                ordered_index[std::move(*k)].insert(itm_id);
+        }
+    }
+
+    void property_index::erase(const std::string &itm_id, const json::json &val) noexcept
+    {
+        if (val.is_array())
+        {
+            for (const auto &v : val.as_array())
+                erase(itm_id, v);
+            return;
+        }
+        if (auto k = key_of(val))
+        {
+            if (kind == index_kind::hash)
+            {
+                if (auto it = hash_index.find(*k); it != hash_index.end() && it->second.erase(itm_id) && it->second.empty())
+                    hash_index.erase(it);
+            }
+            else if (auto it = ordered_index.find(*k); it != ordered_index.end() && it->second.erase(itm_id) && it->second.empty())
+                ordered_index.erase(it);
+        }
+    }
+
+    template <typename Fn>
+    void property_index::for_each(const item_filter &f, Fn &&fn) const noexcept
+    {
+        const auto k = key_of(f.value);
+        if (!k)
+            return;
+        if (kind == index_kind::hash)
+        {
+            if (f.op == filter_op::eq)
+                if (auto it = hash_index.find(*k); it != hash_index.end())
+                    fn(it->second);
+            return;
+        }
+
+        // numbers precede strings, so a range never crosses the first string..
+        const auto first_string = ordered_index.lower_bound(key(std::in_place_index<1>));
+        auto lo = std::holds_alternative<double>(*k) ? ordered_index.begin() : first_string;
+        auto hi = std::holds_alternative<double>(*k) ? first_string : ordered_index.end();
+        switch (f.op)
+        {
+        case filter_op::eq:
+            lo = ordered_index.lower_bound(*k);
+            hi = ordered_index.upper_bound(*k);
+            break;
+        case filter_op::lt:
+            hi = ordered_index.lower_bound(*k);
+            break;
+        case filter_op::le:
+            hi = ordered_index.upper_bound(*k);
+            break;
+        case filter_op::gt:
+            lo = ordered_index.upper_bound(*k);
+            break;
+        case filter_op::ge:
+            lo = ordered_index.lower_bound(*k);
+            break;
+        case filter_op::within:
+            return;
+        }
+        for (; lo != hi; ++lo)
+            if (!fn(lo->second))
+                return;
+    }
+
+    size_t property_index::count(const item_filter &f, size_t limit) const noexcept
+    {
+        size_t res = 0;
+        for_each(f, [&res, limit](const ids &itms)
+                 { res += itms.size();
+                   return res < limit; });
+        return res;
+    }
+
+    void property_index::find(const item_filter &f, const std::function<void(const std::string &)> &cb) const noexcept
+    {
+        for_each(f, [&cb](const ids &itms)
+                 { for (const auto &id : itms)
+                       cb(id);
+                   return true; });
+    }
+} // namespace coco
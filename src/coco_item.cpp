@@ -1,8 +1,10 @@
 #include "coco_item.hpp"
 #include "coco_type.hpp"
 #include "coco_property.hpp"
+#include "coco_column.hpp"
 #include "coco.hpp"
 #include "logging.hpp"
+#include <algorithm>
 #include <cassert>
 
 #ifdef BUILD_LISTENERS
@@ -17,6 +19,29 @@
 
 namespace coco
 {
+    namespace
+    {
+        [[nodiscard]] std::optional<std::pair<size_t, std::chrono::milliseconds>> history_config(const json::json &history, const std::string &p_name)
+        {
+            if (!history.is_object())
+                return std::nullopt;
+            // the history of a single property, within `properties`, replaces the one shared by all the properties..
+            const auto &cfg = history.contains("properties") && history["properties"].is_object() && history["properties"].contains(p_name) ? history["properties"][p_name] : history;
+            if (!cfg.is_object() || (!cfg.contains("count") && !cfg.contains("duration")))
+                return std::nullopt;
+            for (const auto *key : {"count", "duration"})
+                if (cfg.contains(key) && (!cfg[key].is_integer() || cfg[key].get<int64_t>() < 0))
+                { // types stored before their data were checked might hold anything..
+                    LOG_WARN("Ignoring the invalid history of property " + p_name + ": " + cfg.dump());
+                    return std::nullopt;
+                }
+            // the number of values is always bounded, so that a duration based history cannot grow indefinitely..
+            size_t capacity = cfg.contains("count") ? std::min<size_t>(static_cast<size_t>(cfg["count"].get<int64_t>()), HISTORY_MAX_SIZE) : HISTORY_MAX_SIZE;
+            std::chrono::milliseconds duration = cfg.contains("duration") ? std::chrono::seconds(cfg["duration"].get<int64_t>()) : std::chrono::milliseconds::zero();
+            return std::make_pair(capacity, duration);
+        }
+    } // namespace
+
     item::item(coco &cc, std::string_view id, json::json &&props, std::optional<std::pair<json::json, std::chrono::system_clock::time_point>> &&val) noexcept : cc(cc), id(id), properties(std::move(props)), value(std::move(val)) { CREATED_ITEM(*this); }
     item::~item() noexcept
     {
@@ -34,23 +59,53 @@ namespace coco
         return res;
     }
 
-    void item::set_properties(json::json &&props)
+    json::json item::get_properties() const
+    {
+        json::json props = properties;
+        for (const auto &[tp_name, _] : item_facts)
+        {
+            const auto &tp = cc.get_type(tp_name);
+            if (auto row = tp.instances.find(id); row != tp.instances.end())
+                for (const auto &[p_name, col] : tp.columns)
+                    if (!col->is_null(row->second))
+                        props[p_name] = col->get(row->second);
+        }
+        return props;
+    }
+
+    json::json item::get_property_value(const std::string &p_name) const noexcept
+    {
+        for (const auto &[tp_name, _] : item_facts)
+            if (auto val = cc.get_type(tp_name).get_value(*this, p_name); !val.is_null())
+                return val;
+        if (properties.contains(p_name))
+            return properties[p_name];
+        return json::json();
+    }
+
+    void item::set_properties(json::json &&props, bool validate)
     {
+        const auto tps = get_types();
+        for (auto &tp : tps) // the secondary indexes are updated once the new values are known..
+            tp.get().unindex(*this, false);
+        for (const auto &[p_name, _] : props.as_object())
+            if (is_reference(p_name, false))
+                if (const auto old_val = get_property_value(p_name); !old_val.is_null())
+                    cc.remove_referrer(id, p_name, old_val);
         for (auto item_fact : item_facts)
         {
             FactModifier *fact_modifier = CreateFactModifier(cc.env, item_fact.second);
-            const auto &static_props = cc.get_type(item_fact.first).get_static_properties();
+            auto &tp = cc.get_type(item_fact.first);
+            const auto &static_props = tp.get_static_properties();
             for (const auto &[p_name, val] : props.as_object())
                 if (auto prop = static_props.find(p_name); prop != static_props.end())
                 {
                     LOG_TRACE("Updating property " + p_name + " for item " + id + " with value " + val.dump());
-                    if (prop->second->validate(val))
+                    if (!validate || prop->second->validate(val))
                     {
                         prop->second->set_value(fact_modifier, val);
-                        if (val.is_null())
-                            properties.erase(p_name);
-                        else
-                            properties[p_name] = val;
+                        tp.set_value(*this, p_name, val);
+                        properties.erase(p_name);
                     }
                     else
                         LOG_WARN("Property " + p_name + " for item " + id + " is not valid");
@@ -64,15 +119,29 @@ namespace coco
             item_fact.second = updated_fact;
             FMDispose(fact_modifier);
         }
+        for (auto &tp : tps)
+            tp.get().index(*this, false);
+        for (const auto &[p_name, _] : props.as_object())
+            if (is_reference(p_name, false))
+                if (const auto new_val = get_property_value(p_name); !new_val.is_null())
+                    cc.add_referrer(id, p_name, new_val);
         UPDATED_ITEM(*this);
     }
 
-    void item::set_value(std::pair<json::json, std::chrono::system_clock::time_point> &&val)
+    void item::set_value(std::pair<json::json, std::chrono::system_clock::time_point> &&val, bool keep_history)
     {
+        if (keep_history)
+            record(val.first, val.second);
         if (!value.has_value())
             value = std::make_pair(json::json(), val.second);
         else
             value->second = val.second;
+        const auto tps = get_types();
+        for (auto &tp : tps)
+            tp.get().unindex(*this, true);
+        for (const auto &[p_name, _] : val.first.as_object())
+            if (value->first.contains(p_name) && is_reference(p_name, true))
+                cc.remove_referrer(id, p_name, value->first[p_name]);
         for (auto &[tp_name, v_fs] : value_facts)
         {
             auto item_fact = item_facts.at(tp_name);
@@ -143,9 +212,24 @@ namespace coco
             item_fact = updated_fact;
             FMDispose(fact_modifier);
         }
+        for (auto &tp : tps)
+            tp.get().index(*this, true);
+        for (const auto &[p_name, _] : val.first.as_object())
+            if (value->first.contains(p_name) && is_reference(p_name, true))
+                cc.add_referrer(id, p_name, value->first[p_name]);
         NEW_DATA(*this, value->first, value->second);
     }
 
+    void item::record(const json::json &val, const std::chrono::system_clock::time_point &timestamp) noexcept
+    {
+        if (history.empty())
+            return;
+        const auto ts = std::chrono::duration_cast<std::chrono::milliseconds>(timestamp.time_since_epoch()).count();
+        for (const auto &[p_name, j_val] : val.as_object())
+            if (auto h = history.find(p_name); h != history.end())
+                h->second.push(ts, j_val);
+    }
+
     const property &item::get_property(std::string_view name) const
     {
         for (const auto &[tp_name, _] : item_facts)
@@ -161,6 +245,70 @@ namespace coco
         throw std::invalid_argument("property `" + std::string(name) + "` does not exist for item `" + id + "`");
     }
 
+    std::vector<std::pair<std::string, json::json>> item::get_references() const noexcept
+    {
+        std::vector<std::pair<std::string, json::json>> res;
+        for (const auto &[tp_name, _] : item_facts) // only the referencing columns are read..
+            for (const auto &[p_name, prop] : cc.get_type(tp_name).get_static_properties())
+                if (prop->get_property_type().get_name() == item_kw && is_reference(p_name, false) && std::none_of(res.begin(), res.end(), [&p_name = p_name](const auto &ref)
+                                                                                                                   { return ref.first == p_name; }))
+                    if (auto val = get_property_value(p_name); !val.is_null())
+                        res.emplace_back(p_name, std::move(val));
+        if (value.has_value())
+            for (const auto &[p_name, val] : value->first.as_object())
+                if (is_reference(p_name, true))
+                    res.emplace_back(p_name, val);
+        return res;
+    }
+
+    bool item::is_reference(const std::string &p_name, bool dynamic) const noexcept
+    {
+        for (const auto &[tp_name, _] : item_facts)
+        {
+            const auto &props = dynamic ? cc.get_type(tp_name).get_dynamic_properties() : cc.get_type(tp_name).get_static_properties();
+            if (auto prop = props.find(p_name); prop != props.end())
+                return prop->second->get_property_type().get_name() == item_kw;
+        }
+        return false;
+    }
+
+    bool item::covers(const std::vector<std::string> &props, const std::chrono::system_clock::time_point &from) const noexcept
+    {
+        if (history.empty())
+            return false;
+        const auto from_ts = std::chrono::duration_cast<std::chrono::milliseconds>(from.time_since_epoch()).count();
+        const auto covered = [this, from_ts](const std::string &p_name)
+        {
+            auto h = history.find(p_name);
+            return h != history.end() && h->second.get_covered_since() <= from_ts;
+        };
+        if (!props.empty())
+            return std::all_of(props.begin(), props.end(), covered);
+        for (const auto &tp : get_types())
+            for (const auto &[p_name, _] : tp.get().get_dynamic_properties())
+                if (!covered(p_name))
+                    return false;
+        return true;
+    }
+
+    void item::get_history(const std::vector<std::string> &props, const std::chrono::system_clock::time_point &from, const std::chrono::system_clock::time_point &to, const std::function<void(const std::string &, int64_t, json::json &&)> &cb) const
+    {
+        const auto from_ts = std::chrono::duration_cast<std::chrono::milliseconds>(from.time_since_epoch()).count();
+        const auto to_ts = std::chrono::duration_cast<std::chrono::milliseconds>(to.time_since_epoch()).count();
+        for (const auto &[p_name, h] : history)
+            if (props.empty() || std::find(props.begin(), props.end(), p_name) != props.end())
+                h.decode(from_ts, to_ts, [&cb, &p_name = p_name](int64_t ts, json::json &&v)
+                         { cb(p_name, ts, std::move(v)); });
+    }
+
+    size_t item::get_history_bytes() const noexcept
+    {
+        size_t res = 0;
+        for (const auto &[p_name, h] : history)
+            res += p_name.capacity() + h.bytes();
+        return res;
+    }
+
     json::json item::to_json() const noexcept
     {
         json::json j_itm;
@@ -171,8 +319,8 @@ namespace coco
                 types.push_back(type_name);
             j_itm["types"] = std::move(types);
         }
-        if (!properties.as_object().empty())
-            j_itm["properties"] = properties;
+        if (auto props = get_properties(); !props.as_object().empty())
+            j_itm["properties"] = std::move(props);
         if (value.has_value())
             j_itm["value"] = json::json{{"data", value->first}, {"timestamp", std::chrono::duration_cast<std::chrono::milliseconds>(value->second.time_since_epoch()).count()}};
         return j_itm;
@@ -183,7 +331,8 @@ namespace coco
         FactBuilder *item_fact_builder = CreateFactBuilder(cc.env, tp.get_name().c_str());
         FBPutSlotSymbol(item_fact_builder, "item_id", id.data());
         auto &static_props = tp.get_static_properties();
-        for (const auto &[p_name, val] : properties.as_object())
+        const auto props = get_properties();
+        for (const auto &[p_name, val] : props.as_object())
             if (auto prop = static_props.find(p_name); prop != static_props.end())
             {
                 if (prop->second->validate(val))
@@ -208,6 +357,13 @@ namespace coco
         FBDispose(item_fact_builder);
         item_facts.emplace(tp.get_name(), item_fact);
         value_facts.emplace(tp.get_name(), std::map<std::string, Fact *>());
+        if (const auto &data = tp.get_data(); data.is_object() && data.contains("history"))
+        { // the recent history is recorded from now on..
+            const auto now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+            for (const auto &[p_name, _] : dynamic_props)
+                if (auto cfg = history_config(data["history"], p_name))
+                    history.try_emplace(p_name, cfg->first, cfg->second, now);
+        }
         UPDATED_ITEM(*this);
     }
 
@@ -220,6 +376,10 @@ namespace coco
             assert(re_err == RE_NO_ERROR);
         }
         value_facts.erase(tp.get_name());
+        for (const auto &[p_name, _] : tp.get_dynamic_properties())
+            if (const auto tps = get_types(); std::none_of(tps.begin(), tps.end(), [&tp, &p_name = p_name](const type &o_tp)
+                                                           { return &o_tp != &tp && o_tp.get_dynamic_properties().count(p_name); }))
+                history.erase(p_name);
 
         auto it = item_facts.find(tp.get_name());
         assert(it != item_facts.end());
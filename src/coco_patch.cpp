@@ -0,0 +1,224 @@
+#include "coco_patch.hpp"
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+
+namespace coco
+{
+    namespace
+    {
+        [[nodiscard]] std::string to_pointer(const std::vector<std::string> &tokens) noexcept
+        {
+            std::string ptr;
+            for (const auto &token : tokens)
+            {
+                ptr += '/';
+                for (char ch : token)
+                    if (ch == '~')
+                        ptr += "~0";
+                    else if (ch == '/')
+                        ptr += "~1";
+                    else
+                        ptr += ch;
+            }
+            return ptr;
+        }
+
+        [[nodiscard]] size_t to_index(const std::string &token, size_t size, bool end_allowed)
+        {
+            if (end_allowed && token == "-")
+                return size;
+            if (token.empty() || (token.size() > 1 && token[0] == '0') || !std::all_of(token.begin(), token.end(), [](char ch)
+                                                                                      { return std::isdigit(static_cast<unsigned char>(ch)); }))
+                throw std::invalid_argument("Invalid array index: " + token);
+            const auto idx = std::stoull(token);
+            if (idx > size || (!end_allowed && idx == size))
+                throw std::invalid_argument("Array index out of range: " + token);
+            return idx;
+        }
+
+        // gets the value a pointer refers to, creating the missing parent objects if requested..
+        [[nodiscard]] json::json &resolve(json::json &doc, const std::vector<std::string> &tokens, size_t n, bool create = false)
+        {
+            json::json *cur = &doc;
+            for (size_t i = 0; i < n; ++i)
+                if (cur->is_array())
+                    cur = &cur->as_array()[to_index(tokens[i], cur->size(), false)];
+                else if (cur->is_object() || (create && cur->is_null()))
+                {
+                    if (!cur->contains(tokens[i]))
+                    {
+                        if (!create)
+                            throw std::invalid_argument("Path not found: " + to_pointer({tokens.begin(), tokens.begin() + i + 1}));
+                        (*cur)[tokens[i]] = json::json();
+                    }
+                    cur = &(*cur)[tokens[i]];
+                }
+                else
+                    throw std::invalid_argument("Path not found: " + to_pointer({tokens.begin(), tokens.begin() + i + 1}));
+            return *cur;
+        }
+
+        void add(json::json &doc, const std::vector<std::string> &path, json::json value, bool create)
+        {
+            if (path.empty())
+            {
+                doc = std::move(value);
+                return;
+            }
+            auto &parent = resolve(doc, path, path.size() - 1, create);
+            if (parent.is_array())
+            {
+                auto &arr = parent.as_array();
+                const auto idx = to_index(path.back(), arr.size(), true);
+                if (create && idx < arr.size()) // setting an existing element replaces it..
+                    arr[idx] = std::move(value);
+                else
+                    arr.insert(arr.begin() + idx, std::move(value));
+            }
+            else if (parent.is_object() || (create && parent.is_null()))
+                parent[path.back()] = std::move(value);
+            else
+                throw std::invalid_argument("Path not found: " + to_pointer(path));
+        }
+
+        [[nodiscard]] json::json remove(json::json &doc, const std::vector<std::string> &path)
+        {
+            if (path.empty())
+                throw std::invalid_argument("The whole document cannot be removed");
+            auto &parent = resolve(doc, path, path.size() - 1);
+            json::json removed;
+            if (parent.is_array())
+            {
+                auto &arr = parent.as_array();
+                const auto idx = to_index(path.back(), arr.size(), false);
+                removed = std::move(arr[idx]);
+                arr.erase(arr.begin() + idx);
+            }
+            else if (parent.is_object() && parent.contains(path.back()))
+            {
+                removed = std::move(parent[path.back()]);
+                parent.erase(path.back());
+            }
+            else
+                throw std::invalid_argument("Path not found: " + to_pointer(path));
+            return removed;
+        }
+    } // namespace
+
+    std::vector<std::string> parse_pointer(std::string_view ptr)
+    {
+        std::vector<std::string> tokens;
+        if (ptr.empty())
+            return tokens;
+        if (ptr[0] != '/')
+            throw std::invalid_argument("Invalid JSON pointer: " + std::string(ptr));
+        std::string token;
+        for (size_t i = 1; i <= ptr.size(); ++i)
+            if (i == ptr.size() || ptr[i] == '/')
+            {
+                tokens.push_back(std::move(token));
+                token.clear();
+            }
+            else if (ptr[i] == '~')
+            {
+                if (i + 1 == ptr.size() || (ptr[i + 1] != '0' && ptr[i + 1] != '1'))
+                    throw std::invalid_argument("Invalid JSON pointer escape: " + std::string(ptr));
+                token += ptr[++i] == '0' ? '~' : '/';
+            }
+            else
+                token += ptr[i];
+        return tokens;
+    }
+
+    std::vector<patch_op> parse_patch(const json::json &patch)
+    {
+        if (!patch.is_array())
+            throw std::invalid_argument("A JSON patch must be an array of operations");
+        std::vector<patch_op> ops;
+        ops.reserve(patch.size());
+        for (const auto &j_op : patch.as_array())
+        {
+            if (!j_op.is_object() || !j_op.contains("op") || !j_op["op"].is_string() || !j_op.contains("path") || !j_op["path"].is_string())
+                throw std::invalid_argument("Invalid JSON patch operation: " + j_op.dump());
+            const auto op_name = j_op["op"].get<std::string>();
+            patch_op op{patch_kind::add, parse_pointer(j_op["path"].get<std::string>()), {}, {}};
+            if (op_name == "add" || op_name == "replace" || op_name == "test" || op_name == "append" || op_name == "set_path")
+            {
+                if (!j_op.contains("value"))
+                    throw std::invalid_argument("Missing value for the JSON patch operation: " + j_op.dump());
+                op.value = j_op["value"];
+                if (op_name == "replace")
+                    op.kind = patch_kind::replace;
+                else if (op_name == "test")
+                    op.kind = patch_kind::test;
+                else if (op_name == "set_path")
+                    op.kind = patch_kind::set;
+                else if (op_name == "append")
+                    op.path.push_back("-");
+            }
+            else if (op_name == "remove")
+                op.kind = patch_kind::remove;
+            else if (op_name == "remove_at")
+            {
+                if (!j_op.contains("index") || !j_op["index"].is_integer() || j_op["index"].get<int64_t>() < 0)
+                    throw std::invalid_argument("Missing index for the JSON patch operation: " + j_op.dump());
+                op.kind = patch_kind::remove;
+                op.path.push_back(std::to_string(j_op["index"].get<int64_t>()));
+            }
+            else if (op_name == "move" || op_name == "copy")
+            {
+                if (!j_op.contains("from") || !j_op["from"].is_string())
+                    throw std::invalid_argument("Missing source for the JSON patch operation: " + j_op.dump());
+                op.kind = op_name == "move" ? patch_kind::move : patch_kind::copy;
+                op.from = parse_pointer(j_op["from"].get<std::string>());
+            }
+            else
+                throw std::invalid_argument("Unknown JSON patch operation: " + op_name);
+            ops.push_back(std::move(op));
+        }
+        return ops;
+    }
+
+    void apply_patch(json::json &doc, const patch_op &op)
+    {
+        switch (op.kind)
+        {
+        case patch_kind::add:
+            add(doc, op.path, op.value, false);
+            break;
+        case patch_kind::set:
+            add(doc, op.path, op.value, true);
+            break;
+        case patch_kind::remove:
+            static_cast<void>(remove(doc, op.path));
+            break;
+        case patch_kind::replace:
+            resolve(doc, op.path, op.path.size()) = op.value;
+            break;
+        case patch_kind::move:
+        {
+            if (op.path.size() > op.from.size() && std::equal(op.from.begin(), op.from.end(), op.path.begin()))
+                throw std::invalid_argument("A value cannot be moved into itself: " + to_pointer(op.from));
+            auto backup = doc; // the source is restored if the target cannot be reached..
+            try
+            {
+                add(doc, op.path, remove(doc, op.from), false);
+            }
+            catch (const std::invalid_argument &)
+            {
+                doc = std::move(backup);
+                throw;
+            }
+            break;
+        }
+        case patch_kind::copy:
+            add(doc, op.path, resolve(doc, op.from, op.from.size()), false);
+            break;
+        case patch_kind::test:
+            if (!(resolve(doc, op.path, op.path.size()) == op.value))
+                throw std::invalid_argument("Test failed for " + to_pointer(op.path));
+            break;
+        }
+    }
+} // namespace coco
@@ -2,13 +2,39 @@
 #include "coco_type.hpp"
 #include "coco_item.hpp"
 #include "coco.hpp"
+#include "coco_geo.hpp"
+#include "coco_column.hpp"
+#include "coco_schema.hpp"
 #include "logging.hpp"
 #include <algorithm>
+#include <cmath>
+#include <limits>
 #include <queue>
 #include <cassert>
 
 namespace coco
 {
+    namespace
+    {
+        // only the single values of dynamic properties are archived, as `{"deviation": ..., "mode": "swinging_door" | "deadband"}`..
+        [[nodiscard]] std::optional<archive_policy> archive_of(bool dynamic, bool multiple, std::string_view name, const json::json &j) noexcept
+        {
+            if (!j.contains("archive"))
+                return std::nullopt;
+            if (!dynamic || multiple || !j["archive"].contains("deviation"))
+            {
+                LOG_WARN("Ignoring the archive of property " + std::string(name) + ": only single valued dynamic properties with a deviation can be archived");
+                return std::nullopt;
+            }
+            archive_policy policy;
+            policy.deviation = j["archive"]["deviation"].get<double>();
+            if (j["archive"].contains("mode") && j["archive"]["mode"].get<std::string>() == "deadband")
+                policy.mode = archive_mode::deadband;
+            return policy;
+        }
+        [[nodiscard]] json::json archive_to_json(const archive_policy &policy) noexcept { return json::json{{"mode", policy.mode == archive_mode::deadband ? "deadband" : "swinging_door"}, {"deviation", policy.deviation}}; }
+    } // namespace
+
     property_type::property_type(coco &cc, std::string_view name) noexcept : cc(cc), name(name) {}
     Environment *property_type::get_env() const noexcept { return cc.env; }
 
@@ -53,7 +79,7 @@ namespace coco
         std::optional<long> max;
         if (j.contains("max"))
             max = j["max"].get<long>();
-        return std::make_unique<int_property>(*this, tp, dynamic, name, nullable, multiple, default_value, min, max);
+        return std::make_unique<int_property>(*this, tp, dynamic, name, nullable, multiple, default_value, min, max, archive_of(dynamic, multiple, name, j));
     }
 
     float_property_type::float_property_type(coco &cc) noexcept : property_type(cc, float_kw) {}
@@ -78,7 +104,7 @@ namespace coco
         std::optional<double> max;
         if (j.contains("max"))
             max = j["max"].get<double>();
-        return std::make_unique<float_property>(*this, tp, dynamic, name, nullable, multiple, default_value, min, max);
+        return std::make_unique<float_property>(*this, tp, dynamic, name, nullable, multiple, default_value, min, max, archive_of(dynamic, multiple, name, j));
     }
 
     string_property_type::string_property_type(coco &cc) noexcept : property_type(cc, string_kw) {}
@@ -140,7 +166,8 @@ namespace coco
                 def_v.emplace_back(cc.get_item(j["default"].get<std::string>()));
             default_value = std::move(def_v);
         }
-        return std::make_unique<item_property>(*this, tp, dynamic, name, domain, nullable, multiple, default_value);
+        bool cascade = j.contains("on_delete") && j["on_delete"].is_string() && j["on_delete"].get<std::string>() == "cascade";
+        return std::make_unique<item_property>(*this, tp, dynamic, name, domain, nullable, multiple, default_value, cascade);
     }
 
     json_property_type::json_property_type(coco &cc) noexcept : property_type(cc, json_kw) {}
@@ -156,6 +183,46 @@ namespace coco
         return std::make_unique<json_property>(*this, tp, dynamic, name, nullable, schema, default_value);
     }
 
+    geo_property_type::geo_property_type(coco &cc) noexcept : property_type(cc, geo_kw) {}
+    std::unique_ptr<property> geo_property_type::new_instance(type &tp, bool dynamic, std::string_view name, const json::json &j) noexcept
+    {
+        bool nullable = j.contains("nullable") && (j["nullable"].get<bool>());
+        bool polygon = j.contains("polygon") && j["polygon"].get<bool>();
+        return std::make_unique<geo_property>(*this, tp, dynamic, name, nullable, polygon);
+    }
+
+    vector_property_type::vector_property_type(coco &cc) noexcept : property_type(cc, vector_kw) {}
+    std::unique_ptr<property> vector_property_type::new_instance(type &tp, bool dynamic, std::string_view name, const json::json &j) noexcept
+    {
+        bool nullable = j.contains("nullable") && (j["nullable"].get<bool>());
+        auto dtype = vector_dtype::f64;
+        if (j.contains("dtype"))
+        {
+            if (auto dt = to_vector_dtype(j["dtype"].get<std::string>()))
+                dtype = *dt;
+            else
+                LOG_WARN("Unknown element type " + j["dtype"].get<std::string>() + " for property " + std::string(name) + ", using f64");
+        }
+        std::optional<size_t> length;
+        if (j.contains("length"))
+            length = j["length"].get<size_t>();
+        std::optional<size_t> max_length;
+        if (j.contains("max_length"))
+            max_length = j["max_length"].get<size_t>();
+        std::optional<double> min;
+        if (j.contains("min"))
+            min = j["min"].get<double>();
+        std::optional<double> max;
+        if (j.contains("max"))
+            max = j["max"].get<double>();
+        if (length && max_length && *length > *max_length)
+        { // coco::create_type rejects these, but the types stored before it did might hold anything..
+            LOG_WARN("Ignoring the maximum length of property " + std::string(name) + ", which is below its length");
+            max_length.reset();
+        }
+        return std::make_unique<vector_property>(*this, tp, dynamic, name, nullable, dtype, length, max_length, min, max);
+    }
+
     property::property(const property_type &pt, const type &tp, bool dynamic, std::string_view name, bool nullable) noexcept : pt(pt), tp(tp), dynamic(dynamic), name(name), nullable(nullable) {}
     property::~property()
     {
@@ -172,7 +239,13 @@ namespace coco
     std::string property::get_deftemplate_name() const noexcept { return tp.get_name() + "_" + name.data(); }
     Environment *property::get_env() const noexcept { return pt.get_coco().env; }
     const json::json &property::get_schemas() const noexcept { return pt.get_coco().schemas; }
+    std::shared_ptr<const schema_validator> property::get_validator(const json::json &schema) const noexcept { return pt.get_coco().get_validator(schema); }
+    size_t property::get_schemas_version() const noexcept { return pt.get_coco().schemas_version; }
+    CLIPSExternalAddress *property::get_json_address(std::shared_ptr<const json::json> doc) const noexcept { return pt.get_coco().to_json_address(std::move(doc)); }
+    const json::json *property::get_json_document(void *value) const noexcept { return pt.get_coco().to_json_document(value); }
+    CLIPSExternalAddress *property::get_vector_address(std::shared_ptr<const vector_buffer> buf) const noexcept { return pt.get_coco().to_vector_address(std::move(buf)); }
     std::mt19937 &property::get_gen() const noexcept { return pt.get_coco().gen; }
+    std::unique_ptr<column> property::new_column() const noexcept { return std::make_unique<json_column>(); }
 
     bool_property::bool_property(const property_type &pt, const type &tp, bool dynamic, std::string_view name, bool nullable, bool multiple, std::optional<std::vector<bool>> default_value) noexcept : property(pt, tp, dynamic, name, nullable), multiple(multiple), default_value(default_value)
     {
@@ -211,6 +284,12 @@ namespace coco
         }
         return j;
     }
+    std::unique_ptr<column> bool_property::new_column() const noexcept
+    {
+        if (multiple)
+            return property::new_column();
+        return std::make_unique<numeric_column<bool>>();
+    }
     json::json bool_property::fake() const noexcept
     {
         if (multiple) // Generate a random number of values.
@@ -337,7 +416,7 @@ namespace coco
         return slot_decl;
     }
 
-    int_property::int_property(const property_type &pt, const type &tp, bool dynamic, std::string_view name, bool nullable, bool multiple, std::optional<std::vector<long>> default_value, std::optional<long> min, std::optional<long> max) noexcept : property(pt, tp, dynamic, name, nullable), multiple(multiple), default_value(default_value), min(min), max(max)
+    int_property::int_property(const property_type &pt, const type &tp, bool dynamic, std::string_view name, bool nullable, bool multiple, std::optional<std::vector<long>> default_value, std::optional<long> min, std::optional<long> max, std::optional<archive_policy> archive) noexcept : property(pt, tp, dynamic, name, nullable), multiple(multiple), default_value(default_value), min(min), max(max), archive(archive)
     {
         if (dynamic)
         {
@@ -391,8 +470,16 @@ namespace coco
             j["min"] = *min;
         if (max.has_value())
             j["max"] = *max;
+        if (archive.has_value())
+            j["archive"] = archive_to_json(*archive);
         return j;
     }
+    std::unique_ptr<column> int_property::new_column() const noexcept
+    {
+        if (multiple)
+            return property::new_column();
+        return std::make_unique<numeric_column<int64_t>>();
+    }
     json::json int_property::fake() const noexcept
     {
         if (multiple) // Generate a random number of values.
@@ -536,7 +623,7 @@ namespace coco
         return slot_decl;
     }
 
-    float_property::float_property(const property_type &pt, const type &tp, bool dynamic, std::string_view name, bool nullable, bool multiple, std::optional<std::vector<double>> default_value, std::optional<double> min, std::optional<double> max) noexcept : property(pt, tp, dynamic, name, nullable), multiple(multiple), default_value(default_value), min(min), max(max)
+    float_property::float_property(const property_type &pt, const type &tp, bool dynamic, std::string_view name, bool nullable, bool multiple, std::optional<std::vector<double>> default_value, std::optional<double> min, std::optional<double> max, std::optional<archive_policy> archive) noexcept : property(pt, tp, dynamic, name, nullable), multiple(multiple), default_value(default_value), min(min), max(max), archive(archive)
     {
         if (dynamic)
         {
@@ -590,8 +677,16 @@ namespace coco
             j["min"] = *min;
         if (max.has_value())
             j["max"] = *max;
+        if (archive.has_value())
+            j["archive"] = archive_to_json(*archive);
         return j;
     }
+    std::unique_ptr<column> float_property::new_column() const noexcept
+    {
+        if (multiple)
+            return property::new_column();
+        return std::make_unique<numeric_column<double>>();
+    }
     json::json float_property::fake() const noexcept
     {
         if (multiple) // Generate a random number of values.
@@ -772,6 +867,12 @@ namespace coco
         }
         return j;
     }
+    std::unique_ptr<column> string_property::new_column() const noexcept
+    {
+        if (multiple)
+            return property::new_column();
+        return std::make_unique<lexeme_column>();
+    }
     json::json string_property::fake() const noexcept
     {
         if (multiple) // Generate a random number of values.
@@ -962,6 +1063,12 @@ namespace coco
         }
         return j;
     }
+    std::unique_ptr<column> symbol_property::new_column() const noexcept
+    {
+        if (multiple)
+            return property::new_column();
+        return std::make_unique<lexeme_column>();
+    }
     json::json symbol_property::fake() const noexcept
     {
         std::uniform_int_distribution<std::size_t> dist(0, values.size() - 1);
@@ -1099,14 +1206,10 @@ namespace coco
         return slot_decl;
     }
 
-    item_property::item_property(const property_type &pt, const type &tp, bool dynamic, std::string_view name, const type &domain, bool nullable, bool multiple, std::optional<std::vector<std::reference_wrapper<item>>> default_value) noexcept : property(pt, tp, dynamic, name, nullable), domain(domain), multiple(multiple), default_value(default_value)
-    {
-        assert(!default_value.has_value() || default_value->empty() || std::all_of(default_value->begin(), default_value->end(), [&domain](const auto &val)
-                                                                                   {
-                                                                                        for (const auto &tp : val.get().get_types())
-                                                                                            if (&tp.get() == &domain)
-                                                                                                return true;
-                                                                                        return false; }));
+    item_property::item_property(const property_type &pt, const type &tp, bool dynamic, std::string_view name, const type &domain, bool nullable, bool multiple, std::optional<std::vector<std::reference_wrapper<item>>> default_value, bool cascade) noexcept : property(pt, tp, dynamic, name, nullable), domain(domain), multiple(multiple), default_value(default_value), cascade(cascade)
+    {
+        assert(!default_value.has_value() || std::all_of(default_value->begin(), default_value->end(), [&domain](const auto &val)
+                                                         { return domain.has_instance(val.get().get_id()); }));
         assert(!default_value.has_value() || !multiple || default_value->size() <= 1);
 
         if (dynamic)
@@ -1121,25 +1224,10 @@ namespace coco
     {
         if (j.is_null())
             return nullable;
-        if (multiple)
-        {
-            if (!j.is_array())
-                return false;
-            return std::all_of(j.as_array().begin(), j.as_array().end(), [this](const json::json &v)
-                               { return v.is_string() && !tp.get_coco().get_item(v.get<std::string>()).get_id().empty() && ([&]()
-                                                                                                                            {
-                                         for (const auto &tp : tp.get_coco().get_item(v.get<std::string>()).get_types())
-                                             if (&tp.get() == &domain)
-                                                 return true;
-                                         return false; }()); });
-        }
+        if (multiple) // the references are checked in a single pass over the instances of the domain..
+            return domain.has_instances(j);
         else
-            return j.is_string() && !tp.get_coco().get_item(j.get<std::string>()).get_id().empty() && ([&]()
-                                                                                                       {
-                    for (const auto &tp : tp.get_coco().get_item(j.get<std::string>()).get_types())
-                        if (&tp.get() == &domain)
-                            return true;
-                    return false; }());
+            return j.is_string() && domain.has_instance(j.get<std::string>());
     }
     json::json item_property::to_json() const noexcept
     {
@@ -1154,6 +1242,8 @@ namespace coco
                 j_def_vals.push_back(val.get().get_id().c_str());
             j["default"] = j_def_vals;
         }
+        if (cascade)
+            j["on_delete"] = "cascade";
         return j;
     }
     json::json item_property::fake() const noexcept
@@ -1207,13 +1297,10 @@ namespace coco
             assert(value.is_array());
             assert(std::all_of(value.as_array().begin(), value.as_array().end(), [](const json::json &v)
                                { return v.is_string(); }));
-            assert(!domain.get_instances().empty());
-            assert(std::all_of(value.as_array().begin(), value.as_array().end(), [this](const json::json &v)
-                               { return std::find_if(domain.get_instances().begin(), domain.get_instances().end(), [&v](const auto &itm)
-                                                     { return itm.get().get_id() == v.get<std::string>(); }) != domain.get_instances().end(); }));
+            assert(domain.has_instances(value));
             auto mfb = CreateMultifieldBuilder(get_env(), value.as_array().size());
             for (const auto &v : value.as_array())
-                MBAppendSymbol(mfb, tp.get_coco().get_item(v.get<std::string>()).get_id().c_str());
+                MBAppendSymbol(mfb, v.get<std::string>().c_str());
             [[maybe_unused]] auto put_slot_err = FBPutSlotMultifield(property_fact_builder, name.data(), MBCreate(mfb));
             assert(put_slot_err == PSE_NO_ERROR);
             MBDispose(mfb);
@@ -1221,12 +1308,8 @@ namespace coco
         else
         {
             assert(value.is_string());
-            assert(!domain.get_instances().empty());
-            assert(std::find_if(domain.get_instances().begin(), domain.get_instances().end(), [&value](const auto &itm)
-                                { return itm.get().get_id() == value.get<std::string>(); }) != domain.get_instances().end());
-            assert(!tp.get_coco().get_item(value.get<std::string>()).get_id().empty());
-            auto &itm = tp.get_coco().get_item(value.get<std::string>());
-            [[maybe_unused]] auto put_slot_err = FBPutSlotSymbol(property_fact_builder, name.data(), itm.get_id().c_str());
+            assert(domain.has_instance(value.get<std::string>()));
+            [[maybe_unused]] auto put_slot_err = FBPutSlotSymbol(property_fact_builder, name.data(), value.get<std::string>().c_str());
             assert(put_slot_err == PSE_NO_ERROR);
         }
     }
@@ -1266,13 +1349,10 @@ namespace coco
             assert(value.is_array());
             assert(std::all_of(value.as_array().begin(), value.as_array().end(), [](const json::json &v)
                                { return v.is_string(); }));
-            assert(!domain.get_instances().empty());
-            assert(std::all_of(value.as_array().begin(), value.as_array().end(), [this](const json::json &v)
-                               { return std::find_if(domain.get_instances().begin(), domain.get_instances().end(), [&v](const auto &itm)
-                                                     { return itm.get().get_id() == v.get<std::string>(); }) != domain.get_instances().end(); }));
+            assert(domain.has_instances(value));
             auto mfb = CreateMultifieldBuilder(get_env(), value.as_array().size());
             for (const auto &v : value.as_array())
-                MBAppendSymbol(mfb, tp.get_coco().get_item(v.get<std::string>()).get_id().c_str());
+                MBAppendSymbol(mfb, v.get<std::string>().c_str());
             [[maybe_unused]] auto put_slot_err = FMPutSlotMultifield(property_fact_modifier, name.data(), MBCreate(mfb));
             assert(put_slot_err == PSE_NO_ERROR);
             MBDispose(mfb);
@@ -1280,12 +1360,8 @@ namespace coco
         else
         {
             assert(value.is_string());
-            assert(!domain.get_instances().empty());
-            assert(std::find_if(domain.get_instances().begin(), domain.get_instances().end(), [&value](const auto &itm)
-                                { return itm.get().get_id() == value.get<std::string>(); }) != domain.get_instances().end());
-            assert(!tp.get_coco().get_item(value.get<std::string>()).get_id().empty());
-            auto &itm = tp.get_coco().get_item(value.get<std::string>());
-            [[maybe_unused]] auto put_slot_err = FMPutSlotSymbol(property_fact_modifier, name.data(), itm.get_id().c_str());
+            assert(domain.has_instance(value.get<std::string>()));
+            [[maybe_unused]] auto put_slot_err = FMPutSlotSymbol(property_fact_modifier, name.data(), value.get<std::string>().c_str());
             assert(put_slot_err == PSE_NO_ERROR);
         }
     }
@@ -1312,14 +1388,28 @@ namespace coco
             [[maybe_unused]] auto prop_dt = Build(get_env(), deftemplate.c_str());
             assert(prop_dt == BE_NO_ERROR);
         }
+        if (default_value.has_value())
+            default_document = std::make_shared<const json::json>(*default_value);
+        if (schema.has_value())
+        { // the schema is compiled once, rather than interpreted at each validation..
+            validator = get_validator(*schema);
+            validator_version = get_schemas_version();
+        }
     }
     bool json_property::validate(const json::json &j) const noexcept
     {
         if (j.is_null())
             return nullable;
-        if (schema.has_value())
-            return json::validate(j, *schema, get_schemas());
-        return true;
+        if (!schema.has_value())
+            return true;
+        if (validator_version != get_schemas_version())
+        { // the schemas have changed since the schema was compiled..
+            validator = get_validator(*schema);
+            validator_version = get_schemas_version();
+        }
+        if (validator)
+            return validator->validate(j);
+        return json::validate(j, *schema, get_schemas());
     }
     json::json json_property::to_json() const noexcept
     {
@@ -1337,17 +1427,9 @@ namespace coco
         if (value.is_null())
         {
             assert(nullable);
-            if (default_value.has_value())
+            if (default_document)
             {
-                std::string def;
-                for (char ch : default_value->dump())
-                    if (ch == '"')
-                        def += "\\\"";
-                    else if (ch == '\\')
-                        def += "\\\\";
-                    else
-                        def += ch;
-                [[maybe_unused]] auto put_slot_err = FBPutSlotString(property_fact_builder, name.data(), def.c_str());
+                [[maybe_unused]] auto put_slot_err = FBPutSlotCLIPSExternalAddress(property_fact_builder, name.data(), get_json_address(default_document));
                 assert(put_slot_err == PSE_NO_ERROR);
             }
             else
@@ -1357,64 +1439,39 @@ namespace coco
             }
         }
         else
-        {
-            std::string val;
-            for (char ch : value.dump())
-                if (ch == '"')
-                    val += "\\\"";
-                else if (ch == '\\')
-                    val += "\\\\";
-                else
-                    val += ch;
-            [[maybe_unused]] auto put_slot_err = FBPutSlotString(property_fact_builder, name.data(), val.c_str());
+        { // the slot holds the parsed document, which the rules read through the json-* functions..
+            [[maybe_unused]] auto put_slot_err = FBPutSlotCLIPSExternalAddress(property_fact_builder, name.data(), get_json_address(std::make_shared<const json::json>(value)));
             assert(put_slot_err == PSE_NO_ERROR);
         }
     }
     void json_property::set_value(FactModifier *property_fact_modifier, const json::json &value) const noexcept
     {
-        if (value.is_null())
+        assert(!value.is_null() || nullable);
+        if (value.is_null() && !default_document)
         {
-            assert(nullable);
-            if (default_value.has_value())
-            {
-                std::string def;
-                for (char ch : default_value->dump())
-                    if (ch == '"')
-                        def += "\\\"";
-                    else if (ch == '\\')
-                        def += "\\\\";
-                    else
-                        def += ch;
-                [[maybe_unused]] auto put_slot_err = FMPutSlotString(property_fact_modifier, name.data(), def.c_str());
-                assert(put_slot_err == PSE_NO_ERROR);
-            }
-            else
-            {
-                [[maybe_unused]] auto put_slot_err = FMPutSlotSymbol(property_fact_modifier, name.data(), "nil");
-                assert(put_slot_err == PSE_NO_ERROR);
-            }
-        }
-        else
-        {
-            std::string val;
-            for (char ch : value.dump())
-                if (ch == '"')
-                    val += "\\\"";
-                else if (ch == '\\')
-                    val += "\\\\";
-                else
-                    val += ch;
-            [[maybe_unused]] auto put_slot_err = FMPutSlotString(property_fact_modifier, name.data(), val.c_str());
+            [[maybe_unused]] auto put_slot_err = FMPutSlotSymbol(property_fact_modifier, name.data(), "nil");
             assert(put_slot_err == PSE_NO_ERROR);
+            return;
         }
+
+        const json::json &doc = value.is_null() ? *default_document : value;
+        CLIPSExternalAddress *addr = nullptr;
+        CLIPSValue old_val;
+        if (GetFactSlot(property_fact_modifier->fmOldFact, name.data(), &old_val) == GSE_NO_ERROR)
+            if (const auto *old_doc = get_json_document(old_val.value); old_doc && *old_doc == doc)
+                addr = old_val.externalAddressValue; // the document is unchanged, so is the slot..
+        if (!addr) // the slot holds the parsed document, which the rules read through the json-* functions..
+            addr = get_json_address(value.is_null() ? default_document : std::make_shared<const json::json>(value));
+        [[maybe_unused]] auto put_slot_err = FMPutSlotCLIPSExternalAddress(property_fact_modifier, name.data(), addr);
+        assert(put_slot_err == PSE_NO_ERROR);
     }
     std::string json_property::get_slot_declaration() const noexcept
     {
         std::string slot_decl = "(slot " + std::string(name);
         if (!nullable)
-            slot_decl += " (type STRING)";
+            slot_decl += " (type EXTERNAL-ADDRESS)";
         if (default_value.has_value())
-        {
+        { // an external address has no literal form, so the default is parsed when the slot is left unset..
             std::string def;
             for (char ch : default_value->dump())
                 if (ch == '"')
@@ -1423,8 +1480,173 @@ namespace coco
                     def += "\\\\";
                 else
                     def += ch;
-            slot_decl += " (default \"" + def + "\")";
+            slot_decl += " (default-dynamic (json-parse \"" + def + "\"))";
+        }
+        slot_decl += ')';
+        return slot_decl;
+    }
+
+    geo_property::geo_property(const property_type &pt, const type &tp, bool dynamic, std::string_view name, bool nullable, bool polygon) noexcept : property(pt, tp, dynamic, name, nullable), polygon(polygon)
+    {
+        if (dynamic)
+        {
+            std::string deftemplate = "(deftemplate " + get_deftemplate_name() + " (slot item_id (type SYMBOL)) " + get_slot_declaration() + " (slot timestamp (type INTEGER)))";
+            LOG_TRACE(deftemplate);
+            [[maybe_unused]] auto prop_dt = Build(get_env(), deftemplate.c_str());
+            assert(prop_dt == BE_NO_ERROR);
+        }
+    }
+    bool geo_property::validate(const json::json &j) const noexcept
+    {
+        if (j.is_null())
+            return nullable;
+        if (polygon)
+            return j.is_array() && j.size() >= 3 && geo_points(j).size() == j.size();
+        return to_geo_point(j).has_value();
+    }
+    json::json geo_property::to_json() const noexcept
+    {
+        json::json j;
+        j["type"] = geo_kw;
+        if (polygon)
+            j["polygon"] = true;
+        return j;
+    }
+    json::json geo_property::fake() const noexcept
+    {
+        std::uniform_real_distribution<double> lat(-85, 85), lon(-179, 179);
+        json::json p{{"lat", lat(get_gen())}, {"lon", lon(get_gen())}};
+        if (polygon) // Generate a small triangle around the point.
+            return std::vector<json::json>{p, json::json{{"lat", p["lat"].get<double>() + 0.01}, {"lon", p["lon"].get<double>()}}, json::json{{"lat", p["lat"].get<double>()}, {"lon", p["lon"].get<double>() + 0.01}}};
+        return p;
+    }
+    void geo_property::set_value(FactBuilder *property_fact_builder, const json::json &value) const noexcept
+    {
+        assert(!value.is_null() || nullable);
+        const auto pts = geo_points(value);
+        auto mfb = CreateMultifieldBuilder(get_env(), pts.size() * 2);
+        for (const auto &p : pts)
+        {
+            MBAppendFloat(mfb, p.lat);
+            MBAppendFloat(mfb, p.lon);
+        }
+        [[maybe_unused]] auto put_slot_err = FBPutSlotMultifield(property_fact_builder, name.data(), MBCreate(mfb));
+        assert(put_slot_err == PSE_NO_ERROR);
+        MBDispose(mfb);
+    }
+    void geo_property::set_value(FactModifier *property_fact_modifier, const json::json &value) const noexcept
+    {
+        assert(!value.is_null() || nullable);
+        const auto pts = geo_points(value);
+        auto mfb = CreateMultifieldBuilder(get_env(), pts.size() * 2);
+        for (const auto &p : pts)
+        {
+            MBAppendFloat(mfb, p.lat);
+            MBAppendFloat(mfb, p.lon);
+        }
+        [[maybe_unused]] auto put_slot_err = FMPutSlotMultifield(property_fact_modifier, name.data(), MBCreate(mfb));
+        assert(put_slot_err == PSE_NO_ERROR);
+        MBDispose(mfb);
+    }
+    std::string geo_property::get_slot_declaration() const noexcept { return "(multislot " + std::string(name) + " (type FLOAT))"; }
+
+    vector_property::vector_property(const property_type &pt, const type &tp, bool dynamic, std::string_view name, bool nullable, vector_dtype dtype, std::optional<size_t> length, std::optional<size_t> max_length, std::optional<double> min, std::optional<double> max) noexcept : property(pt, tp, dynamic, name, nullable), dtype(dtype), length(length), max_length(max_length), min(min), max(max)
+    {
+        if (dynamic)
+        {
+            std::string deftemplate = "(deftemplate " + get_deftemplate_name() + " (slot item_id (type SYMBOL)) " + get_slot_declaration() + " (slot timestamp (type INTEGER)))";
+            LOG_TRACE(deftemplate);
+            [[maybe_unused]] auto prop_dt = Build(get_env(), deftemplate.c_str());
+            assert(prop_dt == BE_NO_ERROR);
         }
+    }
+    std::shared_ptr<const vector_buffer> vector_property::decode(const json::json &j) const noexcept
+    {
+        if (last_buffer && (j == last_value || j == last_compact))
+            return last_buffer;
+        auto buf = vector_buffer::from_json(j, dtype);
+        if (!buf || (length && buf->size() != *length) || (max_length && buf->size() > *max_length))
+            return nullptr;
+        // the elements are checked against the bounds in a single pass over the buffer..
+        if (!buf->within(min.value_or(-std::numeric_limits<double>::infinity()), max.value_or(std::numeric_limits<double>::infinity())))
+            return nullptr;
+        last_buffer = std::make_shared<const vector_buffer>(std::move(*buf));
+        last_value = j;
+        last_compact = j.is_string() ? j : last_buffer->to_json();
+        return last_buffer;
+    }
+    json::json vector_property::compact(const json::json &j) const noexcept { return decode(j) ? last_compact : j; }
+    bool vector_property::validate(const json::json &j) const noexcept
+    {
+        if (j.is_null())
+            return nullable;
+        return decode(j) != nullptr;
+    }
+    json::json vector_property::to_json() const noexcept
+    {
+        json::json j;
+        j["type"] = vector_kw;
+        j["dtype"] = to_string(dtype);
+        if (length.has_value())
+            j["length"] = *length;
+        if (max_length.has_value())
+            j["max_length"] = *max_length;
+        if (min.has_value())
+            j["min"] = *min;
+        if (max.has_value())
+            j["max"] = *max;
+        return j;
+    }
+    json::json vector_property::fake() const noexcept
+    {
+        std::uniform_int_distribution<std::size_t> dist_size(0, max_length.value_or(16));
+        const auto size = length.value_or(dist_size(get_gen()));
+        std::uniform_real_distribution<double> dist(min.value_or(dtype == vector_dtype::i16 ? std::numeric_limits<int16_t>::min() : -1), max.value_or(dtype == vector_dtype::i16 ? std::numeric_limits<int16_t>::max() : 1));
+        json::json j(json::json_type::array);
+        for (std::size_t i = 0; i < size; ++i)
+            if (dtype == vector_dtype::i16)
+                j.push_back(static_cast<int64_t>(std::ceil(dist(get_gen()))));
+            else
+                j.push_back(dist(get_gen()));
+        return vector_buffer::from_json(j, dtype)->to_json();
+    }
+    void vector_property::set_value(FactBuilder *property_fact_builder, const json::json &value) const noexcept
+    {
+        if (value.is_null())
+        {
+            assert(nullable);
+            [[maybe_unused]] auto put_slot_err = FBPutSlotSymbol(property_fact_builder, name.data(), "nil");
+            assert(put_slot_err == PSE_NO_ERROR);
+        }
+        else
+        { // the slot shares the decoded buffer, which the rules read through the vector-* functions..
+            auto buf = decode(value);
+            assert(buf);
+            [[maybe_unused]] auto put_slot_err = FBPutSlotCLIPSExternalAddress(property_fact_builder, name.data(), get_vector_address(std::move(buf)));
+            assert(put_slot_err == PSE_NO_ERROR);
+        }
+    }
+    void vector_property::set_value(FactModifier *property_fact_modifier, const json::json &value) const noexcept
+    {
+        if (value.is_null())
+        {
+            assert(nullable);
+            [[maybe_unused]] auto put_slot_err = FMPutSlotSymbol(property_fact_modifier, name.data(), "nil");
+            assert(put_slot_err == PSE_NO_ERROR);
+        }
+        else
+        { // the slot shares the decoded buffer, which the rules read through the vector-* functions..
+            auto buf = decode(value);
+            assert(buf);
+            [[maybe_unused]] auto put_slot_err = FMPutSlotCLIPSExternalAddress(property_fact_modifier, name.data(), get_vector_address(std::move(buf)));
+            assert(put_slot_err == PSE_NO_ERROR);
+        }
+    }
+    std::string vector_property::get_slot_declaration() const noexcept
+    {
+        std::string slot_decl = "(slot " + std::string(name);
+        if (!nullable)
+            slot_decl += " (type EXTERNAL-ADDRESS)";
         slot_decl += ')';
         return slot_decl;
     }
@@ -0,0 +1,297 @@
+#include "coco_schema.hpp"
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+
+namespace coco
+{
+    namespace
+    {
+        constexpr uint8_t null_bit = 1, boolean_bit = 2, integer_bit = 4, number_bit = 8, string_bit = 16, array_bit = 32, object_bit = 64;
+
+        [[nodiscard]] uint8_t to_type_bits(const std::string &tp)
+        {
+            if (tp == "null")
+                return null_bit;
+            if (tp == "boolean")
+                return boolean_bit;
+            if (tp == "integer")
+                return integer_bit;
+            if (tp == "number")
+                return integer_bit | number_bit;
+            if (tp == "string")
+                return string_bit;
+            if (tp == "array")
+                return array_bit;
+            if (tp == "object")
+                return object_bit;
+            throw std::invalid_argument("Unknown schema type: " + tp);
+        }
+
+        [[nodiscard]] uint8_t type_bits_of(const json::json &j) noexcept
+        {
+            switch (j.get_type())
+            {
+            case json::json_type::null:
+                return null_bit;
+            case json::json_type::boolean:
+                return boolean_bit;
+            case json::json_type::number: // as for `json::validate`, a float is never an integer, even with no fractional part..
+                return j.is_integer() ? integer_bit | number_bit : number_bit;
+            case json::json_type::string:
+                return string_bit;
+            case json::json_type::array:
+                return array_bit;
+            case json::json_type::object:
+                return object_bit;
+            }
+            return 0;
+        }
+
+        // resolves a `#/...` reference, either a schema name or a JSON pointer, against the schemas..
+        [[nodiscard]] const json::json *resolve(const json::json &schemas, std::string ref) noexcept
+        {
+            if (ref.rfind("#/", 0) != 0)
+                return nullptr;
+            ref.erase(0, 2);
+            if (ref.rfind("components/schemas/", 0) == 0)
+                ref.erase(0, std::string_view("components/schemas/").size());
+            const json::json *cur = &schemas;
+            size_t start = 0;
+            while (start <= ref.size())
+            {
+                const auto end = std::min(ref.find('/', start), ref.size());
+                std::string token;
+                for (size_t i = start; i < end; ++i)
+                    if (ref[i] == '~' && i + 1 < end && (ref[i + 1] == '0' || ref[i + 1] == '1'))
+                        token += ref[++i] == '0' ? '~' : '/';
+                    else
+                        token += ref[i];
+                if (!cur->contains(token))
+                    return nullptr;
+                cur = &(*cur)[token];
+                start = end + 1;
+            }
+            return cur;
+        }
+
+        [[nodiscard]] size_t length_of(const std::string &str) noexcept
+        { // the length of a string is its number of code points..
+            return std::count_if(str.begin(), str.end(), [](char ch)
+                                 { return (static_cast<unsigned char>(ch) & 0xC0) != 0x80; });
+        }
+    } // namespace
+
+    schema_validator::schema_validator(const json::json &schema, const json::json &schemas)
+    {
+        std::unordered_map<std::string, size_t> refs;
+        compile(schema, schemas, refs);
+    }
+
+    size_t schema_validator::compile(const json::json &schema, const json::json &schemas, std::unordered_map<std::string, size_t> &refs)
+    {
+        // nodes may be added while compiling the sub-schemas, so the node is always accessed by index..
+        const size_t n = nodes.size();
+        nodes.emplace_back();
+        if (schema.is_boolean())
+        {
+            if (!schema.get<bool>())
+                nodes[n].types = 0;
+            return n;
+        }
+        if (!schema.is_object())
+            throw std::invalid_argument("Invalid schema: " + schema.dump());
+
+        std::map<std::string, key> keys;
+        bool nullable = false; // the OpenAPI `nullable` keyword widens the `type` keyword, whatever their order..
+        for (const auto &[kw, val] : schema.as_object())
+            if (kw == "$ref")
+            {
+                const auto ref = val.get<std::string>();
+                if (auto it = refs.find(ref); it != refs.end())
+                    nodes[n].ref = it->second;
+                else if (const auto *target = resolve(schemas, ref))
+                { // the reference is registered before being compiled, so that recursive schemas terminate..
+                    refs.emplace(ref, nodes.size());
+                    const auto r = compile(*target, schemas, refs);
+                    nodes[n].ref = r;
+                }
+                else
+                    throw std::invalid_argument("Unresolvable schema reference: " + ref);
+            }
+            else if (kw == "type")
+            {
+                uint8_t types = 0;
+                if (val.is_array())
+                    for (const auto &tp : val.as_array())
+                        types |= to_type_bits(tp.get<std::string>());
+                else
+                    types = to_type_bits(val.get<std::string>());
+                nodes[n].types &= types;
+            }
+            else if (kw == "nullable")
+                nullable = val.get<bool>();
+            else if (kw == "enum" || kw == "const")
+            {
+                nodes[n].enumerated = true;
+                const auto add = [this, n](const json::json &v)
+                {
+                    if (v.is_string())
+                        nodes[n].enum_strings.insert(v.get<std::string>());
+                    else
+                        nodes[n].enum_values.push_back(v);
+                };
+                if (kw == "enum")
+                    for (const auto &v : val.as_array())
+                        add(v);
+                else
+                    add(val);
+            }
+            else if (kw == "minimum")
+                nodes[n].minimum = val.get<double>();
+            else if (kw == "maximum")
+                nodes[n].maximum = val.get<double>();
+            else if (kw == "exclusiveMinimum" && val.is_number())
+                nodes[n].exclusive_minimum = val.get<double>();
+            else if (kw == "exclusiveMaximum" && val.is_number())
+                nodes[n].exclusive_maximum = val.get<double>();
+            else if (kw == "minLength")
+                nodes[n].min_length = val.get<size_t>();
+            else if (kw == "maxLength")
+                nodes[n].max_length = val.get<size_t>();
+            else if (kw == "pattern")
+                try
+                {
+                    nodes[n].pattern.emplace(val.get<std::string>(), std::regex::ECMAScript | std::regex::optimize);
+                }
+                catch (const std::regex_error &)
+                {
+                    throw std::invalid_argument("Invalid schema pattern: " + val.get<std::string>());
+                }
+            else if (kw == "properties")
+                for (const auto &[p_name, p_schema] : val.as_object())
+                {
+                    const auto sub = compile(p_schema, schemas, refs);
+                    keys[p_name].sub = sub;
+                }
+            else if (kw == "required")
+                for (const auto &p_name : val.as_array())
+                    keys[p_name.get<std::string>()].required = true;
+            else if (kw == "additionalProperties")
+            {
+                if (val.is_boolean())
+                    nodes[n].additional = val.get<bool>();
+                else
+                {
+                    const auto sub = compile(val, schemas, refs);
+                    nodes[n].additional_node = sub;
+                }
+            }
+            else if (kw == "items" && !val.is_array())
+            {
+                const auto sub = compile(val, schemas, refs);
+                nodes[n].items = sub;
+            }
+            else if (kw == "minItems")
+                nodes[n].min_items = val.get<size_t>();
+            else if (kw == "maxItems")
+                nodes[n].max_items = val.get<size_t>();
+            else if (kw == "allOf" || kw == "anyOf" || kw == "oneOf")
+                for (const auto &sub_schema : val.as_array())
+                {
+                    const auto sub = compile(sub_schema, schemas, refs);
+                    (kw == "allOf" ? nodes[n].all_of : kw == "anyOf" ? nodes[n].any_of : nodes[n].one_of).push_back(sub);
+                }
+            else if (kw == "not")
+            {
+                const auto sub = compile(val, schemas, refs);
+                nodes[n].not_node = sub;
+            }
+            else if (kw != "description" && kw != "title" && kw != "default" && kw != "examples" && kw != "format" && kw != "$schema" && kw != "$id" && kw != "$comment" && kw != "readOnly" && kw != "writeOnly" && kw != "deprecated")
+                throw std::invalid_argument("Unsupported schema keyword: " + kw);
+
+        if (nullable)
+            nodes[n].types |= null_bit;
+        for (auto &[p_name, k] : keys)
+        {
+            k.name = p_name;
+            if (k.required)
+                ++nodes[n].n_required;
+            nodes[n].keys.push_back(std::move(k));
+        }
+        return n;
+    }
+
+    bool schema_validator::validate(const json::json &j, size_t n) const noexcept
+    {
+        const auto &nd = nodes[n];
+        if (nd.ref && !validate(j, *nd.ref))
+            return false;
+        if (!(nd.types & type_bits_of(j)))
+            return false;
+        if (nd.enumerated && (j.is_string() ? !nd.enum_strings.count(j.get<std::string>()) : std::none_of(nd.enum_values.begin(), nd.enum_values.end(), [&j](const json::json &v)
+                                                                                                                     { return v == j; })))
+            return false;
+
+        switch (j.get_type())
+        {
+        case json::json_type::number:
+        {
+            const auto v = j.get<double>();
+            if ((nd.minimum && v < *nd.minimum) || (nd.maximum && v > *nd.maximum) || (nd.exclusive_minimum && v <= *nd.exclusive_minimum) || (nd.exclusive_maximum && v >= *nd.exclusive_maximum))
+                return false;
+            break;
+        }
+        case json::json_type::string:
+            if (nd.min_length || nd.max_length)
+                if (const auto len = length_of(j.get<std::string>()); (nd.min_length && len < *nd.min_length) || (nd.max_length && len > *nd.max_length))
+                    return false;
+            if (nd.pattern && !std::regex_search(j.get<std::string>(), *nd.pattern))
+                return false;
+            break;
+        case json::json_type::array:
+            if ((nd.min_items && j.size() < *nd.min_items) || (nd.max_items && j.size() > *nd.max_items))
+                return false;
+            if (nd.items)
+                for (const auto &v : j.as_array())
+                    if (!validate(v, *nd.items))
+                        return false;
+            break;
+        case json::json_type::object:
+        {
+            size_t n_required = 0; // the number of required properties found..
+            for (const auto &[p_name, v] : j.as_object())
+            {
+                const auto k = std::lower_bound(nd.keys.begin(), nd.keys.end(), p_name, [](const key &k, const std::string &name)
+                                                { return k.name < name; });
+                const bool found = k != nd.keys.end() && k->name == p_name;
+                if (found && k->required)
+                    ++n_required;
+                if (found && k->sub)
+                {
+                    if (!validate(v, *k->sub))
+                        return false;
+                }
+                else if (!nd.additional || (nd.additional_node && !validate(v, *nd.additional_node)))
+                    return false;
+            }
+            if (n_required != nd.n_required)
+                return false;
+            break;
+        }
+        default:
+            break;
+        }
+
+        if (!std::all_of(nd.all_of.begin(), nd.all_of.end(), [this, &j](size_t sub)
+                         { return validate(j, sub); }))
+            return false;
+        if (!nd.any_of.empty() && std::none_of(nd.any_of.begin(), nd.any_of.end(), [this, &j](size_t sub)
+                                               { return validate(j, sub); }))
+            return false;
+        if (!nd.one_of.empty() && std::count_if(nd.one_of.begin(), nd.one_of.end(), [this, &j](size_t sub)
+                                                { return validate(j, sub); }) != 1)
+            return false;
+        return !nd.not_node || !validate(j, *nd.not_node);
+    }
+} // namespace coco
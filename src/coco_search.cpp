@@ -0,0 +1,81 @@
+#include "coco_search.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+
+namespace coco
+{
+    std::vector<std::string> tokenize(std::string_view text) noexcept
+    {
+        std::vector<std::string> res;
+        std::string token;
+        for (unsigned char ch : text)
+            if (ch >= 0x80 || std::isalnum(ch))
+                token += static_cast<char>(std::tolower(ch));
+            else if (!token.empty())
+            {
+                res.push_back(std::move(token));
+                token.clear();
+            }
+        if (!token.empty())
+            res.push_back(std::move(token));
+        return res;
+    }
+
+    void text_index::insert(const std::string &itm_id, const json::json &val) noexcept
+    {
+        if (val.is_array())
+        {
+            for (const auto &v : val.as_array())
+                insert(itm_id, v);
+            return;
+        }
+        if (!val.is_string())
+            return;
+        for (auto &token : tokenize(val.get<std::string>()))
+        {
+            ++postings[std::move(token)][itm_id];
+            ++tokens[itm_id];
+        }
+    }
+
+    void text_index::erase(const std::string &itm_id, const json::json &val) noexcept
+    {
+        if (val.is_array())
+        {
+            for (const auto &v : val.as_array())
+                erase(itm_id, v);
+            return;
+        }
+        if (!val.is_string())
+            return;
+        for (const auto &token : tokenize(val.get<std::string>()))
+            if (auto it = postings.find(token); it != postings.end())
+                if (auto occ = it->second.find(itm_id); occ != it->second.end())
+                {
+                    if (--occ->second == 0)
+                    {
+                        it->second.erase(occ);
+                        if (it->second.empty())
+                            postings.erase(it);
+                    }
+                    if (auto n = tokens.find(itm_id); --n->second == 0)
+                        tokens.erase(n);
+                }
+    }
+
+    void text_index::search(std::string_view token, const std::function<void(const std::string &, double)> &cb) const noexcept
+    {
+        std::unordered_map<std::string, double> scores;
+        for (auto it = postings.lower_bound(token); it != postings.end() && it->first.compare(0, token.size(), token) == 0; ++it)
+        { // the tokens the prefix covers the most of are more relevant..
+            const double coverage = static_cast<double>(token.size()) / it->first.size();
+            for (const auto &[id, occ] : it->second) // the term frequency is dampened on the length of the indexed values, so that long values are not favoured..
+                scores[id] += occ / std::sqrt(static_cast<double>(tokens.at(id))) * coverage;
+        }
+        // rare tokens are more relevant (inverse document frequency)..
+        const double idf = std::log(1 + static_cast<double>(tokens.size()) / std::max<size_t>(scores.size(), 1));
+        for (const auto &[id, score] : scores)
+            cb(id, score * idf);
+    }
+} // namespace coco
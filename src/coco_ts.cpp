@@ -0,0 +1,661 @@
+#include "coco_ts.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace coco
+{
+    namespace
+    {
+        [[nodiscard]] uint64_t zigzag(int64_t v) noexcept { return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63); }
+        [[nodiscard]] int64_t unzigzag(uint64_t v) noexcept { return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1); }
+
+        [[nodiscard]] unsigned leading_zeros(uint64_t v) noexcept
+        {
+            assert(v);
+#if defined(__GNUC__) || defined(__clang__)
+            return __builtin_clzll(v);
+#else
+            unsigned n = 0;
+            for (uint64_t mask = uint64_t(1) << 63; !(v & mask); mask >>= 1)
+                ++n;
+            return n;
+#endif
+        }
+        [[nodiscard]] unsigned trailing_zeros(uint64_t v) noexcept
+        {
+            assert(v);
+#if defined(__GNUC__) || defined(__clang__)
+            return __builtin_ctzll(v);
+#else
+            unsigned n = 0;
+            for (; !(v & 1); v >>= 1)
+                ++n;
+            return n;
+#endif
+        }
+        [[nodiscard]] unsigned bit_width(uint64_t v) noexcept { return v ? 64 - leading_zeros(v) : 0; }
+
+        [[nodiscard]] uint64_t to_bits(double v) noexcept
+        {
+            uint64_t bits;
+            std::memcpy(&bits, &v, sizeof(bits));
+            return bits;
+        }
+        [[nodiscard]] double from_bits(uint64_t bits) noexcept
+        {
+            double v;
+            std::memcpy(&v, &bits, sizeof(v));
+            return v;
+        }
+
+        /**
+         * Writes a zig-zag encoded value using a prefix code which selects the width of the field: `0` for zero, `10` for 7 bits, `110` for 9 bits, `1110` for 12 bits, `11110` for 32 bits and `11111` for 64 bits.
+         */
+        void write_var(bit_stream &bs, uint64_t v)
+        {
+            if (v == 0)
+                bs.write(0b0, 1);
+            else if (v < (uint64_t(1) << 7))
+            {
+                bs.write(0b10, 2);
+                bs.write(v, 7);
+            }
+            else if (v < (uint64_t(1) << 9))
+            {
+                bs.write(0b110, 3);
+                bs.write(v, 9);
+            }
+            else if (v < (uint64_t(1) << 12))
+            {
+                bs.write(0b1110, 4);
+                bs.write(v, 12);
+            }
+            else if (v < (uint64_t(1) << 32))
+            {
+                bs.write(0b11110, 5);
+                bs.write(v, 32);
+            }
+            else
+            {
+                bs.write(0b11111, 5);
+                bs.write(v, 64);
+            }
+        }
+        [[nodiscard]] uint64_t read_var(bit_stream::reader &r) noexcept
+        {
+            static constexpr unsigned widths[] = {0, 7, 9, 12, 32, 64};
+            unsigned prefix = 0;
+            while (prefix < 5 && r.read_bit())
+                ++prefix;
+            return r.read(widths[prefix]);
+        }
+    } // namespace
+
+    void bit_stream::write(uint64_t bits, unsigned n)
+    {
+        assert(n <= 64);
+        if (n == 0)
+            return;
+        if (n < 64)
+            bits &= (uint64_t(1) << n) - 1;
+        const unsigned used = n_bits % 64;
+        if (used == 0)
+            words.push_back(0);
+        const unsigned free = 64 - used;
+        if (n <= free)
+            words.back() |= bits << (free - n);
+        else
+        {
+            words.back() |= bits >> (n - free);
+            words.push_back(bits << (64 - (n - free)));
+        }
+        n_bits += n;
+    }
+
+    uint64_t bit_stream::reader::read(unsigned n) noexcept
+    {
+        assert(n <= 64 && pos + n <= bs.n_bits);
+        if (n == 0)
+            return 0;
+        const size_t w = pos / 64;
+        const unsigned off = pos % 64, avail = 64 - off;
+        pos += n;
+        if (n <= avail)
+            return (bs.words[w] << off) >> (64 - n);
+        const unsigned rem = n - avail;
+        return ((bs.words[w] & ((uint64_t(1) << avail) - 1)) << rem) | (bs.words[w + 1] >> (64 - rem));
+    }
+
+    ts_chunk::kind ts_chunk::kind_of(const json::json &val) noexcept
+    {
+        switch (val.get_type())
+        {
+        case json::json_type::null:
+            return kind::null;
+        case json::json_type::boolean:
+            return kind::boolean;
+        case json::json_type::number:
+            return val.is_float() ? kind::real : kind::integer;
+        case json::json_type::string:
+            return kind::string;
+        default:
+            return kind::complex;
+        }
+    }
+
+    size_t ts_chunk::bytes() const noexcept
+    {
+        size_t res = sizeof(ts_chunk) + timestamps.bytes() + values.bytes();
+        for (const auto &str : dictionary)
+            res += sizeof(std::string) + str.capacity();
+        for (const auto &[str, _] : codes)
+            res += sizeof(std::string) + sizeof(uint32_t) + str.capacity();
+        return res;
+    }
+
+    void ts_chunk::append(int64_t timestamp, const json::json &val)
+    {
+        assert(!sealed && kind_of(val) == k);
+        assert(count == 0 || timestamp >= last_ts);
+        if (count == 0)
+        {
+            first_ts = timestamp;
+            timestamps.write(zigzag(timestamp), 64);
+        }
+        else
+        { // differences are computed modulo 2^64, so that they never overflow and the decoder's wrapping sums restore the exact values..
+            const auto delta = static_cast<int64_t>(static_cast<uint64_t>(timestamp) - static_cast<uint64_t>(last_ts));
+            write_var(timestamps, zigzag(static_cast<int64_t>(static_cast<uint64_t>(delta) - static_cast<uint64_t>(last_delta))));
+            last_delta = delta;
+        }
+        last_ts = timestamp;
+
+        switch (k)
+        {
+        case kind::null:
+            break;
+        case kind::boolean:
+            values.write(val.get<bool>(), 1);
+            break;
+        case kind::integer:
+        {
+            const auto v = val.get<int64_t>();
+            if (count == 0)
+                values.write(zigzag(v), 64);
+            else
+                write_var(values, zigzag(static_cast<int64_t>(static_cast<uint64_t>(v) - last_bits)));
+            last_bits = static_cast<uint64_t>(v);
+            break;
+        }
+        case kind::real:
+        {
+            const auto bits = to_bits(val.get<double>());
+            if (count == 0)
+                values.write(bits, 64);
+            else if (const auto x = bits ^ last_bits; x == 0)
+                values.write(0b0, 1);
+            else
+            {
+                values.write(0b1, 1);
+                unsigned lz = std::min(leading_zeros(x), 31u), tz = trailing_zeros(x);
+                if (count > 1 && lz >= last_lz && tz >= last_tz)
+                { // the meaningful bits fit within the previous window..
+                    values.write(0b0, 1);
+                    values.write(x >> last_tz, 64 - last_lz - last_tz);
+                }
+                else
+                {
+                    const unsigned len = 64 - lz - tz;
+                    values.write(0b1, 1);
+                    values.write(lz, 5);
+                    values.write(len - 1, 6);
+                    values.write(x >> tz, len);
+                    last_lz = lz;
+                    last_tz = tz;
+                }
+            }
+            last_bits = bits;
+            break;
+        }
+        case kind::string:
+        case kind::complex:
+        {
+            auto str = k == kind::string ? val.get<std::string>() : val.dump();
+            const auto n_codes = dictionary.size();
+            uint32_t code;
+            if (auto it = codes.find(str); it != codes.end())
+                code = it->second;
+            else
+            {
+                code = static_cast<uint32_t>(dictionary.size());
+                codes.emplace(str, code);
+                dictionary.push_back(std::move(str));
+            }
+            if (count > 0 && code == last_code)
+                values.write(0b0, 1);
+            else
+            { // new codes are always the next one, so the field only has to be as wide as the dictionary before this point..
+                values.write(0b1, 1);
+                values.write(code, bit_width(n_codes));
+            }
+            last_code = code;
+            break;
+        }
+        }
+        ++count;
+    }
+
+    void ts_chunk::seal()
+    {
+        sealed = true;
+        codes.clear();
+        timestamps.shrink();
+        values.shrink();
+        dictionary.shrink_to_fit();
+    }
+
+    void ts_chunk::decode(int64_t from, int64_t to, const std::function<void(int64_t, json::json &&)> &cb) const
+    {
+        if (count == 0 || to < first_ts || from > last_ts)
+            return;
+
+        // the timestamps are decoded in two passes: the serial one reads the delta-of-deltas, the branch free one integrates them twice..
+        std::vector<int64_t> ts(count);
+        bit_stream::reader ts_r(timestamps);
+        ts[0] = unzigzag(ts_r.read(64));
+        for (size_t i = 1; i < count; ++i)
+            ts[i] = unzigzag(read_var(ts_r));
+        uint64_t delta = 0;
+        for (size_t i = 1; i < count; ++i)
+        { // the sums wrap around as the encoder's differences do..
+            delta += static_cast<uint64_t>(ts[i]);
+            ts[i] = static_cast<int64_t>(static_cast<uint64_t>(ts[i - 1]) + delta);
+        }
+        // timestamps are sorted within a chunk, so only the values up to the end of the range are decoded and only those within it are materialized..
+        const size_t begin = std::lower_bound(ts.begin(), ts.end(), from) - ts.begin();
+        const size_t end = std::upper_bound(ts.begin(), ts.end(), to) - ts.begin();
+        if (begin >= end)
+            return;
+
+        bit_stream::reader val_r(values);
+        switch (k)
+        {
+        case kind::null:
+            for (size_t i = begin; i < end; ++i)
+                cb(ts[i], json::json(nullptr));
+            break;
+        case kind::boolean:
+        {
+            std::vector<uint8_t> vals(end);
+            for (size_t i = 0; i < end; ++i)
+                vals[i] = val_r.read_bit();
+            for (size_t i = begin; i < end; ++i)
+                cb(ts[i], json::json(vals[i] != 0));
+            break;
+        }
+        case kind::integer:
+        {
+            std::vector<uint64_t> vals(end);
+            vals[0] = static_cast<uint64_t>(unzigzag(val_r.read(64)));
+            for (size_t i = 1; i < end; ++i)
+                vals[i] = static_cast<uint64_t>(unzigzag(read_var(val_r)));
+            for (size_t i = 1; i < end; ++i)
+                vals[i] += vals[i - 1];
+            for (size_t i = begin; i < end; ++i)
+                cb(ts[i], json::json(static_cast<int64_t>(vals[i])));
+            break;
+        }
+        case kind::real:
+        {
+            std::vector<uint64_t> vals(end);
+            vals[0] = val_r.read(64);
+            unsigned lz = 0, tz = 0;
+            for (size_t i = 1; i < end; ++i)
+            {
+                uint64_t x = 0;
+                if (val_r.read_bit())
+                {
+                    if (val_r.read_bit())
+                    {
+                        lz = static_cast<unsigned>(val_r.read(5));
+                        const unsigned len = static_cast<unsigned>(val_r.read(6)) + 1;
+                        tz = 64 - lz - len;
+                    }
+                    x = val_r.read(64 - lz - tz) << tz;
+                }
+                vals[i] = vals[i - 1] ^ x;
+            }
+            for (size_t i = begin; i < end; ++i)
+                cb(ts[i], json::json(from_bits(vals[i])));
+            break;
+        }
+        case kind::string:
+        case kind::complex:
+        {
+            std::vector<uint32_t> vals(end);
+            uint32_t code = 0, n_codes = 0;
+            for (size_t i = 0; i < end; ++i)
+            {
+                if (val_r.read_bit())
+                {
+                    code = static_cast<uint32_t>(val_r.read(bit_width(n_codes)));
+                    if (code == n_codes)
+                        ++n_codes;
+                }
+                vals[i] = code;
+            }
+            for (size_t i = begin; i < end; ++i)
+                cb(ts[i], k == kind::string ? json::json(dictionary[vals[i]]) : json::load(dictionary[vals[i]]));
+            break;
+        }
+        }
+    }
+
+    namespace
+    {
+        [[nodiscard]] size_t estimated_size(const json::json &val) noexcept
+        {
+            switch (val.get_type())
+            {
+            case json::json_type::string:
+                return val.get<std::string>().size();
+            case json::json_type::array:
+            case json::json_type::object:
+                return val.dump().size();
+            default:
+                return 0;
+            }
+        }
+    } // namespace
+
+    void ts_buffer::push(int64_t timestamp, const json::json &val)
+    {
+        if (timestamp < covered_since)
+            return;
+        const size_t bytes = sizeof(point) + estimated_size(val);
+        // points usually come in order, so the insertion point is searched from the back..
+        auto it = points.end();
+        while (it != points.begin() && std::prev(it)->timestamp > timestamp)
+            --it;
+        if (it != points.begin() && std::prev(it)->timestamp == timestamp)
+        {
+            n_bytes -= std::prev(it)->bytes;
+            std::prev(it)->val = val;
+            std::prev(it)->bytes = bytes;
+        }
+        else
+            points.insert(it, point{timestamp, val, bytes});
+        n_bytes += bytes;
+        evict();
+    }
+
+    void ts_buffer::evict() noexcept
+    {
+        while (!points.empty() && (points.size() > capacity || (duration > 0 && points.front().timestamp < points.back().timestamp - duration)))
+        {
+            covered_since = points.front().timestamp + 1;
+            n_bytes -= points.front().bytes;
+            points.pop_front();
+        }
+    }
+
+    void ts_buffer::decode(int64_t from, int64_t to, const std::function<void(int64_t, json::json &&)> &cb) const
+    {
+        for (auto it = std::lower_bound(points.begin(), points.end(), from, [](const point &p, int64_t ts)
+                                        { return p.timestamp < ts; });
+             it != points.end() && it->timestamp <= to; ++it)
+            cb(it->timestamp, json::json(it->val));
+    }
+
+    void ts_stitcher::add(const std::string &name, int64_t timestamp, json::json &&val)
+    {
+        if (!rows.empty() && rows.size() >= keep && timestamp > rows.rbegin()->first)
+            return;
+        rows[timestamp][name] = std::move(val);
+        if (rows.size() > keep)
+            rows.erase(std::prev(rows.end()));
+    }
+
+    std::optional<int64_t> ts_stitcher::flush(const std::function<void(int64_t, json::json &&)> &cb)
+    {
+        std::optional<int64_t> next;
+        if (rows.size() > limit)
+        {
+            next = rows.rbegin()->first;
+            rows.erase(std::prev(rows.end()));
+        }
+        for (auto &[ts, data] : rows)
+            cb(ts, std::move(data));
+        rows.clear();
+        return next;
+    }
+
+    void ts_archive::push(int64_t timestamp, const json::json &val, const std::function<void(int64_t, const json::json &)> &cb)
+    {
+        if (latest && timestamp <= *latest)
+        { // late points are archived as they are, leaving the segment being built untouched..
+            cb(timestamp, val);
+            return;
+        }
+        if (!val.is_number() || !anchor)
+        { // the point starts a new segment..
+            flush(cb);
+            archive(timestamp, val, cb);
+            return;
+        }
+        latest = timestamp;
+        const double v = val.get<double>();
+        if (policy.mode == archive_mode::deadband)
+        {
+            if (std::abs(v - anchor->second) > policy.deviation)
+                archive(timestamp, val, cb);
+            return;
+        }
+
+        const double dt = static_cast<double>(timestamp - anchor->first);
+        const double lo = std::max(lower, (v - policy.deviation - anchor->second) / dt);
+        const double up = std::min(upper, (v + policy.deviation - anchor->second) / dt);
+        if (lo <= up)
+        { // the door is still open..
+            lower = lo;
+            upper = up;
+            held.emplace(timestamp, val);
+            return;
+        }
+        // the door is closed, so the held point ends the segment and the new one starts from it..
+        flush(cb);
+        const double n_dt = static_cast<double>(timestamp - anchor->first);
+        lower = (v - policy.deviation - anchor->second) / n_dt;
+        upper = (v + policy.deviation - anchor->second) / n_dt;
+        held.emplace(timestamp, val);
+    }
+
+    void ts_archive::flush(const std::function<void(int64_t, const json::json &)> &cb)
+    {
+        if (!held)
+            return;
+        auto [h_ts, h_val] = std::move(*held);
+        held.reset();
+        if (anchor)
+        { // any slope within the door interpolates the covered points within the deviation, but the one of the held point might not..
+            const double h_dt = static_cast<double>(h_ts - anchor->first);
+            if (const double slope = (h_val.get<double>() - anchor->second) / h_dt; slope < lower || slope > upper)
+            {
+                const double h_v = anchor->second + (lower + upper) / 2 * h_dt;
+                h_val = h_val.is_integer() ? json::json(static_cast<int64_t>(std::llround(h_v))) : json::json(h_v);
+            }
+        }
+        archive(h_ts, h_val, cb);
+    }
+
+    void ts_archive::archive(int64_t timestamp, const json::json &val, const std::function<void(int64_t, const json::json &)> &cb)
+    {
+        cb(timestamp, val);
+        latest = timestamp;
+        if (val.is_number())
+            anchor.emplace(timestamp, val.get<double>());
+        else
+            anchor.reset();
+        lower = -std::numeric_limits<double>::infinity();
+        upper = std::numeric_limits<double>::infinity();
+    }
+
+    void ts_series::append(int64_t timestamp, const json::json &val)
+    {
+        const auto k = ts_chunk::kind_of(val);
+        if (chunks.empty() || chunks.back().size() >= chunk_size || chunks.back().get_kind() != k || timestamp < chunks.back().get_to())
+        { // out of order points and kind changes start a new chunk, so that each chunk stays sorted and homogeneous..
+            if (!chunks.empty())
+                chunks.back().seal();
+            chunks.emplace_back(k);
+        }
+        chunks.back().append(timestamp, val);
+        ++n_points;
+        // whole chunks are removed, so the series is trimmed only once the oldest one is entirely beyond the maximum..
+        size_t n_removed = 0;
+        while (n_removed < chunks.size() - 1 && n_points - chunks[n_removed].size() >= max_points)
+            n_points -= chunks[n_removed++].size();
+        chunks.erase(chunks.begin(), chunks.begin() + n_removed);
+    }
+
+    void ts_series::decode(int64_t from, int64_t to, const std::function<void(int64_t, json::json &&)> &cb) const
+    {
+        for (const auto &chunk : chunks)
+            if (chunk.get_to() >= from && chunk.get_from() <= to)
+                chunk.decode(from, to, cb);
+    }
+
+    size_t ts_series::expire(int64_t before, size_t limit) noexcept
+    {
+        size_t removed = 0;
+        chunks.erase(std::remove_if(chunks.begin(), chunks.end(), [before, limit, &removed](const ts_chunk &chunk)
+                                    {
+                                        if (chunk.get_to() >= before || removed >= limit)
+                                            return false;
+                                        removed += chunk.size();
+                                        return true; }),
+                     chunks.end());
+        n_points -= removed;
+        return removed;
+    }
+    size_t ts_series::expired(int64_t before) const noexcept
+    {
+        size_t res = 0;
+        for (const auto &chunk : chunks)
+            if (chunk.get_to() < before)
+                res += chunk.size();
+        return res;
+    }
+
+    size_t ts_series::bytes() const noexcept
+    {
+        size_t res = sizeof(ts_series);
+        for (const auto &chunk : chunks)
+            res += chunk.bytes();
+        return res;
+    }
+
+    void ts_store::append(std::string_view itm_id, const json::json &val, const std::chrono::system_clock::time_point &timestamp)
+    {
+        const auto ts = std::chrono::duration_cast<std::chrono::milliseconds>(timestamp.time_since_epoch()).count();
+        auto &itm_series = series[std::string(itm_id)];
+        for (const auto &[name, v] : val.as_object())
+            itm_series.try_emplace(name, chunk_size, max_points).first->second.append(ts, v);
+    }
+
+    json::json ts_store::get_values(std::string_view itm_id, const std::chrono::system_clock::time_point &from, const std::chrono::system_clock::time_point &to) const
+    {
+        json::json res(json::json_type::array);
+        auto itm_series = series.find(std::string(itm_id));
+        if (itm_series == series.end())
+            return res;
+
+        const auto from_ts = std::chrono::duration_cast<std::chrono::milliseconds>(from.time_since_epoch()).count();
+        const auto to_ts = std::chrono::duration_cast<std::chrono::milliseconds>(to.time_since_epoch()).count();
+        // the columns are decoded independently and then stitched back into rows..
+        std::map<int64_t, json::json> rows;
+        for (const auto &[name, s] : itm_series->second)
+            s.decode(from_ts, to_ts, [&rows, &name = name](int64_t ts, json::json &&v)
+                     { rows[ts][name] = std::move(v); });
+        for (auto &[ts, data] : rows)
+            res.push_back(json::json{{"data", std::move(data)}, {"timestamp", ts}});
+        return res;
+    }
+
+    std::optional<int64_t> ts_store::get_values(std::string_view itm_id, const std::vector<std::string> &props, const std::chrono::system_clock::time_point &from, const std::chrono::system_clock::time_point &to, size_t limit, const std::function<void(int64_t, json::json &&)> &cb) const
+    {
+        auto itm_series = series.find(std::string(itm_id));
+        if (itm_series == series.end())
+            return std::nullopt;
+
+        const auto from_ts = std::chrono::duration_cast<std::chrono::milliseconds>(from.time_since_epoch()).count();
+        const auto to_ts = std::chrono::duration_cast<std::chrono::milliseconds>(to.time_since_epoch()).count();
+        ts_stitcher stitcher(limit);
+        for (const auto &[name, s] : itm_series->second)
+            if (props.empty() || std::find(props.begin(), props.end(), name) != props.end())
+                s.decode(from_ts, to_ts, [&stitcher, &name = name](int64_t ts, json::json &&v)
+                         { stitcher.add(name, ts, std::move(v)); });
+        return stitcher.flush(cb);
+    }
+
+    void ts_store::scan(std::string_view itm_id, const std::vector<std::string> &props, const std::chrono::system_clock::time_point &from, const std::chrono::system_clock::time_point &to, const std::function<void(const std::string &, int64_t, json::json &&)> &cb) const
+    {
+        auto itm_series = series.find(std::string(itm_id));
+        if (itm_series == series.end())
+            return;
+
+        const auto from_ts = std::chrono::duration_cast<std::chrono::milliseconds>(from.time_since_epoch()).count();
+        const auto to_ts = std::chrono::duration_cast<std::chrono::milliseconds>(to.time_since_epoch()).count();
+        for (const auto &[name, s] : itm_series->second)
+            if (props.empty() || std::find(props.begin(), props.end(), name) != props.end())
+                s.decode(from_ts, to_ts, [&cb, &name = name](int64_t ts, json::json &&v)
+                         { cb(name, ts, std::move(v)); });
+    }
+
+    size_t ts_store::expire(std::string_view itm_id, const std::chrono::system_clock::time_point &before, size_t limit) noexcept
+    {
+        auto itm_series = series.find(std::string(itm_id));
+        if (itm_series == series.end())
+            return 0;
+        const auto before_ts = std::chrono::duration_cast<std::chrono::milliseconds>(before.time_since_epoch()).count();
+        size_t removed = 0;
+        for (auto &[_, s] : itm_series->second)
+            if (removed < limit)
+                removed += s.expire(before_ts, limit - removed);
+        return removed;
+    }
+    size_t ts_store::expired(std::string_view itm_id, const std::chrono::system_clock::time_point &before) const noexcept
+    {
+        auto itm_series = series.find(std::string(itm_id));
+        if (itm_series == series.end())
+            return 0;
+        const auto before_ts = std::chrono::duration_cast<std::chrono::milliseconds>(before.time_since_epoch()).count();
+        size_t res = 0;
+        for (const auto &[_, s] : itm_series->second)
+            res += s.expired(before_ts);
+        return res;
+    }
+
+    size_t ts_store::size() const noexcept
+    {
+        size_t res = 0;
+        for (const auto &[_, itm_series] : series)
+            for (const auto &[__, s] : itm_series)
+                res += s.size();
+        return res;
+    }
+    size_t ts_store::bytes() const noexcept
+    {
+        size_t res = 0;
+        for (const auto &[id, itm_series] : series)
+        {
+            res += id.capacity();
+            for (const auto &[name, s] : itm_series)
+                res += name.capacity() + s.bytes();
+        }
+        return res;
+    }
+} // namespace coco
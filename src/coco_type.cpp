@@ -2,6 +2,8 @@
 #include "coco.hpp"
 #include "coco_property.hpp"
 #include "coco_item.hpp"
+#include "coco_geo.hpp"
+#include "coco_column.hpp"
 #include "logging.hpp"
 #include <queue>
 #include <cassert>
@@ -17,7 +19,7 @@ namespace coco
     type::type(coco &cc, std::string_view name, json::json &&data) noexcept : cc(cc), name(name), data(std::move(data)) {}
     type::~type()
     {
-        for (const auto &id : instances)
+        for (const auto &[id, _] : instances)
             cc.items.erase(id);
         auto dt = FindDeftemplate(cc.env, name.c_str());
         assert(dt);
@@ -28,6 +30,10 @@ namespace coco
 
     void type::set_properties(json::json &&static_props, json::json &&dynamic_props) noexcept
     {
+        std::vector<std::pair<size_t, json::json>> values; // the values of the static properties survive the redefinition of the columns..
+        for (size_t row = 0; row < rows.size(); ++row)
+            if (rows[row])
+                values.emplace_back(row, get_values(row));
         if (!static_properties.empty() || !dynamic_properties.empty())
         { // Remove existing deftemplate..
             auto dt = FindDeftemplate(cc.env, name.c_str());
@@ -37,12 +43,38 @@ namespace coco
             assert(undef_dt);
             static_properties.clear();
             dynamic_properties.clear();
+            indexes.clear();
+            text_indexes.clear();
+            columns.clear();
         }
 
         for (auto &[name, prop] : static_props.as_object())
-            static_properties.emplace(name, cc.get_property_type(prop["type"].get<std::string>()).new_instance(*this, false, name, prop));
+        {
+            auto &p = static_properties.emplace(name, cc.get_property_type(prop["type"].get<std::string>()).new_instance(*this, false, name, prop)).first->second;
+            columns.emplace(name, p->new_column()).first->second->resize(rows.size());
+            if (prop.contains("index"))
+                try
+                {
+                    indexes.emplace(name, std::make_unique<property_index>(to_index_kind(prop["index"].get<std::string>())));
+                }
+                catch (const std::exception &e)
+                {
+                    LOG_WARN("Ignoring the index of property " + name + " for type " + this->name + ": " + e.what());
+                }
+            if (prop.contains("search") && prop["search"].is_boolean() && prop["search"].get<bool>())
+            {
+                if (const auto &pt_name = prop["type"].get<std::string>(); pt_name == string_kw || pt_name == symbol_kw)
+                    text_indexes[name];
+                else
+                    LOG_WARN("Ignoring the search of property " + name + " for type " + this->name + ": only string and symbol properties are searchable");
+            }
+        }
         for (auto &[name, prop] : dynamic_props.as_object())
             dynamic_properties.emplace(name, cc.get_property_type(prop["type"].get<std::string>()).new_instance(*this, true, name, prop));
+        for (const auto &props : {&static_properties, &dynamic_properties}) // geographic properties are always spatially indexed..
+            for (const auto &[name, prop] : *props)
+                if (prop->get_property_type().get_name() == geo_kw)
+                    indexes.emplace(name, std::make_unique<geo_index>());
 
         std::string deftemplate = "(deftemplate " + get_name() + " (slot item_id (type SYMBOL))";
         for (const auto &[name, prop] : static_properties)
@@ -54,25 +86,180 @@ namespace coco
         [[maybe_unused]] auto prop_dt = Build(cc.env, deftemplate.c_str());
         assert(prop_dt == BE_NO_ERROR);
 
+        for (auto &[row, vals] : values)
+            for (const auto &[p_name, val] : vals.as_object())
+                if (auto col = columns.find(p_name); col != columns.end() && static_properties.at(p_name)->validate(val))
+                    col->second->set(row, val);
+                else if (!is_held_elsewhere(*rows[row], p_name)) // the value is kept by the item itself..
+                    rows[row]->properties[p_name] = val;
+        for (const auto &itm : get_instances())
+        {
+            store(itm.get());
+            index(itm.get());
+        }
+
         CREATED_TYPE(*this);
     }
 
+    const item_index *type::get_index(std::string_view name) const noexcept
+    {
+        if (auto it = indexes.find(name); it != indexes.end())
+            return it->second.get();
+        return nullptr;
+    }
+
     std::vector<std::reference_wrapper<item>> type::get_instances() const noexcept
     {
         std::vector<std::reference_wrapper<item>> res;
-        for (const auto &id : instances)
-            res.emplace_back(cc.get_item(id));
+        res.reserve(instances.size());
+        for (auto *itm : rows)
+            if (itm)
+                res.emplace_back(*itm);
+        return res;
+    }
+    std::vector<std::reference_wrapper<item>> type::get_instances(const std::vector<item_filter> &filters) const noexcept
+    {
+        std::vector<bool> selected(rows.size());
+        for (size_t row = 0; row < rows.size(); ++row)
+            selected[row] = rows[row] != nullptr;
+        for (const auto &f : filters)
+            if (auto col = columns.find(f.property); col != columns.end())
+                col->second->filter(f, selected);
+        std::vector<std::reference_wrapper<item>> res;
+        for (size_t row = 0; row < rows.size(); ++row)
+            if (selected[row])
+                res.emplace_back(*rows[row]);
         return res;
     }
+    bool type::has_instances(const json::json &itm_ids) const noexcept
+    {
+        if (!itm_ids.is_array())
+            return false;
+        for (const auto &itm_id : itm_ids.as_array())
+            if (!itm_id.is_string() || !instances.count(itm_id.get<std::string>()))
+                return false;
+        return true;
+    }
     void type::add_instance(item &itm) noexcept
     {
+        cc.remove_referrers(itm); // the referencing properties depend on the types of the item..
+        size_t row = rows.size();
+        if (free_rows.empty())
+        {
+            rows.push_back(&itm);
+            for (auto &[_, col] : columns)
+                col->resize(rows.size());
+        }
+        else
+        {
+            row = free_rows.back();
+            free_rows.pop_back();
+            rows[row] = &itm;
+        }
+        instances.emplace(itm.get_id(), row);
         itm.add_type(*this);
-        instances.emplace(itm.get_id());
+        store(itm);
+        index(itm);
+        cc.add_referrers(itm);
     }
     void type::remove_instance(item &itm) noexcept
     {
+        cc.remove_referrers(itm);
+        unindex(itm);
+        const auto row = instances.at(itm.get_id());
+        for (auto &[p_name, col] : columns)
+            if (!col->is_null(row) && !is_held_elsewhere(itm, p_name)) // the values held by no other type of the item are kept by the item itself..
+                itm.properties[p_name] = col->get(row);
         itm.remove_type(*this);
+        for (auto &[p_name, col] : columns)
+            col->set(row, nullptr);
+        rows[row] = nullptr;
+        free_rows.push_back(row);
         instances.erase(itm.get_id());
+        cc.add_referrers(itm);
+    }
+
+    json::json type::get_values(size_t row) const noexcept
+    {
+        json::json vals;
+        for (const auto &[p_name, col] : columns)
+            if (!col->is_null(row))
+                vals[p_name] = col->get(row);
+        return vals;
+    }
+    json::json type::get_value(const item &itm, const std::string &p_name) const noexcept
+    {
+        if (auto col = columns.find(p_name); col != columns.end())
+            if (auto row = instances.find(itm.get_id()); row != instances.end() && !col->second->is_null(row->second))
+                return col->second->get(row->second);
+        return json::json();
+    }
+    void type::set_value(const item &itm, const std::string &p_name, const json::json &val) noexcept { columns.at(p_name)->set(instances.at(itm.get_id()), val); }
+    void type::store(item &itm) noexcept
+    {
+        const auto row = instances.at(itm.get_id());
+        for (auto &[p_name, col] : columns)
+            if (col->is_null(row))
+                if (const auto val = itm.get_property_value(p_name); !val.is_null() && static_properties.at(p_name)->validate(val))
+                    col->set(row, val);
+        for (auto &[p_name, col] : columns) // the item no longer keeps the values held by the columns..
+            if (!col->is_null(row))
+                itm.properties.erase(p_name);
+    }
+    bool type::is_held_elsewhere(const item &itm, const std::string &p_name) const noexcept
+    {
+        for (const auto &[tp_name, _] : itm.item_facts)
+            if (const auto &tp = cc.get_type(tp_name); &tp != this)
+                if (auto col = tp.columns.find(p_name); col != tp.columns.end() && !col->second->is_null(tp.instances.at(itm.get_id())))
+                    return true;
+        return false;
+    }
+
+    void type::index(const item &itm) noexcept
+    {
+        index(itm, false);
+        index(itm, true);
+    }
+    void type::index(const item &itm, bool dynamic) noexcept
+    {
+        if (dynamic)
+        {
+            if (const auto &val = itm.get_value())
+                for (auto &[name, idx] : indexes)
+                    if (dynamic_properties.count(name) && val->first.contains(name))
+                        idx->insert(itm.get_id(), val->first[name]);
+            return;
+        }
+        const auto row = instances.at(itm.get_id());
+        for (auto &[name, idx] : indexes)
+            if (auto col = columns.find(name); col != columns.end() && !col->second->is_null(row))
+                idx->insert(itm.get_id(), col->second->get(row));
+        for (auto &[name, idx] : text_indexes)
+            if (auto col = columns.find(name); col != columns.end() && !col->second->is_null(row))
+                idx.insert(itm.get_id(), col->second->get(row));
+    }
+    void type::unindex(const item &itm) noexcept
+    {
+        unindex(itm, false);
+        unindex(itm, true);
+    }
+    void type::unindex(const item &itm, bool dynamic) noexcept
+    {
+        if (dynamic)
+        {
+            if (const auto &val = itm.get_value())
+                for (auto &[name, idx] : indexes)
+                    if (dynamic_properties.count(name) && val->first.contains(name))
+                        idx->erase(itm.get_id(), val->first[name]);
+            return;
+        }
+        const auto row = instances.at(itm.get_id());
+        for (auto &[name, idx] : indexes)
+            if (auto col = columns.find(name); col != columns.end() && !col->second->is_null(row))
+                idx->erase(itm.get_id(), col->second->get(row));
+        for (auto &[name, idx] : text_indexes)
+            if (auto col = columns.find(name); col != columns.end() && !col->second->is_null(row))
+                idx.erase(itm.get_id(), col->second->get(row));
     }
 
     [[nodiscard]] json::json type::to_json() const noexcept
@@ -84,7 +271,13 @@ namespace coco
         {
             json::json static_properties_json;
             for (const auto &[name, p] : static_properties)
+            {
                 static_properties_json[name] = p->to_json();
+                if (auto idx = dynamic_cast<const property_index *>(get_index(name)))
+                    static_properties_json[name]["index"] = idx->get_kind() == index_kind::hash ? "hash" : "ordered";
+                if (text_indexes.count(name))
+                    static_properties_json[name]["search"] = true;
+            }
             j["static_properties"] = std::move(static_properties_json);
         }
         if (!dynamic_properties.empty())
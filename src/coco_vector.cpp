@@ -0,0 +1,284 @@
+#include "coco_vector.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+namespace coco
+{
+    namespace
+    {
+        constexpr const char *base64_chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        constexpr size_t lanes = 8; // the number of independent accumulators, so that the reductions do not depend on a single register..
+
+        [[nodiscard]] int base64_value(char ch) noexcept
+        {
+            if (ch >= 'A' && ch <= 'Z')
+                return ch - 'A';
+            if (ch >= 'a' && ch <= 'z')
+                return ch - 'a' + 26;
+            if (ch >= '0' && ch <= '9')
+                return ch - '0' + 52;
+            if (ch == '+')
+                return 62;
+            if (ch == '/')
+                return 63;
+            return -1;
+        }
+
+        template <typename T>
+        [[nodiscard]] std::optional<std::vector<T>> to_elements(const json::json &j) noexcept
+        {
+            if (j.is_string())
+            { // the elements are copied as they are, assuming a little-endian host..
+                const auto bytes = from_base64(j.get<std::string>());
+                if (!bytes || bytes->size() % sizeof(T))
+                    return std::nullopt;
+                std::vector<T> elems(bytes->size() / sizeof(T));
+                std::memcpy(elems.data(), bytes->data(), bytes->size());
+                if constexpr (std::is_floating_point_v<T>)
+                    if (!std::all_of(elems.begin(), elems.end(), [](T x)
+                                     { return std::isfinite(x); }))
+                        return std::nullopt;
+                return elems;
+            }
+            if (!j.is_array())
+                return std::nullopt;
+            std::vector<T> elems;
+            elems.reserve(j.size());
+            for (const auto &v : j.as_array())
+            {
+                if (!v.is_number())
+                    return std::nullopt;
+                if constexpr (std::is_integral_v<T>)
+                {
+                    const auto d = v.get<double>();
+                    if (std::floor(d) != d || d < std::numeric_limits<T>::min() || d > std::numeric_limits<T>::max())
+                        return std::nullopt;
+                    elems.push_back(static_cast<T>(d));
+                }
+                else
+                { // the values beyond the range of the element type would become infinities..
+                    const auto x = static_cast<T>(v.get<double>());
+                    if (!std::isfinite(x))
+                        return std::nullopt;
+                    elems.push_back(x);
+                }
+            }
+            return elems;
+        }
+
+        template <typename T>
+        [[nodiscard]] bool all_within(const T *v, size_t n, double min, double max) noexcept
+        { // the comparisons are combined rather than short-circuited, so that the loop has no branches..
+            bool ok = true;
+            for (size_t i = 0; i < n; ++i)
+            {
+                const double x = static_cast<double>(v[i]);
+                ok &= (x >= min) & (x <= max);
+            }
+            return ok;
+        }
+
+        template <typename T, typename F>
+        [[nodiscard]] double sum_of(const T *v, size_t n, F f) noexcept
+        {
+            double acc[lanes] = {};
+            size_t i = 0;
+            for (; i + lanes <= n; i += lanes)
+                for (size_t l = 0; l < lanes; ++l)
+                    acc[l] += f(static_cast<double>(v[i + l]));
+            double res = 0;
+            for (; i < n; ++i)
+                res += f(static_cast<double>(v[i]));
+            for (size_t l = 0; l < lanes; ++l)
+                res += acc[l];
+            return res;
+        }
+
+        template <typename T>
+        [[nodiscard]] double max_abs(const T *v, size_t n) noexcept
+        {
+            double acc[lanes] = {};
+            size_t i = 0;
+            for (; i + lanes <= n; i += lanes)
+                for (size_t l = 0; l < lanes; ++l)
+                    acc[l] = std::max(acc[l], std::abs(static_cast<double>(v[i + l])));
+            double res = 0;
+            for (; i < n; ++i)
+                res = std::max(res, std::abs(static_cast<double>(v[i])));
+            for (size_t l = 0; l < lanes; ++l)
+                res = std::max(res, acc[l]);
+            return res;
+        }
+    } // namespace
+
+    std::optional<vector_dtype> to_vector_dtype(std::string_view name) noexcept
+    {
+        if (name == "f32")
+            return vector_dtype::f32;
+        if (name == "f64")
+            return vector_dtype::f64;
+        if (name == "i16")
+            return vector_dtype::i16;
+        return std::nullopt;
+    }
+    const char *to_string(vector_dtype dtype) noexcept
+    {
+        switch (dtype)
+        {
+        case vector_dtype::f32:
+            return "f32";
+        case vector_dtype::f64:
+            return "f64";
+        case vector_dtype::i16:
+            return "i16";
+        }
+        return "";
+    }
+
+    std::string to_base64(const void *data, size_t size) noexcept
+    {
+        const auto *bytes = static_cast<const unsigned char *>(data);
+        std::string str;
+        str.reserve((size + 2) / 3 * 4);
+        size_t i = 0;
+        for (; i + 3 <= size; i += 3)
+        {
+            const uint32_t triple = (bytes[i] << 16) | (bytes[i + 1] << 8) | bytes[i + 2];
+            str += base64_chars[(triple >> 18) & 0x3F];
+            str += base64_chars[(triple >> 12) & 0x3F];
+            str += base64_chars[(triple >> 6) & 0x3F];
+            str += base64_chars[triple & 0x3F];
+        }
+        if (i < size)
+        {
+            const uint32_t triple = (bytes[i] << 16) | (i + 1 < size ? bytes[i + 1] << 8 : 0);
+            str += base64_chars[(triple >> 18) & 0x3F];
+            str += base64_chars[(triple >> 12) & 0x3F];
+            str += i + 1 < size ? base64_chars[(triple >> 6) & 0x3F] : '=';
+            str += '=';
+        }
+        return str;
+    }
+    std::optional<std::string> from_base64(std::string_view str) noexcept
+    {
+        while (!str.empty() && str.back() == '=')
+            str.remove_suffix(1);
+        if (str.size() % 4 == 1)
+            return std::nullopt;
+        std::string bytes;
+        bytes.reserve(str.size() * 3 / 4);
+        uint32_t acc = 0;
+        int bits = 0;
+        for (char ch : str)
+        {
+            const auto v = base64_value(ch);
+            if (v < 0)
+                return std::nullopt;
+            acc = (acc << 6) | static_cast<uint32_t>(v);
+            bits += 6;
+            if (bits >= 8)
+            {
+                bits -= 8;
+                bytes += static_cast<char>((acc >> bits) & 0xFF);
+            }
+        }
+        return bytes;
+    }
+
+    std::optional<vector_buffer> vector_buffer::from_json(const json::json &j, vector_dtype dtype) noexcept
+    {
+        vector_buffer buf;
+        switch (dtype)
+        {
+        case vector_dtype::f32:
+            if (auto elems = to_elements<float>(j))
+                buf.data = std::move(*elems);
+            else
+                return std::nullopt;
+            break;
+        case vector_dtype::f64:
+            if (auto elems = to_elements<double>(j))
+                buf.data = std::move(*elems);
+            else
+                return std::nullopt;
+            break;
+        case vector_dtype::i16:
+            if (auto elems = to_elements<int16_t>(j))
+                buf.data = std::move(*elems);
+            else
+                return std::nullopt;
+            break;
+        }
+        return buf;
+    }
+
+    json::json vector_buffer::to_json() const noexcept
+    {
+        return std::visit([](const auto &elems)
+                          { return json::json(to_base64(elems.data(), elems.size() * sizeof(elems[0]))); }, data);
+    }
+
+    size_t vector_buffer::size() const noexcept
+    {
+        return std::visit([](const auto &elems)
+                          { return elems.size(); }, data);
+    }
+    double vector_buffer::operator[](size_t i) const noexcept
+    {
+        return std::visit([i](const auto &elems)
+                          { return static_cast<double>(elems[i]); }, data);
+    }
+
+    bool vector_buffer::within(double min, double max) const noexcept
+    {
+        return std::visit([min, max](const auto &elems)
+                          { return all_within(elems.data(), elems.size(), min, max); }, data);
+    }
+    double vector_buffer::norm(double p) const noexcept
+    {
+        return std::visit([p](const auto &elems)
+                          {
+                              if (std::isinf(p))
+                                  return max_abs(elems.data(), elems.size());
+                              if (p == 1)
+                                  return sum_of(elems.data(), elems.size(), [](double x)
+                                                { return std::abs(x); });
+                              if (p == 2)
+                                  return std::sqrt(sum_of(elems.data(), elems.size(), [](double x)
+                                                          { return x * x; }));
+                              return std::pow(sum_of(elems.data(), elems.size(), [p](double x)
+                                                     { return std::pow(std::abs(x), p); }),
+                                              1 / p); }, data);
+    }
+    double vector_buffer::band_energy(size_t from, size_t to) const noexcept
+    {
+        return std::visit([from, to](const auto &elems)
+                          {
+                              const auto end = std::min(to, elems.size());
+                              if (from >= end)
+                                  return 0.0;
+                              return sum_of(elems.data() + from, end - from, [](double x)
+                                            { return x * x; }); }, data);
+    }
+    std::vector<size_t> vector_buffer::peaks(double threshold) const noexcept
+    {
+        return std::visit([threshold](const auto &elems)
+                          {
+                              std::vector<size_t> res;
+                              const size_t n = elems.size();
+                              for (size_t i = 1; i + 1 < n; ++i)
+                                  if (elems[i] > elems[i - 1] && static_cast<double>(elems[i]) >= threshold)
+                                  { // a plateau is a peak, at its start, if the first different element is lower..
+                                      size_t j = i + 1;
+                                      while (j < n && elems[j] == elems[i])
+                                          ++j;
+                                      if (j < n && elems[j] < elems[i])
+                                          res.push_back(i);
+                                      i = j - 1;
+                                  }
+                              return res; }, data);
+    }
+} // namespace coco
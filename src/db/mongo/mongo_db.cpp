@@ -2,12 +2,70 @@
 #include "logging.hpp"
 #include "crypto.hpp"
 #include <mongocxx/client.hpp>
-#include <bsoncxx/json.hpp>
 #include <bsoncxx/builder/stream/document.hpp>
+#include <mongocxx/bulk_write.hpp>
+#include <mongocxx/exception/bulk_write_exception.hpp>
+#include <bsoncxx/exception/exception.hpp>
+#include <algorithm>
 #include <cassert>
+#include <limits>
 
 namespace coco
 {
+    namespace
+    {
+        /**
+         * Converts an item ID into a MongoDB object ID, raising an `std::invalid_argument` if the ID is not valid.
+         */
+        [[nodiscard]] bsoncxx::oid to_oid(std::string_view itm_id)
+        {
+            try
+            {
+                return bsoncxx::oid{bsoncxx::stdx::string_view{itm_id.data(), itm_id.size()}};
+            }
+            catch (const bsoncxx::exception &)
+            {
+                throw std::invalid_argument("Invalid item ID: " + std::string(itm_id));
+            }
+        }
+
+        /**
+         * Writes the operations in an ordered bulk write, returning those which have not been written along with the reason.
+         *
+         * A transient failure leaves every operation unwritten. A write error, instead, rejects a single operation: those preceding it have been applied, so only the following ones are returned, while the rejected one is discarded.
+         */
+        [[nodiscard]] std::vector<mongocxx::model::write> bulk_write(mongocxx::collection collection, std::vector<mongocxx::model::write> &&ops, std::string &error)
+        {
+            if (ops.empty())
+                return {};
+            try
+            {
+                auto bulk = collection.create_bulk_write(mongocxx::options::bulk_write{}.ordered(true));
+                for (const auto &op : ops)
+                    bulk.append(op);
+                bulk.execute();
+                return {};
+            }
+            catch (const mongocxx::bulk_write_exception &e)
+            {
+                error = e.what();
+                if (const auto &reply = e.raw_server_error(); reply)
+                    if (const auto w_errs = reply->view()["writeErrors"]; w_errs && w_errs.type() == bsoncxx::type::k_array && !w_errs.get_array().value.empty())
+                    {
+                        const auto idx = static_cast<size_t>(w_errs.get_array().value[0]["index"].get_int32().value);
+                        LOG_ERR("Discarding operation " << idx << " on " << collection.name() << ": " << e.what());
+                        return std::vector<mongocxx::model::write>(std::make_move_iterator(ops.begin() + std::min(idx + 1, ops.size())), std::make_move_iterator(ops.end()));
+                    }
+                return std::move(ops);
+            }
+            catch (const std::exception &e)
+            {
+                error = e.what();
+                return std::move(ops);
+            }
+        }
+    } // namespace
+
     mongo_module::mongo_module(mongo_db &db) noexcept : db_module(db) {}
     [[nodiscard]] mongocxx::v_noabi::pool::entry mongo_module::get_client() const noexcept { return static_cast<mongo_db &>(db).pool.acquire(); }
 
@@ -25,6 +83,13 @@ namespace coco
             LOG_DEBUG("Creating indexes for item data collection");
             item_data_collection.create_index(bsoncxx::builder::stream::document{} << "item_id" << 1 << "timestamp" << 1 << bsoncxx::builder::stream::finalize, mongocxx::options::index{}.unique(true));
         }
+        auto item_rollups_collection = db[item_rollups_collection_name];
+        assert(item_rollups_collection);
+        if (item_rollups_collection.list_indexes().begin() == item_rollups_collection.list_indexes().end())
+        {
+            LOG_DEBUG("Creating indexes for item rollups collection");
+            item_rollups_collection.create_index(bsoncxx::builder::stream::document{} << "item_id" << 1 << "resolution" << 1 << "timestamp" << 1 << bsoncxx::builder::stream::finalize, mongocxx::options::index{}.unique(true));
+        }
         auto rules_collection = db[rules_collection_name];
         assert(rules_collection);
         if (rules_collection.list_indexes().begin() == rules_collection.list_indexes().end())
@@ -32,6 +97,176 @@ namespace coco
             LOG_DEBUG("Creating indexes for rules collection");
             rules_collection.create_index(bsoncxx::builder::stream::document{} << "name" << 1 << bsoncxx::builder::stream::finalize, mongocxx::options::index{}.unique(true));
         }
+
+        flusher = std::thread([this]
+                              {
+            std::unique_lock<std::mutex> lock(batch_mtx);
+            while (running)
+            {
+                batch_cv.wait_for(lock, std::chrono::milliseconds(MONGODB_FLUSH_INTERVAL), [this]
+                                  { return !running || pending_size() >= MONGODB_BULK_SIZE; });
+                lock.unlock();
+                try
+                {
+                    flush();
+                }
+                catch (const std::exception &e)
+                { // the unwritten operations are back in the queues, to be retried with the next flush..
+                    LOG_ERR(e.what());
+                }
+                lock.lock();
+            } });
+    }
+    mongo_db::~mongo_db()
+    {
+        stop_compactor(); // the compactor uses the pool, so it must be stopped first..
+        {
+            std::lock_guard<std::mutex> _(batch_mtx);
+            running = false;
+        }
+        batch_cv.notify_one();
+        flusher.join();
+        try
+        {
+            flush_archives(); // the points held back by the archives are written too..
+            flush();
+        }
+        catch (const std::exception &e)
+        {
+            LOG_ERR(e.what());
+        }
+    }
+
+    void mongo_db::flush()
+    {
+        std::lock_guard<std::mutex> _(flush_mtx);
+        std::vector<mongocxx::model::write> items_ops, data_ops, rollups_ops;
+        std::unordered_map<std::string, std::pair<json::json, std::chrono::system_clock::time_point>> values_ops;
+        std::map<std::tuple<std::string, int64_t, int64_t>, std::map<std::string, db_rollup>> rollups;
+        {
+            std::lock_guard<std::mutex> lock(batch_mtx);
+            std::swap(items_ops, pending_items);
+            std::swap(values_ops, pending_values);
+            std::swap(data_ops, pending_data);
+            std::swap(rollups_ops, pending_rollup_ops);
+            std::swap(rollups, pending_rollups);
+        }
+        if (items_ops.empty() && values_ops.empty() && data_ops.empty() && rollups_ops.empty() && rollups.empty())
+            return;
+
+        // the coalesced values are written after the other item operations, as they never concern deleted items..
+        for (const auto &[itm_id, val] : values_ops)
+            try
+            {
+                bsoncxx::builder::basic::document update_fields;
+                for (const auto &[nm, v] : val.first.as_object())
+                    append_bson(update_fields, "value.data." + nm, v);
+                update_fields.append(bsoncxx::builder::basic::kvp("value.timestamp", bsoncxx::types::b_date{val.second}));
+                bsoncxx::builder::basic::document update_doc;
+                update_doc.append(bsoncxx::builder::basic::kvp("$set", update_fields.view()));
+                items_ops.emplace_back(mongocxx::model::update_one{bsoncxx::builder::basic::make_document(bsoncxx::builder::basic::kvp("_id", to_oid(itm_id))), update_doc.extract()});
+            }
+            catch (const std::exception &e)
+            {
+                LOG_ERR("Discarding the value of item " << itm_id << ": " << e.what());
+            }
+
+        // each rollup is folded into its bucket by an update tagged with the ID of the flush, so that retrying it never counts its values twice..
+        const auto flush_id = bsoncxx::oid();
+        for (const auto &[key, props] : rollups)
+            try
+            {
+                const auto &[itm_id, resolution, bucket] = key;
+                const auto bucket_filter = [&itm_id = itm_id, &resolution = resolution, &bucket = bucket]()
+                {
+                    bsoncxx::builder::basic::document filter_doc;
+                    filter_doc.append(bsoncxx::builder::basic::kvp("item_id", to_oid(itm_id)));
+                    filter_doc.append(bsoncxx::builder::basic::kvp("resolution", resolution));
+                    filter_doc.append(bsoncxx::builder::basic::kvp("timestamp", bsoncxx::types::b_date{std::chrono::milliseconds{bucket}}));
+                    return filter_doc;
+                };
+                bsoncxx::builder::basic::document inc_fields, min_fields, max_fields;
+                for (const auto &[nm, r] : props)
+                {
+                    inc_fields.append(bsoncxx::builder::basic::kvp("data." + nm + ".count", static_cast<int64_t>(r.count)));
+                    inc_fields.append(bsoncxx::builder::basic::kvp("data." + nm + ".sum", r.sum));
+                    min_fields.append(bsoncxx::builder::basic::kvp("data." + nm + ".min", r.min));
+                    max_fields.append(bsoncxx::builder::basic::kvp("data." + nm + ".max", r.max));
+                    max_fields.append(bsoncxx::builder::basic::kvp("data." + nm + ".last", bsoncxx::builder::basic::make_document(bsoncxx::builder::basic::kvp("t", r.last_timestamp), bsoncxx::builder::basic::kvp("v", r.last))));
+                }
+                // the bucket is created first, as the update skips the buckets which already went through this flush..
+                mongocxx::model::update_one create{bucket_filter().extract(), bsoncxx::builder::basic::make_document(bsoncxx::builder::basic::kvp("$setOnInsert", bsoncxx::builder::basic::make_document(bsoncxx::builder::basic::kvp("flushes", bsoncxx::builder::basic::make_array()))))};
+                create.upsert(true);
+
+                // the bucket keeps the IDs of the flushes which might still be retried, that is the last `MONGODB_FLUSH_RETRIES + 1` ones..
+                auto filter_doc = bucket_filter();
+                filter_doc.append(bsoncxx::builder::basic::kvp("flushes", bsoncxx::builder::basic::make_document(bsoncxx::builder::basic::kvp("$ne", flush_id))));
+                bsoncxx::builder::basic::document update_doc;
+                update_doc.append(bsoncxx::builder::basic::kvp("$inc", inc_fields.view()));
+                update_doc.append(bsoncxx::builder::basic::kvp("$min", min_fields.view()));
+                update_doc.append(bsoncxx::builder::basic::kvp("$max", max_fields.view()));
+                update_doc.append(bsoncxx::builder::basic::kvp("$push", bsoncxx::builder::basic::make_document(bsoncxx::builder::basic::kvp("flushes", bsoncxx::builder::basic::make_document(bsoncxx::builder::basic::kvp("$each", bsoncxx::builder::basic::make_array(flush_id)), bsoncxx::builder::basic::kvp("$slice", -(MONGODB_FLUSH_RETRIES + 1)))))));
+                rollups_ops.emplace_back(std::move(create));
+                rollups_ops.emplace_back(mongocxx::model::update_one{filter_doc.extract(), update_doc.extract()});
+            }
+            catch (const std::exception &e)
+            {
+                LOG_ERR("Discarding the rollups of item " << std::get<0>(key) << ": " << e.what());
+            }
+
+        // each collection is written on its own, so that a failure on one of them does not hold back the others..
+        const auto batch_size = items_ops.size() + data_ops.size() + rollups_ops.size();
+        const auto start = std::chrono::steady_clock::now();
+        std::string error;
+        std::vector<mongocxx::model::write> unwritten_items, unwritten_data, unwritten_rollups;
+        try
+        {
+            auto client = pool.acquire();
+            auto db = (*client)[db_name];
+            unwritten_items = bulk_write(db[items_collection_name], std::move(items_ops), error);
+            unwritten_data = bulk_write(db[item_data_collection_name], std::move(data_ops), error);
+            unwritten_rollups = bulk_write(db[item_rollups_collection_name], std::move(rollups_ops), error);
+        }
+        catch (const std::exception &e)
+        { // the operations moved into a bulk write are always either written or returned, so the others are still in place..
+            error = e.what();
+            unwritten_items = std::move(items_ops);
+            unwritten_data = std::move(data_ops);
+            unwritten_rollups = std::move(rollups_ops);
+        }
+        const auto unwritten = unwritten_items.size() + unwritten_data.size() + unwritten_rollups.size();
+        const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+        LOG_DEBUG("Flushed " << batch_size - unwritten << " operations in " << latency.count() << " us");
+
+        std::lock_guard<std::mutex> lock(batch_mtx);
+        if (unwritten && ++failed_flushes <= MONGODB_FLUSH_RETRIES)
+        { // the unwritten operations precede the ones queued in the meantime, so they are put back at the front of the queues..
+            pending_items.insert(pending_items.begin(), std::make_move_iterator(unwritten_items.begin()), std::make_move_iterator(unwritten_items.end()));
+            pending_data.insert(pending_data.begin(), std::make_move_iterator(unwritten_data.begin()), std::make_move_iterator(unwritten_data.end()));
+            pending_rollup_ops.insert(pending_rollup_ops.begin(), std::make_move_iterator(unwritten_rollups.begin()), std::make_move_iterator(unwritten_rollups.end()));
+        }
+        else if (unwritten)
+        {
+            LOG_ERR("Dropping " << unwritten << " operations after " << MONGODB_FLUSH_RETRIES << " retries");
+            stats.dropped += unwritten;
+            failed_flushes = 0;
+        }
+        else
+            failed_flushes = 0;
+        stats.last_error = unwritten ? error : std::string();
+        ++stats.flushes;
+        stats.operations += batch_size - unwritten;
+        stats.last_batch_size = batch_size;
+        stats.max_batch_size = std::max(stats.max_batch_size, batch_size);
+        stats.last_latency = latency;
+        stats.max_latency = std::max(stats.max_latency, latency);
+        if (unwritten)
+            throw std::invalid_argument("Failed to flush " + std::to_string(unwritten) + " operations: " + error);
+    }
+    flush_stats mongo_db::get_flush_stats() noexcept
+    {
+        std::lock_guard<std::mutex> _(batch_mtx);
+        return stats;
     }
 
     std::vector<db_type> mongo_db::get_types() noexcept
@@ -46,11 +281,11 @@ namespace coco
         {
             json::json j_t{{"name", std::string(doc["_id"].get_string().value)}};
             if (doc.find("static_properties") != doc.end())
-                j_t["static_properties"] = json::load(bsoncxx::to_json(doc["static_properties"].get_document().view()));
+                j_t["static_properties"] = from_bson(doc["static_properties"].get_document().view());
             if (doc.find("dynamic_properties") != doc.end())
-                j_t["dynamic_properties"] = json::load(bsoncxx::to_json(doc["dynamic_properties"].get_document().view()));
+                j_t["dynamic_properties"] = from_bson(doc["dynamic_properties"].get_document().view());
             if (doc.find("data") != doc.end())
-                j_t["data"] = json::load(bsoncxx::to_json(doc["data"].get_document().view()));
+                j_t["data"] = from_bson(doc["data"].get_document().view());
 
             types.push_back(db_type(std::move(j_t)));
         }
@@ -61,11 +296,11 @@ namespace coco
         bsoncxx::builder::basic::document doc;
         doc.append(bsoncxx::builder::basic::kvp("_id", name.data()));
         if (!static_props.as_object().empty())
-            doc.append(bsoncxx::builder::basic::kvp("static_properties", bsoncxx::from_json(static_props.dump())));
+            doc.append(bsoncxx::builder::basic::kvp("static_properties", to_bson(static_props)));
         if (!dynamic_props.as_object().empty())
-            doc.append(bsoncxx::builder::basic::kvp("dynamic_properties", bsoncxx::from_json(dynamic_props.dump())));
+            doc.append(bsoncxx::builder::basic::kvp("dynamic_properties", to_bson(dynamic_props)));
         if (!data.as_object().empty())
-            doc.append(bsoncxx::builder::basic::kvp("data", bsoncxx::from_json(data.dump())));
+            doc.append(bsoncxx::builder::basic::kvp("data", to_bson(data)));
         auto client = pool.acquire();
         auto db = (*client)[db_name];
         auto types_collection = db[types_collection_name];
@@ -77,9 +312,9 @@ namespace coco
     {
         bsoncxx::builder::basic::document update_fields; // Fields to set
         if (!static_props.as_object().empty())
-            update_fields.append(bsoncxx::builder::basic::kvp("static_properties", bsoncxx::from_json(static_props.dump())));
+            update_fields.append(bsoncxx::builder::basic::kvp("static_properties", to_bson(static_props)));
         if (!dynamic_props.as_object().empty())
-            update_fields.append(bsoncxx::builder::basic::kvp("dynamic_properties", bsoncxx::from_json(dynamic_props.dump())));
+            update_fields.append(bsoncxx::builder::basic::kvp("dynamic_properties", to_bson(dynamic_props)));
 
         bsoncxx::builder::basic::document filter_doc; // Prepare the filter document
         filter_doc.append(bsoncxx::builder::basic::kvp("_id", tp_name.data()));
@@ -96,6 +331,7 @@ namespace coco
     }
     void mongo_db::delete_type(std::string_view name)
     {
+        flush();
         auto client = pool.acquire();
         auto db = (*client)[db_name];
         auto items_collection = db[items_collection_name];
@@ -110,6 +346,14 @@ namespace coco
 
     [[nodiscard]] std::vector<db_item> mongo_db::get_items() noexcept
     {
+        try
+        {
+            flush();
+        }
+        catch (const std::exception &e)
+        { // the items are read anyway, possibly missing the unwritten operations..
+            LOG_ERR(e.what());
+        }
         auto client = pool.acquire();
         auto db = (*client)[db_name];
         auto items_collection = db[items_collection_name];
@@ -125,86 +369,119 @@ namespace coco
 
             std::optional<json::json> props;
             if (doc.find("properties") != doc.end())
-                props = json::load(bsoncxx::to_json(doc["properties"].get_document().view()));
+                props = from_bson(doc["properties"].get_document().view());
 
             std::optional<std::pair<json::json, std::chrono::system_clock::time_point>> value;
             if (doc.find("value") != doc.end())
-                value = {json::load(bsoncxx::to_json(doc["value"]["data"].get_document().view())), doc["value"]["timestamp"].get_date()};
+                value = {from_bson(doc["value"]["data"].get_document().view()), doc["value"]["timestamp"].get_date()};
 
             items.push_back({std::move(id), std::move(types), std::move(props), std::move(value)});
         }
         return items;
     }
-    std::string mongo_db::create_item(const std::vector<std::string> &types, const json::json &props, const std::optional<std::pair<json::json, std::chrono::system_clock::time_point>> &val)
+    std::string mongo_db::generate_id() { return bsoncxx::oid().to_string(); }
+    void mongo_db::create_item(std::string_view itm_id, const std::vector<std::string> &types, const json::json &props, const std::optional<std::pair<json::json, std::chrono::system_clock::time_point>> &val)
     {
-        bsoncxx::builder::basic::document doc;
-        bsoncxx::builder::basic::array types_array;
-        for (const auto &type : types)
-            types_array.append(type);
-        doc.append(bsoncxx::builder::basic::kvp("types", types_array));
-        if (!props.as_object().empty())
-            doc.append(bsoncxx::builder::basic::kvp("properties", bsoncxx::from_json(props.dump())));
-        if (val.has_value())
+        auto insert = item_insert(itm_id, types, props, val);
+        // the ID is generated locally, so the insertion is batched with the later operations on the item, which it precedes, and retried by the following flushes if it fails..
+        std::lock_guard<std::mutex> _(batch_mtx);
+        pending_items.emplace_back(std::move(insert));
+        if (pending_size() >= MONGODB_BULK_SIZE)
+            batch_cv.notify_one();
+    }
+    void mongo_db::create_items(const std::vector<db_item> &itms)
+    {
+        if (itms.empty())
+            return;
+        std::vector<mongocxx::model::write> inserts;
+        inserts.reserve(itms.size());
+        bsoncxx::builder::basic::array ids;
+        for (const auto &itm : itms)
         {
-            bsoncxx::builder::basic::document data_doc;
-            data_doc.append(bsoncxx::builder::basic::kvp("data", bsoncxx::from_json(val->first.dump())));
-            data_doc.append(bsoncxx::builder::basic::kvp("timestamp", bsoncxx::types::b_date{val->second}));
-            doc.append(bsoncxx::builder::basic::kvp("value", data_doc));
+            inserts.emplace_back(item_insert(itm.id, itm.types, itm.props.value_or(json::json(json::json_type::object)), itm.value));
+            ids.append(to_oid(itm.id));
         }
-        auto client = pool.acquire();
-        auto db = (*client)[db_name];
-        auto items_collection = db[items_collection_name];
-        assert(items_collection);
-        auto result = items_collection.insert_one(doc.view());
-        if (!result)
-            throw std::invalid_argument("Failed to insert item");
-        return result->inserted_id().get_oid().value.to_string();
+        // the batch is written right away, rather than by the flusher, so that a failure reaches the caller before the items are created in memory..
+        std::string error;
+        try
+        {
+            auto client = pool.acquire();
+            auto db = (*client)[db_name];
+            if (const auto unwritten = bulk_write(db[items_collection_name], std::move(inserts), error); unwritten.empty() && error.empty())
+                return;
+            // the items written before the failure are removed, so that the batch is created either as a whole or not at all..
+            db[items_collection_name].delete_many(bsoncxx::builder::basic::make_document(bsoncxx::builder::basic::kvp("_id", bsoncxx::builder::basic::make_document(bsoncxx::builder::basic::kvp("$in", ids.extract())))));
+        }
+        catch (const std::exception &e)
+        {
+            if (error.empty())
+                error = e.what();
+        }
+        throw std::invalid_argument("Failed to create " + std::to_string(itms.size()) + " items: " + error);
     }
     void mongo_db::set_properties(std::string_view itm_id, const json::json &props)
     {
         bsoncxx::builder::basic::document update_fields; // Fields to set
-        // Iterate through properties and build set/unset operations
         for (const auto &[nm, prop] : props.as_object())
-            switch (prop.get_type())
+            append_bson(update_fields, "properties." + nm, prop);
+
+        bsoncxx::builder::basic::document update_doc; // Prepare the update document
+        update_doc.append(bsoncxx::builder::basic::kvp("$set", update_fields.view()));
+        mongocxx::model::update_one update{bsoncxx::builder::basic::make_document(bsoncxx::builder::basic::kvp("_id", to_oid(itm_id))), update_doc.extract()};
+
+        std::lock_guard<std::mutex> _(batch_mtx);
+        pending_items.emplace_back(std::move(update));
+        if (pending_size() >= MONGODB_BULK_SIZE)
+            batch_cv.notify_one();
+    }
+    void mongo_db::update_properties(std::string_view itm_id, const std::vector<db_property_update> &updates)
+    {
+        std::vector<mongocxx::model::update_one> updates_docs; // each update is a separate write, since they may target overlapping paths..
+        for (const auto &upd : updates)
+        {
+            std::string path = "properties";
+            for (const auto &token : upd.path)
+                path += "." + token;
+
+            bsoncxx::builder::basic::document update_fields;
+            switch (upd.kind)
             {
-            case json::json_type::null:
-                update_fields.append(bsoncxx::builder::basic::kvp("properties." + nm, bsoncxx::types::b_null{}));
+            case db_property_update::set:
+                append_bson(update_fields, path, upd.value);
                 break;
-            case json::json_type::boolean:
-                update_fields.append(bsoncxx::builder::basic::kvp("properties." + nm, prop.get<bool>()));
+            case db_property_update::unset:
+                update_fields.append(bsoncxx::builder::basic::kvp(path, ""));
                 break;
-            case json::json_type::number:
-                if (prop.is_float())
-                    update_fields.append(bsoncxx::builder::basic::kvp("properties." + nm, prop.get<double>()));
-                else
-                    update_fields.append(bsoncxx::builder::basic::kvp("properties." + nm, prop.get<int64_t>()));
-                break;
-            case json::json_type::string:
-                update_fields.append(bsoncxx::builder::basic::kvp("properties." + nm, prop.get<std::string>()));
-                break;
-            case json::json_type::array:
-                update_fields.append(bsoncxx::builder::basic::kvp("properties." + nm, to_bson_array(prop).view()));
+            case db_property_update::push:
+            {
+                bsoncxx::builder::basic::document each_doc;
+                append_bson(each_doc, "$each", json::json(std::vector<json::json>{upd.value}));
+                if (upd.position.has_value())
+                    each_doc.append(bsoncxx::builder::basic::kvp("$position", static_cast<int64_t>(*upd.position)));
+                update_fields.append(bsoncxx::builder::basic::kvp(path, each_doc.extract()));
                 break;
-            default:
-                update_fields.append(bsoncxx::builder::basic::kvp("properties." + nm, bsoncxx::from_json(prop.dump())));
+            }
             }
 
-        bsoncxx::builder::basic::document filter_doc; // Prepare the filter document
-        filter_doc.append(bsoncxx::builder::basic::kvp("_id", bsoncxx::oid{itm_id.data()}));
-        bsoncxx::builder::basic::document update_doc; // Prepare the update document
-        update_doc.append(bsoncxx::builder::basic::kvp("$set", update_fields.view()));
+            bsoncxx::builder::basic::document update_doc;
+            update_doc.append(bsoncxx::builder::basic::kvp(upd.kind == db_property_update::set ? "$set" : upd.kind == db_property_update::unset ? "$unset"
+                                                                                                                                               : "$push",
+                                                           update_fields.view()));
+            updates_docs.emplace_back(bsoncxx::builder::basic::make_document(bsoncxx::builder::basic::kvp("_id", to_oid(itm_id))), update_doc.extract());
+        }
 
-        auto client = pool.acquire();
-        auto db = (*client)[db_name];
-        auto items_collection = db[items_collection_name];
-        assert(items_collection);
-        if (!items_collection.update_one(filter_doc.view(), update_doc.view()))
-            throw std::invalid_argument("Failed to set properties for item: " + std::string(itm_id));
+        std::lock_guard<std::mutex> _(batch_mtx);
+        for (auto &update : updates_docs) // the bulk writes are ordered, so the updates are applied in sequence..
+            pending_items.emplace_back(std::move(update));
+        if (pending_size() >= MONGODB_BULK_SIZE)
+            batch_cv.notify_one();
     }
     json::json mongo_db::get_values(std::string_view itm_id, const std::chrono::system_clock::time_point &from, const std::chrono::system_clock::time_point &to)
     {
+        flush_archives(itm_id);
+        flush();
         bsoncxx::builder::basic::document query;
-        query.append(bsoncxx::builder::basic::kvp("item_id", bsoncxx::oid{itm_id.data()}));
+        query.append(bsoncxx::builder::basic::kvp("item_id", to_oid(itm_id)));
         query.append(bsoncxx::builder::basic::kvp("timestamp", bsoncxx::builder::basic::make_document(bsoncxx::builder::basic::kvp("$gte", bsoncxx::types::b_date{from}), bsoncxx::builder::basic::kvp("$lte", bsoncxx::types::b_date{to}))));
         json::json data = json::json_type::array;
 
@@ -215,87 +492,225 @@ namespace coco
         mongocxx::options::find find_opts;
         find_opts.sort(bsoncxx::builder::basic::make_document(bsoncxx::builder::basic::kvp("timestamp", 1)));
         for (const auto &doc : item_data_collection.find(query.view(), find_opts))
-            data.push_back(json::json{{"data", json::load(bsoncxx::to_json(doc["data"].get_document().view()))}, {"timestamp", doc["timestamp"].get_date().to_int64()}});
+            data.push_back(json::json{{"data", from_bson(doc["data"].get_document().view())}, {"timestamp", doc["timestamp"].get_date().to_int64()}});
         return data;
     }
-    void mongo_db::set_value(std::string_view itm_id, const json::json &val, const std::chrono::system_clock::time_point &timestamp)
+    std::optional<std::chrono::system_clock::time_point> mongo_db::get_values(std::string_view itm_id, const std::vector<std::string> &fields, const std::chrono::system_clock::time_point &from, const std::chrono::system_clock::time_point &to, size_t limit, const std::function<void(json::json &&)> &cb)
     {
-        bsoncxx::builder::basic::document update_fields;
-        bsoncxx::builder::basic::document update_val_fields; // Fields to set
-        // Iterate through properties and build set/unset operations
-        for (const auto &[nm, v] : val.as_object())
-            switch (v.get_type())
-            {
-            case json::json_type::null:
-                update_fields.append(bsoncxx::builder::basic::kvp("value.data." + nm, bsoncxx::types::b_null{}));
-                update_val_fields.append(bsoncxx::builder::basic::kvp("data." + nm, bsoncxx::types::b_null{}));
-                break;
-            case json::json_type::boolean:
-                update_fields.append(bsoncxx::builder::basic::kvp("value.data." + nm, v.get<bool>()));
-                update_val_fields.append(bsoncxx::builder::basic::kvp("data." + nm, v.get<bool>()));
-                break;
-            case json::json_type::number:
-                if (v.is_float())
-                {
-                    update_fields.append(bsoncxx::builder::basic::kvp("value.data." + nm, v.get<double>()));
-                    update_val_fields.append(bsoncxx::builder::basic::kvp("data." + nm, v.get<double>()));
-                }
-                else
-                {
-                    update_fields.append(bsoncxx::builder::basic::kvp("value.data." + nm, v.get<int64_t>()));
-                    update_val_fields.append(bsoncxx::builder::basic::kvp("data." + nm, v.get<int64_t>()));
-                }
-                break;
-            case json::json_type::string:
-                update_fields.append(bsoncxx::builder::basic::kvp("value.data." + nm, v.get<std::string>()));
-                update_val_fields.append(bsoncxx::builder::basic::kvp("data." + nm, v.get<std::string>()));
-                break;
-            case json::json_type::array:
-                update_fields.append(bsoncxx::builder::basic::kvp("value.data." + nm, to_bson_array(v).view()));
-                update_val_fields.append(bsoncxx::builder::basic::kvp("data." + nm, to_bson_array(v).view()));
-                break;
-            default:
-                update_fields.append(bsoncxx::builder::basic::kvp("value.data." + nm, bsoncxx::from_json(v.dump())));
-                update_val_fields.append(bsoncxx::builder::basic::kvp("data." + nm, bsoncxx::from_json(v.dump())));
-            }
-        update_fields.append(bsoncxx::builder::basic::kvp("value.timestamp", bsoncxx::types::b_date{timestamp}));
-        bsoncxx::builder::basic::document filter_doc; // Prepare the filter document
-        filter_doc.append(bsoncxx::builder::basic::kvp("_id", bsoncxx::oid{itm_id.data()}));
-        bsoncxx::builder::basic::document update_doc;
-        update_doc.append(bsoncxx::builder::basic::kvp("$set", update_fields.view()));
+        flush_archives(itm_id);
+        flush();
+        bsoncxx::builder::basic::document query;
+        query.append(bsoncxx::builder::basic::kvp("item_id", to_oid(itm_id)));
+        query.append(bsoncxx::builder::basic::kvp("timestamp", bsoncxx::builder::basic::make_document(bsoncxx::builder::basic::kvp("$gte", bsoncxx::types::b_date{from}), bsoncxx::builder::basic::kvp("$lte", bsoncxx::types::b_date{to}))));
 
         auto client = pool.acquire();
         auto db = (*client)[db_name];
-        auto items_collection = db[items_collection_name];
-        assert(items_collection);
-        if (!items_collection.update_one(filter_doc.view(), update_doc.view()))
-            throw std::invalid_argument("Failed to set value for item: " + std::string(itm_id));
+        auto item_data_collection = db[item_data_collection_name];
+        assert(item_data_collection);
+        mongocxx::options::find find_opts;
+        find_opts.sort(bsoncxx::builder::basic::make_document(bsoncxx::builder::basic::kvp("timestamp", 1)));
+        find_opts.batch_size(static_cast<int32_t>(std::min<size_t>(limit, MONGODB_BULK_SIZE)));
+        if (limit < static_cast<size_t>(std::numeric_limits<int64_t>::max()))
+            find_opts.limit(static_cast<int64_t>(limit) + 1); // the extra document tells where the next page starts..
+        if (!fields.empty())
+        {
+            bsoncxx::builder::basic::document projection;
+            projection.append(bsoncxx::builder::basic::kvp("timestamp", 1));
+            for (const auto &field : fields)
+                projection.append(bsoncxx::builder::basic::kvp("data." + field, 1));
+            find_opts.projection(projection.extract());
+        }
+        size_t count = 0;
+        for (const auto &doc : item_data_collection.find(query.view(), find_opts))
+        {
+            if (count++ == limit)
+                return std::chrono::system_clock::time_point(std::chrono::milliseconds{doc["timestamp"].get_date().to_int64()});
+            cb(json::json{{"data", from_bson(doc["data"].get_document().view())}, {"timestamp", doc["timestamp"].get_date().to_int64()}});
+        }
+        return std::nullopt;
+    }
+    void mongo_db::get_values(const std::vector<std::string> &itm_ids, const std::vector<std::string> &fields, const std::chrono::system_clock::time_point &from, const std::chrono::system_clock::time_point &to, const std::function<void(const std::string &, json::json &&)> &cb)
+    {
+        if (itm_ids.empty())
+            return;
+        for (const auto &itm_id : itm_ids)
+            flush_archives(itm_id);
+        flush();
+        bsoncxx::builder::basic::array ids;
+        for (const auto &itm_id : itm_ids)
+            ids.append(to_oid(itm_id));
+        bsoncxx::builder::basic::document query;
+        query.append(bsoncxx::builder::basic::kvp("item_id", bsoncxx::builder::basic::make_document(bsoncxx::builder::basic::kvp("$in", ids.extract()))));
+        query.append(bsoncxx::builder::basic::kvp("timestamp", bsoncxx::builder::basic::make_document(bsoncxx::builder::basic::kvp("$gte", bsoncxx::types::b_date{from}), bsoncxx::builder::basic::kvp("$lte", bsoncxx::types::b_date{to}))));
 
-        bsoncxx::builder::basic::document filter_data_doc; // Prepare the filter document
-        filter_data_doc.append(bsoncxx::builder::basic::kvp("item_id", bsoncxx::oid{itm_id.data()}));
-        filter_data_doc.append(bsoncxx::builder::basic::kvp("timestamp", bsoncxx::types::b_date{timestamp}));
-        bsoncxx::builder::basic::document update_data_doc; // Prepare the update document
-        update_data_doc.append(bsoncxx::builder::basic::kvp("$set", update_val_fields.view()));
-        mongocxx::options::update update_opts;
-        update_opts.upsert(true); // Create a new document if no document matches the filter
+        auto client = pool.acquire();
+        auto db = (*client)[db_name];
+        auto item_data_collection = db[item_data_collection_name];
+        assert(item_data_collection);
+        mongocxx::options::find find_opts;
+        // sorting by item first groups the values of each item together..
+        find_opts.sort(bsoncxx::builder::basic::make_document(bsoncxx::builder::basic::kvp("item_id", 1), bsoncxx::builder::basic::kvp("timestamp", 1)));
+        find_opts.batch_size(MONGODB_BULK_SIZE);
+        bsoncxx::builder::basic::document projection;
+        projection.append(bsoncxx::builder::basic::kvp("item_id", 1));
+        projection.append(bsoncxx::builder::basic::kvp("timestamp", 1));
+        if (fields.empty())
+            projection.append(bsoncxx::builder::basic::kvp("data", 1));
+        else
+            for (const auto &field : fields)
+                projection.append(bsoncxx::builder::basic::kvp("data." + field, 1));
+        find_opts.projection(projection.extract());
+        for (const auto &doc : item_data_collection.find(query.view(), find_opts))
+            cb(doc["item_id"].get_oid().value.to_string(), json::json{{"data", from_bson(doc["data"].get_document().view())}, {"timestamp", doc["timestamp"].get_date().to_int64()}});
+    }
+    void mongo_db::scan_values(std::string_view itm_id, const std::vector<std::string> &props, const std::chrono::system_clock::time_point &from, const std::chrono::system_clock::time_point &to, const std::function<void(const std::string &, int64_t, json::json &&)> &cb)
+    {
+        flush_archives(itm_id);
+        flush();
+        bsoncxx::builder::basic::document query;
+        query.append(bsoncxx::builder::basic::kvp("item_id", to_oid(itm_id)));
+        query.append(bsoncxx::builder::basic::kvp("timestamp", bsoncxx::builder::basic::make_document(bsoncxx::builder::basic::kvp("$gte", bsoncxx::types::b_date{from}), bsoncxx::builder::basic::kvp("$lte", bsoncxx::types::b_date{to}))));
 
+        auto client = pool.acquire();
+        auto db = (*client)[db_name];
         auto item_data_collection = db[item_data_collection_name];
         assert(item_data_collection);
-        if (!item_data_collection.update_one(filter_data_doc.view(), update_data_doc.view(), update_opts))
-            throw std::invalid_argument("Failed to set value for item: " + std::string(itm_id));
+        mongocxx::options::find find_opts;
+        find_opts.sort(bsoncxx::builder::basic::make_document(bsoncxx::builder::basic::kvp("timestamp", 1)));
+        find_opts.batch_size(MONGODB_BULK_SIZE); // the cursor is consumed one batch at a time..
+        if (!props.empty())
+        { // only the requested dynamic properties are sent back by the server..
+            bsoncxx::builder::basic::document projection;
+            projection.append(bsoncxx::builder::basic::kvp("timestamp", 1));
+            for (const auto &prop : props)
+                projection.append(bsoncxx::builder::basic::kvp("data." + prop, 1));
+            find_opts.projection(projection.extract());
+        }
+        for (const auto &doc : item_data_collection.find(query.view(), find_opts))
+        {
+            const auto ts = doc["timestamp"].get_date().to_int64();
+            for (const auto &el : doc["data"].get_document().view())
+                cb(std::string(el.key()), ts, from_bson(el.get_value()));
+        }
+    }
+    void mongo_db::set_value(std::string_view itm_id, const json::json &val, const std::chrono::system_clock::time_point &timestamp)
+    {
+        auto upserts = data_upserts(itm_id, val, timestamp);
+        std::lock_guard<std::mutex> _(batch_mtx);
+        // every data point is kept, while only the latest value of the item is written..
+        set_latest(itm_id, val, timestamp);
+        for (auto &upsert : upserts)
+            pending_data.emplace_back(std::move(upsert));
+        add_rollups(itm_id, val, timestamp);
+        if (pending_size() >= MONGODB_BULK_SIZE)
+            batch_cv.notify_one();
+    }
+    void mongo_db::set_values(std::string_view itm_id, const std::vector<std::pair<json::json, std::chrono::system_clock::time_point>> &series, const std::optional<std::pair<json::json, std::chrono::system_clock::time_point>> &latest)
+    {
+        std::map<int64_t, json::json> data; // backfilled values bypass the archives, leaving the segments being built untouched..
+        for (const auto &[val, timestamp] : series)
+        {
+            auto &d = data.try_emplace(std::chrono::duration_cast<std::chrono::milliseconds>(timestamp.time_since_epoch()).count(), json::json(json::json_type::object)).first->second;
+            for (const auto &[nm, v] : val.as_object())
+                d[nm] = v;
+        }
+        auto upserts = data_upserts(to_oid(itm_id), data);
+        std::lock_guard<std::mutex> _(batch_mtx);
+        if (latest)
+            set_latest(itm_id, latest->first, latest->second);
+        for (auto &upsert : upserts)
+            pending_data.emplace_back(std::move(upsert));
+        for (const auto &[val, timestamp] : series)
+            add_rollups(itm_id, val, timestamp);
+        if (pending_size() >= MONGODB_BULK_SIZE)
+            batch_cv.notify_one();
+    }
+    json::json mongo_db::get_rollups(std::string_view itm_id, const std::chrono::seconds &resolution, const std::chrono::system_clock::time_point &from, const std::chrono::system_clock::time_point &to)
+    {
+        flush();
+        const auto from_bucket = bucket_of(std::chrono::duration_cast<std::chrono::milliseconds>(from.time_since_epoch()).count(), resolution);
+        bsoncxx::builder::basic::document query;
+        query.append(bsoncxx::builder::basic::kvp("item_id", to_oid(itm_id)));
+        query.append(bsoncxx::builder::basic::kvp("resolution", static_cast<int64_t>(resolution.count())));
+        query.append(bsoncxx::builder::basic::kvp("timestamp", bsoncxx::builder::basic::make_document(bsoncxx::builder::basic::kvp("$gte", bsoncxx::types::b_date{std::chrono::milliseconds{from_bucket}}), bsoncxx::builder::basic::kvp("$lte", bsoncxx::types::b_date{to}))));
+        json::json data = json::json_type::array;
+
+        auto client = pool.acquire();
+        auto db = (*client)[db_name];
+        auto item_rollups_collection = db[item_rollups_collection_name];
+        assert(item_rollups_collection);
+        mongocxx::options::find find_opts;
+        find_opts.sort(bsoncxx::builder::basic::make_document(bsoncxx::builder::basic::kvp("timestamp", 1)));
+        for (const auto &doc : item_rollups_collection.find(query.view(), find_opts))
+        {
+            auto j_data = from_bson(doc["data"].get_document().view());
+            for (auto &[nm, r] : j_data.as_object())
+            {
+                json::json last = r["last"]["v"];
+                r["last"] = std::move(last);
+            }
+            data.push_back(json::json{{"timestamp", doc["timestamp"].get_date().to_int64()}, {"data", std::move(j_data)}});
+        }
+        return data;
     }
     void mongo_db::delete_item(std::string_view itm_id)
+    {
+        std::lock_guard<std::mutex> _(batch_mtx);
+        pending_values.erase(std::string(itm_id));
+        for (auto it = pending_rollups.lower_bound({std::string(itm_id), std::numeric_limits<int64_t>::min(), std::numeric_limits<int64_t>::min()}); it != pending_rollups.end() && std::get<0>(it->first) == itm_id;)
+            it = pending_rollups.erase(it);
+        pending_rollup_ops.emplace_back(mongocxx::model::delete_many{bsoncxx::builder::basic::make_document(bsoncxx::builder::basic::kvp("item_id", to_oid(itm_id)))});
+        pending_data.emplace_back(mongocxx::model::delete_many{bsoncxx::builder::basic::make_document(bsoncxx::builder::basic::kvp("item_id", to_oid(itm_id)))});
+        pending_items.emplace_back(mongocxx::model::delete_one{bsoncxx::builder::basic::make_document(bsoncxx::builder::basic::kvp("_id", to_oid(itm_id)))});
+        if (pending_size() >= MONGODB_BULK_SIZE)
+            batch_cv.notify_one();
+    }
+
+    size_t mongo_db::count_values(std::string_view itm_id, const std::chrono::system_clock::time_point &before)
     {
         auto client = pool.acquire();
         auto db = (*client)[db_name];
         auto item_data_collection = db[item_data_collection_name];
         assert(item_data_collection);
-        if (!item_data_collection.delete_many(bsoncxx::builder::basic::make_document(bsoncxx::builder::basic::kvp("item_id", bsoncxx::oid{itm_id.data()}))))
-            throw std::invalid_argument("Failed to delete item data for item: " + std::string(itm_id));
-        auto items_collection = db[items_collection_name];
-        assert(items_collection);
-        if (!items_collection.delete_one(bsoncxx::builder::basic::make_document(bsoncxx::builder::basic::kvp("_id", bsoncxx::oid{itm_id.data()}))))
-            throw std::invalid_argument("Failed to delete item: " + std::string(itm_id));
+        return static_cast<size_t>(item_data_collection.count_documents(bsoncxx::builder::basic::make_document(bsoncxx::builder::basic::kvp("item_id", to_oid(itm_id)), bsoncxx::builder::basic::kvp("timestamp", bsoncxx::builder::basic::make_document(bsoncxx::builder::basic::kvp("$lt", bsoncxx::types::b_date{before}))))));
+    }
+    size_t mongo_db::delete_values(std::string_view itm_id, const std::chrono::system_clock::time_point &before, size_t limit)
+    {
+        auto client = pool.acquire();
+        auto db = (*client)[db_name];
+        auto item_data_collection = db[item_data_collection_name];
+        assert(item_data_collection);
+        // the oldest expired values are selected through the (item_id, timestamp) index and then deleted by ID, so that a single batch never holds the collection for long..
+        mongocxx::options::find find_opts;
+        find_opts.sort(bsoncxx::builder::basic::make_document(bsoncxx::builder::basic::kvp("timestamp", 1)));
+        find_opts.projection(bsoncxx::builder::basic::make_document(bsoncxx::builder::basic::kvp("_id", 1)));
+        find_opts.limit(static_cast<int64_t>(limit));
+        bsoncxx::builder::basic::array ids;
+        size_t n_ids = 0;
+        for (const auto &doc : item_data_collection.find(bsoncxx::builder::basic::make_document(bsoncxx::builder::basic::kvp("item_id", to_oid(itm_id)), bsoncxx::builder::basic::kvp("timestamp", bsoncxx::builder::basic::make_document(bsoncxx::builder::basic::kvp("$lt", bsoncxx::types::b_date{before})))), find_opts))
+        {
+            ids.append(doc["_id"].get_oid().value);
+            ++n_ids;
+        }
+        if (!n_ids)
+            return 0;
+        auto result = item_data_collection.delete_many(bsoncxx::builder::basic::make_document(bsoncxx::builder::basic::kvp("_id", bsoncxx::builder::basic::make_document(bsoncxx::builder::basic::kvp("$in", ids.extract())))));
+        return result ? static_cast<size_t>(result->deleted_count()) : 0;
+    }
+    size_t mongo_db::delete_rollups(std::string_view itm_id, const std::chrono::system_clock::time_point &before)
+    {
+        auto client = pool.acquire();
+        auto db = (*client)[db_name];
+        auto item_rollups_collection = db[item_rollups_collection_name];
+        assert(item_rollups_collection);
+        size_t deleted = 0;
+        for (const auto &res : resolutions)
+        { // a bucket expires once it ends before the expiration time..
+            auto result = item_rollups_collection.delete_many(bsoncxx::builder::basic::make_document(bsoncxx::builder::basic::kvp("item_id", to_oid(itm_id)), bsoncxx::builder::basic::kvp("resolution", static_cast<int64_t>(res.count())), bsoncxx::builder::basic::kvp("timestamp", bsoncxx::builder::basic::make_document(bsoncxx::builder::basic::kvp("$lte", bsoncxx::types::b_date{before - res})))));
+            if (result)
+                deleted += static_cast<size_t>(result->deleted_count());
+        }
+        return deleted;
     }
 
     std::vector<db_rule> mongo_db::get_rules() noexcept
@@ -328,40 +743,214 @@ namespace coco
 
     void mongo_db::drop() noexcept
     {
+        std::lock_guard<std::mutex> flush_lock(flush_mtx); // an in-flight flush would otherwise write into the dropped database..
+        {
+            std::lock_guard<std::mutex> _(batch_mtx);
+            pending_items.clear();
+            pending_values.clear();
+            pending_data.clear();
+            pending_rollup_ops.clear();
+            pending_rollups.clear();
+            failed_flushes = 0;
+        }
         coco_db::drop();
         auto client = pool.acquire();
         auto db = (*client)[db_name];
         db.drop();
     }
 
+    mongocxx::model::replace_one mongo_db::item_insert(std::string_view itm_id, const std::vector<std::string> &types, const json::json &props, const std::optional<std::pair<json::json, std::chrono::system_clock::time_point>> &val)
+    {
+        const auto itm_oid = to_oid(itm_id);
+        bsoncxx::builder::basic::document doc;
+        doc.append(bsoncxx::builder::basic::kvp("_id", itm_oid));
+        bsoncxx::builder::basic::array types_array;
+        for (const auto &type : types)
+            types_array.append(type);
+        doc.append(bsoncxx::builder::basic::kvp("types", types_array));
+        if (!props.as_object().empty())
+            doc.append(bsoncxx::builder::basic::kvp("properties", to_bson(props)));
+        if (val.has_value())
+        {
+            bsoncxx::builder::basic::document data_doc;
+            data_doc.append(bsoncxx::builder::basic::kvp("data", to_bson(val->first)));
+            data_doc.append(bsoncxx::builder::basic::kvp("timestamp", bsoncxx::types::b_date{val->second}));
+            doc.append(bsoncxx::builder::basic::kvp("value", data_doc));
+        }
+        // the insertion is an upsert, so that retrying a partially written batch does not fail on the already inserted items..
+        mongocxx::model::replace_one insert{bsoncxx::builder::basic::make_document(bsoncxx::builder::basic::kvp("_id", itm_oid)), doc.extract()};
+        insert.upsert(true);
+        return insert;
+    }
+    std::vector<mongocxx::model::update_one> mongo_db::data_upserts(std::string_view itm_id, const json::json &val, const std::chrono::system_clock::time_point &timestamp)
+    {
+        const auto itm_oid = to_oid(itm_id); // the ID is checked even if the archives hold the value back..
+        // only the archived points are stored, possibly including points held back by previous values..
+        return data_upserts(itm_oid, archive(itm_id, val, timestamp));
+    }
+    std::vector<mongocxx::model::update_one> mongo_db::data_upserts(const bsoncxx::oid &itm_oid, const std::map<int64_t, json::json> &data)
+    {
+        std::vector<mongocxx::model::update_one> upserts;
+        for (const auto &[data_ts, d] : data)
+        {
+            bsoncxx::builder::basic::document update_val_fields; // Fields to set
+            for (const auto &[nm, v] : d.as_object())
+                append_bson(update_val_fields, "data." + nm, v);
+
+            bsoncxx::builder::basic::document filter_data_doc; // Prepare the filter document
+            filter_data_doc.append(bsoncxx::builder::basic::kvp("item_id", itm_oid));
+            filter_data_doc.append(bsoncxx::builder::basic::kvp("timestamp", bsoncxx::types::b_date{std::chrono::milliseconds{data_ts}}));
+            bsoncxx::builder::basic::document update_data_doc; // Prepare the update document
+            update_data_doc.append(bsoncxx::builder::basic::kvp("$set", update_val_fields.view()));
+            mongocxx::model::update_one upsert{filter_data_doc.extract(), update_data_doc.extract()};
+            upsert.upsert(true); // Create a new document if no document matches the filter
+            upserts.emplace_back(std::move(upsert));
+        }
+        return upserts;
+    }
+    void mongo_db::store_archived(std::string_view itm_id, const std::map<int64_t, json::json> &data)
+    {
+        auto upserts = data_upserts(to_oid(itm_id), data);
+        std::lock_guard<std::mutex> _(batch_mtx);
+        for (auto &upsert : upserts) // the held points are written with the next flush, which the reads perform first..
+            pending_data.emplace_back(std::move(upsert));
+    }
+    void mongo_db::set_latest(std::string_view itm_id, const json::json &val, const std::chrono::system_clock::time_point &timestamp)
+    {
+        auto &[data, data_ts] = pending_values.try_emplace(std::string(itm_id), json::json(json::json_type::object), timestamp).first->second;
+        for (const auto &[nm, v] : val.as_object())
+            data[nm] = v;
+        data_ts = timestamp;
+    }
+    void mongo_db::add_rollups(std::string_view itm_id, const json::json &val, const std::chrono::system_clock::time_point &timestamp)
+    {
+        const auto ts = std::chrono::duration_cast<std::chrono::milliseconds>(timestamp.time_since_epoch()).count();
+        for (const auto &[nm, v] : val.as_object())
+            if (v.is_number())
+                for (const auto &res : resolutions)
+                    pending_rollups[{std::string(itm_id), res.count(), bucket_of(ts, res)}][nm].add(v.get<double>(), ts);
+    }
+
+    void append_bson(bsoncxx::builder::basic::sub_document doc, std::string_view key, const json::json &j)
+    {
+        switch (j.get_type())
+        {
+        case json::json_type::null:
+            doc.append(bsoncxx::builder::basic::kvp(key, bsoncxx::types::b_null{}));
+            break;
+        case json::json_type::boolean:
+            doc.append(bsoncxx::builder::basic::kvp(key, j.get<bool>()));
+            break;
+        case json::json_type::number:
+            if (j.is_float())
+                doc.append(bsoncxx::builder::basic::kvp(key, j.get<double>()));
+            else
+                doc.append(bsoncxx::builder::basic::kvp(key, j.get<int64_t>()));
+            break;
+        case json::json_type::string:
+            doc.append(bsoncxx::builder::basic::kvp(key, j.get<std::string>()));
+            break;
+        case json::json_type::object:
+            doc.append(bsoncxx::builder::basic::kvp(key, [&j](bsoncxx::builder::basic::sub_document sub_doc)
+                                                    { for (const auto &[k, v] : j.as_object())
+                                                          append_bson(sub_doc, k, v); }));
+            break;
+        case json::json_type::array:
+            doc.append(bsoncxx::builder::basic::kvp(key, [&j](bsoncxx::builder::basic::sub_array sub_arr)
+                                                    { for (const auto &v : j.as_array())
+                                                          append_bson(sub_arr, v); }));
+            break;
+        }
+    }
+    void append_bson(bsoncxx::builder::basic::sub_array arr, const json::json &j)
+    {
+        switch (j.get_type())
+        {
+        case json::json_type::null:
+            arr.append(bsoncxx::types::b_null{});
+            break;
+        case json::json_type::boolean:
+            arr.append(j.get<bool>());
+            break;
+        case json::json_type::number:
+            if (j.is_float())
+                arr.append(j.get<double>());
+            else
+                arr.append(j.get<int64_t>());
+            break;
+        case json::json_type::string:
+            arr.append(j.get<std::string>());
+            break;
+        case json::json_type::object:
+            arr.append([&j](bsoncxx::builder::basic::sub_document sub_doc)
+                       { for (const auto &[k, v] : j.as_object())
+                             append_bson(sub_doc, k, v); });
+            break;
+        case json::json_type::array:
+            arr.append([&j](bsoncxx::builder::basic::sub_array sub_arr)
+                       { for (const auto &v : j.as_array())
+                             append_bson(sub_arr, v); });
+            break;
+        }
+    }
+    bsoncxx::document::value to_bson(const json::json &j)
+    {
+        bsoncxx::builder::basic::document doc;
+        for (const auto &[k, v] : j.as_object())
+            append_bson(doc, k, v);
+        return doc.extract();
+    }
     bsoncxx::array::value to_bson_array(const json::json &j)
     {
         bsoncxx::builder::basic::array arr;
-        for (const auto &elem : j.as_array())
-            switch (elem.get_type())
-            {
-            case json::json_type::null:
-                arr.append(bsoncxx::types::b_null{});
-                break;
-            case json::json_type::boolean:
-                arr.append(elem.get<bool>());
-                break;
-            case json::json_type::number:
-                if (elem.is_float())
-                    arr.append(elem.get<double>());
-                else
-                    arr.append(elem.get<int64_t>());
-                break;
-            case json::json_type::string:
-                arr.append(elem.get<std::string>());
-                break;
-            case json::json_type::object:
-                arr.append(bsoncxx::from_json(elem.dump()));
-                break;
-            case json::json_type::array:
-                arr.append(to_bson_array(elem).view());
-                break;
-            }
+        for (const auto &v : j.as_array())
+            append_bson(arr, v);
         return arr.extract();
     }
+
+    json::json from_bson(const bsoncxx::types::bson_value::view &val)
+    {
+        switch (val.type())
+        {
+        case bsoncxx::type::k_double:
+            return val.get_double().value;
+        case bsoncxx::type::k_string:
+            return std::string(val.get_string().value);
+        case bsoncxx::type::k_document:
+            return from_bson(val.get_document().value);
+        case bsoncxx::type::k_array:
+            return from_bson(val.get_array().value);
+        case bsoncxx::type::k_oid:
+            return val.get_oid().value.to_string();
+        case bsoncxx::type::k_bool:
+            return val.get_bool().value;
+        case bsoncxx::type::k_date:
+            return static_cast<int64_t>(val.get_date().to_int64());
+        case bsoncxx::type::k_int32:
+            return static_cast<int64_t>(val.get_int32().value);
+        case bsoncxx::type::k_int64:
+            return static_cast<int64_t>(val.get_int64().value);
+        case bsoncxx::type::k_decimal128:
+            return val.get_decimal128().value.to_string();
+        case bsoncxx::type::k_null:
+            return json::json(json::json_type::null);
+        default:
+            LOG_WARN("Unsupported BSON type: " + bsoncxx::to_string(val.type()));
+            return json::json(json::json_type::null);
+        }
+    }
+    json::json from_bson(const bsoncxx::document::view &doc)
+    {
+        json::json j(json::json_type::object);
+        for (const auto &elem : doc)
+            j[std::string(elem.key())] = from_bson(elem.get_value());
+        return j;
+    }
+    json::json from_bson(const bsoncxx::array::view &arr)
+    {
+        json::json j(json::json_type::array);
+        for (const auto &elem : arr)
+            j.push_back(from_bson(elem.get_value()));
+        return j;
+    }
 } // namespace coco
@@ -10,13 +10,120 @@
 #include "coco_noauth.hpp"
 #endif
 #include "logging.hpp"
+#include <algorithm>
+#include <limits>
+#include <sstream>
 
 namespace coco
 {
+    namespace
+    {
+        [[nodiscard]] std::vector<std::string> split_list(const std::string &list)
+        {
+            std::vector<std::string> res;
+            std::istringstream iss(list);
+            for (std::string elem; std::getline(iss, elem, ',');)
+                if (!elem.empty())
+                    res.push_back(elem);
+            return res;
+        }
+
+        // parses a `name=value` (equality) or `name.op=value` (with op among lt, le, gt and ge) query parameter into a filter on a static property, typing the value after the property of the given type, if any..
+        [[nodiscard]] item_filter to_filter(const std::string &par, const std::string &val, const type *tp)
+        {
+            item_filter f;
+            f.property = par;
+            if (const auto dot = par.rfind('.'); dot != std::string::npos)
+            {
+                const auto op = par.substr(dot + 1);
+                if (op == "lt")
+                    f.op = filter_op::lt;
+                else if (op == "le")
+                    f.op = filter_op::le;
+                else if (op == "gt")
+                    f.op = filter_op::gt;
+                else if (op == "ge")
+                    f.op = filter_op::ge;
+                else
+                    throw std::invalid_argument("Unknown filter operator: " + op);
+                f.property = par.substr(0, dot);
+            }
+            f.value = val;
+            if (tp)
+                if (auto prop = tp->get_static_properties().find(f.property); prop != tp->get_static_properties().end())
+                    if (const auto &pt_name = prop->second->get_property_type().get_name(); pt_name == "string" || pt_name == "symbol" || pt_name == "item")
+                        return f;
+            try
+            { // numbers and booleans are compared as such..
+                if (auto j = json::load(val); j.is_number() || j.is_boolean())
+                    f.value = std::move(j);
+            }
+            catch (const std::exception &)
+            {
+            }
+            return f;
+        }
+
+        // parses an integer query parameter, rejecting values which are not integers or which are less than the given minimum, instead of letting them wrap around..
+        [[nodiscard]] size_t parse_count(const std::string &par, const std::string &val, long long min)
+        {
+            size_t pos = 0;
+            long long n = 0;
+            try
+            {
+                n = std::stoll(val, &pos);
+            }
+            catch (const std::exception &)
+            {
+                pos = 0;
+            }
+            if (pos == 0 || pos != val.size() || n < min)
+                throw std::invalid_argument("The `" + par + "` parameter must be an integer not less than " + std::to_string(min));
+            return static_cast<size_t>(n);
+        }
+
+        // parses a `within=min_lat,min_lon,max_lat,max_lon` box or a `near=lat,lon,radius` circle query parameter into the area of a `within` filter..
+        [[nodiscard]] json::json parse_area(const std::string &par, const std::string &val)
+        {
+            std::vector<json::json> coords;
+            for (const auto &c : split_list(val))
+                try
+                {
+                    size_t pos = 0;
+                    coords.push_back(std::stod(c, &pos));
+                    if (pos != c.size())
+                        throw std::invalid_argument(c);
+                }
+                catch (const std::exception &)
+                {
+                    throw std::invalid_argument("Invalid coordinate: " + c);
+                }
+            if (par == "within" && coords.size() == 4)
+                return json::json{{"bbox", std::move(coords)}};
+            if (par == "near" && coords.size() == 3)
+                return json::json{{"lat", coords[0]}, {"lon", coords[1]}, {"radius", coords[2]}};
+            throw std::invalid_argument(par == "within" ? "The `within` parameter must be `min_lat,min_lon,max_lat,max_lon`" : "The `near` parameter must be `lat,lon,radius`");
+        }
+
+        // gets the name of the first geographic property, static or dynamic, of the given type, if any..
+        [[nodiscard]] std::optional<std::string> geo_property_of(const type &tp)
+        {
+            for (const auto &props : {&tp.get_static_properties(), &tp.get_dynamic_properties()})
+                for (const auto &[name, prop] : *props)
+                    if (prop->get_property_type().get_name() == geo_kw)
+                        return name;
+            return std::nullopt;
+        }
+    } // namespace
+
     server_module::server_module(coco_server &srv) noexcept : srv(srv) {}
     coco &server_module::get_coco() noexcept { return srv.get_coco(); }
 
-    void server_module::add_schema(std::string_view name, json::json &&schema) noexcept { srv.schemas[name] = std::move(schema); }
+    void server_module::add_schema(std::string_view name, json::json &&schema) noexcept
+    { // the schemas of the json properties can reference the schemas of the modules..
+        get_coco().set_schema(name, json::json(schema));
+        srv.schemas[name] = std::move(schema);
+    }
     json::json &server_module::get_schema(std::string_view name)
     {
         if (srv.schemas.as_object().count(name.data()))
@@ -45,12 +152,16 @@ namespace coco
         add_route(network::Post, "^/types$", std::bind(&coco_server::create_type, this, network::placeholders::request));
         add_route(network::Delete, "^/types/.*$", std::bind(&coco_server::delete_type, this, network::placeholders::request));
 
-        add_route(network::Get, "^/items(\\?([a-zA-Z0-9_\\-]+=[^&=#]+)(\\&[a-zA-Z0-9_\\-]+=[^&=#]+)*)?$", std::bind(&coco_server::get_items, this, network::placeholders::request));
+        add_route(network::Get, "^/items(\\?([a-zA-Z0-9_\\-\\.]+=[^&=#]+)(\\&[a-zA-Z0-9_\\-\\.]+=[^&=#]+)*)?$", std::bind(&coco_server::get_items, this, network::placeholders::request));
+        add_route(network::Get, "^/items/[^/?]+/referrers$", std::bind(&coco_server::get_referrers, this, network::placeholders::request));
         add_route(network::Get, "^/items/.*$", std::bind(&coco_server::get_item, this, network::placeholders::request));
         add_route(network::Post, "^/items$", std::bind(&coco_server::create_item, this, network::placeholders::request));
+        add_route(network::Post, "^/items/bulk$", std::bind(&coco_server::create_items, this, network::placeholders::request));
         add_route(network::Patch, "^/items/.*$", std::bind(&coco_server::update_item, this, network::placeholders::request));
         add_route(network::Delete, "^/items/.*$", std::bind(&coco_server::delete_item, this, network::placeholders::request));
 
+        add_route(network::Post, "^/data/query$", std::bind(&coco_server::query_data, this, network::placeholders::request));
+        add_route(network::Post, "^/data/[^/?]+/backfill$", std::bind(&coco_server::backfill_data, this, network::placeholders::request));
         add_route(network::Get, "^/data/.*$", std::bind(&coco_server::get_data, this, network::placeholders::request));
         add_route(network::Post, "^/data/.*$", std::bind(&coco_server::set_datum, this, network::placeholders::request));
 
@@ -65,8 +176,19 @@ namespace coco
         add_ws_route("/coco").on_open(std::bind(&coco_server::on_ws_open, this, network::placeholders::request)).on_message(std::bind(&coco_server::on_ws_message, this, std::placeholders::_1, std::placeholders::_2)).on_close(std::bind(&coco_server::on_ws_close, this, network::placeholders::request)).on_error(std::bind(&coco_server::on_ws_error, this, network::placeholders::request, std::placeholders::_2));
 
         schemas["property"] = {
-            {"description", "A property definition that can be one of several types: integer, float, string, symbol, item reference, or JSON object."},
-            {"oneOf", std::vector<json::json>{{"$ref", "#/components/schemas/int_property"}, {"$ref", "#/components/schemas/float_property"}, {"$ref", "#/components/schemas/string_property"}, {"$ref", "#/components/schemas/symbol_property"}, {"$ref", "#/components/schemas/item_property"}, {"$ref", "#/components/schemas/json_property"}}}};
+            {"description", "A property definition that can be one of several types: integer, float, string, symbol, item reference, JSON object, or geographic shape."},
+            {"oneOf", std::vector<json::json>{{"$ref", "#/components/schemas/int_property"}, {"$ref", "#/components/schemas/float_property"}, {"$ref", "#/components/schemas/string_property"}, {"$ref", "#/components/schemas/symbol_property"}, {"$ref", "#/components/schemas/item_property"}, {"$ref", "#/components/schemas/json_property"}, {"$ref", "#/components/schemas/geo_property"}, {"$ref", "#/components/schemas/vector_property"}}}};
+        schemas["archive"] = {
+            {"type", "object"},
+            {"description", "The lossy compression of the stored values of a single valued dynamic property, which keeps only the values needed to reconstruct its series within the deviation. Every value still reaches the item and its rules."},
+            {"properties",
+             {{"mode", {{"type", "string"}, {"enum", {"swinging_door", "deadband"}}, {"description", "Whether the series is reconstructed by linear interpolation (swinging_door, the default) or by holding the last stored value (deadband)."}}},
+              {"deviation", {{"type", "number"}, {"minimum", 0}, {"description", "The maximum error of the reconstructed series."}}}}},
+            {"required", std::vector<json::json>{"deviation"}}};
+        schemas["index"] = {
+            {"type", "string"},
+            {"enum", {"hash", "ordered"}},
+            {"description", "The secondary index of a static property, used to filter the items by equality (hash) or by equality and range (ordered)."}};
         schemas["int_property"] = {
             {"type", "object"},
             {"description", "A property that holds integer values, with optional constraints and default values."},
@@ -76,7 +198,9 @@ namespace coco
               {"multiple", {{"type", "boolean"}, {"description", "Whether this property can hold multiple values (array)."}}},
               {"default", {{"oneOf", std::vector<json::json>{{{"type", "integer"}}, {{"type", "array"}, {"items", {{"type", "integer"}}}}}}, {"description", "Default value(s) for this property."}}},
               {"min", {{"type", "integer"}, {"description", "Minimum allowed value for this property."}}},
-              {"max", {{"type", "integer"}, {"description", "Maximum allowed value for this property."}}}}},
+              {"max", {{"type", "integer"}, {"description", "Maximum allowed value for this property."}}},
+              {"archive", {{"$ref", "#/components/schemas/archive"}}},
+              {"index", {{"$ref", "#/components/schemas/index"}}}}},
             {"required", std::vector<json::json>{"type"}}};
         schemas["float_property"] = {
             {"type", "object"},
@@ -87,7 +211,9 @@ namespace coco
               {"multiple", {{"type", "boolean"}, {"description", "Whether this property can hold multiple values (array)."}}},
               {"default", {{"oneOf", std::vector<json::json>{{{"type", "number"}}, {{"type", "array"}, {"items", {{"type", "number"}}}}}}, {"description", "Default value(s) for this property."}}},
               {"min", {{"type", "number"}, {"description", "Minimum allowed value for this property."}}},
-              {"max", {{"type", "number"}, {"description", "Maximum allowed value for this property."}}}}},
+              {"max", {{"type", "number"}, {"description", "Maximum allowed value for this property."}}},
+              {"archive", {{"$ref", "#/components/schemas/archive"}}},
+              {"index", {{"$ref", "#/components/schemas/index"}}}}},
             {"required", std::vector<json::json>{"type"}}};
         schemas["string_property"] = {
             {"type", "object"},
@@ -96,7 +222,9 @@ namespace coco
              {{"type", {{"type", "string"}, {"enum", {"string"}}, {"description", "The property type identifier."}}},
               {"nullable", {{"type", "boolean"}, {"description", "Whether this property can be null."}}},
               {"multiple", {{"type", "boolean"}, {"description", "Whether this property can hold multiple values (array)."}}},
-              {"default", {{"oneOf", std::vector<json::json>{{{"type", "string"}}, {{"type", "array"}, {"items", {{"type", "string"}}}}}}, {"description", "Default value(s) for this property."}}}}},
+              {"default", {{"oneOf", std::vector<json::json>{{{"type", "string"}}, {{"type", "array"}, {"items", {{"type", "string"}}}}}}, {"description", "Default value(s) for this property."}}},
+              {"index", {{"$ref", "#/components/schemas/index"}}},
+              {"search", {{"type", "boolean"}, {"description", "Whether the items can be searched by the words of this property."}}}}},
             {"required", std::vector<json::json>{"type"}}};
         schemas["symbol_property"] = {
             {"type", "object"},
@@ -106,7 +234,9 @@ namespace coco
               {"nullable", {{"type", "boolean"}, {"description", "Whether this property can be null."}}},
               {"values", {{"type", "array"}, {"items", {{"type", "string"}}}, {"description", "The allowed symbolic values for this property."}}},
               {"multiple", {{"type", "boolean"}, {"description", "Whether this property can hold multiple values (array)."}}},
-              {"default", {{"oneOf", std::vector<json::json>{{{"type", "string"}}, {{"type", "array"}, {"items", {{"type", "string"}}}}}}, {"description", "Default value(s) for this property."}}}}},
+              {"default", {{"oneOf", std::vector<json::json>{{{"type", "string"}}, {{"type", "array"}, {"items", {{"type", "string"}}}}}}, {"description", "Default value(s) for this property."}}},
+              {"index", {{"$ref", "#/components/schemas/index"}}},
+              {"search", {{"type", "boolean"}, {"description", "Whether the items can be searched by the words of this property."}}}}},
             {"required", std::vector<json::json>{"type"}}};
         schemas["item_property"] = {
             {"type", "object"},
@@ -116,7 +246,9 @@ namespace coco
               {"nullable", {{"type", "boolean"}, {"description", "Whether this property can be null."}}},
               {"domain", {{"type", "string"}, {"description", "The type of objects that are allowed as values for this property."}}},
               {"multiple", {{"type", "boolean"}, {"description", "Whether this property can hold multiple values (array)."}}},
-              {"default", {{"oneOf", std::vector<json::json>{{{"type", "string"}, {"pattern", "^[a-fA-F0-9]{24}$"}}, {{"type", "array"}, {"items", {{"type", "string"}, {"pattern", "^[a-fA-F0-9]{24}$"}}}}}}, {"description", "Default ID value(s) for this property."}}}}},
+              {"default", {{"oneOf", std::vector<json::json>{{{"type", "string"}, {"pattern", "^[a-fA-F0-9]{24}$"}}, {{"type", "array"}, {"items", {{"type", "string"}, {"pattern", "^[a-fA-F0-9]{24}$"}}}}}}, {"description", "Default ID value(s) for this property."}}},
+              {"on_delete", {{"type", "string"}, {"enum", {"null", "cascade"}}, {"description", "Whether deleting a referenced item removes the reference (null, the default, the deletion being refused if the property is neither nullable nor multiple) or deletes the referencing item as well (cascade)."}}},
+              {"index", {{"$ref", "#/components/schemas/index"}}}}},
             {"required", std::vector<json::json>{"type", "domain"}}};
         schemas["json_property"] = {
             {"type", "object"},
@@ -127,6 +259,26 @@ namespace coco
               {"schema", {{"type", "object"}, {"description", "The JSON schema that validates the property's value."}}},
               {"default", {{"type", "object"}, {"description", "Default JSON object for this property."}}}}},
             {"required", std::vector<json::json>{"type", "schema"}}};
+        schemas["geo_property"] = {
+            {"type", "object"},
+            {"description", "A property that holds a geographic point, as a `{\"lat\": ..., \"lon\": ...}` object in degrees, or, if polygon, an array of at least three points. The items are spatially indexed on the property."},
+            {"properties",
+             {{"type", {{"type", "string"}, {"enum", {"geo"}}, {"description", "The property type identifier."}}},
+              {"nullable", {{"type", "boolean"}, {"description", "Whether this property can be null."}}},
+              {"polygon", {{"type", "boolean"}, {"description", "Whether this property holds polygons rather than points."}}}}},
+            {"required", std::vector<json::json>{"type"}}};
+        schemas["vector_property"] = {
+            {"type", "object"},
+            {"description", "A property that holds a vector of numbers, such as a spectrum or a waveform, either as an array of numbers or as a base64 string of its little-endian elements. The elements must be finite within the element type. The values are stored in the latter, compact, form."},
+            {"properties",
+             {{"type", {{"type", "string"}, {"enum", {"vector"}}, {"description", "The property type identifier."}}},
+              {"nullable", {{"type", "boolean"}, {"description", "Whether this property can be null."}}},
+              {"dtype", {{"type", "string"}, {"enum", {"f32", "f64", "i16"}}, {"description", "The type of the elements, f64 by default."}}},
+              {"length", {{"type", "integer"}, {"minimum", 0}, {"description", "The length of the vectors, if fixed."}}},
+              {"max_length", {{"type", "integer"}, {"minimum", 0}, {"description", "The maximum length of the vectors, not less than their length if fixed."}}},
+              {"min", {{"type", "number"}, {"description", "The minimum value allowed for the elements."}}},
+              {"max", {{"type", "number"}, {"description", "The maximum value allowed for the elements."}}}}},
+            {"required", std::vector<json::json>{"type"}}};
         schemas["type"] = {
             {"type", "object"},
             {"description", "A " COCO_NAME " type definition that describes the structure and behavior of items."},
@@ -134,7 +286,7 @@ namespace coco
              {{"name", {{"type", "string"}, {"description", "The unique name identifier for this type."}}},
               {"static_properties", {{"type", "object"}, {"additionalProperties", {{"$ref", "#/components/schemas/property"}}}, {"description", "Object containing static properties that define the fixed structure of items of this type. Keys are property names, values are property definitions."}}},
               {"dynamic_properties", {{"type", "object"}, {"additionalProperties", {{"$ref", "#/components/schemas/property"}}}, {"description", "Object containing dynamic properties that can store time-series data for items of this type. Keys are property names, values are property definitions."}}},
-              {"data", {{"type", "object"}, {"description", "Additional metadata or configuration data for this type."}}}}},
+              {"data", {{"type", "object"}, {"properties", {{"late", {{"type", "string"}, {"enum", {"apply", "store", "reject"}}, {"description", "How the values older than the current value of an item are handled: `apply` (the default) handles them as any other value, `store` only stores them in the history of the item and `reject` discards them."}}}, {"history", {{"type", "object"}, {"properties", {{"count", {{"type", "integer"}, {"minimum", 0}}}, {"duration", {{"type", "integer"}, {"minimum", 0}, {"description", "The time span, in seconds."}}}, {"properties", {{"type", "object"}, {"additionalProperties", {{"type", "object"}, {"properties", {{"count", {{"type", "integer"}, {"minimum", 0}}}, {"duration", {{"type", "integer"}, {"minimum", 0}}}}}, {"additionalProperties", false}}}, {"description", "The recent history of single dynamic properties, replacing the shared one."}}}}}, {"additionalProperties", false}, {"description", "The recent history kept in memory for the dynamic properties of the items, bounded by a count of values and/or a duration."}}}}}, {"description", "Additional metadata or configuration data for this type."}}}}},
             {"required", std::vector<json::json>{"name"}}};
         schemas["item"] = {
             {"type", "object"},
@@ -145,6 +297,26 @@ namespace coco
               {"properties", {{"type", "object"}, {"description", "Static data of the item defined by its type."}}},
               {"value", {{"type", "object"}, {"additionalProperties", {{"$ref", "#/components/schemas/data"}}}, {"description", "Dynamic data of the item defined by its type."}}}}},
             {"required", std::vector<json::json>{"id", "type"}}};
+        schemas["item_spec"] = {
+            {"type", "object"},
+            {"description", "The specification of a " COCO_NAME " item to be created in bulk."},
+            {"properties",
+             {{"name", {{"type", "string"}, {"description", "The name through which the other items of the batch can reference this item, as `{\"item\": name}` static property values."}}},
+              {"types", {{"type", "array"}, {"items", {{"type", "string"}}}, {"description", "The names of the types of the item."}}},
+              {"properties", {{"type", "object"}, {"description", "Static data of the item defined by its types."}}},
+              {"value", {{"type", "object"}, {"properties", {{"data", {{"type", "object"}}}, {"timestamp", {{"type", "integer"}, {"format", "int64"}}}}}, {"required", std::vector<json::json>{"data"}}, {"description", "The initial dynamic data of the item."}}}}}};
+        schemas["patch"] = {
+            {"type", "array"},
+            {"description", "A JSON patch (RFC 6902) of the static properties of a " COCO_NAME " item, extended with the `append`, `remove_at` and `set_path` operations."},
+            {"items",
+             {{"type", "object"},
+              {"properties",
+               {{"op", {{"type", "string"}, {"enum", std::vector<json::json>{"add", "remove", "replace", "move", "copy", "test", "append", "remove_at", "set_path"}}}},
+                {"path", {{"type", "string"}, {"description", "The JSON pointer of the target, whose first token is the name of a static property."}}},
+                {"from", {{"type", "string"}, {"description", "The JSON pointer of the source, for the `move` and `copy` operations."}}},
+                {"index", {{"type", "integer"}, {"minimum", 0}, {"description", "The index of the removed element, for the `remove_at` operation."}}},
+                {"value", {{"description", "The value, for the `add`, `replace`, `test`, `append` and `set_path` operations."}}}}},
+              {"required", std::vector<json::json>{"op", "path"}}}}};
         schemas["data"] = {
             {"type", "object"},
             {"description", "A data entry containing dynamic values and associated metadata for an item."},
@@ -186,7 +358,8 @@ namespace coco
 #endif
                              {"responses",
                               {{"204",
-                                {{"description", "Type created successfully."}}}}}}}};
+                                {{"description", "Type created successfully."}}},
+                               {"400", {{"description", "Invalid request"}}}}}}}};
         paths["/types/{name}"] = {{"get",
                                    {{"summary", "Retrieve a specific " COCO_NAME " type."},
                                     {"description", "Endpoint to fetch a specific type by name."},
@@ -226,7 +399,13 @@ namespace coco
                              {"parameters",
                               {{{"name", "type"}, {"description", "Filter items by type name."}, {"in", "query"}, {"required", false}, {"schema", {{"type", "string"}}}},
                                {{"name", "types"}, {"description", "Filter items by multiple type names (comma-separated)."}, {"in", "query"}, {"required", false}, {"schema", {{"type", "string"}}}},
-                               {{"name", "\"\""}, {"description", "Filter items by specific properties."}, {"in", "query"}, {"required", false}, {"style", "form"}, {"explode", true}, {"schema", {{"type", "object"}, {"additionalProperties", {{"type", "string"}}}}}}}},
+                               {{"name", "\"\""}, {"description", "Filter items by specific static properties, either by equality (`name=value`) or by comparison (`name.lt`, `name.le`, `name.gt` or `name.ge`). Numbers are compared numerically and strings lexicographically. The filters are answered through the secondary indexes declared on the static properties, when available."}, {"in", "query"}, {"required", false}, {"style", "form"}, {"explode", true}, {"schema", {{"type", "object"}, {"additionalProperties", {{"type", "string"}}}}}},
+                               {{"name", "within"}, {"description", "Filter items whose geographic property lies within a box, given as `min_lat,min_lon,max_lat,max_lon` (a minimum longitude greater than the maximum one crosses the antimeridian)."}, {"in", "query"}, {"required", false}, {"schema", {{"type", "string"}}}},
+                               {{"name", "near"}, {"description", "Filter items whose geographic property lies within a circle, given as `lat,lon,radius` with the radius in meters."}, {"in", "query"}, {"required", false}, {"schema", {{"type", "string"}}}},
+                               {{"name", "geo"}, {"description", "The geographic property the `within` and `near` filters apply to, by default the first geographic property of each type."}, {"in", "query"}, {"required", false}, {"schema", {{"type", "string"}}}},
+                               {{"name", "search"}, {"description", "Search items whose searchable static properties contain all the words of the text, or words starting with them. The items are sorted by relevance."}, {"in", "query"}, {"required", false}, {"schema", {{"type", "string"}}}},
+                               {{"name", "offset"}, {"description", "The number of items to skip. Without a search, the items are sorted by ID when paginated."}, {"in", "query"}, {"required", false}, {"schema", {{"type", "integer"}, {"minimum", 0}}}},
+                               {{"name", "limit"}, {"description", "The maximum number of items to return."}, {"in", "query"}, {"required", false}, {"schema", {{"type", "integer"}, {"minimum", 0}}}}}},
 #ifdef BUILD_AUTH
                              {"security", std::vector<json::json>{{"bearerAuth", std::vector<json::json>{}}}},
 #endif
@@ -234,6 +413,8 @@ namespace coco
                               {{"200",
                                 {{"description", "Successful response containing an array of all managed items with their properties and metadata."},
                                  {"content", {{"application/json", {{"schema", {{"type", "array"}, {"items", {{"$ref", "#/components/schemas/item"}}}}}}}}}}},
+                               {"400",
+                                {{"description", "Invalid filter"}}},
 #ifdef BUILD_AUTH
                                {"401", {{"$ref", "#/components/responses/UnauthorizedError"}}},
 #endif
@@ -257,6 +438,42 @@ namespace coco
                                {"401", {{"$ref", "#/components/responses/UnauthorizedError"}}}
 #endif
                               }}}}};
+        paths["/items/bulk"] = {{"post",
+                                 {{"summary", "Create several " COCO_NAME " items at once."},
+                                  {"description", "Endpoint to create, with a single bulk insert and a single inference run, the items of a batch, either as a JSON array or as newline delimited JSON. The items can reference each other through `{\"item\": name}` static property values."},
+                                  {"requestBody",
+                                   {{"required", true},
+                                    {"content", {{"application/json", {{"schema", {{"type", "array"}, {"items", {{"$ref", "#/components/schemas/item_spec"}}}}}}}, {"application/x-ndjson", {{"schema", {{"$ref", "#/components/schemas/item_spec"}}}}}}}}},
+#ifdef BUILD_AUTH
+                                  {"security", std::vector<json::json>{{"bearerAuth", std::vector<json::json>{}}}},
+#endif
+                                  {"responses",
+                                   {{"201",
+                                     {{"description", "Items created successfully."},
+                                      {"content", {{"application/json", {{"schema", {{"type", "array"}, {"items", {{"type", "string"}, {"pattern", "^[a-fA-F0-9]{24}$"}}}, {"description", "The IDs of the newly created items, in the order of the batch."}}}}}}}}},
+                                    {"400", {{"description", "Invalid request"}}},
+#ifdef BUILD_AUTH
+                                    {"401", {{"$ref", "#/components/responses/UnauthorizedError"}}},
+#endif
+                                    {"404",
+                                     {{"description", "Type not found"}}}}}}}};
+        paths["/items/{id}/referrers"] = {{"get",
+                                           {{"summary", "Retrieve the items referencing a specific " COCO_NAME " item."},
+                                            {"description", "Endpoint to fetch, through the reverse reference index, the items whose static or dynamic item properties reference a specific item."},
+                                            {"parameters",
+                                             {{{"name", "id"}, {"description", "The ID of the referenced " COCO_NAME " item."}, {"in", "path"}, {"required", true}, {"schema", {{"type", "string"}, {"pattern", "^[a-fA-F0-9]{24}$"}}}}}},
+#ifdef BUILD_AUTH
+                                            {"security", std::vector<json::json>{{"bearerAuth", std::vector<json::json>{}}}},
+#endif
+                                            {"responses",
+                                             {{"200",
+                                               {{"description", "Successful response containing the referencing items, each with its referencing property."},
+                                                {"content", {{"application/json", {{"schema", {{"type", "array"}, {"items", {{"type", "object"}, {"properties", {{"id", {{"type", "string"}, {"pattern", "^[a-fA-F0-9]{24}$"}}}, {"property", {{"type", "string"}}}}}}}}}}}}}}},
+#ifdef BUILD_AUTH
+                                              {"401", {{"$ref", "#/components/responses/UnauthorizedError"}}},
+#endif
+                                              {"404",
+                                               {{"description", "Item not found"}}}}}}}};
         paths["/items/{id}"] = {{"get",
                                  {{"summary", "Retrieve a specific " COCO_NAME " item."},
                                   {"description", "Endpoint to fetch a specific item by ID."},
@@ -273,18 +490,20 @@ namespace coco
                                      {{"description", "Item not found"}}}}}}},
                                 {"patch",
                                  {{"summary", "Update a specific " COCO_NAME " item."},
-                                  {"description", "Endpoint to update a specific item by ID. You can provide partial updates for the item's properties."},
+                                  {"description", "Endpoint to update a specific item by ID. You can provide partial updates for the item's properties, either as new property values or as a JSON patch (RFC 6902) whose paths start with the name of a static property. Besides the standard operations, the patch can use the `append` (adds `value` at the end of the array at `path`), `remove_at` (removes the element at `index` of the array at `path`) and `set_path` (sets `value` at `path`, creating the missing parent objects) operations."},
                                   {"parameters",
                                    {{{"name", "id"}, {"description", "The ID of the specific " COCO_NAME " item to update."}, {"in", "path"}, {"required", true}, {"schema", {{"type", "string"}, {"pattern", "^[a-fA-F0-9]{24}$"}}}}}},
                                   {"requestBody",
                                    {{"required", true},
-                                    {"content", {{"application/json", {{"schema", {{"$ref", "#/components/schemas/item"}}}}}}}}},
+                                    {"content", {{"application/json", {{"schema", {{"oneOf", std::vector<json::json>{{{"$ref", "#/components/schemas/item"}}, {{"$ref", "#/components/schemas/patch"}}, {{"type", "object"}, {"properties", {{"patch", {{"$ref", "#/components/schemas/patch"}}}}}, {"required", std::vector<json::json>{"patch"}}}}}}}}}}}}},
 #ifdef BUILD_AUTH
                                   {"security", std::vector<json::json>{{"bearerAuth", std::vector<json::json>{}}}},
 #endif
                                   {"responses",
                                    {{"204",
                                      {{"description", "Item updated successfully."}}},
+                                    {"400",
+                                     {{"description", "Invalid patch"}}},
 #ifdef BUILD_AUTH
                                     {"401", {{"$ref", "#/components/responses/UnauthorizedError"}}},
 #endif
@@ -292,7 +511,7 @@ namespace coco
                                      {{"description", "Item not found"}}}}}}},
                                 {"delete",
                                  {{"summary", "Delete a specific " COCO_NAME " item."},
-                                  {"description", "Endpoint to delete a specific item by ID."},
+                                  {"description", "Endpoint to delete a specific item by ID. The items referencing it are deleted as well if their referencing property cascades, otherwise the reference is removed from them, provided that their referencing property can be nulled."},
                                   {"parameters",
                                    {{{"name", "id"}, {"description", "The ID of the specific " COCO_NAME " item to delete."}, {"in", "path"}, {"required", true}, {"schema", {{"type", "string"}, {"pattern", "^[a-fA-F0-9]{24}$"}}}}}},
 #ifdef BUILD_AUTH
@@ -305,21 +524,32 @@ namespace coco
                                     {"401", {{"$ref", "#/components/responses/UnauthorizedError"}}},
 #endif
                                     {"404",
-                                     {{"description", "Item not found"}}}}}}}};
+                                     {{"description", "Item not found"}}},
+                                    {"409",
+                                     {{"description", "Item referenced through a property which neither cascades nor can be nulled"}}}}}}}};
         paths["/data/{id}"] = {{"get",
                                 {{"summary", "Retrieve data for a specific " COCO_NAME " item."},
                                  {"description", "Endpoint to fetch data for a specific item by ID. You can filter data by providing 'from' and 'to' query parameters."},
                                  {"parameters",
                                   {{{"name", "id"}, {"description", "The ID of the " COCO_NAME " item."}, {"in", "path"}, {"required", true}, {"schema", {{"type", "string"}, {"pattern", "^[a-fA-F0-9]{24}$"}}}},
                                    {{"name", "from"}, {"description", "Start date for filtering data."}, {"in", "query"}, {"schema", {{"type", "string"}, {"format", "date-time"}}}},
-                                   {{"name", "to"}, {"description", "End date for filtering data."}, {"in", "query"}, {"schema", {{"type", "string"}, {"format", "date-time"}}}}}},
+                                   {{"name", "to"}, {"description", "End date for filtering data."}, {"in", "query"}, {"schema", {{"type", "string"}, {"format", "date-time"}}}},
+                                   {{"name", "resolution"}, {"description", "Resolution, in seconds, of the rollups to retrieve instead of the raw data. Each bucket holds the count, sum, min, max and last value of the numeric properties."}, {"in", "query"}, {"schema", {{"type", "integer"}}}},
+                                   {{"name", "aggregate"}, {"description", "Aggregate function applied to each bucket of the raw data, computed while streaming it from the database."}, {"in", "query"}, {"schema", {{"type", "string"}, {"enum", {"avg", "min", "max", "count", "first", "last", "percentile", "rate"}}}}},
+                                   {{"name", "bucket"}, {"description", "Width, in milliseconds, of the buckets of the aggregation."}, {"in", "query"}, {"schema", {{"type", "integer"}, {"minimum", 1}, {"default", 60000}}}},
+                                   {{"name", "percentile"}, {"description", "Percentile computed by the 'percentile' aggregate function."}, {"in", "query"}, {"schema", {{"type", "number"}, {"minimum", 0}, {"maximum", 100}, {"default", 50}}}},
+                                   {{"name", "properties"}, {"description", "Comma separated list of the dynamic properties to aggregate."}, {"in", "query"}, {"schema", {{"type", "string"}}}},
+                                   {{"name", "limit"}, {"description", "Maximum number of data to retrieve. When provided, the response is a page holding the data and, if more data are available, the token of the next page."}, {"in", "query"}, {"schema", {{"type", "integer"}, {"minimum", 1}}}},
+                                   {{"name", "token"}, {"description", "Continuation token of the page to retrieve, as returned by the previous page."}, {"in", "query"}, {"schema", {{"type", "string"}}}},
+                                   {{"name", "fields"}, {"description", "Comma separated list of the dynamic properties to retrieve."}, {"in", "query"}, {"schema", {{"type", "string"}}}}}},
 #ifdef BUILD_AUTH
                                  {"security", std::vector<json::json>{{"bearerAuth", std::vector<json::json>{}}}},
 #endif
                                  {"responses",
                                   {{"200",
-                                    {{"description", "Successful response with the item data."},
-                                     {"content", {{"application/json", {{"schema", {{"type", "array"}, {"items", {{"$ref", "#/components/schemas/data"}}}}}}}}}}},
+                                    {{"description", "Successful response with the item data, or with a page of the item data if 'limit' or 'token' are provided."},
+                                     {"content", {{"application/json", {{"schema", {{"oneOf", std::vector<json::json>{{{"type", "array"}, {"items", {{"$ref", "#/components/schemas/data"}}}}, {{"type", "object"}, {"properties", {{"values", {{"type", "array"}, {"items", {{"$ref", "#/components/schemas/data"}}}}}, {"next", {{"type", "string"}}}}}, {"required", std::vector<json::json>{"values"}}}}}}}}}}}}},
+                                    {"400", {{"description", "Invalid request"}}},
 #ifdef BUILD_AUTH
                                    {"401", {{"$ref", "#/components/responses/UnauthorizedError"}}},
 #endif
@@ -345,6 +575,45 @@ namespace coco
 #endif
                                    {"404",
                                     {{"description", "Item not found."}}}}}}}};
+        paths["/data/{id}/backfill"] = {{"post",
+                                         {{"summary", "Backfill past data of a specific " COCO_NAME " item."},
+                                          {"description", "Endpoint to upload, in bulk, past data of a specific item by ID, such as the readings buffered by a gateway while disconnected. The data are stored without firing the rules on each of them: the value of the item is updated once, and only if the data contain values newer than the current one."},
+                                          {"parameters",
+                                           {{{"name", "id"}, {"description", "The ID of the " COCO_NAME " item."}, {"in", "path"}, {"required", true}, {"schema", {{"type", "string"}, {"pattern", "^[a-fA-F0-9]{24}$"}}}}}},
+                                          {"requestBody",
+                                           {{"required", true},
+                                            {"content", {{"application/json", {{"schema", {{"type", "array"}, {"items", {{"$ref", "#/components/schemas/data"}}}}}}}}}}},
+#ifdef BUILD_AUTH
+                                          {"security", std::vector<json::json>{{"bearerAuth", std::vector<json::json>{}}}},
+#endif
+                                          {"responses",
+                                           {{"204",
+                                             {{"description", "Data backfilled successfully."}}},
+                                            {"400", {{"description", "Invalid request"}}},
+#ifdef BUILD_AUTH
+                                            {"401", {{"$ref", "#/components/responses/UnauthorizedError"}}},
+#endif
+                                            {"404",
+                                             {{"description", "Item not found."}}}}}}}};
+        paths["/data/query"] = {{"post",
+                                  {{"summary", "Retrieve data for several " COCO_NAME " items."},
+                                   {"description", "Endpoint to fetch, with a single query, the data of the given items or of the instances of a type whose static properties match a filter. The data are grouped per item."},
+                                   {"requestBody",
+                                    {{"required", true},
+                                     {"content", {{"application/json", {{"schema", {{"type", "object"}, {"properties", {{"items", {{"type", "array"}, {"items", {{"type", "string"}}}}}, {"type", {{"type", "string"}}}, {"filter", {{"type", "object"}}}, {"from", {{"type", "integer"}}}, {"to", {{"type", "integer"}}}, {"fields", {{"type", "array"}, {"items", {{"type", "string"}}}}}}}}}}}}}}},
+#ifdef BUILD_AUTH
+                                   {"security", std::vector<json::json>{{"bearerAuth", std::vector<json::json>{}}}},
+#endif
+                                   {"responses",
+                                    {{"200",
+                                      {{"description", "Successful response with the data of each item."},
+                                       {"content", {{"application/json", {{"schema", {{"type", "object"}, {"additionalProperties", {{"type", "array"}, {"items", {{"$ref", "#/components/schemas/data"}}}}}}}}}}}}},
+                                     {"400", {{"description", "Invalid request"}}},
+#ifdef BUILD_AUTH
+                                     {"401", {{"$ref", "#/components/responses/UnauthorizedError"}}},
+#endif
+                                     {"404",
+                                      {{"description", "Item or type not found."}}}}}}}};
         paths["/fake/{type}"] = {{"get",
                                   {{"summary", "Generate fake data for testing."},
                                    {"description", "Endpoint to generate fake data for testing purposes."},
@@ -400,6 +669,8 @@ namespace coco
         auth_mdwr.add_authorized_path(network::Delete, "^/types/.*$", {0});
         auth_mdwr.add_authorized_path(network::Get, "^/items$", {0, 1});
         auth_mdwr.add_authorized_path(network::Post, "^/items$", {0});
+        auth_mdwr.add_authorized_path(network::Post, "^/items/bulk$", {0});
+        auth_mdwr.add_authorized_path(network::Get, "^/items/[^/?]+/referrers$", {0, 1});
         auth_mdwr.add_authorized_path(network::Get, "^/items/.*$", {0, 1}, true);
         auth_mdwr.add_authorized_path(network::Delete, "^/items/.*$", {0});
         auth_mdwr.add_authorized_path(network::Get, "^/data/.*$", {0, 1}, true);
@@ -514,8 +785,15 @@ namespace coco
         if (body.contains("data"))
             data = std::move(body["data"]);
 
-        [[maybe_unused]] auto &tp = get_coco().create_type(name, std::move(static_props), std::move(dynamic_props), std::move(data));
-        return std::make_unique<network::response>(network::status_code::no_content);
+        try
+        {
+            [[maybe_unused]] auto &tp = get_coco().create_type(name, std::move(static_props), std::move(dynamic_props), std::move(data));
+            return std::make_unique<network::response>(network::status_code::no_content);
+        }
+        catch (const std::exception &e)
+        {
+            return std::make_unique<network::json_response>(json::json({{"message", e.what()}}), network::status_code::bad_request);
+        }
     }
     std::unique_ptr<network::response> coco_server::delete_type(const network::request &req)
     {
@@ -535,67 +813,139 @@ namespace coco
         std::map<std::string, std::string> filter;
         if (req.get_target().find('?') != std::string::npos)
             filter = network::parse_query(req.get_target().substr(req.get_target().find('?') + 1));
-        json::json is(json::json_type::array);
+        std::vector<std::string> tp_names;
         if (filter.count("type")) // filter by type
+            tp_names.push_back(filter["type"]);
+        else if (filter.count("types")) // filter by multiple types
+            tp_names = network::split_string(filter["types"], ',');
+        filter.erase("type");
+        filter.erase("types");
+        std::optional<json::json> area; // the area the geographic property of the items must lie within, if any..
+        std::optional<std::string> geo_prop;
+        if (filter.count("geo"))
+            geo_prop = filter["geo"];
+        filter.erase("geo");
+        for (const auto par : {"within", "near"})
+            if (filter.count(par))
+            {
+                if (area)
+                    return std::make_unique<network::json_response>(json::json({{"message", "The `within` and `near` parameters are mutually exclusive"}}), network::status_code::bad_request);
+                try
+                {
+                    area = parse_area(par, filter[par]);
+                }
+                catch (const std::exception &e)
+                {
+                    return std::make_unique<network::json_response>(json::json({{"message", e.what()}}), network::status_code::bad_request);
+                }
+                filter.erase(par);
+            }
+
+        std::vector<std::reference_wrapper<type>> types;
+        for (auto &tp_name : tp_names)
             try
             {
-                auto &tp = get_coco().get_type(filter["type"]);
-                for (auto &itm : get_coco().get_items(tp))
-                    if (std::all_of(filter.begin(), filter.end(), [&](const auto &p)
-                                    { return p.first == "type" || (itm.get().get_properties().contains(p.first) && itm.get().get_properties()[p.first] == p.second); }))
-                    {
-                        auto j_itm = itm.get().to_json();
-                        j_itm["id"] = itm.get().get_id();
-                        is.push_back(std::move(j_itm));
-                    }
-                return std::make_unique<network::json_response>(std::move(is));
+                types.push_back(get_coco().get_type(tp_name));
             }
             catch (const std::exception &)
             {
-                return std::make_unique<network::json_response>(json::json({{"message", "Type `" + filter["type"] + "` not found"}}), network::status_code::not_found);
+                return std::make_unique<network::json_response>(json::json({{"message", "Type `" + tp_name + "` not found"}}), network::status_code::not_found);
             }
-        else if (filter.count("types")) // filter by multiple types
+
+        std::optional<std::string> search; // the text the searchable properties of the items must contain, if any..
+        if (filter.count("search"))
+            search = filter["search"];
+        filter.erase("search");
+        size_t offset = 0, limit = std::numeric_limits<size_t>::max();
+        try
         {
-            std::vector<std::reference_wrapper<type>> types;
-            auto tp_names = network::split_string(filter["types"], ',');
-            for (auto &tp_name : tp_names)
-                try
-                {
-                    types.push_back(get_coco().get_type(tp_name));
-                }
-                catch (const std::exception &)
-                {
-                    return std::make_unique<network::json_response>(json::json({{"message", "Type `" + tp_name + "` not found"}}), network::status_code::not_found);
-                }
-            std::unordered_set<std::string> seen_ids;
-            for (auto &tp : types)
-                for (auto &itm : get_coco().get_items(tp))
+            if (filter.count("offset"))
+                offset = parse_count("offset", filter["offset"], 0);
+            if (filter.count("limit"))
+                limit = parse_count("limit", filter["limit"], 0);
+        }
+        catch (const std::exception &e)
+        {
+            return std::make_unique<network::json_response>(json::json({{"message", e.what()}}), network::status_code::bad_request);
+        }
+        const bool paginated = filter.count("offset") || filter.count("limit");
+        filter.erase("offset");
+        filter.erase("limit");
+
+        std::vector<std::pair<std::reference_wrapper<item>, double>> res; // the items, with their relevance when searched..
+        std::unordered_map<std::string, size_t> res_idx;                   // the position of the items within the results, by ID..
+        const auto add_items = [&res, &res_idx](std::vector<std::pair<std::reference_wrapper<item>, double>> &&itms)
+        {
+            for (auto &[itm, score] : itms)
+                if (auto [it, inserted] = res_idx.emplace(itm.get().get_id(), res.size()); inserted)
+                    res.emplace_back(itm, score);
+                else // items of more types keep their best relevance..
+                    res[it->second].second = std::max(res[it->second].second, score);
+        };
+        const auto found = [](std::vector<std::reference_wrapper<item>> &&itms)
+        {
+            std::vector<std::pair<std::reference_wrapper<item>, double>> r;
+            r.reserve(itms.size());
+            for (auto &itm : itms)
+                r.emplace_back(itm, 0.0);
+            return r;
+        };
+        try
+        {
+            if (area && types.empty() && !geo_prop)
+            { // the spatially indexed types are searched..
+                for (auto &tp : get_coco().get_types())
+                    if (geo_property_of(tp))
+                        types.push_back(tp);
+                if (types.empty())
+                    return std::make_unique<network::json_response>(json::json(json::json_type::array));
+            }
+            if (types.empty())
+            {
+                std::vector<item_filter> filters;
+                for (const auto &[par, val] : filter)
+                    filters.push_back(to_filter(par, val, nullptr));
+                if (area)
+                    filters.push_back({*geo_prop, filter_op::within, *area});
+                add_items(search ? get_coco().search_items(*search, filters) : found(get_coco().find_items(filters)));
+            }
+            else
+                for (const type &tp : types)
                 {
+                    std::vector<item_filter> filters;
                     for (const auto &[par, val] : filter)
-                        if (par != "types" && (!itm.get().get_properties().contains(par) || itm.get().get_properties()[par] != val))
-                            continue; // skip items that do not match the filter
-                    auto j_itm = itm.get().to_json();
-                    if (seen_ids.count(itm.get().get_id()) == 0)
+                        filters.push_back(to_filter(par, val, &tp));
+                    if (area)
                     {
-                        j_itm["id"] = itm.get().get_id();
-                        is.push_back(std::move(j_itm));
-                        seen_ids.insert(itm.get().get_id());
+                        const auto tp_geo_prop = geo_prop ? geo_prop : geo_property_of(tp);
+                        if (!tp_geo_prop)
+                            continue; // the items of the type have no position..
+                        filters.push_back({*tp_geo_prop, filter_op::within, *area});
                     }
+                    add_items(search ? get_coco().search_items(tp, *search, filters) : found(get_coco().find_items(tp, filters)));
                 }
-            return std::make_unique<network::json_response>(std::move(is));
         }
-        else
-            for (auto &itm : get_coco().get_items())
-            {
-                for (const auto &[par, val] : filter)
-                    if (!itm.get().get_properties().contains(par) || itm.get().get_properties()[par] != val)
-                        continue; // skip items that do not match the filter
-                auto j_itm = itm.get().to_json();
-                j_itm["id"] = itm.get().get_id();
-                is.push_back(std::move(j_itm));
-            }
+        catch (const std::exception &e)
+        {
+            return std::make_unique<network::json_response>(json::json({{"message", e.what()}}), network::status_code::bad_request);
+        }
+
+        if (search) // the most relevant items first..
+            std::stable_sort(res.begin(), res.end(), [](const auto &a, const auto &b)
+                             { return a.second > b.second; });
+        else if (paginated) // the pages are stable as long as the items do not change..
+            std::sort(res.begin(), res.end(), [](const auto &a, const auto &b)
+                      { return a.first.get().get_id() < b.first.get().get_id(); });
+        json::json is(json::json_type::array);
+        for (size_t i = offset; i < res.size() && i - offset < limit; ++i)
+        {
+            auto j_itm = res[i].first.get().to_json();
+            j_itm["id"] = res[i].first.get().get_id();
+            is.push_back(std::move(j_itm));
+        }
         return std::make_unique<network::json_response>(std::move(is));
     }
+
     std::unique_ptr<network::response> coco_server::get_item(const network::request &req)
     {
         try
@@ -610,6 +960,22 @@ namespace coco
             return std::make_unique<network::json_response>(json::json({{"message", "Item not found"}}), network::status_code::not_found);
         }
     }
+    std::unique_ptr<network::response> coco_server::get_referrers(const network::request &req)
+    {
+        const auto &target = req.get_target();
+        try
+        { // get the referrers of the item by id in the path
+            auto &itm = get_coco().get_item(target.substr(7, target.size() - 7 - std::string_view("/referrers").size()));
+            json::json refs(json::json_type::array);
+            for (const auto &[ref, p_name] : get_coco().get_referrers(itm))
+                refs.push_back(json::json{{"id", ref.get().get_id()}, {"property", p_name}});
+            return std::make_unique<network::json_response>(std::move(refs));
+        }
+        catch (const std::exception &)
+        {
+            return std::make_unique<network::json_response>(json::json({{"message", "Item not found"}}), network::status_code::not_found);
+        }
+    }
     std::unique_ptr<network::response> coco_server::create_item(const network::request &req)
     {
         auto &body = static_cast<const network::json_request &>(req).get_body();
@@ -646,9 +1012,94 @@ namespace coco
             return std::make_unique<network::json_response>(json::json({{"message", e.what()}}), network::status_code::conflict);
         }
     }
+    std::unique_ptr<network::response> coco_server::create_items(const network::request &req)
+    {
+        json::json body;
+        try
+        {
+            if (auto j_req = dynamic_cast<const network::json_request *>(&req))
+                body = j_req->get_body();
+            else if (auto s_req = dynamic_cast<const network::string_request *>(&req))
+            { // newline delimited JSON, one item per line..
+                body = json::json(json::json_type::array);
+                std::istringstream in(s_req->get_body());
+                for (std::string line; std::getline(in, line);)
+                    if (line.find_first_not_of(" \t\r") != std::string::npos)
+                        body.push_back(json::load(line));
+            }
+        }
+        catch (const std::exception &)
+        {
+            return std::make_unique<network::json_response>(json::json({{"message", "Invalid request"}}), network::status_code::bad_request);
+        }
+        if (!body.is_array())
+            return std::make_unique<network::json_response>(json::json({{"message", "Invalid request"}}), network::status_code::bad_request);
+
+        std::vector<item_spec> specs;
+        specs.reserve(body.size());
+        for (auto &j_spec : body.as_array())
+        {
+            if (!j_spec.is_object() || (j_spec.contains("name") && !j_spec["name"].is_string()) || (j_spec.contains("types") && !j_spec["types"].is_array()) || (j_spec.contains("properties") && !j_spec["properties"].is_object()) || (j_spec.contains("value") && (!j_spec["value"].is_object() || !j_spec["value"].contains("data") || !j_spec["value"]["data"].is_object() || (j_spec["value"].contains("timestamp") && !j_spec["value"]["timestamp"].is_integer()))))
+                return std::make_unique<network::json_response>(json::json({{"message", "Invalid request"}}), network::status_code::bad_request);
+            item_spec spec;
+            if (j_spec.contains("name"))
+                spec.name = j_spec["name"].get<std::string>();
+            if (j_spec.contains("types"))
+                for (auto &tp_name : j_spec["types"].as_array())
+                {
+                    if (!tp_name.is_string())
+                        return std::make_unique<network::json_response>(json::json({{"message", "Invalid request"}}), network::status_code::bad_request);
+                    try
+                    {
+                        spec.types.push_back(get_coco().get_type(tp_name.get<std::string>()));
+                    }
+                    catch (const std::exception &)
+                    {
+                        return std::make_unique<network::json_response>(json::json({{"message", "Type `" + tp_name.get<std::string>() + "` not found"}}), network::status_code::not_found);
+                    }
+                }
+            if (j_spec.contains("properties"))
+                spec.props = std::move(j_spec["properties"]);
+            if (j_spec.contains("value"))
+                spec.value = std::make_pair(std::move(j_spec["value"]["data"]), j_spec["value"].contains("timestamp") ? std::chrono::system_clock::time_point(std::chrono::milliseconds{j_spec["value"]["timestamp"].get<int64_t>()}) : std::chrono::system_clock::now());
+            specs.push_back(std::move(spec));
+        }
+        try
+        {
+            json::json ids(json::json_type::array);
+            for (const item &itm : get_coco().create_items(std::move(specs)))
+                ids.push_back(itm.get_id());
+            return std::make_unique<network::json_response>(std::move(ids), network::status_code::created);
+        }
+        catch (const std::exception &e)
+        {
+            return std::make_unique<network::json_response>(json::json({{"message", e.what()}}), network::status_code::bad_request);
+        }
+    }
     std::unique_ptr<network::response> coco_server::update_item(const network::request &req)
     {
         auto &body = static_cast<const network::json_request &>(req).get_body();
+        if (body.is_array() || (body.is_object() && body.contains("patch")))
+        { // a JSON patch of the properties of the item..
+            item *itm = nullptr;
+            try
+            {
+                itm = &get_coco().get_item(req.get_target().substr(7));
+            }
+            catch (const std::exception &)
+            {
+                return std::make_unique<network::json_response>(json::json({{"message", "Item not found"}}), network::status_code::not_found);
+            }
+            try
+            {
+                get_coco().patch_properties(*itm, body.is_array() ? body : body["patch"]);
+                return std::make_unique<network::response>(network::status_code::no_content);
+            }
+            catch (const std::invalid_argument &e)
+            {
+                return std::make_unique<network::json_response>(json::json({{"message", e.what()}}), network::status_code::bad_request);
+            }
+        }
         if (!body.is_object())
             return std::make_unique<network::json_response>(json::json({{"message", "Invalid request"}}), network::status_code::bad_request);
 
@@ -671,15 +1122,24 @@ namespace coco
     }
     std::unique_ptr<network::response> coco_server::delete_item(const network::request &req)
     {
+        item *itm = nullptr;
         try
         { // get item by id in the path
-            get_coco().delete_item(get_coco().get_item(req.get_target().substr(7)));
-            return std::make_unique<network::response>(network::status_code::no_content);
+            itm = &get_coco().get_item(req.get_target().substr(7));
         }
         catch (const std::exception &)
         {
             return std::make_unique<network::json_response>(json::json({{"message", "Item not found"}}), network::status_code::not_found);
         }
+        try
+        {
+            get_coco().delete_item(*itm);
+            return std::make_unique<network::response>(network::status_code::no_content);
+        }
+        catch (const std::exception &e)
+        { // the item is still referenced..
+            return std::make_unique<network::json_response>(json::json({{"message", e.what()}}), network::status_code::conflict);
+        }
     }
 
     std::unique_ptr<network::response> coco_server::get_data(const network::request &req)
@@ -701,10 +1161,113 @@ namespace coco
         {
             return std::make_unique<network::json_response>(json::json({{"message", "Item not found"}}), network::status_code::not_found);
         }
-        std::chrono::system_clock::time_point to = params.count("to") ? std::chrono::system_clock::time_point(std::chrono::milliseconds{std::stol(params.at("to"))}) : std::chrono::system_clock::time_point();
+        std::chrono::system_clock::time_point to = params.count("to") ? std::chrono::system_clock::time_point(std::chrono::milliseconds{std::stol(params.at("to"))}) : std::chrono::system_clock::now();
         std::chrono::system_clock::time_point from = params.count("from") ? std::chrono::system_clock::time_point(std::chrono::milliseconds{std::stol(params.at("from"))}) : to - std::chrono::hours{24 * 7};
+        if (params.count("resolution"))
+        {
+            try
+            {
+                return std::make_unique<network::json_response>(get_coco().get_values(*itm, std::chrono::seconds{std::stol(params.at("resolution"))}, from, to));
+            }
+            catch (const std::exception &e)
+            {
+                return std::make_unique<network::json_response>(json::json({{"message", e.what()}}), network::status_code::bad_request);
+            }
+        }
+        if (params.count("aggregate"))
+        {
+            try
+            {
+                aggregation agg;
+                agg.fn = to_aggregate_fn(params.at("aggregate"));
+                if (params.count("bucket"))
+                    agg.bucket = std::chrono::milliseconds{std::stol(params.at("bucket"))};
+                if (params.count("percentile"))
+                    agg.percentile = std::stod(params.at("percentile"));
+                if (params.count("properties"))
+                    agg.properties = split_list(params.at("properties"));
+                return std::make_unique<network::json_response>(get_coco().get_values(*itm, agg, from, to));
+            }
+            catch (const std::exception &e)
+            {
+                return std::make_unique<network::json_response>(json::json({{"message", e.what()}}), network::status_code::bad_request);
+            }
+        }
+        if (params.count("limit") || params.count("token") || params.count("fields"))
+        {
+            try
+            {
+                const bool paged = params.count("limit") || params.count("token");
+                const size_t limit = params.count("limit") ? parse_count("limit", params.at("limit"), 1) : std::numeric_limits<size_t>::max();
+                json::json values(json::json_type::array);
+                auto next = get_coco().get_values(*itm, params.count("fields") ? split_list(params.at("fields")) : std::vector<std::string>{}, from, to, limit, [&values](json::json &&row)
+                                                  { values.push_back(std::move(row)); }, params.count("token") ? params.at("token") : "");
+                if (!paged)
+                    return std::make_unique<network::json_response>(std::move(values));
+                json::json page{{"values", std::move(values)}};
+                if (next)
+                    page["next"] = *next;
+                return std::make_unique<network::json_response>(std::move(page));
+            }
+            catch (const std::exception &e)
+            {
+                return std::make_unique<network::json_response>(json::json({{"message", e.what()}}), network::status_code::bad_request);
+            }
+        }
         return std::make_unique<network::json_response>(get_coco().get_values(*itm, from, to));
     }
+    std::unique_ptr<network::response> coco_server::query_data(const network::request &req)
+    {
+        auto &body = static_cast<const network::json_request &>(req).get_body();
+        const auto is_string_array = [](const json::json &j)
+        { return j.is_array() && std::all_of(j.as_array().begin(), j.as_array().end(), [](const json::json &el)
+                                             { return el.is_string(); }); };
+        if (!body.is_object() || (!body.contains("items") && !body.contains("type")) || (body.contains("items") && !is_string_array(body["items"])) || (body.contains("type") && !body["type"].is_string()) || (body.contains("filter") && !body["filter"].is_object()) || (body.contains("fields") && !is_string_array(body["fields"])) || (body.contains("from") && !body["from"].is_integer()) || (body.contains("to") && !body["to"].is_integer()))
+            return std::make_unique<network::json_response>(json::json({{"message", "Invalid request"}}), network::status_code::bad_request);
+        std::chrono::system_clock::time_point to = body.contains("to") ? std::chrono::system_clock::time_point(std::chrono::milliseconds{body["to"].get<int64_t>()}) : std::chrono::system_clock::now();
+        std::chrono::system_clock::time_point from = body.contains("from") ? std::chrono::system_clock::time_point(std::chrono::milliseconds{body["from"].get<int64_t>()}) : to - std::chrono::hours{24 * 7};
+        std::vector<std::string> fields;
+        if (body.contains("fields"))
+            for (const auto &field : body["fields"].as_array())
+                fields.push_back(field.get<std::string>());
+
+        json::json res(json::json_type::object);
+        const auto append = [&res](const std::string &itm_id, json::json &&row)
+        {
+            if (!res.contains(itm_id))
+                res[itm_id] = json::json(json::json_type::array);
+            res[itm_id].push_back(std::move(row));
+        };
+        std::vector<std::string> itm_ids;
+        if (body.contains("items"))
+            for (const auto &itm_id : body["items"].as_array())
+                itm_ids.push_back(itm_id.get<std::string>());
+        type *tp = nullptr;
+        try
+        {
+            if (body.contains("type"))
+                tp = &get_coco().get_type(body["type"].get<std::string>());
+            else
+                for (const auto &itm_id : itm_ids)
+                    [[maybe_unused]] auto &itm = get_coco().get_item(itm_id);
+        }
+        catch (const std::exception &e)
+        {
+            return std::make_unique<network::json_response>(json::json({{"message", e.what()}}), network::status_code::not_found);
+        }
+        try
+        {
+            if (tp)
+                get_coco().get_values(*tp, body.contains("filter") ? body["filter"] : json::json(json::json_type::object), fields, from, to, append);
+            else
+                get_coco().get_values(itm_ids, fields, from, to, append);
+            return std::make_unique<network::json_response>(std::move(res));
+        }
+        catch (const std::exception &e)
+        {
+            return std::make_unique<network::json_response>(json::json({{"message", e.what()}}), network::status_code::bad_request);
+        }
+    }
     std::unique_ptr<network::response> coco_server::set_datum(const network::request &req)
     {
         // get item by id in the path
@@ -736,6 +1299,42 @@ namespace coco
         }
     }
 
+    std::unique_ptr<network::response> coco_server::backfill_data(const network::request &req)
+    {
+        // get item by id in the path
+        auto id = req.get_target().substr(6);
+        id = id.substr(0, id.find('/'));
+        auto &body = static_cast<const network::json_request &>(req).get_body();
+        if (!body.is_array())
+            return std::make_unique<network::json_response>(json::json({{"message", "Invalid request"}}), network::status_code::bad_request);
+        std::vector<std::pair<json::json, std::chrono::system_clock::time_point>> series;
+        series.reserve(body.size());
+        for (const auto &datum : body.as_array())
+        {
+            if (!datum.is_object() || !datum.contains("data") || !datum["data"].is_object() || !datum.contains("timestamp") || !datum["timestamp"].is_integer())
+                return std::make_unique<network::json_response>(json::json({{"message", "Invalid request"}}), network::status_code::bad_request);
+            series.emplace_back(datum["data"], std::chrono::system_clock::time_point(std::chrono::milliseconds{datum["timestamp"].get<int64_t>()}));
+        }
+        item *itm;
+        try
+        {
+            itm = &get_coco().get_item(id);
+        }
+        catch (const std::exception &)
+        {
+            return std::make_unique<network::json_response>(json::json({{"message", "Item not found"}}), network::status_code::not_found);
+        }
+        try
+        {
+            get_coco().backfill(*itm, std::move(series));
+            return std::make_unique<network::response>(network::status_code::no_content);
+        }
+        catch (const std::exception &e)
+        {
+            return std::make_unique<network::json_response>(json::json({{"message", e.what()}}), network::status_code::bad_request);
+        }
+    }
+
     std::unique_ptr<network::response> coco_server::fake(const network::request &req)
     {
         auto name = req.get_target().substr(6);
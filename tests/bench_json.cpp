@@ -0,0 +1,57 @@
+#include "coco.hpp"
+#include "coco_db.hpp"
+#include <cassert>
+#include <chrono>
+#include <iostream>
+
+// exposes the CLIPS environment of CoCo, so that the bridging functions can be called as the rules do..
+class bench_coco : public ::coco::coco
+{
+public:
+    bench_coco(::coco::coco_db &db) noexcept : ::coco::coco(db) {}
+
+    [[nodiscard]] Environment *get_env() const noexcept { return env; }
+};
+
+// times the evaluation of an expression, returning the average time per iteration in nanoseconds..
+double bench(Environment *env, const std::string &fn, const std::string &arg, long long iterations)
+{
+    CLIPSValue res;
+    const auto start = std::chrono::steady_clock::now();
+    if (Eval(env, ("(" + fn + " " + arg + " " + std::to_string(iterations) + ")").c_str(), &res) != EE_NO_ERROR)
+    {
+        std::cerr << "Cannot evaluate " << fn << std::endl;
+        std::exit(1);
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / iterations;
+}
+
+int main(int argc, char *argv[])
+{
+    const long long iterations = argc > 1 ? std::stoll(argv[1]) : 100000;
+
+    coco::coco_db db;
+    bench_coco cc(db);
+    auto env = cc.get_env();
+
+    // the loops run within CLIPS, so that the same lexemes are read at each iteration, as from a slot..
+    [[maybe_unused]] auto to_json_fn = Build(env, "(deffunction bench-to-json (?n) (bind ?m (create$ a \"b c\" 1 2.5 \"quote \\\" and \\\\ backslash\" d e f 42 3.14)) (loop-for-count ?n (to_json ?m)))");
+    assert(to_json_fn == BE_NO_ERROR);
+    [[maybe_unused]] auto from_json_fn = Build(env, "(deffunction bench-from-json (?j ?n) (loop-for-count ?n (from_json ?j)))");
+    assert(from_json_fn == BE_NO_ERROR);
+    [[maybe_unused]] auto json_values_fn = Build(env, "(deffunction bench-json-values (?j ?n) (loop-for-count ?n (json-values ?j)))");
+    assert(json_values_fn == BE_NO_ERROR);
+    [[maybe_unused]] auto json_get_fn = Build(env, "(deffunction bench-json-get (?j ?n) (loop-for-count ?n (json-get ?j \"b.c[1]\")))");
+    assert(json_get_fn == BE_NO_ERROR);
+
+    const std::string doc = "\"{\\\"a\\\": 1, \\\"b\\\": {\\\"c\\\": [1, 2, 3], \\\"d\\\": \\\"text\\\"}, \\\"e\\\": [true, false, null], \\\"f\\\": 2.5}\"";
+    std::cout << "to_json:              " << bench(env, "bench-to-json", "", iterations) << " ns" << std::endl;
+    std::cout << "from_json (string):   " << bench(env, "bench-from-json", doc, iterations) << " ns" << std::endl;
+    std::cout << "from_json (document): " << bench(env, "bench-from-json", "(json-parse " + doc + ")", iterations) << " ns" << std::endl;
+    std::cout << "json-values (string): " << bench(env, "bench-json-values", doc, iterations) << " ns" << std::endl;
+    std::cout << "json-values (doc.):   " << bench(env, "bench-json-values", "(json-parse " + doc + ")", iterations) << " ns" << std::endl;
+    std::cout << "json-get (string):    " << bench(env, "bench-json-get", doc, iterations) << " ns" << std::endl;
+    std::cout << "json-get (document):  " << bench(env, "bench-json-get", "(json-parse " + doc + ")", iterations) << " ns" << std::endl;
+
+    return 0;
+}
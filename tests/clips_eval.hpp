@@ -0,0 +1,23 @@
+#pragma once
+
+#include "coco_module.hpp"
+#include <stdexcept>
+#include <string>
+
+/**
+ * @brief A module through which the tests evaluate CLIPS expressions within the environment of a CoCo instance.
+ */
+class clips_eval final : public coco::coco_module
+{
+public:
+  clips_eval(coco::coco &cc) noexcept : coco_module(cc) {}
+
+  [[nodiscard]] CLIPSValue eval(const std::string &expr)
+  {
+    std::lock_guard<std::recursive_mutex> _(get_mtx());
+    CLIPSValue res;
+    if (Eval(get_env(), expr.c_str(), &res) != EE_NO_ERROR)
+      throw std::invalid_argument("Invalid expression: " + expr);
+    return res;
+  }
+};
@@ -0,0 +1,38 @@
+#include "mongo_db.hpp"
+#include <bsoncxx/builder/basic/kvp.hpp>
+#include <iostream>
+
+int main([[maybe_unused]] int argc, [[maybe_unused]] char *argv[])
+{
+    json::json j{{"int", 42}, {"negative", -7}, {"big", static_cast<int64_t>(1) << 40}, {"float", 3.25}, {"bool", true}, {"null", nullptr}, {"string", "hello"}, {"nested", {{"array", std::vector<json::json>{1, 2.5, "three", std::vector<json::json>{4, std::vector<json::json>{5}}}}}}};
+
+    // JSON -> BSON -> JSON..
+    auto doc = coco::to_bson(j);
+    if (doc.view()["int"].type() != bsoncxx::type::k_int64 || doc.view()["float"].type() != bsoncxx::type::k_double || doc.view()["nested"]["array"].type() != bsoncxx::type::k_array)
+    {
+        std::cerr << "Unexpected BSON types" << std::endl;
+        return 1;
+    }
+    auto j_round = coco::from_bson(doc.view());
+    if (!(j_round == j))
+    {
+        std::cerr << "Round trip mismatch: " << j.dump() << " != " << j_round.dump() << std::endl;
+        return 1;
+    }
+    if (!j_round["float"].is_float() || !j_round["int"].is_integer() || !j_round["nested"]["array"][1].is_float() || !j_round["nested"]["array"][3][1].is_array())
+    {
+        std::cerr << "Unexpected JSON types: " << j_round.dump() << std::endl;
+        return 1;
+    }
+
+    // BSON dates and 32-bit integers -> JSON integers..
+    const auto now = std::chrono::system_clock::time_point(std::chrono::milliseconds(1700000000123));
+    auto date_doc = bsoncxx::builder::basic::make_document(bsoncxx::builder::basic::kvp("timestamp", bsoncxx::types::b_date{now}), bsoncxx::builder::basic::kvp("small", static_cast<int32_t>(12)));
+    auto j_date = coco::from_bson(date_doc.view());
+    if (!j_date["timestamp"].is_integer() || j_date["timestamp"].get<int64_t>() != 1700000000123 || j_date["small"].get<int64_t>() != 12)
+    {
+        std::cerr << "Unexpected date conversion: " << j_date.dump() << std::endl;
+        return 1;
+    }
+    return 0;
+}
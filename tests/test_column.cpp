@@ -0,0 +1,115 @@
+#include "coco.hpp"
+#include "coco_db.hpp"
+#include "coco_type.hpp"
+#include "coco_item.hpp"
+#include "coco_column.hpp"
+#include "clips_eval.hpp"
+#include <iostream>
+#include <random>
+#if defined(BUILD_SERVER) && defined(BUILD_NOAUTH) && !defined(BUILD_SECURE)
+#include "coco_server.hpp"
+#include "client.hpp"
+#include <future>
+#include <thread>
+#endif
+
+int main([[maybe_unused]] int argc, [[maybe_unused]] char *argv[])
+{
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> ages(0, 99), cities(0, 19);
+    std::vector<std::pair<std::string, json::json>> items;
+    for (int i = 0; i < 10000; ++i)
+        items.emplace_back(std::to_string(i), json::json{{"age", ages(gen)}, {"city", i % 2 ? "city_" + std::to_string(cities(gen)) : std::string("moved")}});
+
+    // store the items in columns, the scans must agree with the filters on the stored values..
+    coco::numeric_column<int64_t> ages_col;
+    coco::lexeme_column cities_col;
+    ages_col.resize(items.size());
+    cities_col.resize(items.size());
+    for (size_t row = 0; row < items.size(); ++row)
+        if (row % 7) // some rows are left null..
+        {
+            ages_col.set(row, static_cast<int64_t>(items[row].second["age"].get<double>()));
+            cities_col.set(row, items[row].second["city"]);
+        }
+    const auto check_column = [&items](const coco::column &col, const coco::item_filter &f)
+    {
+        std::vector<bool> rows(items.size(), true);
+        col.filter(f, rows);
+        for (size_t row = 0; row < items.size(); ++row)
+            if (rows[row] != (!col.is_null(row) && coco::matches(col.get(row), f)))
+            {
+                std::cerr << "Mismatch on row " << row << " for " << f.property << " " << static_cast<int>(f.op) << " " << f.value.dump() << std::endl;
+                return false;
+            }
+        return true;
+    };
+    for (auto op : {coco::filter_op::eq, coco::filter_op::lt, coco::filter_op::le, coco::filter_op::gt, coco::filter_op::ge})
+        if (!check_column(ages_col, {"age", op, 42}) || !check_column(ages_col, {"age", op, "42"}) || !check_column(cities_col, {"city", op, "city_7"}))
+            return 1;
+    for (size_t row = 0; row < items.size(); row += 3) // releasing values must not affect the other rows..
+        cities_col.set(row, nullptr);
+    if (!check_column(cities_col, {"city", coco::filter_op::eq, "moved"}) || !(cities_col.get(1) == items[1].second["city"]))
+        return 1;
+
+    // the static properties of the items are held by the columns of their types, each value being read on its own..
+    coco::coco_db db;
+    coco::coco cc(db);
+    auto &person = cc.create_type("person", json::json{{"name", {{"type", "string"}}}, {"age", {{"type", "int"}}}}, json::json());
+    auto &employee = cc.create_type("employee", json::json{{"name", {{"type", "string"}}}, {"salary", {{"type", "float"}}}}, json::json());
+    auto &alice = cc.create_item({person, employee}, json::json{{"name", "Alice"}, {"age", 30}, {"salary", 1000.0}, {"nickname", "Al"}});
+    const auto consistent = [](const coco::item &itm)
+    {
+        const auto props = itm.get_properties();
+        for (const auto &[p_name, val] : props.as_object())
+            if (!(itm.get_property_value(p_name) == val))
+                return false;
+        return itm.get_property_value("missing").is_null();
+    };
+    if (!consistent(alice) || alice.get_property_value("age").get<int64_t>() != 30 || alice.get_property_value("nickname").get<std::string>() != "Al" || alice.get_properties().size() != 4)
+    {
+        std::cerr << "Unexpected properties of the item: " << alice.get_properties().dump() << std::endl;
+        return 1;
+    }
+    cc.set_properties(alice, json::json{{"name", "Alice B."}, {"age", nullptr}});
+    if (!consistent(alice) || alice.get_property_value("name").get<std::string>() != "Alice B." || !alice.get_property_value("age").is_null())
+    {
+        std::cerr << "Unexpected properties after a change: " << alice.get_properties().dump() << std::endl;
+        return 1;
+    }
+    for (int i = 0; i < 100; ++i) // the rows released by the deleted items are reused..
+        cc.delete_item(cc.create_item({person}, json::json{{"name", "Temp"}, {"age", i}}));
+    auto &bob = cc.create_item({person}, json::json{{"name", "Bob"}, {"age", 40}});
+    if (!consistent(bob) || bob.get_property_value("age").get<int64_t>() != 40 || !consistent(alice) || cc.get_items(person).size() != 2)
+    {
+        std::cerr << "Unexpected properties in a reused row: " << bob.get_properties().dump() << std::endl;
+        return 1;
+    }
+
+    // the facts of the items hold the values of the columns..
+    auto &clips = cc.add_module<clips_eval>(cc);
+    if (clips.eval("(length$ (find-all-facts ((?p person)) (and (eq ?p:name \"Bob\") (eq ?p:age 40))))").integerValue->contents != 1 || clips.eval("(length$ (find-all-facts ((?e employee)) (eq ?e:name \"Alice B.\")))").integerValue->contents != 1)
+    {
+        std::cerr << "Unexpected facts of the items" << std::endl;
+        return 1;
+    }
+
+#if defined(BUILD_SERVER) && defined(BUILD_NOAUTH) && !defined(BUILD_SECURE)
+    // the items are served with the values of the columns..
+    coco::coco_server srv(cc, "127.0.0.1", 8094);
+    auto srv_ft = std::async(std::launch::async, [&srv]
+                             { srv.start(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    network::client client("127.0.0.1", 8094);
+    auto res = client.get("/items/" + bob.get_id());
+    if (!res || res->get_status_code() != network::status_code::ok || !(static_cast<network::json_response &>(*res).get_body()["properties"] == bob.get_properties()))
+    {
+        std::cerr << "Unexpected item from the query" << std::endl;
+        srv.stop();
+        return 1;
+    }
+    srv.stop();
+#endif
+
+    return 0;
+}
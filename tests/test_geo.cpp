@@ -0,0 +1,130 @@
+#include "coco.hpp"
+#include "coco_db.hpp"
+#include "coco_type.hpp"
+#include "coco_item.hpp"
+#include "coco_geo.hpp"
+#include "clips_eval.hpp"
+#include <algorithm>
+#include <iostream>
+#include <cmath>
+#include <random>
+#include <set>
+#if defined(BUILD_SERVER) && defined(BUILD_NOAUTH) && !defined(BUILD_SECURE)
+#include "coco_server.hpp"
+#include "client.hpp"
+#include <future>
+#include <thread>
+#endif
+
+int main([[maybe_unused]] int argc, [[maybe_unused]] char *argv[])
+{
+    std::mt19937 gen(42);
+
+    // index random positions, and polygons around some of them..
+    coco::geo_index by_position;
+    std::uniform_real_distribution<double> lats(-89, 89), lons(-180, 180);
+    std::vector<std::pair<std::string, json::json>> places;
+    for (int i = 0; i < 10000; ++i)
+    {
+        const double lat = lats(gen), lon = lons(gen);
+        json::json pos{{"lat", lat}, {"lon", lon}};
+        if (i % 5 == 0)
+            pos = std::vector<json::json>{pos, json::json{{"lat", lat + 0.5}, {"lon", lon}}, json::json{{"lat", lat}, {"lon", std::min(lon + 0.5, 180.0)}}};
+        places.emplace_back(std::to_string(i), std::move(pos));
+        by_position.insert(places.back().first, places.back().second);
+    }
+    const auto check_area = [&places, &by_position](json::json &&area)
+    {
+        const coco::item_filter f{"position", coco::filter_op::within, std::move(area)};
+        std::set<std::string> found, expected;
+        by_position.find(f, [&](const std::string &id)
+                         { if (coco::matches(places[std::stoul(id)].second, f))
+                               found.insert(id); });
+        for (const auto &[id, pos] : places)
+            if (coco::matches(pos, f))
+                expected.insert(id);
+        if (found != expected || expected.empty() || by_position.count(f, places.size() / 2) >= places.size() / 2)
+        {
+            std::cerr << "Mismatch within " << f.value.dump() << ": " << found.size() << " places found, " << expected.size() << " expected, " << by_position.count(f, places.size()) << " candidates" << std::endl;
+            return false;
+        }
+        return true;
+    };
+    if (!check_area(json::json{{"bbox", std::vector<json::json>{10.0, 20.0, 40.0, 60.0}}}) || !check_area(json::json{{"bbox", std::vector<json::json>{-30.0, 170.0, 30.0, -170.0}}}) ||
+        !check_area(json::json{{"lat", 45.0}, {"lon", 7.0}, {"radius", 1000000.0}}) || !check_area(json::json{{"lat", 0.0}, {"lon", 179.0}, {"radius", 800000.0}}))
+        return 1;
+    if (std::abs(coco::distance({45.07, 7.69}, {41.9, 12.5}) - 525000) > 5000)
+    {
+        std::cerr << "Unexpected distance: " << coco::distance({45.07, 7.69}, {41.9, 12.5}) << std::endl;
+        return 1;
+    }
+
+    // the positions of the items are indexed by their type, and the areas are answered the same way with and without the index..
+    coco::coco_db db;
+    coco::coco cc(db);
+    auto &place = cc.create_type("place", json::json{{"position", {{"type", "geo"}}}, {"name", {{"type", "string"}}}}, json::json());
+    for (size_t i = 0; i < 1000; ++i)
+        [[maybe_unused]] auto &itm = cc.create_item({place}, json::json{{"position", {{"lat", lats(gen)}, {"lon", lons(gen)}}}, {"name", "place_" + std::to_string(i)}});
+    const auto check_found = [&cc, &place](json::json &&area)
+    {
+        const std::vector<coco::item_filter> filters{{"position", coco::filter_op::within, std::move(area)}};
+        std::set<std::string> found, expected;
+        for (const coco::item &itm : cc.find_items(place, filters))
+            found.insert(itm.get_id());
+        for (const coco::item &itm : cc.get_items(place))
+            if (coco::matches(itm.get_properties()["position"], filters.front()))
+                expected.insert(itm.get_id());
+        if (found != expected || expected.empty())
+        {
+            std::cerr << "Mismatch within " << filters.front().value.dump() << ": " << found.size() << " items found, " << expected.size() << " expected" << std::endl;
+            return false;
+        }
+        return true;
+    };
+    if (!check_found(json::json{{"bbox", std::vector<json::json>{10.0, 20.0, 40.0, 60.0}}}) || !check_found(json::json{{"lat", 45.0}, {"lon", 7.0}, {"radius", 2000000.0}}))
+        return 1;
+    auto &moved = cc.get_items(place).front().get(); // the index follows the moved items..
+    cc.set_properties(moved, json::json{{"position", {{"lat", 45.07}, {"lon", 7.69}}}});
+    const auto near_turin = cc.find_items(place, {{"position", coco::filter_op::within, json::json{{"lat", 45.07}, {"lon", 7.69}, {"radius", 1000.0}}}});
+    if (std::none_of(near_turin.begin(), near_turin.end(), [&moved](const coco::item &itm)
+                     { return &itm == &moved; }))
+    {
+        std::cerr << "Moved item not found at its new position" << std::endl;
+        return 1;
+    }
+
+    // the geographic functions are available to the rules..
+    auto &clips = cc.add_module<clips_eval>(cc);
+    const auto turin_rome = clips.eval("(distance (create$ 45.07 7.69) (create$ 41.9 12.5))");
+    if (std::abs(turin_rome.floatValue->contents - 525000) > 5000 || std::string(clips.eval("(within (create$ 45.07 7.69) (create$ 40.0 5.0 50.0 10.0))").lexemeValue->contents) != "TRUE" || std::string(clips.eval("(within (create$ 41.9 12.5) (create$ 45.07 7.69 100000.0))").lexemeValue->contents) != "FALSE")
+    {
+        std::cerr << "Unexpected results of the geographic functions" << std::endl;
+        return 1;
+    }
+
+#if defined(BUILD_SERVER) && defined(BUILD_NOAUTH) && !defined(BUILD_SECURE)
+    // the areas of the query are answered through the same index..
+    coco::coco_server srv(cc, "127.0.0.1", 8092);
+    auto srv_ft = std::async(std::launch::async, [&srv]
+                             { srv.start(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    network::client client("127.0.0.1", 8092);
+    const auto get_items = [&client](std::string &&target) -> std::optional<json::json>
+    {
+        auto res = client.get(std::move(target));
+        if (!res || res->get_status_code() != network::status_code::ok)
+            return std::nullopt;
+        return static_cast<network::json_response &>(*res).get_body();
+    };
+    const auto boxed = get_items("/items?type=place&within=10,20,40,60"), near = get_items("/items?near=45.07,7.69,1000");
+    if (!boxed || boxed->size() != cc.find_items(place, {{"position", coco::filter_op::within, json::json{{"bbox", std::vector<json::json>{10.0, 20.0, 40.0, 60.0}}}}}).size() || !near || near->size() != near_turin.size() || get_items("/items?within=10,20,40") || get_items("/items?within=10,20,40,60&near=45,7,1000"))
+    {
+        std::cerr << "Unexpected items from the query areas" << std::endl;
+        srv.stop();
+        return 1;
+    }
+    srv.stop();
+#endif
+
+    return 0;
+}
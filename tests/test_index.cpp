@@ -0,0 +1,142 @@
+#include "coco.hpp"
+#include "coco_db.hpp"
+#include "coco_type.hpp"
+#include "coco_item.hpp"
+#include "coco_index.hpp"
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <set>
+#if defined(BUILD_SERVER) && defined(BUILD_NOAUTH) && !defined(BUILD_SECURE)
+#include "coco_server.hpp"
+#include "client.hpp"
+#include <future>
+#include <thread>
+#endif
+
+int main([[maybe_unused]] int argc, [[maybe_unused]] char *argv[])
+{
+    coco::property_index by_age(coco::index_kind::ordered), by_city(coco::index_kind::hash), by_tag(coco::index_kind::ordered);
+
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> ages(0, 99), cities(0, 19), tags(0, 9);
+    std::vector<std::pair<std::string, json::json>> items;
+    for (int i = 0; i < 10000; ++i)
+    {
+        json::json props{{"age", ages(gen)}, {"city", "city_" + std::to_string(cities(gen))}, {"tags", std::vector<json::json>{"tag_" + std::to_string(tags(gen)), "tag_" + std::to_string(tags(gen))}}};
+        if (i % 10 == 0)
+            props["age"] = ages(gen) + 0.5;
+        items.emplace_back(std::to_string(i), std::move(props));
+        by_age.insert(items.back().first, items.back().second["age"]);
+        by_city.insert(items.back().first, items.back().second["city"]);
+        by_tag.insert(items.back().first, items.back().second["tags"]);
+    }
+
+    // every indexed lookup must return exactly the items found by a scan..
+    const auto check = [&items](const coco::property_index &idx, const coco::item_filter &f)
+    {
+        std::set<std::string> found, expected;
+        idx.find(f, [&found](const std::string &id)
+                 { found.insert(id); });
+        for (const auto &[id, props] : items)
+            if (props.contains(f.property) && coco::matches(props[f.property], f))
+                expected.insert(id);
+        if (found != expected || idx.count(f, std::numeric_limits<size_t>::max()) < found.size() || (!found.empty() && idx.count(f, 1) < 1))
+        {
+            std::cerr << "Mismatch for " << f.property << " " << static_cast<int>(f.op) << " " << f.value.dump() << ": " << found.size() << " items found, " << expected.size() << " expected" << std::endl;
+            return false;
+        }
+        return true;
+    };
+    for (auto op : {coco::filter_op::eq, coco::filter_op::lt, coco::filter_op::le, coco::filter_op::gt, coco::filter_op::ge})
+        if (!check(by_age, {"age", op, 42}) || !check(by_age, {"age", op, 42.5}) || !check(by_tag, {"tags", op, "tag_5"}))
+            return 1;
+    if (!check(by_city, {"city", coco::filter_op::eq, "city_7"}) || !check(by_city, {"city", coco::filter_op::eq, "nowhere"}) || !check(by_age, {"age", coco::filter_op::lt, "42"}))
+        return 1;
+    if (by_city.supports({"city", coco::filter_op::lt, "city_7"}) || !by_age.supports({"age", coco::filter_op::lt, 42}) || by_city.supports({"city", coco::filter_op::eq, json::json{{"name", "city_7"}}}))
+    {
+        std::cerr << "Unexpected supported filters" << std::endl;
+        return 1;
+    }
+    if (const auto n = by_age.count({"age", coco::filter_op::ge, 0}, 100); n < 100 || n >= items.size() / 2)
+    { // the counting stops at the limit, instead of visiting all the values..
+        std::cerr << "Unexpected limited count: " << n << std::endl;
+        return 1;
+    }
+    by_city.insert("complex", json::json{{"name", "city_7"}}); // objects are not indexed..
+    if (!check(by_city, {"city", coco::filter_op::eq, "city_7"}))
+        return 1;
+
+    // update half of the items, the index must follow..
+    for (size_t i = 0; i < items.size(); i += 2)
+    {
+        by_age.erase(items[i].first, items[i].second["age"]);
+        by_city.erase(items[i].first, items[i].second["city"]);
+        items[i].second["age"] = 1000;
+        items[i].second["city"] = "moved";
+        by_age.insert(items[i].first, items[i].second["age"]);
+        by_city.insert(items[i].first, items[i].second["city"]);
+    }
+    if (!check(by_age, {"age", coco::filter_op::ge, 100}) || !check(by_age, {"age", coco::filter_op::lt, 50}) || !check(by_city, {"city", coco::filter_op::eq, "moved"}) || !check(by_city, {"city", coco::filter_op::eq, "city_7"}))
+        return 1;
+
+    // the items found through the indexes of a type are the ones found by a scan, also after their properties change..
+    coco::coco_db db;
+    coco::coco cc(db);
+    auto &person = cc.create_type("person", json::json{{"age", {{"type", "int"}, {"index", "ordered"}}}, {"city", {{"type", "symbol"}, {"index", "hash"}}}, {"nickname", {{"type", "string"}}}}, json::json());
+    std::vector<std::reference_wrapper<coco::item>> people;
+    for (int i = 0; i < 100; ++i)
+        people.push_back(cc.create_item({person}, json::json{{"age", i % 50}, {"city", "city_" + std::to_string(i % 5)}, {"nickname", "p" + std::to_string(i)}}));
+    const auto check_found = [&cc, &person](const std::vector<coco::item_filter> &filters, size_t n_expected)
+    {
+        std::set<std::string> found, expected;
+        for (const coco::item &itm : cc.find_items(person, filters))
+            found.insert(itm.get_id());
+        for (const coco::item &itm : cc.get_items(person))
+        {
+            const auto props = itm.get_properties();
+            if (std::all_of(filters.begin(), filters.end(), [&props](const coco::item_filter &f)
+                            { return props.contains(f.property) && coco::matches(props[f.property], f); }))
+                expected.insert(itm.get_id());
+        }
+        if (found != expected || found.size() != n_expected)
+        {
+            std::cerr << "Mismatch for " << filters.size() << " filters: " << found.size() << " items found, " << expected.size() << " scanned, " << n_expected << " expected" << std::endl;
+            return false;
+        }
+        return true;
+    };
+    if (!check_found({{"age", coco::filter_op::ge, 45}}, 10) || !check_found({{"age", coco::filter_op::ge, 45}, {"city", coco::filter_op::eq, "city_0"}}, 2) || !check_found({{"city", coco::filter_op::eq, "city_1"}, {"nickname", coco::filter_op::eq, "p1"}}, 1) || !check_found({{"nickname", coco::filter_op::lt, "p2"}}, 12))
+        return 1;
+    for (size_t i = 0; i < people.size(); i += 2) // the indexes follow the changes of the properties..
+        cc.set_properties(people[i], json::json{{"age", 100}, {"city", "moved"}});
+    if (!check_found({{"city", coco::filter_op::eq, "moved"}}, 50) || !check_found({{"city", coco::filter_op::eq, "city_0"}}, 0) || !check_found({{"city", coco::filter_op::eq, "city_1"}}, 10) || !check_found({{"age", coco::filter_op::ge, 100}, {"city", coco::filter_op::eq, "moved"}}, 50) || !check_found({{"age", coco::filter_op::lt, 10}}, 10))
+        return 1;
+
+#if defined(BUILD_SERVER) && defined(BUILD_NOAUTH) && !defined(BUILD_SECURE)
+    // the filters of the query are answered the same way..
+    coco::coco_server srv(cc, "127.0.0.1", 8091);
+    auto srv_ft = std::async(std::launch::async, [&srv]
+                             { srv.start(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    network::client client("127.0.0.1", 8091);
+    const auto get_items = [&client](std::string &&target) -> std::optional<json::json>
+    {
+        auto res = client.get(std::move(target));
+        if (!res || res->get_status_code() != network::status_code::ok)
+            return std::nullopt;
+        return static_cast<network::json_response &>(*res).get_body();
+    };
+    const auto moved = get_items("/items?type=person&city=moved&age.ge=100"), young = get_items("/items?type=person&age.lt=10&limit=5");
+    if (!moved || moved->size() != 50 || !young || young->size() != 5 || get_items("/items?type=person&age.around=10") || get_items("/items?type=person&limit=-1"))
+    {
+        std::cerr << "Unexpected items from the query filters" << std::endl;
+        srv.stop();
+        return 1;
+    }
+    srv.stop();
+#endif
+
+    return 0;
+}
@@ -0,0 +1,157 @@
+#include "coco.hpp"
+#include "coco_db.hpp"
+#include "coco_type.hpp"
+#include "coco_item.hpp"
+#include "coco_property.hpp"
+#include <algorithm>
+#include <iostream>
+
+int main([[maybe_unused]] int argc, [[maybe_unused]] char *argv[])
+{
+    coco::coco_db db;
+    coco::coco cc(db);
+
+    auto &room = cc.create_type("room", json::json{{"name", {{"type", "string"}}}}, json::json());
+    auto &probe = cc.create_type("probe", json::json{{"room", {{"type", "item"}, {"domain", "room"}}}}, json::json{{"temperature", {{"type", "float"}}}});
+
+    const auto spec = [](std::string name, coco::type &tp, json::json props, json::json value = json::json())
+    {
+        coco::item_spec s{std::move(name), {tp}, std::move(props), std::nullopt};
+        if (!value.is_null())
+            s.value.emplace(std::move(value), std::chrono::system_clock::time_point(std::chrono::milliseconds(1700000000000)));
+        return s;
+    };
+
+    // the items of a batch can reference each other by name..
+    std::vector<coco::item_spec> specs;
+    specs.push_back(spec("probe", probe, json::json{{"room", {{"item", "kitchen"}}}}, json::json{{"temperature", 21.5}}));
+    specs.push_back(spec("kitchen", room, json::json{{"name", "Kitchen"}}));
+    auto itms = cc.create_items(std::move(specs));
+    if (itms.size() != 2 || cc.get_items().size() != 2 || itms[0].get().get_properties()["room"].get<std::string>() != itms[1].get().get_id() || itms[0].get().get_value()->first["temperature"].get<double>() != 21.5)
+    {
+        std::cerr << "Unexpected items of the batch" << std::endl;
+        return 1;
+    }
+
+    // a batch with an invalid item is rejected before anything is created..
+    std::vector<std::vector<coco::item_spec>> invalid_batches(4);
+    invalid_batches[0].push_back(spec("bedroom", room, json::json{{"name", "Bedroom"}})); // an invalid static property..
+    invalid_batches[0].push_back(spec("", room, json::json{{"name", 1}}));
+    invalid_batches[1].push_back(spec("bedroom", room, json::json{{"name", "Bedroom"}})); // an invalid value..
+    invalid_batches[1].push_back(spec("", probe, json::json{{"room", {{"item", "bedroom"}}}}, json::json{{"temperature", "hot"}}));
+    invalid_batches[2].push_back(spec("", probe, json::json{{"room", {{"item", 1}}}})); // an invalid reference..
+    invalid_batches[3].push_back(spec("", probe, json::json{{"room", "missing"}})); // a reference to an unknown item..
+    for (size_t i = 0; i < invalid_batches.size(); ++i)
+        try
+        {
+            [[maybe_unused]] auto invalid_itms = cc.create_items(std::move(invalid_batches[i]));
+            std::cerr << "Invalid batch " << i << " accepted" << std::endl;
+            return 1;
+        }
+        catch (const std::invalid_argument &)
+        {
+        }
+    if (cc.get_items().size() != 2 || db.get_items().size() != 2)
+    {
+        std::cerr << "Part of an invalid batch created" << std::endl;
+        return 1;
+    }
+
+    // the referrers of an item are tracked as the references change..
+    auto &kitchen = itms[1].get();
+    auto &office = cc.create_item({room}, json::json{{"name", "Office"}});
+    auto &zone = cc.create_type("zone", json::json{{"rooms", {{"type", "item"}, {"domain", "room"}, {"multiple", true}}}, {"main", {{"type", "item"}, {"domain", "room"}, {"nullable", true}, {"on_delete", "null"}}}}, json::json());
+    auto &floor = cc.create_item({zone}, json::json{{"rooms", std::vector<json::json>{kitchen.get_id(), office.get_id()}}, {"main", office.get_id()}});
+    const auto n_referrers = [&cc](const coco::item &itm, const std::string &p_name)
+    {
+        const auto refs = cc.get_referrers(itm);
+        return std::count_if(refs.begin(), refs.end(), [&p_name](const auto &ref)
+                             { return ref.second == p_name; });
+    };
+    if (n_referrers(kitchen, "room") != 1 || n_referrers(kitchen, "rooms") != 1 || n_referrers(office, "rooms") != 1 || n_referrers(office, "main") != 1)
+    {
+        std::cerr << "Unexpected referrers" << std::endl;
+        return 1;
+    }
+    cc.set_properties(floor, json::json{{"main", kitchen.get_id()}});
+    if (n_referrers(office, "main") != 0 || n_referrers(kitchen, "main") != 1)
+    {
+        std::cerr << "Unexpected referrers after the change of a reference" << std::endl;
+        return 1;
+    }
+
+    // the references are accepted only towards instances of the domain..
+    const auto &main_prop = *zone.get_static_properties().at("main");
+    const auto &rooms_prop = *zone.get_static_properties().at("rooms");
+    const auto probe_id = itms[0].get().get_id();
+    if (!main_prop.validate(kitchen.get_id()) || main_prop.validate(probe_id) || main_prop.validate("missing") || !rooms_prop.validate(std::vector<json::json>{kitchen.get_id(), office.get_id()}) || rooms_prop.validate(std::vector<json::json>{kitchen.get_id(), probe_id}) || rooms_prop.validate(kitchen.get_id()))
+    {
+        std::cerr << "Unexpected validation of the references against the domain" << std::endl;
+        return 1;
+    }
+    for (auto &out_of_domain : {json::json{{"rooms", std::vector<json::json>{kitchen.get_id()}}, {"main", probe_id}}, json::json{{"rooms", std::vector<json::json>{kitchen.get_id(), probe_id}}}})
+        try
+        {
+            std::vector<coco::item_spec> invalid_zones;
+            invalid_zones.push_back(spec("", zone, json::json(out_of_domain)));
+            [[maybe_unused]] auto invalid_itms = cc.create_items(std::move(invalid_zones));
+            std::cerr << "Reference outside the domain accepted: " << out_of_domain.dump() << std::endl;
+            return 1;
+        }
+        catch (const std::invalid_argument &)
+        {
+        }
+
+    // an item referenced through a property which can be neither nulled nor cascaded is not deleted..
+    try
+    {
+        cc.delete_item(kitchen);
+        std::cerr << "Referenced item deleted" << std::endl;
+        return 1;
+    }
+    catch (const std::invalid_argument &)
+    {
+    }
+    if (cc.get_items().size() != 4 || !n_referrers(kitchen, "rooms"))
+    {
+        std::cerr << "Part of a refused deletion performed" << std::endl;
+        return 1;
+    }
+    // otherwise the references are removed..
+    const auto office_id = office.get_id();
+    cc.set_properties(floor, json::json{{"main", office_id}});
+    cc.delete_item(office);
+    if (cc.get_items().size() != 3 || !floor.get_properties()["main"].is_null() || floor.get_properties()["rooms"].size() != 1)
+    {
+        std::cerr << "Unexpected references after a deletion: " << floor.get_properties().dump() << std::endl;
+        return 1;
+    }
+
+    // the deletions cascade, also when the cascades are mutual..
+    auto &node = cc.create_type("node", json::json{{"next", {{"type", "item"}, {"domain", "node"}, {"nullable", true}, {"on_delete", "cascade"}}}}, json::json());
+    auto &first = cc.create_item({node});
+    auto &second = cc.create_item({node}, json::json{{"next", first.get_id()}});
+    auto &third = cc.create_item({node}, json::json{{"next", second.get_id()}});
+    cc.set_properties(first, json::json{{"next", third.get_id()}});
+    [[maybe_unused]] auto &other = cc.create_item({node});
+    cc.delete_item(second);
+    if (cc.get_items().size() != 4 || cc.get_items(node).size() != 1)
+    {
+        std::cerr << "Unexpected items after a cascading deletion" << std::endl;
+        return 1;
+    }
+
+    // the deletion policies are checked when the types are created..
+    for (auto &invalid_props : {json::json{{"next", {{"type", "item"}, {"domain", "node"}, {"nullable", true}, {"on_delete", "restrict"}}}}, json::json{{"next", {{"type", "item"}, {"domain", "node"}, {"on_delete", "null"}}}}})
+        try
+        {
+            [[maybe_unused]] auto &invalid_tp = cc.create_type("invalid_node", json::json(invalid_props), json::json());
+            std::cerr << "Invalid deletion policy accepted: " << invalid_props.dump() << std::endl;
+            return 1;
+        }
+        catch (const std::invalid_argument &)
+        {
+        }
+
+    return 0;
+}
@@ -0,0 +1,97 @@
+#include "coco.hpp"
+#include "coco_db.hpp"
+#include "coco_type.hpp"
+#include "coco_item.hpp"
+#include "clips_eval.hpp"
+#include <iostream>
+
+int main([[maybe_unused]] int argc, [[maybe_unused]] char *argv[])
+{
+    coco::coco_db db;
+    coco::coco cc(db);
+    auto &clips = cc.add_module<clips_eval>(cc);
+
+    // the values are read through their paths, the missing ones being nil..
+    const std::string doc = R"clp((json-parse "{\"a\":{\"b\":[1,2,3.5]},\"c\":\"x\"}"))clp";
+    const auto is_nil = [&clips](const std::string &expr)
+    {
+        auto res = clips.eval(expr);
+        return res.header->type == SYMBOL_TYPE && std::string(res.lexemeValue->contents) == "nil";
+    };
+    if (clips.eval("(json-get " + doc + " \"a.b[2]\")").floatValue->contents != 3.5 || clips.eval("(json-get " + doc + " \"a.b[0]\")").integerValue->contents != 1 || std::string(clips.eval("(json-get " + doc + " \"c\")").lexemeValue->contents) != "x")
+    {
+        std::cerr << "Unexpected values of the JSON document" << std::endl;
+        return 1;
+    }
+    if (!is_nil("(json-get " + doc + " \"a.d\")") || !is_nil("(json-get " + doc + " \"a.b[3]\")") || !is_nil("(json-get " + doc + " \"c[0]\")") || !is_nil("(json-get " + doc + " \"a.b[x]\")"))
+    {
+        std::cerr << "Missing values of the JSON document are not nil" << std::endl;
+        return 1;
+    }
+    // the nested documents can be read in turn, as can the serialized documents..
+    if (clips.eval("(json-get (json-get " + doc + " \"a\") \"b[1]\")").integerValue->contents != 2 || clips.eval(R"clp((json-get "{\"a\":[4,5]}" "a[1]"))clp").integerValue->contents != 5)
+    {
+        std::cerr << "Unexpected values of the nested JSON documents" << std::endl;
+        return 1;
+    }
+
+    // the paths are tested and the arrays and objects measured..
+    if (std::string(clips.eval("(json-has " + doc + " \"a.b[1]\")").lexemeValue->contents) != "TRUE" || std::string(clips.eval("(json-has " + doc + " \"a.b[5]\")").lexemeValue->contents) != "FALSE" || std::string(clips.eval("(json-has " + doc + " \"d\")").lexemeValue->contents) != "FALSE")
+    {
+        std::cerr << "Unexpected paths of the JSON document" << std::endl;
+        return 1;
+    }
+    if (clips.eval("(json-len " + doc + ")").integerValue->contents != 2 || clips.eval("(json-len " + doc + " \"a.b\")").integerValue->contents != 3)
+    {
+        std::cerr << "Unexpected lengths of the JSON document" << std::endl;
+        return 1;
+    }
+    for (const auto &invalid : {"(json-len " + doc + " \"c\")", "(json-len " + doc + " \"a.b[3]\")", std::string(R"clp((json-parse "{\"a\":"))clp")})
+        try
+        {
+            [[maybe_unused]] auto res = clips.eval(invalid);
+            std::cerr << "Invalid expression evaluated: " << invalid << std::endl;
+            return 1;
+        }
+        catch (const std::invalid_argument &)
+        {
+        }
+
+    // from_json serializes the values, while json-values converts them into CLIPS values..
+    if (std::string(clips.eval(R"clp((nth$ 2 (from_json "[1,\"a\",[2]]")))clp").lexemeValue->contents) != "\"a\"" || std::string(clips.eval(R"clp((nth$ 3 (from_json "[1,\"a\",[2]]")))clp").lexemeValue->contents) != "[2]")
+    {
+        std::cerr << "Unexpected values of from_json" << std::endl;
+        return 1;
+    }
+    if (clips.eval(R"clp((nth$ 1 (json-values "[1,\"a\",[2]]")))clp").integerValue->contents != 1 || std::string(clips.eval(R"clp((nth$ 2 (json-values "[1,\"a\",[2]]")))clp").lexemeValue->contents) != "a" || clips.eval(R"clp((json-get (nth$ 3 (json-values "[1,\"a\",[2]]")) "[0]"))clp").integerValue->contents != 2)
+    {
+        std::cerr << "Unexpected values of json-values" << std::endl;
+        return 1;
+    }
+
+    // the json properties are held by the facts as documents..
+    auto &sensor = cc.create_type("sensor", json::json{{"config", {{"type", "json"}}}}, json::json());
+    auto &s0 = cc.create_item({sensor}, json::json{{"config", {{"rate", 10}, {"channels", std::vector<json::json>{"a", "b"}}}}});
+    const auto n_rated = [&clips](int rate)
+    { return clips.eval("(length$ (find-all-facts ((?s sensor)) (eq (json-get ?s:config \"rate\") " + std::to_string(rate) + ")))").integerValue->contents; };
+    if (n_rated(10) != 1 || clips.eval("(json-len (fact-slot-value (nth$ 1 (find-all-facts ((?s sensor)) TRUE)) config) \"channels\")").integerValue->contents != 2)
+    {
+        std::cerr << "Unexpected json property of the facts" << std::endl;
+        return 1;
+    }
+    cc.set_properties(s0, json::json{{"config", {{"rate", 10}, {"channels", std::vector<json::json>{"a", "b"}}}}});
+    if (n_rated(10) != 1)
+    {
+        std::cerr << "Unexpected json property after an unchanged value" << std::endl;
+        return 1;
+    }
+    // the rules set the json properties through the documents..
+    [[maybe_unused]] auto set_res = clips.eval("(set_properties (sym-cat \"" + s0.get_id() + "\") (create$ config) (create$ (json-parse \"{\\\"rate\\\":20}\")))");
+    if (n_rated(20) != 1 || n_rated(10) != 0 || s0.get_properties()["config"]["rate"].get<int64_t>() != 20)
+    {
+        std::cerr << "Unexpected json property after a change from the rules" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,63 @@
+#include "mongo_db.hpp"
+#include <mongocxx/instance.hpp>
+#include <mongocxx/client.hpp>
+#include <bsoncxx/builder/basic/kvp.hpp>
+#include <algorithm>
+#include <iostream>
+
+int main([[maybe_unused]] int argc, [[maybe_unused]] char *argv[])
+{
+    mongocxx::instance inst{}; // This should be done only once.
+    coco::mongo_db db(json::json{{"name", "coco_mongo_test"}});
+    db.drop();
+    mongocxx::client client{mongocxx::uri{coco::default_mongodb_uri()}}; // reads the collections without flushing the pending operations..
+    const auto n_stored = [&client](const std::string &itm_id)
+    { return client["coco_mongo_test"][coco::mongo_db::items_collection_name].count_documents(bsoncxx::builder::basic::make_document(bsoncxx::builder::basic::kvp("_id", bsoncxx::oid{itm_id}))); };
+
+    // a single item is queued and written by the next flush..
+    const auto itm_id = db.generate_id();
+    db.create_item(itm_id, {"sensor"}, json::json{{"room", "kitchen"}}, std::make_pair(json::json{{"temperature", 21.5}}, std::chrono::system_clock::time_point(std::chrono::milliseconds(1700000000000))));
+    db.flush();
+    if (n_stored(itm_id) != 1 || db.get_flush_stats().operations == 0 || !db.get_flush_stats().last_error.empty())
+    {
+        std::cerr << "The queued item has not been written" << std::endl;
+        return 1;
+    }
+    // the insertion is an upsert, so that retrying it does not fail..
+    db.create_item(itm_id, {"sensor"}, json::json{{"room", "bedroom"}});
+    db.flush();
+    auto itms = db.get_items();
+    auto itm = std::find_if(itms.begin(), itms.end(), [&itm_id](const coco::db_item &i)
+                            { return i.id == itm_id; });
+    if (itm == itms.end() || !itm->props || (*itm->props)["room"].get<std::string>() != "bedroom")
+    {
+        std::cerr << "Unexpected item after the retried insertion" << std::endl;
+        return 1;
+    }
+
+    // an invalid ID is rejected before anything is queued..
+    try
+    {
+        db.create_item("not an id", {"sensor"}, json::json(json::json_type::object));
+        std::cerr << "Invalid item ID accepted" << std::endl;
+        return 1;
+    }
+    catch (const std::invalid_argument &)
+    {
+    }
+
+    // a batch is written before the call returns..
+    std::vector<coco::db_item> batch;
+    for (int i = 0; i < 3; ++i)
+        batch.push_back({db.generate_id(), {"sensor"}, json::json{{"room", "hall"}}, std::nullopt});
+    db.create_items(batch);
+    for (const auto &b_itm : batch)
+        if (n_stored(b_itm.id) != 1)
+        {
+            std::cerr << "Item " << b_itm.id << " of the batch has not been written" << std::endl;
+            return 1;
+        }
+
+    db.drop();
+    return 0;
+}
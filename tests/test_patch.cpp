@@ -0,0 +1,145 @@
+#include "coco.hpp"
+#include "coco_db.hpp"
+#include "coco_type.hpp"
+#include "coco_item.hpp"
+#include "coco_patch.hpp"
+#include "clips_eval.hpp"
+#include <iostream>
+#if defined(BUILD_SERVER) && defined(BUILD_NOAUTH) && !defined(BUILD_SECURE)
+#include "coco_server.hpp"
+#include "client.hpp"
+#include <future>
+#include <thread>
+#endif
+
+// records the partial updates of the static properties, so that the tests can check what is persisted..
+class patch_db : public coco::coco_db
+{
+public:
+    void update_properties(std::string_view, const std::vector<coco::db_property_update> &upds) override { updates.insert(updates.end(), upds.begin(), upds.end()); }
+
+    std::vector<coco::db_property_update> updates;
+};
+
+int main([[maybe_unused]] int argc, [[maybe_unused]] char *argv[])
+{
+    // apply a patch using both the standard operations and the shorthands..
+    json::json doc = {{"tags", std::vector<json::json>{"a", "b"}}, {"info", {{"name", "x"}}}};
+    const auto ops = coco::parse_patch(std::vector<json::json>{{{"op", "append"}, {"path", "/tags"}, {"value", "c"}}, {{"op", "remove_at"}, {"path", "/tags"}, {"index", 0}}, {{"op", "set_path"}, {"path", "/info/address/city"}, {"value", "Rome"}}, {{"op", "move"}, {"from", "/info/name"}, {"path", "/info/alias"}}, {{"op", "test"}, {"path", "/tags/1"}, {"value", "c"}}});
+    for (const auto &op : ops)
+        coco::apply_patch(doc, op);
+    if (!(doc == json::json{{"tags", std::vector<json::json>{"b", "c"}}, {"info", {{"address", {{"city", "Rome"}}}, {"alias", "x"}}}}))
+    {
+        std::cerr << "Wrong patched document: " << doc.dump() << std::endl;
+        return 1;
+    }
+    for (const auto &bad : {json::json{{"op", "remove"}, {"path", "/tags/5"}}, json::json{{"op", "replace"}, {"path", "/missing"}, {"value", 1}}, json::json{{"op", "test"}, {"path", "/tags/0"}, {"value", "a"}}})
+        try
+        {
+            for (const auto &op : coco::parse_patch(std::vector<json::json>{bad}))
+                coco::apply_patch(doc, op);
+            std::cerr << "Invalid operation applied: " << bad.dump() << std::endl;
+            return 1;
+        }
+        catch (const std::invalid_argument &)
+        {
+        }
+
+    // the patches of the items are validated and persisted part by part..
+    patch_db db;
+    coco::coco cc(db);
+    auto &clips = cc.add_module<clips_eval>(cc);
+    auto &shelf = cc.create_type("shelf", json::json{{"tags", {{"type", "string"}, {"multiple", true}}}, {"size", {{"type", "int"}}}, {"info", {{"type", "json"}}}}, json::json());
+    auto &s0 = cc.create_item({shelf}, json::json{{"tags", std::vector<json::json>{"a", "b"}}, {"size", 3}, {"info", {{"name", "x"}}}});
+    const auto patch = [&cc, &s0](json::json &&p)
+    { cc.patch_properties(s0, std::vector<json::json>{std::move(p)}); };
+
+    patch(json::json{{"op", "append"}, {"path", "/tags"}, {"value", "c"}});
+    if (db.updates.size() != 1 || db.updates[0].kind != coco::db_property_update::push || db.updates[0].path != std::vector<std::string>{"tags"} || !(db.updates[0].value == json::json("c")) || db.updates[0].position || !(s0.get_properties()["tags"] == json::json(std::vector<json::json>{"a", "b", "c"})))
+    {
+        std::cerr << "Unexpected update for an appended element" << std::endl;
+        return 1;
+    }
+    db.updates.clear();
+    patch(json::json{{"op", "replace"}, {"path", "/size"}, {"value", 5}});
+    patch(json::json{{"op", "set_path"}, {"path", "/info/address/city"}, {"value", "Rome"}});
+    if (db.updates.size() != 2 || db.updates[0].kind != coco::db_property_update::set || db.updates[0].path != std::vector<std::string>{"size"} || db.updates[1].kind != coco::db_property_update::set || db.updates[1].path != std::vector<std::string>{"info", "address", "city"} || s0.get_properties()["size"].get<int64_t>() != 5 || s0.get_properties()["info"]["address"]["city"].get<std::string>() != "Rome")
+    {
+        std::cerr << "Unexpected updates for replaced values" << std::endl;
+        return 1;
+    }
+    db.updates.clear();
+    patch(json::json{{"op", "remove_at"}, {"path", "/tags"}, {"index", 0}});
+    if (db.updates.size() != 1 || db.updates[0].kind != coco::db_property_update::set || db.updates[0].path != std::vector<std::string>{"tags"} || !(db.updates[0].value == json::json(std::vector<json::json>{"b", "c"})))
+    {
+        std::cerr << "Unexpected update for a removed element" << std::endl;
+        return 1;
+    }
+    db.updates.clear();
+    patch(json::json{{"op", "set_path"}, {"path", "/tags/0"}, {"value", "e"}});
+    if (db.updates.size() != 1 || db.updates[0].kind != coco::db_property_update::set || db.updates[0].path != std::vector<std::string>{"tags", "0"} || !(db.updates[0].value == json::json("e")) || !(s0.get_properties()["tags"] == json::json(std::vector<json::json>{"e", "c"})))
+    { // setting an existing element replaces it, leaving the length of the array unchanged..
+        std::cerr << "Unexpected update for a set element" << std::endl;
+        return 1;
+    }
+    db.updates.clear();
+
+    // an invalid patch leaves the item untouched..
+    for (auto &invalid : {json::json{{"op", "append"}, {"path", "/tags"}, {"value", 1}}, json::json{{"op", "replace"}, {"path", "/size"}, {"value", "big"}}, json::json{{"op", "add"}, {"path", "/color"}, {"value", "red"}}})
+        try
+        {
+            patch(json::json(invalid));
+            std::cerr << "Invalid patch applied: " << invalid.dump() << std::endl;
+            return 1;
+        }
+        catch (const std::invalid_argument &)
+        {
+        }
+    if (!db.updates.empty() || !(s0.get_properties()["tags"] == json::json(std::vector<json::json>{"e", "c"})) || s0.get_properties()["size"].get<int64_t>() != 5)
+    {
+        std::cerr << "Invalid patch partially applied" << std::endl;
+        return 1;
+    }
+
+    // the facts follow the patches..
+    if (clips.eval("(length$ (find-all-facts ((?s shelf)) (and (eq ?s:size 5) (member$ \"c\" ?s:tags) (not (member$ \"a\" ?s:tags)))))").integerValue->contents != 1)
+    {
+        std::cerr << "Unexpected facts after the patches" << std::endl;
+        return 1;
+    }
+
+#if defined(BUILD_SERVER) && defined(BUILD_NOAUTH) && !defined(BUILD_SECURE)
+    // the items are patched through the REST API..
+    coco::coco_server srv(cc, "127.0.0.1", 8096);
+    auto srv_ft = std::async(std::launch::async, [&srv]
+                             { srv.start(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    network::client client("127.0.0.1", 8096);
+    const auto status = [&client](const std::string &itm_id, json::json &&body)
+    {
+        auto res = client.patch("/items/" + itm_id, std::move(body), {{"Content-Type", "application/json"}});
+        return res ? res->get_status_code() : network::status_code::internal_server_error;
+    };
+    if (status(s0.get_id(), std::vector<json::json>{{{"op", "append"}, {"path", "/tags"}, {"value", "d"}}}) != network::status_code::no_content || status(s0.get_id(), json::json{{"patch", std::vector<json::json>{{{"op", "replace"}, {"path", "/size"}, {"value", 7}}}}}) != network::status_code::no_content || s0.get_properties()["tags"].size() != 3 || s0.get_properties()["size"].get<int64_t>() != 7)
+    {
+        std::cerr << "Unexpected item after the REST patches" << std::endl;
+        srv.stop();
+        return 1;
+    }
+    if (status(s0.get_id(), std::vector<json::json>{{{"op", "set_path"}, {"path", "/tags/0"}, {"value", "f"}}}) != network::status_code::no_content || s0.get_properties()["tags"].size() != 3 || s0.get_properties()["tags"][0].get<std::string>() != "f")
+    {
+        std::cerr << "Unexpected item after setting an element through the REST API" << std::endl;
+        srv.stop();
+        return 1;
+    }
+    if (status(s0.get_id(), std::vector<json::json>{{{"op", "append"}, {"path", "/tags"}, {"value", 1}}}) != network::status_code::bad_request || status(s0.get_id(), std::vector<json::json>{{{"op", "jump"}, {"path", "/tags"}}}) != network::status_code::bad_request || status("missing", std::vector<json::json>{{{"op", "remove"}, {"path", "/size"}}}) != network::status_code::not_found)
+    {
+        std::cerr << "Unexpected status of the invalid REST patches" << std::endl;
+        srv.stop();
+        return 1;
+    }
+    srv.stop();
+#endif
+
+    return 0;
+}
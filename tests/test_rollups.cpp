@@ -0,0 +1,89 @@
+#include "coco.hpp"
+#include "coco_db.hpp"
+#include "coco_type.hpp"
+#include "coco_item.hpp"
+#include <iostream>
+
+int main([[maybe_unused]] int argc, [[maybe_unused]] char *argv[])
+{
+    coco::coco_db db(json::json{{"rollups", std::vector<json::json>{60, 3600}}});
+    coco::coco cc(db);
+
+    auto &tp = cc.create_type("thermometer", json::json(), json::json{{"temperature", {{"type", "float"}}}, {"state", {{"type", "symbol"}}}});
+    auto &itm = cc.create_item({tp});
+
+    // two minutes of values, aligned on the minute buckets..
+    const auto start = std::chrono::system_clock::time_point(std::chrono::milliseconds(1699999980000));
+    for (int i = 0; i < 120; ++i)
+        cc.set_value(itm, {{"temperature", static_cast<double>(i)}, {"state", i % 2 ? "on" : "off"}}, start + std::chrono::seconds(i));
+
+    auto minutes = cc.get_values(itm, std::chrono::seconds(60), start, start + std::chrono::minutes(2));
+    if (minutes.size() != 2 || minutes[0]["timestamp"].get<int64_t>() != 1699999980000 || minutes[1]["timestamp"].get<int64_t>() != 1699999980000 + 60000)
+    {
+        std::cerr << "Unexpected minute buckets: " << minutes.dump() << std::endl;
+        return 1;
+    }
+    for (size_t b = 0; b < 2; ++b)
+    {
+        const auto &data = minutes[b]["data"];
+        const double first = static_cast<double>(b * 60), last = first + 59;
+        if (data.size() != 1 || data["temperature"]["count"].get<int64_t>() != 60 || data["temperature"]["sum"].get<double>() != (first + last) * 30 || data["temperature"]["min"].get<double>() != first || data["temperature"]["max"].get<double>() != last || data["temperature"]["last"].get<double>() != last)
+        { // only the numeric properties are rolled up..
+            std::cerr << "Unexpected minute rollup: " << minutes[b].dump() << std::endl;
+            return 1;
+        }
+    }
+
+    // a late value contributes to the aggregates of its bucket without replacing the last value..
+    cc.set_value(itm, {{"temperature", 1000.0}}, start + std::chrono::seconds(10));
+    minutes = cc.get_values(itm, std::chrono::seconds(60), start, start + std::chrono::minutes(2));
+    if (minutes[0]["data"]["temperature"]["count"].get<int64_t>() != 61 || minutes[0]["data"]["temperature"]["max"].get<double>() != 1000 || minutes[0]["data"]["temperature"]["last"].get<double>() != 59)
+    {
+        std::cerr << "Unexpected rollup after a late value: " << minutes[0].dump() << std::endl;
+        return 1;
+    }
+
+    size_t n_hourly = 0;
+    for (const auto &bucket : cc.get_values(itm, std::chrono::seconds(3600), start - std::chrono::hours(1), start + std::chrono::hours(1)).as_array())
+        n_hourly += bucket["data"]["temperature"]["count"].get<size_t>();
+    if (n_hourly != 121)
+    {
+        std::cerr << "Expected 121 values in the hourly rollups, got " << n_hourly << std::endl;
+        return 1;
+    }
+
+    try
+    {
+        [[maybe_unused]] auto days = cc.get_values(itm, std::chrono::seconds(86400), start, start + std::chrono::minutes(2));
+        std::cerr << "Unsupported resolution accepted" << std::endl;
+        return 1;
+    }
+    catch (const std::invalid_argument &)
+    {
+    }
+
+    // a bucket expires once it ends before the expiration time..
+    if (db.delete_rollups(itm.get_id(), start + std::chrono::minutes(1)) != 1 || cc.get_values(itm, std::chrono::seconds(60), start, start + std::chrono::minutes(2)).size() != 1)
+    {
+        std::cerr << "Unexpected rollups expiration" << std::endl;
+        return 1;
+    }
+
+    // the resolutions which are not positive are ignored, and the buckets held in memory are bounded..
+    coco::coco_db bounded_db(json::json{{"rollups", std::vector<json::json>{0, -60, "60", 60}}, {"max_rollups", 2}});
+    if (bounded_db.get_rollup_resolutions().size() != 1 || bounded_db.get_rollup_resolutions()[0] != std::chrono::seconds(60))
+    {
+        std::cerr << "Unexpected rollup resolutions" << std::endl;
+        return 1;
+    }
+    for (int i = 0; i < 3; ++i)
+        bounded_db.set_value(itm.get_id(), {{"temperature", static_cast<double>(i)}}, start + std::chrono::minutes(i));
+    auto bounded = bounded_db.get_rollups(itm.get_id(), std::chrono::seconds(60), start, start + std::chrono::minutes(3));
+    if (bounded.size() != 2 || bounded[0]["timestamp"].get<int64_t>() != 1699999980000 + 60000 || bounded[1]["data"]["temperature"]["last"].get<double>() != 2)
+    {
+        std::cerr << "Unexpected bounded rollups: " << bounded.dump() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,122 @@
+#include "coco.hpp"
+#include "coco_db.hpp"
+#include "coco_type.hpp"
+#include "coco_item.hpp"
+#include "coco_property.hpp"
+#include "coco_schema.hpp"
+#include <iostream>
+#if defined(BUILD_SERVER) && defined(BUILD_NOAUTH) && !defined(BUILD_SECURE)
+#include "coco_server.hpp"
+#include "client.hpp"
+#include <future>
+#include <thread>
+#endif
+
+int main([[maybe_unused]] int argc, [[maybe_unused]] char *argv[])
+{
+    // compile a recursive schema with references, enumerations, patterns and required properties..
+    json::json schemas;
+    schemas["node"] = {{"type", "object"}, {"properties", {{"name", {{"type", "string"}, {"pattern", "^[a-z]+$"}}}, {"kind", {{"enum", std::vector<json::json>{"leaf", "branch", 3}}}}, {"weight", {{"type", "number"}, {"minimum", 0}, {"exclusiveMaximum", 10}}}, {"children", {{"type", "array"}, {"maxItems", 2}, {"items", {{"$ref", "#/components/schemas/node"}}}}}}}, {"required", std::vector<json::json>{"name", "kind"}}, {"additionalProperties", false}};
+    coco::schema_validator node_validator({{"$ref", "#/components/schemas/node"}}, schemas);
+    json::json leaf = {{"name", "a"}, {"kind", "leaf"}, {"weight", 2.5}};
+    json::json tree = {{"name", "root"}, {"kind", 3}, {"children", std::vector<json::json>{leaf, leaf}}};
+    if (!node_validator.validate(leaf) || !node_validator.validate(tree))
+    {
+        std::cerr << "Valid values rejected" << std::endl;
+        return 1;
+    }
+    json::json bad_name = {{"name", "A1"}, {"kind", "leaf"}}, bad_kind = {{"name", "a"}, {"kind", "trunk"}}, bad_weight = {{"name", "a"}, {"kind", "leaf"}, {"weight", 10}}, missing = {{"name", "a"}}, extra = {{"name", "a"}, {"kind", "leaf"}, {"color", "red"}};
+    json::json bad_child = {{"name", "root"}, {"kind", "branch"}, {"children", std::vector<json::json>{missing}}};
+    for (const auto &bad : {bad_name, bad_kind, bad_weight, missing, extra, bad_child})
+        if (node_validator.validate(bad))
+        {
+            std::cerr << "Invalid value accepted: " << bad.dump() << std::endl;
+            return 1;
+        }
+    try
+    {
+        coco::schema_validator unresolved({{"$ref", "#/components/schemas/missing"}}, schemas);
+        std::cerr << "Unresolvable reference compiled" << std::endl;
+        return 1;
+    }
+    catch (const std::invalid_argument &)
+    {
+    }
+
+    // the compiled schemas agree with the generic validator..
+    json::json point_schemas;
+    point_schemas["point"] = {{"type", "object"}, {"properties", {{"x", {{"type", "number"}}}, {"y", {{"type", "number"}}}}}, {"required", std::vector<json::json>{"x", "y"}}};
+    const std::vector<json::json> diff_schemas = {{{"type", "integer"}},
+                                                  {{"type", "number"}, {"minimum", 0}, {"maximum", 10}},
+                                                  {{"type", "string"}, {"minLength", 2}, {"maxLength", 4}},
+                                                  {{"type", "boolean"}},
+                                                  {{"enum", std::vector<json::json>{"on", "off", 1}}},
+                                                  {{"type", "array"}, {"items", {{"type", "integer"}}}},
+                                                  {{"$ref", "#/components/schemas/point"}},
+                                                  {{"type", "array"}, {"items", {{"$ref", "#/components/schemas/point"}}}}};
+    const std::vector<json::json> diff_values = {json::json(2), json::json(2.0), json::json(2.5), json::json(-1), json::json(11), json::json("on"), json::json("a"), json::json("abcde"), json::json(true), json::json(nullptr),
+                                                 std::vector<json::json>{1, 2}, std::vector<json::json>{1, 2.5}, json::json{{"x", 1}, {"y", 2.5}}, json::json{{"x", 1}}, std::vector<json::json>{json::json{{"x", 1}, {"y", 2}}, json::json{{"y", 2}}}};
+    for (const auto &schema : diff_schemas)
+    {
+        const coco::schema_validator validator(schema, point_schemas);
+        for (const auto &val : diff_values)
+            if (validator.validate(val) != json::validate(val, schema, point_schemas))
+            {
+                std::cerr << "The compiled and the generic validators disagree on " << val.dump() << " against " << schema.dump() << std::endl;
+                return 1;
+            }
+    }
+
+    // the json properties validate their values against the schemas set on the CoCo instance, and follow their changes..
+    coco::coco_db db;
+    coco::coco cc(db);
+    cc.set_schema("point", json::json(point_schemas["point"]));
+    auto &shape = cc.create_type("shape", json::json{{"origin", {{"type", "json"}, {"schema", {{"$ref", "#/components/schemas/point"}}}}}, {"corner", {{"type", "json"}, {"schema", {{"$ref", "#/components/schemas/point"}}}}}}, json::json());
+    const auto &origin = *shape.get_static_properties().at("origin");
+    if (!origin.validate(json::json{{"x", 1}, {"y", 2}}) || origin.validate(json::json{{"x", 1}}) || !shape.get_static_properties().at("corner")->validate(json::json{{"x", 1}, {"y", 2}}))
+    {
+        std::cerr << "Unexpected validation against a referenced schema" << std::endl;
+        return 1;
+    }
+    cc.set_schema("point", json::json{{"type", "object"}, {"required", std::vector<json::json>{"x"}}});
+    if (!origin.validate(json::json{{"x", 1}}) || origin.validate(json::json{{"y", 1}}))
+    {
+        std::cerr << "Unexpected validation after a change of the referenced schema" << std::endl;
+        return 1;
+    }
+    std::vector<coco::item_spec> invalid_shapes(1);
+    invalid_shapes.front().types.push_back(shape);
+    invalid_shapes.front().props = json::json{{"origin", {{"y", 1}}}};
+    try
+    {
+        [[maybe_unused]] auto invalid_itms = cc.create_items(std::move(invalid_shapes));
+        std::cerr << "Invalid shape created" << std::endl;
+        return 1;
+    }
+    catch (const std::invalid_argument &)
+    {
+    }
+
+#if defined(BUILD_SERVER) && defined(BUILD_NOAUTH) && !defined(BUILD_SECURE)
+    // the items created through the REST API are validated against the same schemas..
+    coco::coco_server srv(cc, "127.0.0.1", 8095);
+    auto srv_ft = std::async(std::launch::async, [&srv]
+                             { srv.start(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    network::client client("127.0.0.1", 8095);
+    const auto status = [&client](json::json &&body)
+    {
+        auto res = client.post("/items/bulk", std::move(body), {{"Content-Type", "application/json"}});
+        return res ? res->get_status_code() : network::status_code::bad_request;
+    };
+    if (status(std::vector<json::json>{{{"types", std::vector<json::json>{"shape"}}, {"properties", {{"origin", {{"x", 1}}}}}}}) != network::status_code::created || status(std::vector<json::json>{{{"types", std::vector<json::json>{"shape"}}, {"properties", {{"origin", {{"y", 1}}}}}}}) != network::status_code::bad_request)
+    {
+        std::cerr << "Unexpected validation of the items from the REST API" << std::endl;
+        srv.stop();
+        return 1;
+    }
+    srv.stop();
+#endif
+
+    return 0;
+}
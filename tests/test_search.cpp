@@ -0,0 +1,110 @@
+#include "coco.hpp"
+#include "coco_db.hpp"
+#include "coco_type.hpp"
+#include "coco_item.hpp"
+#include "coco_search.hpp"
+#include <iostream>
+#include <map>
+#if defined(BUILD_SERVER) && defined(BUILD_NOAUTH) && !defined(BUILD_SECURE)
+#include "coco_server.hpp"
+#include "client.hpp"
+#include <future>
+#include <thread>
+#endif
+
+int main([[maybe_unused]] int argc, [[maybe_unused]] char *argv[])
+{
+    // search items by the words, or the beginnings of the words, of their names..
+    coco::text_index by_name;
+    by_name.insert("0", "Water pump P-100");
+    by_name.insert("1", "Pumping station");
+    by_name.insert("2", std::vector<json::json>{"Valve V-7", "spare pump"});
+    const auto search = [&by_name](std::string_view token)
+    {
+        std::map<std::string, double> scores;
+        by_name.search(token, [&scores](const std::string &id, double score)
+                       { scores[id] = score; });
+        return scores;
+    };
+    if (coco::tokenize("Water pump P-100") != std::vector<std::string>{"water", "pump", "p", "100"})
+    {
+        std::cerr << "Unexpected tokens" << std::endl;
+        return 1;
+    }
+    if (auto pump = search("pump"); pump.size() != 3 || pump["0"] <= pump["1"] || search("p").size() != 3 || search("10").size() != 1 || !search("pumps").empty())
+    {
+        std::cerr << "Unexpected search results" << std::endl;
+        return 1;
+    }
+    by_name.erase("2", std::vector<json::json>{"Valve V-7", "spare pump"});
+    if (search("pump").size() != 2 || !search("valve").empty())
+    {
+        std::cerr << "Unexpected search results after removal" << std::endl;
+        return 1;
+    }
+
+    // the searchable properties of the items are indexed by their type, and the results are ranked by relevance..
+    coco::coco_db db;
+    coco::coco cc(db);
+    auto &asset = cc.create_type("asset", json::json{{"name", {{"type", "string"}, {"search", true}}}, {"site", {{"type", "symbol"}, {"index", "hash"}}}}, json::json());
+    auto &pump = cc.create_item({asset}, json::json{{"name", "Water pump P-100"}, {"site", "north"}});
+    auto &station = cc.create_item({asset}, json::json{{"name", "Pumping station"}, {"site", "south"}});
+    auto &valve = cc.create_item({asset}, json::json{{"name", "Valve V-7"}, {"site", "north"}});
+    const auto search_ids = [&cc, &asset](std::string_view text, const std::vector<coco::item_filter> &filters = {})
+    {
+        std::vector<std::string> ids;
+        for (const auto &[itm, score] : cc.search_items(asset, text, filters))
+            ids.push_back(itm.get().get_id());
+        return ids;
+    };
+    if (search_ids("pump") != std::vector<std::string>{pump.get_id(), station.get_id()} || search_ids("pump", {{"site", coco::filter_op::eq, "south"}}) != std::vector<std::string>{station.get_id()} || search_ids("water pump") != std::vector<std::string>{pump.get_id()} || !search_ids("pumps").empty() || cc.search_items("valve").size() != 1)
+    {
+        std::cerr << "Unexpected search results of the type" << std::endl;
+        return 1;
+    }
+    cc.set_properties(valve, json::json{{"name", "Spare pump valve"}}); // the text index follows the changes of the properties..
+    if (search_ids("pump").size() != 3 || search_ids("v").size() != 1)
+    {
+        std::cerr << "Unexpected search results after a change" << std::endl;
+        return 1;
+    }
+    cc.delete_item(station);
+    if (search_ids("pump").size() != 2 || !search_ids("station").empty())
+    {
+        std::cerr << "Unexpected search results after a deletion" << std::endl;
+        return 1;
+    }
+
+#if defined(BUILD_SERVER) && defined(BUILD_NOAUTH) && !defined(BUILD_SECURE)
+    // the searches of the query are paginated, and invalid pages are rejected..
+    coco::coco_server srv(cc, "127.0.0.1", 8093);
+    auto srv_ft = std::async(std::launch::async, [&srv]
+                             { srv.start(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    network::client client("127.0.0.1", 8093);
+    const auto get_items = [&client](std::string &&target) -> std::optional<json::json>
+    {
+        auto res = client.get(std::move(target));
+        if (!res || res->get_status_code() != network::status_code::ok)
+            return std::nullopt;
+        return static_cast<network::json_response &>(*res).get_body();
+    };
+    const auto found = get_items("/items?search=pump"), first = get_items("/items?search=pump&limit=1"), second = get_items("/items?search=pump&offset=1&limit=1");
+    if (!found || found->size() != 2 || !first || first->size() != 1 || !((*first)[0]["id"] == (*found)[0]["id"]) || !second || second->size() != 1 || !((*second)[0]["id"] == (*found)[1]["id"]))
+    {
+        std::cerr << "Unexpected items from the query search" << std::endl;
+        srv.stop();
+        return 1;
+    }
+    for (const auto target : {"/items?search=pump&offset=-1", "/items?search=pump&limit=-1", "/items?limit=ten", "/items?offset=1.5"})
+        if (get_items(target))
+        {
+            std::cerr << "Invalid page accepted: " << target << std::endl;
+            srv.stop();
+            return 1;
+        }
+    srv.stop();
+#endif
+
+    return 0;
+}
@@ -0,0 +1,299 @@
+#include "coco.hpp"
+#include "coco_ts.hpp"
+#include "coco_aggregate.hpp"
+#include "coco_db.hpp"
+#include "coco_type.hpp"
+#include "coco_item.hpp"
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <random>
+
+int main([[maybe_unused]] int argc, [[maybe_unused]] char *argv[])
+{
+    coco::ts_store store(64);
+    const auto start = std::chrono::system_clock::time_point(std::chrono::milliseconds(1700000000000));
+
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<double> dist(-100, 100);
+    std::vector<json::json> points;
+    for (int i = 0; i < 1000; ++i)
+    {
+        json::json val{{"temperature", i % 7 ? dist(gen) : 21.5}, {"count", static_cast<int64_t>(dist(gen) * 1000)}, {"state", i % 3 ? "idle" : "busy"}, {"on", i % 2 == 0}};
+        store.append("sensor", val, start + std::chrono::milliseconds(i * 1000 + (i % 4) * 3));
+        points.push_back(std::move(val));
+    }
+
+    auto values = store.get_values("sensor", start, start + std::chrono::hours(1));
+    if (values.size() != points.size())
+    {
+        std::cerr << "Expected " << points.size() << " values, got " << values.size() << std::endl;
+        return 1;
+    }
+    for (size_t i = 0; i < points.size(); ++i)
+        if (!(values[i]["data"] == points[i]) || values[i]["timestamp"].get<int64_t>() != 1700000000000 + static_cast<int64_t>(i) * 1000 + static_cast<int64_t>(i % 4) * 3)
+        {
+            std::cerr << "Mismatch at " << i << ": " << values[i].dump() << std::endl;
+            return 1;
+        }
+
+    auto range = store.get_values("sensor", start + std::chrono::seconds(500), start + std::chrono::seconds(509));
+    if (range.size() != 9)
+    {
+        std::cerr << "Expected 9 values in range, got " << range.size() << std::endl;
+        return 1;
+    }
+
+    // page through the temperature and the state, 64 values at a time..
+    size_t n_paged = 0, n_mismatches = 0;
+    for (std::optional<int64_t> next = 1700000000000; next;)
+    {
+        size_t n_page = 0;
+        next = store.get_values("sensor", {"temperature", "state"}, std::chrono::system_clock::time_point(std::chrono::milliseconds(*next)), start + std::chrono::hours(1), 64, [&](int64_t ts, json::json &&data)
+                                {
+                                    if (data.size() != 2 || !(data["temperature"] == points[n_paged]["temperature"]) || ts != 1700000000000 + static_cast<int64_t>(n_paged) * 1000 + static_cast<int64_t>(n_paged % 4) * 3)
+                                        ++n_mismatches;
+                                    ++n_paged;
+                                    ++n_page; });
+        if (n_page > 64 || (next && n_page != 64))
+        {
+            std::cerr << "Unexpected page size: " << n_page << std::endl;
+            return 1;
+        }
+    }
+    if (n_paged != points.size() || n_mismatches)
+    {
+        std::cerr << "Expected " << points.size() << " matching paged values, got " << n_paged - n_mismatches << std::endl;
+        return 1;
+    }
+
+    // aggregate the temperature in buckets of ten seconds, streaming the points from the store..
+    coco::aggregation agg;
+    agg.bucket = std::chrono::seconds(10);
+    agg.properties = {"temperature"};
+    for (auto fn : {coco::aggregate_fn::avg, coco::aggregate_fn::min, coco::aggregate_fn::max, coco::aggregate_fn::count, coco::aggregate_fn::first, coco::aggregate_fn::last, coco::aggregate_fn::percentile, coco::aggregate_fn::rate})
+    {
+        agg.fn = fn;
+        agg.percentile = 100;
+        coco::aggregator aggr(agg);
+        store.scan("sensor", agg.properties, start, start + std::chrono::hours(1), [&aggr](const std::string &name, int64_t ts, json::json &&v)
+                   { aggr.add(name, ts, v); });
+        auto buckets = aggr.get_result();
+        if (buckets.size() != 100)
+        {
+            std::cerr << "Expected 100 buckets, got " << buckets.size() << std::endl;
+            return 1;
+        }
+        for (size_t b = 0; b < buckets.size(); ++b)
+        {
+            double sum = 0, min = std::numeric_limits<double>::max(), max = std::numeric_limits<double>::lowest();
+            for (size_t i = b * 10; i < b * 10 + 10; ++i)
+            {
+                sum += points[i]["temperature"].get<double>();
+                min = std::min(min, points[i]["temperature"].get<double>());
+                max = std::max(max, points[i]["temperature"].get<double>());
+            }
+            const auto &first = points[b * 10]["temperature"], &last = points[b * 10 + 9]["temperature"];
+            // the first and the last points of a bucket are 9 seconds apart, each shifted by (i % 4) * 3 milliseconds..
+            const double rate = (last.get<double>() - first.get<double>()) * 1000.0 / (9 * 1000 + ((b * 10 + 9) % 4) * 3 - ((b * 10) % 4) * 3);
+            const auto &data = buckets[b]["data"];
+            if (data.size() != 1 || buckets[b]["timestamp"].get<int64_t>() != 1700000000000 + static_cast<int64_t>(b) * 10000 ||
+                (fn == coco::aggregate_fn::avg && std::abs(data["temperature"].get<double>() - sum / 10) > 1e-9) ||
+                (fn == coco::aggregate_fn::min && data["temperature"].get<double>() != min) ||
+                ((fn == coco::aggregate_fn::max || fn == coco::aggregate_fn::percentile) && data["temperature"].get<double>() != max) ||
+                (fn == coco::aggregate_fn::count && data["temperature"].get<int64_t>() != 10) ||
+                (fn == coco::aggregate_fn::first && !(data["temperature"] == first)) ||
+                (fn == coco::aggregate_fn::last && !(data["temperature"] == last)) ||
+                (fn == coco::aggregate_fn::rate && std::abs(data["temperature"].get<double>() - rate) > 1e-9))
+            {
+                std::cerr << "Aggregate mismatch at bucket " << b << ": " << buckets[b].dump() << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    // the percentiles interpolate between the closest ranks, here of an even number of samples..
+    coco::aggregation pct_agg;
+    pct_agg.fn = coco::aggregate_fn::percentile;
+    pct_agg.bucket = std::chrono::seconds(10);
+    for (const auto &[p, expected] : std::vector<std::pair<double, double>>{{50, 2.5}, {25, 1.75}, {0, 1}, {100, 4}})
+    {
+        pct_agg.percentile = p;
+        coco::aggregator pct(pct_agg);
+        for (const auto &[ts, v] : std::vector<std::pair<int64_t, double>>{{0, 4}, {1000, 1}, {2000, 3}, {3000, 2}})
+            pct.add("temperature", ts, v);
+        if (auto res = pct.get_result(); res.size() != 1 || res[0]["data"]["temperature"].get<double>() != expected)
+        {
+            std::cerr << "Unexpected percentile " << p << ": " << res.dump() << std::endl;
+            return 1;
+        }
+    }
+
+    // the empty buckets are skipped, and the points on a boundary start their bucket..
+    coco::aggregation gap_agg;
+    gap_agg.fn = coco::aggregate_fn::count;
+    gap_agg.bucket = std::chrono::seconds(10);
+    coco::aggregator gaps(gap_agg);
+    for (int64_t ts : {-1, 0, 9999, 10000, 35000})
+        gaps.add("temperature", ts, 1.0);
+    auto gap_buckets = gaps.get_result();
+    const std::vector<std::pair<int64_t, int64_t>> expected_gaps = {{-10000, 1}, {0, 2}, {10000, 1}, {30000, 1}};
+    bool gaps_match = gap_buckets.size() == expected_gaps.size();
+    for (size_t b = 0; gaps_match && b < expected_gaps.size(); ++b)
+        gaps_match = gap_buckets[b]["timestamp"].get<int64_t>() == expected_gaps[b].first && gap_buckets[b]["data"]["temperature"].get<int64_t>() == expected_gaps[b].second;
+    if (!gaps_match)
+    {
+        std::cerr << "Unexpected buckets with gaps: " << gap_buckets.dump() << std::endl;
+        return 1;
+    }
+
+    // the items are aggregated through CoCo, projecting on the requested dynamic properties..
+    coco::coco_db agg_db;
+    coco::coco cc(agg_db);
+    auto &tp = cc.create_type("thermometer", json::json(), json::json{{"temperature", {{"type", "float"}}}, {"humidity", {{"type", "float"}}}});
+    auto &itm = cc.create_item({tp});
+    for (int i = 0; i < 30; ++i)
+        cc.set_value(itm, {{"temperature", static_cast<double>(i)}, {"humidity", 50.0}}, start + std::chrono::seconds(i < 20 ? i : i + 10));
+    coco::aggregation itm_agg;
+    itm_agg.fn = coco::aggregate_fn::max;
+    itm_agg.bucket = std::chrono::seconds(10);
+    itm_agg.properties = {"temperature"};
+    auto itm_buckets = cc.get_values(itm, itm_agg, start, start + std::chrono::minutes(1));
+    if (itm_buckets.size() != 3 || itm_buckets[1]["data"].size() != 1 || itm_buckets[1]["data"]["temperature"].get<double>() != 19 || itm_buckets[2]["timestamp"].get<int64_t>() != 1700000000000 + 30000 || itm_buckets[2]["data"]["temperature"].get<double>() != 29)
+    {
+        std::cerr << "Unexpected aggregated item values: " << itm_buckets.dump() << std::endl;
+        return 1;
+    }
+    itm_agg.properties = {"pressure"};
+    try
+    {
+        [[maybe_unused]] auto unknown = cc.get_values(itm, itm_agg, start, start + std::chrono::minutes(1));
+        std::cerr << "Unknown dynamic property aggregated" << std::endl;
+        return 1;
+    }
+    catch (const std::invalid_argument &)
+    {
+    }
+
+    // keep the recent history of the temperature, both by count and by duration..
+    coco::ts_buffer by_count(100, std::chrono::milliseconds::zero(), 1700000000000), by_duration(10000, std::chrono::seconds(60), 1700000000000);
+    for (size_t i = 0; i < points.size(); ++i)
+    {
+        const auto ts = 1700000000000 + static_cast<int64_t>(i) * 1000 + static_cast<int64_t>(i % 4) * 3;
+        by_count.push(ts, points[i]["temperature"]);
+        by_duration.push(ts, points[i]["temperature"]);
+    }
+    by_duration.push(1700000000000, 0.0); // too old to be recorded..
+    if (by_count.size() != 100 || by_count.get_covered_since() != 1700000000000 + 899 * 1000 + 3 * 3 + 1 || by_duration.size() != 61 || by_duration.get_covered_since() != 1700000000000 + 938 * 1000 + 2 * 3 + 1)
+    {
+        std::cerr << "Unexpected recent history: " << by_count.size() << " values since " << by_count.get_covered_since() << ", " << by_duration.size() << " values since " << by_duration.get_covered_since() << std::endl;
+        return 1;
+    }
+    size_t n_recent = 0;
+    by_count.decode(1700000000000 + 950 * 1000, 1700000000000 + 959 * 1000 + 3 * 3, [&](int64_t, json::json &&v)
+                    { n_recent += v == points[950 + n_recent]["temperature"]; });
+    if (n_recent != 10)
+    {
+        std::cerr << "Expected 10 recent values, got " << n_recent << std::endl;
+        return 1;
+    }
+
+    // expire the points older than 500 seconds, in batches of 100 points..
+    const auto before = start + std::chrono::seconds(500);
+    const size_t n_expired = store.expired("sensor", before), n_points = store.size();
+    size_t n_removed = 0;
+    for (size_t removed = 100; removed >= 100;)
+        n_removed += removed = store.expire("sensor", before, 100);
+    if (n_expired == 0 || n_removed != n_expired || store.size() != n_points - n_removed || store.expired("sensor", before) != 0 || store.get_values("sensor", before, start + std::chrono::hours(1)).size() != 500)
+    {
+        std::cerr << "Unexpected expiration: " << n_removed << " points removed out of " << n_expired << std::endl;
+        return 1;
+    }
+
+    // archive a slowly varying, noisy, humidity with a swinging door of half a unit..
+    coco::ts_archive archive(coco::archive_policy{coco::archive_mode::swinging_door, 0.5});
+    std::normal_distribution<double> noise(0, 0.1);
+    std::vector<std::pair<int64_t, double>> humidity, archived;
+    for (int i = 0; i < 10000; ++i)
+    {
+        humidity.emplace_back(1700000000000 + static_cast<int64_t>(i) * 1000, 50 + 10 * std::sin(i / 500.0) + noise(gen));
+        archive.push(humidity.back().first, humidity.back().second, [&archived](int64_t ts, const json::json &v)
+                     { archived.emplace_back(ts, v.get<double>()); });
+    }
+    archive.flush([&archived](int64_t ts, const json::json &v)
+                  { archived.emplace_back(ts, v.get<double>()); });
+    double max_error = 0;
+    for (size_t i = 0, s = 0; i < humidity.size(); ++i)
+    { // reconstruct the series by linear interpolation between the archived points..
+        while (archived[s + 1].first < humidity[i].first)
+            ++s;
+        const auto &[t0, v0] = archived[s];
+        const auto &[t1, v1] = archived[s + 1];
+        max_error = std::max(max_error, std::abs(v0 + (v1 - v0) * (humidity[i].first - t0) / (t1 - t0) - humidity[i].second));
+    }
+    if (archived.front().first != humidity.front().first || archived.back().first != humidity.back().first || max_error > 0.5 + 1e-9 || archived.size() * 10 > humidity.size())
+    {
+        std::cerr << "Unexpected archive: " << archived.size() << " points out of " << humidity.size() << ", with a maximum error of " << max_error << std::endl;
+        return 1;
+    }
+
+    // a late point is archived as it is, while the held point stays held until flushed..
+    coco::ts_archive line(coco::archive_policy{coco::archive_mode::swinging_door, 0.5});
+    std::vector<std::pair<int64_t, double>> line_archived;
+    const auto on_line = [&line_archived](int64_t ts, const json::json &v)
+    { line_archived.emplace_back(ts, v.get<double>()); };
+    for (int64_t ts : {0, 1000, 2000})
+        line.push(ts, static_cast<double>(ts / 1000), on_line);
+    line.push(500, 100.0, on_line);
+    line.push(3000, 3.0, on_line); // still on the line through the anchor..
+    if (line_archived != std::vector<std::pair<int64_t, double>>{{0, 0.0}, {500, 100.0}})
+    {
+        std::cerr << "Unexpected archive of a late point: " << line_archived.size() << " points" << std::endl;
+        return 1;
+    }
+    line.flush(on_line);
+    if (line_archived.size() != 3 || line_archived.back() != std::pair<int64_t, double>{3000, 3.0})
+    {
+        std::cerr << "Unexpected flush of the held point: " << line_archived.size() << " points" << std::endl;
+        return 1;
+    }
+
+    // the database stores the held point before reading the values..
+    coco::coco_db db;
+    db.set_archive("sensor", {{"humidity", coco::archive_policy{coco::archive_mode::swinging_door, 0.5}}});
+    for (int i = 0; i < 10; ++i)
+        db.set_value("sensor", json::json{{"humidity", 50.0 + i}}, start + std::chrono::seconds(i));
+    auto db_values = db.get_values("sensor", start, start + std::chrono::minutes(1));
+    if (db_values.size() != 2 || db_values[1]["timestamp"].get<int64_t>() != 1700000009000 || db_values[1]["data"]["humidity"].get<double>() != 59.0)
+    {
+        std::cerr << "Unexpected archived values: " << db_values.dump() << std::endl;
+        return 1;
+    }
+
+    // deltas between the extreme integers do not fit in a signed integer, yet they round trip..
+    coco::ts_store extremes(64);
+    const std::vector<int64_t> ints = {std::numeric_limits<int64_t>::min(), std::numeric_limits<int64_t>::max(), -1, std::numeric_limits<int64_t>::min(), 0};
+    for (size_t i = 0; i < ints.size(); ++i)
+        extremes.append("counter", json::json{{"value", ints[i]}}, start + std::chrono::milliseconds(i));
+    auto ext_values = extremes.get_values("counter", start, start + std::chrono::seconds(1));
+    for (size_t i = 0; i < ints.size(); ++i)
+        if (ext_values.size() != ints.size() || ext_values[i]["data"]["value"].get<int64_t>() != ints[i])
+        {
+            std::cerr << "Extreme integer mismatch at " << i << ": " << ext_values.dump() << std::endl;
+            return 1;
+        }
+
+    // a bounded store keeps at least the given number of points, removing the oldest chunks beyond it..
+    coco::ts_store bounded(64, 200);
+    for (int i = 0; i < 1000; ++i)
+        bounded.append("sensor", json::json{{"temperature", points[i]["temperature"]}}, start + std::chrono::seconds(i));
+    auto bounded_values = bounded.get_values("sensor", start, start + std::chrono::hours(1));
+    if (bounded.size() < 200 || bounded.size() >= 200 + 64 || bounded_values.size() != bounded.size() || !(bounded_values[bounded_values.size() - 1]["data"]["temperature"] == points[999]["temperature"]))
+    {
+        std::cerr << "Unexpected bounded store: " << bounded.size() << " points" << std::endl;
+        return 1;
+    }
+
+    std::cout << store.size() << " points in " << store.bytes() << " bytes" << std::endl;
+    return 0;
+}
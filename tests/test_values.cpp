@@ -0,0 +1,204 @@
+#include "coco.hpp"
+#include "coco_db.hpp"
+#include "coco_type.hpp"
+#include "coco_item.hpp"
+#include <iostream>
+#if defined(BUILD_SERVER) && defined(BUILD_NOAUTH) && !defined(BUILD_SECURE)
+#include "coco_server.hpp"
+#include "client.hpp"
+#include <future>
+#include <thread>
+#endif
+
+int main([[maybe_unused]] int argc, [[maybe_unused]] char *argv[])
+{
+    coco::coco_db db;
+    coco::coco cc(db);
+
+    auto &tp = cc.create_type("sensor", json::json{{"room", {{"type", "symbol"}}}}, json::json{{"temperature", {{"type", "float"}}}, {"humidity", {{"type", "float"}}}});
+    auto &kitchen = cc.create_item({tp}, json::json{{"room", "kitchen"}});
+    auto &oven = cc.create_item({tp}, json::json{{"room", "kitchen"}});
+    auto &bedroom = cc.create_item({tp}, json::json{{"room", "bedroom"}});
+
+    const auto start = std::chrono::system_clock::time_point(std::chrono::milliseconds(1700000000000));
+    for (int i = 0; i < 10; ++i)
+    {
+        cc.set_value(kitchen, {{"temperature", 20.0 + i}, {"humidity", 40.0}}, start + std::chrono::seconds(i));
+        cc.set_value(oven, {{"temperature", 180.0 + i}}, start + std::chrono::seconds(i));
+        cc.set_value(bedroom, {{"temperature", 18.0 + i}, {"humidity", 50.0}}, start + std::chrono::seconds(i));
+    }
+
+    // the values of the listed items, projected on the temperature, are streamed grouped per item and in timestamp order..
+    std::map<std::string, std::vector<json::json>> values;
+    const auto collect = [&values](const std::string &itm_id, json::json &&row)
+    { values[itm_id].push_back(std::move(row)); };
+    cc.get_values({kitchen.get_id(), bedroom.get_id()}, {"temperature"}, start, start + std::chrono::minutes(1), collect);
+    if (values.size() != 2 || values[kitchen.get_id()].size() != 10 || values[bedroom.get_id()].size() != 10)
+    {
+        std::cerr << "Unexpected values of the listed items: " << values.size() << " items" << std::endl;
+        return 1;
+    }
+    for (int i = 0; i < 10; ++i)
+    {
+        const auto &row = values[kitchen.get_id()][i];
+        if (row["timestamp"].get<int64_t>() != 1700000000000 + i * 1000 || row["data"].size() != 1 || row["data"]["temperature"].get<double>() != 20.0 + i)
+        {
+            std::cerr << "Unexpected value of the kitchen sensor: " << row.dump() << std::endl;
+            return 1;
+        }
+    }
+
+    // the values of the instances of the type in the kitchen, with all their dynamic properties..
+    values.clear();
+    cc.get_values(tp, json::json{{"room", "kitchen"}}, {}, start + std::chrono::seconds(5), start + std::chrono::minutes(1), collect);
+    if (values.size() != 2 || !values.count(kitchen.get_id()) || !values.count(oven.get_id()) || values[kitchen.get_id()].size() != 5 || values[oven.get_id()].size() != 5 || values[kitchen.get_id()][0]["data"].size() != 2 || values[oven.get_id()][0]["data"]["temperature"].get<double>() != 185.0)
+    {
+        std::cerr << "Unexpected values of the kitchen sensors: " << values.size() << " items" << std::endl;
+        return 1;
+    }
+
+    // unknown items, fields and filter properties are rejected..
+    const std::vector<std::function<void()>> invalid = {[&]
+                                                        { cc.get_values({kitchen.get_id(), "missing"}, {}, start, start + std::chrono::minutes(1), collect); },
+                                                        [&]
+                                                        { cc.get_values({kitchen.get_id()}, {"pressure"}, start, start + std::chrono::minutes(1), collect); },
+                                                        [&]
+                                                        { cc.get_values(tp, json::json{{"floor", 1}}, {}, start, start + std::chrono::minutes(1), collect); }};
+    for (size_t i = 0; i < invalid.size(); ++i)
+        try
+        {
+            invalid[i]();
+            std::cerr << "Invalid request " << i << " accepted" << std::endl;
+            return 1;
+        }
+        catch (const std::invalid_argument &)
+        {
+        }
+
+    // backfilled values are stored as they are, without going through the archive of the temperature..
+    auto &meter = cc.create_type("meter", json::json(), json::json{{"temperature", {{"type", "float"}, {"archive", {{"deviation", 0.5}}}}}});
+    auto &boiler = cc.create_item({meter});
+    for (int i = 0; i < 5; ++i) // a straight line, of which the archive keeps the first point and holds the last one..
+        cc.set_value(boiler, {{"temperature", 20.0 + i}}, start + std::chrono::seconds(i));
+    std::vector<std::pair<json::json, std::chrono::system_clock::time_point>> series;
+    for (int i = 0; i < 3; ++i)
+    {
+        series.emplace_back(json::json{{"temperature", i == 1 ? 100.0 : 1.0}}, start - std::chrono::seconds(3 - i));
+        series.emplace_back(json::json{{"temperature", i == 1 ? 100.0 : 1.0}}, start + std::chrono::seconds(10 + i));
+    }
+    cc.backfill(boiler, std::move(series));
+    auto stored = db.get_values(boiler.get_id(), start - std::chrono::minutes(1), start + std::chrono::minutes(1));
+    if (stored.size() != 8 || stored[1]["data"]["temperature"].get<double>() != 100.0 || stored[4]["data"]["temperature"].get<double>() != 24.0 || stored[6]["data"]["temperature"].get<double>() != 100.0 || boiler.get_value()->first["temperature"].get<double>() != 1.0)
+    {
+        std::cerr << "Unexpected backfilled values: " << stored.dump() << std::endl;
+        return 1;
+    }
+
+    // an invalid series is rejected as a whole..
+    for (auto &invalid_series : std::vector<std::vector<std::pair<json::json, std::chrono::system_clock::time_point>>>{{{json::json{{"temperature", 30.0}}, start + std::chrono::seconds(20)}, {json::json{{"pressure", 1.0}}, start + std::chrono::seconds(21)}},
+                                                                                                                      {{json::json{{"temperature", "hot"}}, start + std::chrono::seconds(20)}}})
+        try
+        {
+            cc.backfill(boiler, std::move(invalid_series));
+            std::cerr << "Invalid series backfilled" << std::endl;
+            return 1;
+        }
+        catch (const std::invalid_argument &)
+        {
+        }
+    if (db.get_values(boiler.get_id(), start - std::chrono::minutes(1), start + std::chrono::minutes(1)).size() != 8)
+    {
+        std::cerr << "Part of an invalid series stored" << std::endl;
+        return 1;
+    }
+
+    // values older than the current one are handled according to the late policy of the type..
+    std::map<std::string, std::reference_wrapper<coco::item>> late_itms;
+    for (const std::string policy : {"apply", "store", "reject"})
+    {
+        auto &late_tp = cc.create_type(policy + "_sensor", json::json(), json::json{{"temperature", {{"type", "float"}}}}, json::json{{"late", policy}});
+        auto &late_itm = late_itms.emplace(policy, cc.create_item({late_tp})).first->second.get();
+        cc.set_value(late_itm, {{"temperature", 1.0}}, start + std::chrono::seconds(10));
+        cc.set_value(late_itm, {{"temperature", 2.0}}, start + std::chrono::seconds(5));
+    }
+    const auto current = [&late_itms](const std::string &policy)
+    { return late_itms.at(policy).get().get_value()->first["temperature"].get<double>(); };
+    const auto n_stored = [&db, &late_itms, &start](const std::string &policy)
+    { return db.get_values(late_itms.at(policy).get().get_id(), start, start + std::chrono::minutes(1)).size(); };
+    if (current("apply") != 2.0 || current("store") != 1.0 || current("reject") != 1.0 || n_stored("apply") != 2 || n_stored("store") != 2 || n_stored("reject") != 1)
+    {
+        std::cerr << "Unexpected handling of the late values" << std::endl;
+        return 1;
+    }
+    const auto late = cc.get_late_stats();
+    const auto stored_late = cc.get_late_stats(late_itms.at("store"));
+    if (late.applied != 1 || late.stored != 1 || late.rejected != 1 || stored_late.applied != 0 || stored_late.stored != 1 || stored_late.rejected != 0)
+    {
+        std::cerr << "Unexpected late value counters: " << late.applied << " applied, " << late.stored << " stored, " << late.rejected << " rejected" << std::endl;
+        return 1;
+    }
+    for (auto &invalid_data : {json::json{{"late", "later"}}, json::json{{"late", 1}}})
+        try
+        {
+            [[maybe_unused]] auto &invalid_tp = cc.create_type("invalid_sensor", json::json(), json::json(), json::json(invalid_data));
+            std::cerr << "Invalid late policy accepted: " << invalid_data.dump() << std::endl;
+            return 1;
+        }
+        catch (const std::invalid_argument &)
+        {
+        }
+
+    // the dynamic properties named `count` and `duration` keep their own recent history, given within `properties`..
+    auto &counter_tp = cc.create_type("counter", json::json(), json::json{{"count", {{"type", "int"}}}, {"duration", {{"type", "int"}}}}, json::json{{"history", {{"count", 2}, {"properties", {{"duration", {{"count", 3}}}}}}}});
+    auto &counter = cc.create_item({counter_tp});
+    const auto now = std::chrono::system_clock::now();
+    for (int i = 0; i < 5; ++i)
+        cc.set_value(counter, {{"count", i}, {"duration", i}}, now + std::chrono::seconds(i));
+    std::map<std::string, size_t> n_recent;
+    counter.get_history({}, now, now + std::chrono::minutes(1), [&n_recent](const std::string &name, int64_t, json::json &&)
+                        { ++n_recent[name]; });
+    if (n_recent["count"] != 2 || n_recent["duration"] != 3)
+    {
+        std::cerr << "Unexpected recent history of the counter: " << n_recent["count"] << " counts and " << n_recent["duration"] << " durations" << std::endl;
+        return 1;
+    }
+    for (auto &invalid_data : {json::json{{"history", {{"count", -1}}}}, json::json{{"history", {{"duration", -60}}}}, json::json{{"history", {{"count", "10"}}}}, json::json{{"history", 10}}, json::json{{"history", {{"temperature", {{"count", 10}}}}}}, json::json{{"history", {{"properties", {{"temperature", {{"count", -1}}}}}}}}, json::json{{"history", {{"properties", {{"temperature", {{"duration", 60}, {"properties", json::json(json::json_type::object)}}}}}}}}})
+        try
+        {
+            [[maybe_unused]] auto &invalid_tp = cc.create_type("invalid_sensor", json::json(), json::json{{"temperature", {{"type", "float"}}}}, json::json(invalid_data));
+            std::cerr << "Invalid history accepted: " << invalid_data.dump() << std::endl;
+            return 1;
+        }
+        catch (const std::invalid_argument &)
+        {
+        }
+
+#if defined(BUILD_SERVER) && defined(BUILD_NOAUTH) && !defined(BUILD_SECURE)
+    // the values of several items are queried through the REST API, the malformed bodies being rejected..
+    coco::coco_server srv(cc, "127.0.0.1", 8098);
+    auto srv_ft = std::async(std::launch::async, [&srv]
+                             { srv.start(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    network::client client("127.0.0.1", 8098);
+    const auto query = [&client](json::json &&body)
+    { return client.post("/data/query", std::move(body), {{"Content-Type", "application/json"}}); };
+    const auto from_ms = std::chrono::duration_cast<std::chrono::milliseconds>(start.time_since_epoch()).count();
+    auto res = query(json::json{{"items", std::vector<json::json>{kitchen.get_id(), bedroom.get_id()}}, {"fields", std::vector<json::json>{"temperature"}}, {"from", from_ms}, {"to", from_ms + 60000}});
+    if (!res || res->get_status_code() != network::status_code::ok || static_cast<network::json_response &>(*res).get_body()[kitchen.get_id()].size() != 10)
+    {
+        std::cerr << "Unexpected response to the REST query" << std::endl;
+        srv.stop();
+        return 1;
+    }
+    for (auto &invalid_body : {json::json{{"items", std::vector<json::json>{kitchen.get_id()}}, {"to", "x"}}, json::json{{"items", std::vector<json::json>{kitchen.get_id()}}, {"from", 1.5}}, json::json{{"items", json::json(json::json_type::object)}}, json::json{{"items", std::vector<json::json>{1}}}, json::json{{"items", std::vector<json::json>{kitchen.get_id()}}, {"fields", "temperature"}}, json::json{{"items", std::vector<json::json>{kitchen.get_id()}}, {"fields", std::vector<json::json>{1}}}, json::json{{"type", 1}}, json::json{{"type", "sensor"}, {"filter", std::vector<json::json>{}}}, json::json(std::vector<json::json>{})})
+        if (auto invalid_res = query(json::json(invalid_body)); !invalid_res || invalid_res->get_status_code() != network::status_code::bad_request)
+        {
+            std::cerr << "Malformed REST query not rejected: " << invalid_body.dump() << std::endl;
+            srv.stop();
+            return 1;
+        }
+    srv.stop();
+#endif
+
+    return 0;
+}
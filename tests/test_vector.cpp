@@ -0,0 +1,169 @@
+#include "coco.hpp"
+#include "coco_db.hpp"
+#include "coco_type.hpp"
+#include "coco_item.hpp"
+#include "coco_property.hpp"
+#include "coco_vector.hpp"
+#include "clips_eval.hpp"
+#include <cmath>
+#include <iostream>
+#include <limits>
+#if defined(BUILD_SERVER) && defined(BUILD_NOAUTH) && !defined(BUILD_SECURE)
+#include "coco_server.hpp"
+#include "client.hpp"
+#include <future>
+#include <thread>
+#endif
+
+int main([[maybe_unused]] int argc, [[maybe_unused]] char *argv[])
+{
+    // round-trip a vector through its compact form and run the kernels on it..
+    const auto spectrum = coco::vector_buffer::from_json(std::vector<json::json>{0, 3, 1, 4, 4, 2, -5, 9, 2, 6, 5, 3}, coco::vector_dtype::f32);
+    if (!spectrum || spectrum->size() != 12)
+    {
+        std::cerr << "Vector not decoded" << std::endl;
+        return 1;
+    }
+    const auto encoded = spectrum->to_json();
+    const auto decoded = coco::vector_buffer::from_json(encoded, coco::vector_dtype::f32);
+    if (!encoded.is_string() || !decoded || decoded->size() != 12 || (*decoded)[7] != 9 || (*decoded)[6] != -5)
+    {
+        std::cerr << "Vector not round-tripped through base64" << std::endl;
+        return 1;
+    }
+    if (!spectrum->within(-5, 9) || spectrum->within(-4, 9) || spectrum->within(-5, 8))
+    {
+        std::cerr << "Wrong vector bounds check" << std::endl;
+        return 1;
+    }
+    if (spectrum->norm(1) != 44 || spectrum->norm(std::numeric_limits<double>::infinity()) != 9 || std::abs(spectrum->norm() - std::sqrt(226.0)) > 1e-9 || spectrum->band_energy(6, 8) != 106 || spectrum->band_energy(10, 100) != 34)
+    {
+        std::cerr << "Wrong vector norms" << std::endl;
+        return 1;
+    }
+    if (spectrum->peaks(0) != std::vector<size_t>{1, 3, 7, 9} || spectrum->peaks(5) != std::vector<size_t>{7, 9})
+    {
+        std::cerr << "Wrong vector peaks" << std::endl;
+        return 1;
+    }
+    if (coco::vector_buffer::from_json(std::vector<json::json>{1, 40000}, coco::vector_dtype::i16) || coco::vector_buffer::from_json(std::vector<json::json>{1.5}, coco::vector_dtype::i16) || coco::vector_buffer::from_json("AAA", coco::vector_dtype::f64) || coco::vector_buffer::from_json("not base64!", coco::vector_dtype::f32))
+    {
+        std::cerr << "Invalid vector decoded" << std::endl;
+        return 1;
+    }
+
+    // the elements which are not finite, or would not be once converted, are rejected..
+    if (coco::vector_buffer::from_json(std::vector<json::json>{1, 1e39}, coco::vector_dtype::f32) || !coco::vector_buffer::from_json(std::vector<json::json>{1, 1e39}, coco::vector_dtype::f64) || coco::vector_buffer::from_json("AADAfw==", coco::vector_dtype::f32) || coco::vector_buffer::from_json("AACAfw==", coco::vector_dtype::f32))
+    {
+        std::cerr << "Non-finite vector decoded" << std::endl;
+        return 1;
+    }
+
+    // the shapes of the vector properties are checked when the types are created..
+    coco::coco_db db;
+    coco::coco cc(db);
+    for (auto &invalid_props : {json::json{{"v", {{"type", "vector"}, {"dtype", "f8"}}}}, json::json{{"v", {{"type", "vector"}, {"length", 5}, {"max_length", 3}}}}, json::json{{"v", {{"type", "vector"}, {"length", -1}}}}, json::json{{"v", {{"type", "vector"}, {"max_length", 2.5}}}}})
+        try
+        {
+            [[maybe_unused]] auto &invalid_tp = cc.create_type("invalid_sensor", json::json(), json::json(invalid_props));
+            std::cerr << "Invalid vector property accepted: " << invalid_props.dump() << std::endl;
+            return 1;
+        }
+        catch (const std::invalid_argument &)
+        {
+        }
+
+    // the vectors are validated against the shape and the bounds of their property..
+    auto &sensor = cc.create_type("sensor", json::json{{"profile", {{"type", "vector"}, {"dtype", "i16"}, {"max_length", 3}, {"nullable", true}}}}, json::json{{"spectrum", {{"type", "vector"}, {"dtype", "f32"}, {"length", 4}, {"min", -10}, {"max", 10}}}});
+    const auto &spectrum_prop = static_cast<const coco::vector_property &>(*sensor.get_dynamic_properties().at("spectrum"));
+    const json::json spectrum_val = std::vector<json::json>{1, 7, 2, 3};
+    if (!spectrum_prop.validate(spectrum_val) || spectrum_prop.validate(std::vector<json::json>{1, 7, 2}) || spectrum_prop.validate(std::vector<json::json>{1, 7, 2, 30}) || spectrum_prop.validate(std::vector<json::json>{1, 7, 2, 1e39}) || spectrum_prop.validate(json::json()))
+    {
+        std::cerr << "Unexpected validation of the vectors" << std::endl;
+        return 1;
+    }
+    // a vector is decoded once, its compact form sharing the decoded buffer..
+    const auto spectrum_buf = spectrum_prop.decode(spectrum_val);
+    const auto spectrum_compact = spectrum_prop.compact(spectrum_val);
+    if (!spectrum_buf || !spectrum_compact.is_string() || spectrum_prop.decode(spectrum_compact) != spectrum_buf || spectrum_prop.decode(spectrum_val) != spectrum_buf)
+    {
+        std::cerr << "Vector decoded more than once" << std::endl;
+        return 1;
+    }
+
+    // the static and the dynamic vectors are held in their compact form..
+    auto &s0 = cc.create_item({sensor}, json::json{{"profile", std::vector<json::json>{1, 2, 3}}});
+    cc.set_value(s0, json::json{{"spectrum", spectrum_val}});
+    const auto profile = s0.get_properties()["profile"];
+    const auto profile_buf = coco::vector_buffer::from_json(profile, coco::vector_dtype::i16);
+    if (!profile.is_string() || !profile_buf || profile_buf->size() != 3 || (*profile_buf)[2] != 3 || !(s0.get_value()->first["spectrum"] == spectrum_compact))
+    {
+        std::cerr << "Vectors not compacted: " << s0.get_properties().dump() << std::endl;
+        return 1;
+    }
+    cc.set_properties(s0, json::json{{"profile", std::vector<json::json>{4, 5}}});
+    if (!s0.get_properties()["profile"].is_string())
+    {
+        std::cerr << "Vector not compacted after a change of the properties" << std::endl;
+        return 1;
+    }
+
+    // the rules read the vectors through the vector-* functions..
+    auto &clips = cc.add_module<clips_eval>(cc);
+    const std::string vec = "(fact-slot-value (nth$ 1 (find-all-facts ((?s sensor)) TRUE)) spectrum)";
+    if (clips.eval("(vector-len " + vec + ")").integerValue->contents != 4 || clips.eval("(vector-nth " + vec + " 1)").floatValue->contents != 7 || clips.eval("(vector-norm " + vec + " 1)").floatValue->contents != 13 || clips.eval("(vector-norm " + vec + " inf)").floatValue->contents != 7 || clips.eval("(vector-band-energy " + vec + " 1 3)").floatValue->contents != 53)
+    {
+        std::cerr << "Unexpected vector functions" << std::endl;
+        return 1;
+    }
+    if (clips.eval("(length$ (vector-peaks " + vec + "))").integerValue->contents != 1 || clips.eval("(nth$ 1 (vector-peaks " + vec + "))").integerValue->contents != 1 || clips.eval("(length$ (vector-peaks " + vec + " 8))").integerValue->contents != 0)
+    {
+        std::cerr << "Unexpected vector peaks" << std::endl;
+        return 1;
+    }
+    for (const auto &invalid : {"(vector-nth " + vec + " 4)", "(vector-norm " + vec + " 0.5)", std::string("(vector-len (json-parse \"[1]\"))")})
+        try
+        {
+            [[maybe_unused]] auto res = clips.eval(invalid);
+            std::cerr << "Invalid expression evaluated: " << invalid << std::endl;
+            return 1;
+        }
+        catch (const std::invalid_argument &)
+        {
+        }
+
+#if defined(BUILD_SERVER) && defined(BUILD_NOAUTH) && !defined(BUILD_SECURE)
+    // the vectors sent through the REST API are served in their compact form..
+    coco::coco_server srv(cc, "127.0.0.1", 8097);
+    auto srv_ft = std::async(std::launch::async, [&srv]
+                             { srv.start(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    network::client client("127.0.0.1", 8097);
+    auto set_res = client.post("/data/" + s0.get_id(), json::json{{"spectrum", std::vector<json::json>{0, 1, 0, 2}}}, {{"Content-Type", "application/json"}});
+    auto get_res = client.get("/items/" + s0.get_id());
+    if (!set_res || set_res->get_status_code() != network::status_code::no_content || !get_res || get_res->get_status_code() != network::status_code::ok)
+    {
+        std::cerr << "Unexpected status of the vector requests" << std::endl;
+        srv.stop();
+        return 1;
+    }
+    const auto served = static_cast<network::json_response &>(*get_res).get_body()["value"]["data"]["spectrum"];
+    const auto served_buf = coco::vector_buffer::from_json(served, coco::vector_dtype::f32);
+    if (!served.is_string() || !served_buf || served_buf->size() != 4 || (*served_buf)[3] != 2)
+    {
+        std::cerr << "Unexpected vector from the REST API: " << served.dump() << std::endl;
+        srv.stop();
+        return 1;
+    }
+    auto invalid_tp_res = client.post("/types", json::json{{"name", "invalid_sensor"}, {"dynamic_properties", {{"v", {{"type", "vector"}, {"dtype", "f8"}}}}}}, {{"Content-Type", "application/json"}});
+    if (!invalid_tp_res || invalid_tp_res->get_status_code() != network::status_code::bad_request)
+    {
+        std::cerr << "Invalid vector property accepted through the REST API" << std::endl;
+        srv.stop();
+        return 1;
+    }
+    srv.stop();
+#endif
+
+    return 0;
+}